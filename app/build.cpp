@@ -11,11 +11,13 @@
 #include "build.hpp"
 
 #include <chrono>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <string>
 
 #include <entwine/builder/builder.hpp>
+#include <entwine/builder/overflow-tuner.hpp>
 #include <entwine/builder/thread-pools.hpp>
 #include <entwine/io/io.hpp>
 #include <entwine/types/bounds.hpp>
@@ -27,6 +29,8 @@
 #include <entwine/util/env.hpp>
 #include <entwine/util/json.hpp>
 #include <entwine/util/matrix.hpp>
+#include <entwine/util/memory.hpp>
+#include <entwine/util/scratch.hpp>
 
 namespace entwine
 {
@@ -71,10 +75,20 @@ void Build::addArgs()
     m_ap.add(
             "--dataType",
             "Data type for serialized point cloud data.  Valid values are "
-            "\"laszip\" or \"binary\".  Default: \"laszip\".\n"
+            "\"laszip\", \"binary\", \"zstandard\", or \"columnar\".  "
+            "Default: \"laszip\".\n"
             "Example: --dataType binary",
             [this](json j) { m_json["dataType"] = j; });
 
+    m_ap.add(
+            "--nodeOrder",
+            "Ordering of points within each data node.  Valid values are "
+            "\"none\", \"gpstime\", \"morton\", or \"hilbert\".  Default: "
+            "\"gpstime\" for laszip data with GpsTime, \"morton\" for columnar "
+            "data, otherwise \"none\".\n"
+            "Example: --nodeOrder morton",
+            [this](json j) { m_json["nodeOrder"] = j; });
+
     m_ap.add(
             "--span",
             "Number of voxels in each spatial dimension for data nodes.  "
@@ -124,6 +138,17 @@ void Build::addArgs()
             "Example: --scale 0.1, --scale \"[0.1, 0.1, 0.025]\"",
             [this](json j) { m_json["scale"] = extract(j); });
 
+    m_ap.add(
+            "--scaledResident",
+            "If present, points held in memory during the build are stored "
+            "with scaled integral coordinates rather than as doubles.  Has no "
+            "effect for absolute builds.",
+            [this](json j)
+            {
+                checkEmpty(j);
+                m_json["scaledResident"] = true;
+            });
+
     m_ap.add(
             "--run",
             "-g",
@@ -165,6 +190,40 @@ void Build::addArgs()
             "Threshold at which overflowed points are placed into child nodes",
             [this](json j) { m_json["overflowThreshold"] = extract(j); });
 
+    m_ap.add(
+            "--adaptiveOverflow",
+            "If present, overflow thresholds are adjusted per depth based on "
+            "the observed density of the data",
+            [this](json j)
+            {
+                checkEmpty(j);
+                m_json["adaptiveOverflow"] = true;
+            });
+
+    m_ap.add(
+            "--incremental",
+            "If present, continuing a build routes new points past existing "
+            "nodes which have already overflowed, rather than rewriting them",
+            [this](json j)
+            {
+                checkEmpty(j);
+                m_json["incremental"] = true;
+            });
+
+    m_ap.add(
+            "--sharedChunks",
+            "Number of chunks kept resident across all inputs, released "
+            "least recently used first.  Zero releases each chunk as soon as "
+            "the inputs using it are done with it.  Defaults to zero unless "
+            "--memoryLimit is set",
+            [this](json j) { m_json["sharedChunks"] = extract(j); });
+
+    m_ap.add(
+            "--memoryLimit",
+            "Tracked memory, in megabytes, beyond which shared chunks are "
+            "released until usage is back under it",
+            [this](json j) { m_json["memoryLimit"] = extract(j); });
+
     m_ap.add(
             "--hierarchyStep",
             "Hierarchy step size - recommended to be set for testing only as "
@@ -182,6 +241,13 @@ void Build::addArgs()
             "logging (default: 10).",
             [this](json j) { m_json["progressInterval"] = extract(j); });
 
+    m_ap.add(
+            "--trace",
+            "Path at which to write a Chrome trace of the build, viewable in "
+            "Perfetto or chrome://tracing.  Requires a WITH_TRACE build.\n"
+            "Example: --trace build-trace.json",
+            [this](json j) { m_json["trace"] = j.get<std::string>(); });
+
     addArbiter();
 }
 
@@ -230,6 +296,18 @@ void Build::run()
             "\tPoints discarded: " << commify(stats.outOfBounds()) << "\n" <<
             std::endl;
     }
+
+    const Scratch::Stats scratch(Scratch::stats());
+    if (scratch.taken)
+    {
+        std::cout << "\tScratch buffers: " << commify(scratch.taken) <<
+            " taken, " << std::round(scratch.reuseRate() * 100) <<
+            "% reused, peak " << commify(scratch.peak) << " bytes" <<
+            std::endl;
+    }
+
+    std::cout << builder->metadata().overflowTuner().summary();
+    std::cout << Memory::report();
 }
 
 void Build::log(const Builder& b) const
@@ -237,6 +315,11 @@ void Build::log(const Builder& b) const
     if (b.isContinuation())
     {
         std::cout << "\nContinuing previous index..." << std::endl;
+        if (b.metadata().incremental())
+        {
+            std::cout << "\tIncremental: overflowed nodes are sealed" <<
+                std::endl;
+        }
     }
 
     std::string outPath(b.outEndpoint().prefixedRoot());
@@ -296,6 +379,7 @@ void Build::log(const Builder& b) const
         "Output:\n" <<
         "\tPath: " << outPath << "\n" <<
         "\tData type: " << metadata.dataIo().type() << "\n" <<
+        "\tNode order: " << toString(metadata.nodeOrder()) << "\n" <<
         "\tHierarchy type: " << "json" << "\n" <<
         "\tSleep count: " << commify(b.sleepCount()) <<
         std::endl;
@@ -346,6 +430,7 @@ void Build::log(const Builder& b) const
             t << " * " << t << " * " << t << " = " << commify(t * t * t) <<
             "\n" <<
         "\tOverflow threshold: " << commify(metadata.overflowThreshold()) <<
+            (metadata.overflowTuner().adaptive() ? " (adaptive)" : "") <<
             "\n";
 
     if (const Subset* s = metadata.subset())
@@ -10,13 +10,28 @@
 
 #include "convert.hpp"
 
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
 #include <entwine/formats/cesium/tileset.hpp>
+#include <entwine/formats/copc/exporter.hpp>
 
 namespace entwine
 {
 namespace app
 {
 
+namespace
+{
+    bool isCopcPath(const std::string& path)
+    {
+        const std::string ext(".copc.laz");
+        return path.size() > ext.size() &&
+            path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+    }
+}
+
 void Convert::addArgs()
 {
     m_ap.setUsage("entwine convert <options>");
@@ -27,10 +42,29 @@ void Convert::addArgs()
             "Path to a completed entwine build",
             [this](json j) { m_json["input"] = j; });
 
-    addOutput("Path for Cesium 3D Tiles output");
+    addOutput(
+            "Path for Cesium 3D Tiles output, or a COPC file ending in "
+            "\".copc.laz\"");
     addTmp();
     addSimpleThreads();
 
+    m_ap.add(
+            "--format",
+            "-f",
+            "The output format, which is inferred from the output path if "
+            "omitted.\n"
+            "Valid values:\n"
+            "'cesium': Cesium 3D Tiles\n"
+            "'copc': a single Cloud Optimized Point Cloud LAZ file",
+            [this](json j) { m_json["format"] = j; });
+
+    m_ap.add(
+            "--hierarchyStep",
+            "For COPC output, the depth interval at which the hierarchy is "
+            "split into pages.  By default it is a single page.\n"
+            "Example: --hierarchyStep 6",
+            [this](json j) { m_json["hierarchyStep"] = extract(j); });
+
     m_ap.add(
             "--geometricErrorDivisor",
             "-g",
@@ -68,6 +102,17 @@ void Convert::addArgs()
 }
 
 void Convert::run()
+{
+    const std::string output(m_json.value("output", ""));
+    const std::string format(
+            m_json.value("format", isCopcPath(output) ? "copc" : "cesium"));
+
+    if (format == "copc") runCopc();
+    else if (format == "cesium") runCesium();
+    else throw std::runtime_error("Invalid convert format: " + format);
+}
+
+void Convert::runCesium()
 {
     cesium::Tileset tileset(m_json);
 
@@ -85,6 +130,39 @@ void Convert::run()
     std::cout << "\tDone." << std::endl;
 }
 
+void Convert::runCopc()
+{
+    copc::Exporter exporter(m_json);
+
+    std::cout << "Converting:" << std::endl;
+    std::cout << "\tInput:  " << exporter.in().prefixedRoot() << "\n";
+    std::cout << "\tOutput: " << exporter.output() << "\n";
+    std::cout << "\tPoint format: " << int(exporter.pointFormat()) << "\n";
+    std::cout << "\tThreads: " << exporter.threads() << "\n";
+
+    if (!exporter.dropped().empty())
+    {
+        std::cout << "\tDropped dimensions:";
+        for (const auto& name : exporter.dropped()) std::cout << " " << name;
+        std::cout << "\n";
+    }
+
+    std::cout << "Running..." << std::endl;
+    const copc::Exporter::Stats stats(exporter.go());
+    std::cout << "\tDone." << std::endl;
+
+    std::cout << "\tPoints: " << commify(stats.points) << "\n";
+    std::cout << "\tNodes: " << commify(stats.nodes) << "\n";
+    std::cout << "\tSize: " << commify(stats.bytes) << " bytes\n";
+    std::cout << "\tTime: " << stats.seconds << " seconds\n";
+    if (stats.seconds > 0)
+    {
+        std::cout << "\tSpeed: " <<
+            commify(std::llround(stats.points / stats.seconds)) <<
+            " points/s" << std::endl;
+    }
+}
+
 } // namespace app
 } // namespace entwine
 
@@ -22,6 +22,9 @@ class Convert : public App
 private:
     virtual void addArgs() override;
     virtual void run() override;
+
+    void runCesium();
+    void runCopc();
 };
 
 } // namespace app
@@ -11,7 +11,9 @@
 #include "build.hpp"
 #include "entwine.hpp"
 #include "convert.hpp"
+#include "generate.hpp"
 #include "merge.hpp"
+#include "remove.hpp"
 #include "scan.hpp"
 
 #include <csignal>
@@ -43,8 +45,12 @@ namespace
             t(3) + "Aggregate information about an unindexed dataset\n" +
             t(2) + "merge\n" +
             t(3) + "Merge colocated entwine subsets\n" +
+            t(2) + "remove\n" +
+            t(3) + "Remove points from an EPT dataset by origin or region\n" +
             t(2) + "convert\n" +
-            t(3) + "Convert an entwine dataset to a different format\n";
+            t(3) + "Convert an entwine dataset to a different format\n" +
+            t(2) + "generate\n" +
+            t(3) + "Generate deterministic synthetic point cloud data\n";
     }
 
     std::mutex mutex;
@@ -316,10 +322,18 @@ int main(int argc, char** argv)
         {
             entwine::app::Merge().go(args);
         }
+        else if (app == "remove")
+        {
+            entwine::app::Remove().go(args);
+        }
         else if (app == "convert")
         {
             entwine::app::Convert().go(args);
         }
+        else if (app == "generate")
+        {
+            entwine::app::Generate().go(args);
+        }
         else
         {
             if (app != "help" && app != "-h" && app != "--help")
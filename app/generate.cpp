@@ -0,0 +1,186 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include "generate.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <entwine/builder/synthetic.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/pool.hpp>
+
+namespace entwine
+{
+namespace app
+{
+
+void Generate::addArgs()
+{
+    m_ap.setUsage("entwine generate (<output>) (<options>)");
+
+    addOutput(
+            "Path of a LAS or LAZ file to write.  If multiple files are "
+            "requested, this is a directory in which 0.laz, 1.laz, ... are "
+            "written, each containing an equal range of the points.  If "
+            "omitted, nothing is written - the printed synthetic path may "
+            "be used as an input to `entwine build` directly\n"
+            "Example: --output synthetic.laz, -o synthetic/ --files 16",
+            true);
+
+    m_ap.add(
+            "--distribution",
+            "-d",
+            "The distribution of the generated points, defaulting to "
+            "'terrain'.\n"
+            "Valid values:\n"
+            "'uniform': uniformly random throughout the bounds\n"
+            "'urban': dense clusters of buildings over sparse ground\n"
+            "'terrain': a 2.5D surface with vegetation and structures\n"
+            "'pathological': duplicates, edges, lines, and tiny clusters",
+            [this](json j) { m_json["distribution"] = j; });
+
+    m_ap.add(
+            "--points",
+            "-n",
+            "The number of points to generate, defaulting to one million\n"
+            "Example: --points 1000000000",
+            [this](json j) { m_json["points"] = extract(j); });
+
+    m_ap.add(
+            "--seed",
+            "-s",
+            "Seed for the generator.  Identical options produce identical "
+            "points\n"
+            "Example: --seed 7",
+            [this](json j) { m_json["seed"] = extract(j); });
+
+    m_ap.add(
+            "--bounds",
+            "-b",
+            "XYZ bounds of the generated points, defaulting to "
+            "[0, 0, 0, 1000, 1000, 100].  "
+            "Format is [xmin, ymin, zmin, xmax, ymax, zmax].\n"
+            "Example: --bounds 0 0 0 100 100 100, -b \"[0,0,0,100,100,100]\"",
+            [this](json j)
+            {
+                if (j.is_string())
+                {
+                    m_json["bounds"] = json::parse(j.get<std::string>());
+                }
+                else if (j.is_array())
+                {
+                    for (json& coord : j)
+                    {
+                        coord = std::stod(coord.get<std::string>());
+                    }
+                    m_json["bounds"] = j;
+                }
+            });
+
+    m_ap.add(
+            "--scale",
+            "The scale factor for XYZ, defaulting to 0.01\n"
+            "Example: --scale 0.001",
+            [this](json j)
+            {
+                m_json["scale"] = std::stod(j.get<std::string>());
+            });
+
+    m_ap.add(
+            "--dims",
+            "Dimensions to generate in addition to XYZ, defaulting to all of "
+            "Intensity, ReturnNumber, NumberOfReturns, Classification, "
+            "GpsTime, Red, Green, and Blue\n"
+            "Example: --dims Intensity Classification",
+            [this](json j)
+            {
+                if (j.is_string()) j = json::array({ j });
+                m_json["dims"] = j;
+            });
+
+    m_ap.add(
+            "--files",
+            "-f",
+            "The number of files to write\n"
+            "Example: --files 16",
+            [this](json j) { m_json["files"] = extract(j); });
+
+    addSimpleThreads();
+}
+
+void Generate::run()
+{
+    const Synthetic synthetic(m_json);
+
+    std::cout << "Generating:" << std::endl;
+    std::cout << "\tDistribution: " <<
+        Synthetic::toString(synthetic.distribution()) << std::endl;
+    std::cout << "\tPoints: " << commify(synthetic.points()) << std::endl;
+    std::cout << "\tSeed: " << synthetic.seed() << std::endl;
+    std::cout << "\tBounds: " << synthetic.bounds() << std::endl;
+    std::cout << "\tSchema: " << getDimensionString(synthetic.schema()) <<
+        std::endl;
+    std::cout << "\tPath: " << synthetic.path() << std::endl;
+
+    const std::string output(m_json.value("output", ""));
+    if (output.empty())
+    {
+        std::cout << std::endl;
+        return;
+    }
+
+    const uint64_t files(std::max<uint64_t>(m_json.value("files", 1), 1));
+    const uint64_t threads(m_json.value("threads", 8));
+
+    const std::string ext(arbiter::Arbiter::getExtension(output));
+    if (files == 1 && (ext == "las" || ext == "laz"))
+    {
+        std::cout << "\tOutput: " << output << "\n" << std::endl;
+        synthetic.write(output);
+        std::cout << "Done." << std::endl;
+        return;
+    }
+
+    std::string dir(output);
+    if (dir.back() != '/') dir += '/';
+    if (!arbiter::mkdirp(dir))
+    {
+        throw std::runtime_error("Could not create directory: " + dir);
+    }
+
+    std::cout << "\tOutput: " << dir << " (" << files << " files)" << "\n" <<
+        std::endl;
+
+    const uint64_t np(synthetic.points());
+
+    Pool pool(threads);
+    for (uint64_t i(0); i < files; ++i)
+    {
+        const uint64_t begin(np * i / files);
+        const uint64_t end(np * (i + 1) / files);
+        const std::string path(dir + std::to_string(i) + ".laz");
+
+        pool.add([&synthetic, path, begin, end]()
+        {
+            if (begin < end) synthetic.write(path, begin, end);
+            std::cout << "\tWrote " << path << std::endl;
+        });
+    }
+
+    pool.join();
+    std::cout << "Done." << std::endl;
+}
+
+} // namespace app
+} // namespace entwine
+
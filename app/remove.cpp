@@ -0,0 +1,109 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include "remove.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <string>
+
+#include <entwine/builder/config.hpp>
+#include <entwine/builder/remover.hpp>
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+namespace app
+{
+
+void Remove::addArgs()
+{
+    m_ap.setUsage("entwine remove <output> (<options>)");
+
+    addOutput("Path of an existing build from which to remove points", true);
+    addConfig();
+
+    m_ap.add(
+            "--origins",
+            "-r",
+            "Origins whose points are removed, each either an OriginId or "
+            "a path, or part of a path, matching an input file\n"
+            "Example: --origins 3 7, -r tile-04.laz",
+            [this](json j)
+            {
+                if (j.is_string()) j = json::array({ j });
+                for (const json& entry : j)
+                {
+                    const std::string s(entry.get<std::string>());
+                    const bool id(
+                            !s.empty() &&
+                            std::all_of(s.begin(), s.end(), [](char c)
+                            {
+                                return std::isdigit(c);
+                            }));
+
+                    if (id) m_json["origins"].push_back(std::stoull(s));
+                    else m_json["origins"].push_back(s);
+                }
+            });
+
+    m_ap.add(
+            "--region",
+            "-b",
+            "Bounds within which points are removed.  If origins are also "
+            "given, only their points within these bounds are removed.  "
+            "Format is [xmin, ymin, zmin, xmax, ymax, zmax].\n"
+            "Example: --region 0 0 0 100 100 100, -b \"[0,0,0,100,100,100]\"",
+            [this](json j)
+            {
+                if (j.is_string())
+                {
+                    m_json["region"] = json::parse(j.get<std::string>());
+                }
+                else if (j.is_array())
+                {
+                    for (json& coord : j)
+                    {
+                        coord = std::stod(coord.get<std::string>());
+                    }
+                    m_json["region"] = j;
+                }
+            });
+
+    m_ap.add(
+            "--replace",
+            "If present, the removed origins are marked for insertion again, "
+            "so continuing the build with `entwine build -o <output>` "
+            "reinserts them from their paths",
+            [this](json j)
+            {
+                checkEmpty(j);
+                m_json["replace"] = true;
+            });
+
+    addSimpleThreads();
+    addArbiter();
+}
+
+void Remove::run()
+{
+    m_json["verbose"] = true;
+
+    Config config(m_json);
+    Remover remover(config);
+    std::cout << "Removing from " << config.output() << "..." << std::endl;
+    remover.go();
+    std::cout << "Removed " << commify(remover.removed()) << " points, " <<
+        "rewrote " << commify(remover.rewritten()) << " nodes." << std::endl;
+}
+
+} // namespace app
+} // namespace entwine
@@ -0,0 +1,293 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include "bench.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/defs.hpp>
+
+namespace entwine
+{
+namespace bench
+{
+
+namespace
+{
+    volatile uint64_t sink(0);
+
+    // Reads a "Key:   <n> kB" line from /proc/self/status, if available.
+    uint64_t procStatus(const std::string& key)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, key.size() + 1, key + ":") == 0)
+            {
+                std::istringstream ss(line.substr(key.size() + 1));
+                uint64_t kb(0);
+                ss >> kb;
+                return kb * 1024;
+            }
+        }
+        return 0;
+    }
+
+    double median(std::vector<double> v)
+    {
+        std::sort(v.begin(), v.end());
+        const std::size_t n(v.size());
+        return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+    }
+}
+
+void keep(const uint64_t v)
+{
+    sink = sink + v;
+}
+
+uint64_t peakRss()
+{
+    if (const uint64_t hwm = procStatus("VmHWM")) return hwm;
+
+#ifndef _WIN32
+    struct rusage usage;
+    if (!getrusage(RUSAGE_SELF, &usage))
+    {
+#ifdef __APPLE__
+        return usage.ru_maxrss;
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+
+    return 0;
+}
+
+void resetPeakRss()
+{
+    // Linux resets VmHWM to the current RSS when "5" is written here.
+    std::ofstream clear("/proc/self/clear_refs");
+    if (clear.good()) clear << "5";
+}
+
+void Suite::add(
+        const std::string& group,
+        const std::string& name,
+        Run run,
+        const std::size_t runs)
+{
+    const std::size_t n(std::max<std::size_t>(runs, 1));
+    m_entries.push_back(Entry { group, name, run, n });
+}
+
+json Suite::go() const
+{
+    json results(json::array());
+
+    for (const Entry& entry : m_entries)
+    {
+        const std::string id(entry.group + "/" + entry.name);
+        if (id.find(m_options.filter) == std::string::npos) continue;
+
+        std::cout << std::left << std::setw(32) << id << std::flush;
+
+        resetPeakRss();
+        if (entry.group == "micro") entry.run();
+
+        std::vector<double> seconds;
+        Sample sample;
+        for (std::size_t i(0); i < entry.runs; ++i)
+        {
+            sample = entry.run();
+            seconds.push_back(sample.seconds);
+        }
+
+        const double mid(median(seconds));
+        const double mean(
+                std::accumulate(seconds.begin(), seconds.end(), 0.0) /
+                seconds.size());
+        const double pps(mid > 0 ? sample.points / mid : 0);
+        const double mbps(mid > 0 ? sample.bytes / mid / 1024 / 1024 : 0);
+        const uint64_t rss(peakRss());
+
+        std::cout <<
+            std::right << std::fixed << std::setprecision(3) <<
+            std::setw(10) << mid * 1000 << " ms" <<
+            std::setw(10) << pps / 1000000 << " Mpt/s" <<
+            std::setw(10) << mbps << " MB/s" <<
+            std::setw(8) << rss / 1024 / 1024 << " MB peak" <<
+            std::endl;
+
+        results.push_back(json {
+            { "group", entry.group },
+            { "name", entry.name },
+            { "runs", seconds.size() },
+            { "seconds", {
+                { "min", *std::min_element(seconds.begin(), seconds.end()) },
+                { "median", mid },
+                { "mean", mean },
+                { "max", *std::max_element(seconds.begin(), seconds.end()) }
+            } },
+            { "points", sample.points },
+            { "bytes", sample.bytes },
+            { "pointsPerSecond", pps },
+            { "mbPerSecond", mbps },
+            { "peakRss", rss }
+        });
+    }
+
+    return results;
+}
+
+} // namespace bench
+} // namespace entwine
+
+using namespace entwine;
+
+namespace
+{
+    std::string utcNow()
+    {
+        const std::time_t t(std::time(nullptr));
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&t));
+        return buf;
+    }
+
+    void usage()
+    {
+        std::cout <<
+            "Usage: entwine-bench (<options>)\n"
+            "\t--output <path>: Write JSON results here, otherwise stdout\n"
+            "\t--tmp <dir>: Working directory for generated data\n"
+            "\t--runs <n>: Timed runs per microbenchmark (default 5)\n"
+            "\t--macro-runs <n>: Timed runs per macro-benchmark (default 1)\n"
+            "\t--points <n>: Macro-benchmark dataset size (default 2000000)\n"
+            "\t--files <n>: Macro-benchmark file count (default 4)\n"
+            "\t--threads <n>: Threads for builds and merges (default 8)\n"
+            "\t--filter <s>: Run only benchmarks whose group/name contains s\n"
+            << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bench::Options options;
+    std::string output;
+
+    try
+    {
+        for (int i(1); i < argc; ++i)
+        {
+            const std::string flag(argv[i]);
+            if (flag == "-h" || flag == "--help")
+            {
+                usage();
+                return 0;
+            }
+
+            if (i + 1 >= argc) throw std::runtime_error("Missing value");
+            const std::string value(argv[++i]);
+
+            if (flag == "--output") output = value;
+            else if (flag == "--tmp") options.tmp = value;
+            else if (flag == "--runs") options.runs = std::stoull(value);
+            else if (flag == "--macro-runs")
+            {
+                options.macroRuns = std::stoull(value);
+            }
+            else if (flag == "--points") options.points = std::stoull(value);
+            else if (flag == "--files") options.files = std::stoull(value);
+            else if (flag == "--threads") options.threads = std::stoull(value);
+            else if (flag == "--filter") options.filter = value;
+            else throw std::runtime_error("Invalid argument: " + flag);
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cout << e.what() << std::endl;
+        usage();
+        return 1;
+    }
+
+    if (options.tmp.empty())
+    {
+        options.tmp = arbiter::getTempPath() + "entwine-bench";
+    }
+    options.tmp = arbiter::expandTilde(options.tmp);
+    if (options.tmp.back() != '/') options.tmp += '/';
+
+    if (!arbiter::mkdirp(options.tmp))
+    {
+        std::cout << "Could not create " << options.tmp << std::endl;
+        return 1;
+    }
+
+    bench::Suite suite(options);
+    bench::addMicro(suite, options);
+    bench::addMacro(suite, options);
+
+    json results;
+
+    try
+    {
+        results = suite.go();
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    const json summary {
+        { "version", currentEntwineVersion().toString() },
+        { "date", utcNow() },
+        { "hardwareThreads", std::thread::hardware_concurrency() },
+        { "options", {
+            { "runs", options.runs },
+            { "macroRuns", options.macroRuns },
+            { "points", options.points },
+            { "files", options.files },
+            { "threads", options.threads }
+        } },
+        { "results", results }
+    };
+
+    if (output.empty()) std::cout << summary.dump(2) << std::endl;
+    else
+    {
+        std::ofstream file(output);
+        file << summary.dump(2) << std::endl;
+        if (!file.good())
+        {
+            std::cout << "Could not write " << output << std::endl;
+            return 1;
+        }
+        std::cout << "Results written to " << output << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+namespace bench
+{
+
+struct Options
+{
+    // Working directory for generated data and outputs.
+    std::string tmp;
+
+    // Timed runs per benchmark, after one untimed warm-up run for the
+    // microbenchmarks.  Macro-benchmarks are not warmed up.
+    std::size_t runs = 5;
+    std::size_t macroRuns = 1;
+
+    // Size of the generated macro-benchmark dataset.
+    uint64_t points = 2000000;
+    uint64_t files = 4;
+
+    uint64_t threads = 8;
+
+    // Only benchmarks whose "group/name" contains this string are run.
+    std::string filter;
+};
+
+// The result of one run.  Only the timed section of a run counts toward its
+// seconds, so setup and teardown may happen within the run itself.  Points
+// and bytes are the work done, from which throughput is derived.
+struct Sample
+{
+    double seconds = 0;
+    uint64_t points = 0;
+    uint64_t bytes = 0;
+};
+
+using Run = std::function<Sample()>;
+
+class Suite
+{
+public:
+    Suite(const Options& options) : m_options(options) { }
+
+    void add(
+            const std::string& group,
+            const std::string& name,
+            Run run,
+            std::size_t runs);
+
+    // Run every selected benchmark in the order added.  Returns an array of
+    // results.
+    json go() const;
+
+private:
+    struct Entry
+    {
+        std::string group;
+        std::string name;
+        Run run;
+        std::size_t runs;
+    };
+
+    const Options& m_options;
+    std::vector<Entry> m_entries;
+};
+
+// Seconds taken by f().
+template<typename F>
+double time(F f)
+{
+    const auto start(std::chrono::steady_clock::now());
+    f();
+    const std::chrono::duration<double> d(
+            std::chrono::steady_clock::now() - start);
+    return d.count();
+}
+
+// Fold a value into a sink the optimizer cannot see through, so the work
+// producing it is not elided.
+void keep(uint64_t v);
+
+// Peak resident set size of this process in bytes, and a best-effort reset
+// of it so each benchmark reports its own peak.  Where the peak cannot be
+// reset, it is the peak of the process so far.
+uint64_t peakRss();
+void resetPeakRss();
+
+void addMicro(Suite& suite, const Options& options);
+void addMacro(Suite& suite, const Options& options);
+
+} // namespace bench
+} // namespace entwine
@@ -0,0 +1,308 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include "bench.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/builder/config.hpp>
+#include <entwine/builder/merger.hpp>
+#include <entwine/builder/synthetic.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+namespace bench
+{
+
+namespace
+{
+    // Depth of the bundled variants, so the deepest few levels of the
+    // generated dataset are bundled.
+    const uint64_t bundleDepth(3);
+
+    // Generated input, shared by all macro-benchmarks and written the first
+    // time any of them runs.  The dataset is tiled into square files laid out
+    // along a row, so files overlap as little as real surveys do.
+    class Dataset
+    {
+    public:
+        Dataset(const Options& o)
+            : m_options(o)
+            , m_input(o.tmp + "input/")
+            , m_output(o.tmp + "output/")
+            , m_bundled(o.tmp + "output-bundled/")
+        { }
+
+        const std::string& input()
+        {
+            if (!m_generated) generate();
+            return m_input;
+        }
+
+        const std::string& output(bool bundled = false) const
+        {
+            return bundled ? m_bundled : m_output;
+        }
+        const Options& options() const { return m_options; }
+
+        uint64_t points() const { return m_options.points; }
+        uint64_t bytes() const { return m_bytes; }
+
+        Config config(const std::string& output, bool bundled = false)
+        {
+            return config(output, json::object(), bundled);
+        }
+
+        Config config(
+                const std::string& output,
+                const json& options,
+                bool bundled = false)
+        {
+            return Config(merge(json {
+                { "input", input() },
+                { "output", output },
+                { "force", true },
+                { "threads", m_options.threads },
+                { "verbose", false },
+                { "bundleDepth", bundled ? bundleDepth : 0 }
+            }, options));
+        }
+
+    private:
+        void generate()
+        {
+            arbiter::Arbiter a;
+            arbiter::mkdirp(m_input);
+
+            const uint64_t files(std::max<uint64_t>(m_options.files, 1));
+            const uint64_t each(m_options.points / files);
+
+            m_bytes = 0;
+            for (uint64_t i(0); i < files; ++i)
+            {
+                const uint64_t np(
+                        i + 1 < files ?
+                            each : m_options.points - each * (files - 1));
+
+                const Bounds b(i * 1000, 0, 0, (i + 1) * 1000, 1000, 100);
+                const std::string path(
+                        m_input + std::to_string(i) + ".las");
+
+                Synthetic(json {
+                    { "points", np },
+                    { "seed", i },
+                    { "bounds", b }
+                }).write(path);
+                m_bytes += a.getSize(path);
+            }
+
+            m_generated = true;
+        }
+
+        const Options& m_options;
+        const std::string m_input;
+        const std::string m_output;
+        const std::string m_bundled;
+
+        bool m_generated = false;
+        uint64_t m_bytes = 0;
+    };
+
+    void ensureBuilt(Dataset& d, bool bundled = false)
+    {
+        arbiter::Arbiter a;
+        if (a.exists(d.output(bundled) + "ept.json")) return;
+        Builder(d.config(d.output(bundled), bundled)).go();
+    }
+
+    std::string variant(const std::string& name, bool bundled)
+    {
+        return bundled ? name + "-bundled" : name;
+    }
+
+    // Reads of the full dataset for each node order, which trades data size
+    // and decompression speed.  The bytes of each sample are the size of the
+    // node data, so its output compares both.
+    void addNodeOrder(Suite& suite, std::shared_ptr<Dataset> d)
+    {
+        const std::vector<std::string> orders {
+            "none", "gpstime", "morton", "hilbert"
+        };
+
+        for (const std::string dataType : { "laszip", "zstandard" })
+        {
+            for (const std::string& order : orders)
+            {
+                const std::string name(
+                        "node-order-" + dataType + "-" + order);
+
+                suite.add("macro", name, [d, dataType, order, name]()
+                {
+                    const std::string out(d->options().tmp + name + "/");
+
+                    arbiter::Arbiter a;
+                    if (!a.exists(out + "ept.json"))
+                    {
+                        Builder(d->config(out, json {
+                            { "dataType", dataType },
+                            { "nodeOrder", order }
+                        })).go();
+                    }
+
+                    Sample s;
+                    for (const auto& path : a.resolve(out + "ept-data/*"))
+                    {
+                        s.bytes += a.getSize(path);
+                    }
+
+                    Reader reader(out);
+                    s.seconds = time([&]()
+                    {
+                        auto q(reader.read(json::object()));
+                        q->run();
+                        s.points = q->points();
+                    });
+                    return s;
+                }, d->options().macroRuns);
+            }
+        }
+    }
+}
+
+void addMacro(Suite& suite, const Options& o)
+{
+    auto d(std::make_shared<Dataset>(o));
+    const std::size_t runs(o.macroRuns);
+
+    // Build and read both with and without bundling of deep nodes.
+    for (const bool bundled : { false, true })
+    {
+        suite.add("macro", variant("build", bundled), [d, bundled]()
+        {
+            // Generate outside of the timed section.
+            d->input();
+
+            Sample s;
+            s.points = d->points();
+            s.bytes = d->bytes();
+            s.seconds = time([&]()
+            {
+                Builder(d->config(d->output(bundled), bundled)).go();
+            });
+            return s;
+        }, runs);
+    }
+
+    suite.add("macro", "merge", [d]()
+    {
+        const std::string out(d->options().tmp + "merge/");
+        const uint64_t of(4);
+
+        for (uint64_t i(0); i < of; ++i)
+        {
+            Config c(d->config(out));
+            c.setSubsetId(i + 1);
+            c.setSubsetOf(of);
+            Builder(c).go();
+        }
+
+        Sample s;
+        s.points = d->points();
+        s.seconds = time([&]()
+        {
+            Merger(Config(json {
+                { "output", out },
+                { "threads", d->options().threads },
+                { "verbose", false }
+            })).go();
+        });
+        return s;
+    }, runs);
+
+    suite.add("macro", "open", [d]()
+    {
+        ensureBuilt(*d);
+
+        Sample s;
+        s.seconds = time([&]()
+        {
+            Reader reader(d->output());
+            keep(reader.hierarchy().keys().size());
+        });
+        return s;
+    }, runs);
+
+    for (const bool bundled : { false, true })
+    {
+        suite.add("macro", variant("query", bundled), [d, bundled]()
+        {
+            ensureBuilt(*d, bundled);
+            Reader reader(d->output(bundled));
+
+            Sample s;
+            s.seconds = time([&]()
+            {
+                auto q(reader.read(json::object()));
+                q->run();
+                s.points = q->points();
+                s.bytes = q->data().size();
+            });
+            return s;
+        }, runs);
+
+        // Many small box queries against one reader, as a tile server would
+        // see.
+        suite.add("macro", variant("query-boxes", bundled), [d, bundled]()
+        {
+            ensureBuilt(*d, bundled);
+            Reader reader(d->output(bundled));
+            const Bounds& b(reader.metadata().boundsConforming());
+
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<double> fx(0, 0.9);
+            std::uniform_real_distribution<double> fy(0, 0.9);
+
+            Sample s;
+            s.seconds = time([&]()
+            {
+                for (std::size_t i(0); i < 64; ++i)
+                {
+                    const Point mn(
+                            b.min().x + fx(gen) * b.width(),
+                            b.min().y + fy(gen) * b.depth(),
+                            b.min().z);
+                    const Point mx(
+                            mn.x + b.width() / 10,
+                            mn.y + b.depth() / 10,
+                            b.max().z);
+
+                    auto q(reader.read(json { { "bounds", Bounds(mn, mx) } }));
+                    q->run();
+                    s.points += q->points();
+                    s.bytes += q->data().size();
+                }
+            });
+            return s;
+        }, runs);
+    }
+
+    addNodeOrder(suite, d);
+}
+
+} // namespace bench
+} // namespace entwine
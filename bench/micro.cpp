@@ -0,0 +1,435 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include "bench.hpp"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <entwine/builder/clipper.hpp>
+#include <entwine/builder/config.hpp>
+#include <entwine/builder/registry.hpp>
+#include <entwine/builder/synthetic.hpp>
+#include <entwine/builder/thread-pools.hpp>
+#include <entwine/io/io.hpp>
+#include <entwine/reader/filter.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/key.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/scale-offset.hpp>
+#include <entwine/types/vector-point-table.hpp>
+#include <entwine/types/voxel.hpp>
+
+namespace entwine
+{
+namespace bench
+{
+
+namespace
+{
+    const Synthetic synthetic;
+
+    // A typical node size.
+    const uint64_t nodePoints(100000);
+
+    // For benchmarks of per-point operations.
+    const uint64_t manyPoints(1000000);
+
+    std::shared_ptr<Metadata> makeMetadata(const std::string& dataType)
+    {
+        return std::make_shared<Metadata>(Config(json {
+            { "bounds", synthetic.bounds() },
+            { "schema", synthetic.schema() },
+            { "dataType", dataType },
+            { "span", 128 }
+        }));
+    }
+
+    // Synthetic points in the resident layout of a build.
+    class Points
+    {
+    public:
+        Points(const Metadata& m, const uint64_t size)
+            : m_block(m.residentSchema().pointSize(), size)
+            , m_table(m.residentSchema())
+        {
+            for (uint64_t i(0); i < size; ++i) m_block.next();
+            m_table.insert(m_block);
+
+            pdal::PointRef pr(m_table, 0);
+            for (uint64_t i(0); i < size; ++i)
+            {
+                pr.setPointId(i);
+                synthetic.fill(pr, i);
+            }
+        }
+
+        BlockPointTable& table() { return m_table; }
+
+    private:
+        MemBlock m_block;
+        BlockPointTable m_table;
+    };
+
+    void addKey(Suite& suite, const Options& o)
+    {
+        auto m(makeMetadata("binary"));
+
+        auto points(std::make_shared<std::vector<Point>>());
+        const Bounds& b(m->boundsConforming());
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> dx(b.min().x, b.max().x);
+        std::uniform_real_distribution<double> dy(b.min().y, b.max().y);
+        std::uniform_real_distribution<double> dz(b.min().z, b.max().z);
+        for (uint64_t i(0); i < manyPoints; ++i)
+        {
+            points->emplace_back(dx(gen), dy(gen), dz(gen));
+        }
+
+        for (const uint64_t depth : { 0, 6 })
+        {
+            suite.add(
+                    "micro",
+                    "key-init-depth-" + std::to_string(depth),
+                    [m, points, depth]()
+            {
+                Key key(*m);
+                uint64_t sum(0);
+
+                Sample s;
+                s.points = points->size();
+                s.seconds = time([&]()
+                {
+                    for (const Point& p : *points)
+                    {
+                        key.init(p, depth);
+                        sum += key.position().x;
+                    }
+                });
+
+                keep(sum);
+                return s;
+            }, o.runs);
+
+            // The per-level bisection which Key::init replaces, where its
+            // direct location applies.
+            suite.add(
+                    "micro",
+                    "key-bisect-depth-" + std::to_string(depth),
+                    [m, points, depth]()
+            {
+                Key key(*m);
+                const uint64_t levels(m->startDepth() + depth);
+                uint64_t sum(0);
+
+                Sample s;
+                s.points = points->size();
+                s.seconds = time([&]()
+                {
+                    for (const Point& p : *points)
+                    {
+                        key.reset();
+                        for (uint64_t d(0); d < levels; ++d) key.step(p);
+                        sum += key.position().x;
+                    }
+                });
+
+                keep(sum);
+                return s;
+            }, o.runs);
+        }
+
+        // Descending through the tree as an insertion does, on the integer
+        // grid and by bisection of the double bounds.
+        const uint64_t descent(8);
+        auto cells(std::make_shared<std::vector<Xyz>>());
+        {
+            const Key key(*m);
+            for (const Point& p : *points) cells->push_back(key.cell(p));
+        }
+
+        suite.add("micro", "key-step-grid", [m, points, cells, descent]()
+        {
+            Key key(*m);
+            uint64_t sum(0);
+
+            Sample s;
+            s.points = points->size();
+            s.seconds = time([&]()
+            {
+                for (std::size_t i(0); i < points->size(); ++i)
+                {
+                    const Point& p((*points)[i]);
+                    const Xyz& c((*cells)[i]);
+                    key.init(p, c);
+                    for (uint64_t d(0); d < descent; ++d) key.step(p, c);
+                    sum += key.position().x;
+                }
+            });
+
+            keep(sum);
+            return s;
+        }, o.runs);
+
+        suite.add("micro", "key-step-bisect", [m, points, descent]()
+        {
+            Key key(*m);
+            uint64_t sum(0);
+
+            Sample s;
+            s.points = points->size();
+            s.seconds = time([&]()
+            {
+                for (const Point& p : *points)
+                {
+                    key.init(p);
+                    for (uint64_t d(0); d < descent; ++d) key.step(p);
+                    sum += key.position().x;
+                }
+            });
+
+            keep(sum);
+            return s;
+        }, o.runs);
+
+        // The voxel winner comparison, between each point and one halfway
+        // from it to the middle of its cell.
+        struct Pair
+        {
+            Pair(const Key& key, const Point& a, const Point& b)
+                : key(key), a(a), ac(key.cell(a)), b(b), bc(key.cell(b))
+                , mid(key.bounds().mid())
+            { }
+
+            Key key;
+            Point a;
+            Xyz ac;
+            Point b;
+            Xyz bc;
+            Point mid;
+        };
+
+        auto pairs(std::make_shared<std::vector<Pair>>());
+        {
+            Key key(*m);
+            for (const Point& p : *points)
+            {
+                key.init(p, descent);
+                const Point mid(key.bounds().mid());
+                const Point half(
+                        (p.x + mid.x) / 2,
+                        (p.y + mid.y) / 2,
+                        (p.z + mid.z) / 2);
+                pairs->emplace_back(key, p, half);
+            }
+        }
+
+        suite.add("micro", "voxel-nearer-grid", [pairs]()
+        {
+            uint64_t sum(0);
+
+            Sample s;
+            s.points = pairs->size();
+            s.seconds = time([&]()
+            {
+                for (const Pair& p : *pairs)
+                {
+                    sum += p.key.nearer(p.a, p.ac, p.b, p.bc);
+                }
+            });
+
+            keep(sum);
+            return s;
+        }, o.runs);
+
+        suite.add("micro", "voxel-nearer-double", [pairs]()
+        {
+            uint64_t sum(0);
+
+            Sample s;
+            s.points = pairs->size();
+            s.seconds = time([&]()
+            {
+                for (const Pair& p : *pairs)
+                {
+                    sum += p.a.sqDist3d(p.mid) < p.b.sqDist3d(p.mid);
+                }
+            });
+
+            keep(sum);
+            return s;
+        }, o.runs);
+    }
+
+    void addChunk(Suite& suite, const Options& o)
+    {
+        auto m(makeMetadata("binary"));
+        auto points(std::make_shared<Points>(*m, manyPoints));
+        const std::string dir(o.tmp + "chunk-insert/");
+        const uint64_t threads(o.threads);
+
+        suite.add("micro", "chunk-insert", [m, points, dir, threads]()
+        {
+            arbiter::Arbiter a;
+            const arbiter::Endpoint out(a.getEndpoint(dir));
+            arbiter::mkdirp(out.getSubEndpoint("ept-data").root());
+            arbiter::mkdirp(out.getSubEndpoint("ept-hierarchy").root());
+
+            ThreadPools pools(threads, false);
+            Registry registry(*m, out, out, pools);
+
+            std::unique_ptr<ScaleOffset> so(m->outSchema().scaleOffset());
+            BlockPointTable& table(points->table());
+
+            Sample s;
+            s.points = table.size();
+            s.bytes = table.size() * m->residentSchema().pointSize();
+
+            {
+                // Chunks are serialized as this clipper goes out of scope,
+                // which is not timed.
+                Clipper clipper(registry, 0);
+
+                s.seconds = time([&]()
+                {
+                    Key key(*m);
+                    Voxel voxel;
+                    pdal::PointRef pr(table, 0);
+
+                    for (uint64_t i(0); i < table.size(); ++i)
+                    {
+                        pr.setPointId(i);
+                        voxel.initShallow(pr, table.getPoint(i));
+                        if (so) voxel.clip(*so);
+
+                        voxel.locate(key);
+                        key.init(voxel.point(), voxel.cell());
+                        registry.addPoint(voxel, key, clipper);
+                    }
+                });
+            }
+
+            pools.join();
+            return s;
+        }, o.runs);
+    }
+
+    // The binary write and read are dominated by its pack and unpack.
+    void addCodecs(Suite& suite, const Options& o)
+    {
+        for (const std::string type :
+                { "binary", "zstandard", "laszip", "columnar" })
+        {
+            auto m(makeMetadata(type));
+            auto points(std::make_shared<Points>(*m, nodePoints));
+            const std::string dir(o.tmp + "codec/" + type + "/");
+            arbiter::mkdirp(dir);
+
+            const std::string filename("0-0-0-0");
+            const uint64_t pointSize(m->schema().pointSize());
+
+            suite.add("micro", type + "-write", [=]()
+            {
+                arbiter::Arbiter a;
+                const arbiter::Endpoint out(a.getEndpoint(dir));
+
+                Sample s;
+                s.points = points->table().size();
+                s.bytes = s.points * pointSize;
+                s.seconds = time([&]()
+                {
+                    m->dataIo().write(
+                            out,
+                            out,
+                            filename,
+                            m->boundsCubic(),
+                            points->table());
+                });
+                return s;
+            }, o.runs);
+
+            suite.add("micro", type + "-read", [=]()
+            {
+                arbiter::Arbiter a;
+                const arbiter::Endpoint out(a.getEndpoint(dir));
+
+                // Write our own input, so this may run alone.
+                m->dataIo().write(
+                        out,
+                        out,
+                        filename,
+                        m->boundsCubic(),
+                        points->table());
+
+                VectorPointTable table(m->schema());
+                uint64_t np(0);
+                table.setProcess([&table, &np]() { np += table.numPoints(); });
+
+                Sample s;
+                s.seconds = time([&]()
+                {
+                    m->dataIo().read(out, out, filename, table);
+                });
+                s.points = np;
+                s.bytes = np * pointSize;
+                return s;
+            }, o.runs);
+        }
+    }
+
+    void addFilter(Suite& suite, const Options& o)
+    {
+        auto m(makeMetadata("binary"));
+        auto points(std::make_shared<Points>(*m, manyPoints));
+        auto filter(std::make_shared<Filter>(
+                    *m,
+                    m->boundsCubic(),
+                    json {
+                        { "Classification", {
+                            { "$in", json::array({ 2, 6 }) }
+                        } },
+                        { "Intensity", { { "$gt", 100 } } }
+                    }));
+
+        suite.add("micro", "filter-check", [m, points, filter]()
+        {
+            BlockPointTable& table(points->table());
+            pdal::PointRef pr(table, 0);
+            uint64_t passed(0);
+
+            Sample s;
+            s.points = table.size();
+            s.seconds = time([&]()
+            {
+                for (uint64_t i(0); i < table.size(); ++i)
+                {
+                    pr.setPointId(i);
+                    if (filter->check(pr)) ++passed;
+                }
+            });
+
+            keep(passed);
+            return s;
+        }, o.runs);
+    }
+}
+
+void addMicro(Suite& suite, const Options& o)
+{
+    addKey(suite, o);
+    addChunk(suite, o);
+    addCodecs(suite, o);
+    addFilter(suite, o);
+}
+
+} // namespace bench
+} // namespace entwine
@@ -0,0 +1,5 @@
+option(WITH_LOCK_STATS "Choose if Entwine should count lock contention" FALSE)
+if (WITH_LOCK_STATS)
+    message("Configuring with lock contention statistics")
+    set(LOCK_STATS_DEFS ENTWINE_LOCK_STATS)
+endif()
@@ -0,0 +1,12 @@
+find_package(LAZPERF CONFIG QUIET)
+
+if (LAZPERF_FOUND)
+    message("Using lazperf for COPC export")
+    set(LAZPERF_LIBRARIES LAZPERF::lazperf)
+    get_target_property(LAZPERF_INCLUDE_DIRS ${LAZPERF_LIBRARIES}
+        INTERFACE_INCLUDE_DIRECTORIES)
+    set(ENTWINE_LAZPERF TRUE)
+    set(LAZPERF_DEFS ENTWINE_LAZPERF)
+else()
+    message("lazperf NOT found - COPC export will be unavailable")
+endif()
@@ -0,0 +1,19 @@
+find_package(PROJ 6.1 CONFIG QUIET)
+if (NOT PROJ_FOUND)
+    # PROJ 6 installs its package configuration as PROJ4.
+    find_package(PROJ4 6.1 CONFIG QUIET)
+    if (PROJ4_FOUND)
+        set(PROJ_FOUND TRUE)
+        set(PROJ_LIBRARIES ${PROJ4_LIBRARIES})
+    endif()
+endif()
+
+if (PROJ_FOUND)
+    message("Using PROJ for native reprojection")
+    get_target_property(PROJ_INCLUDE_DIRS ${PROJ_LIBRARIES}
+        INTERFACE_INCLUDE_DIRECTORIES)
+    set(ENTWINE_PROJ TRUE)
+    set(PROJ_DEFS ENTWINE_PROJ)
+else()
+    message("PROJ NOT found - reprojection will be performed by PDAL")
+endif()
@@ -18,7 +18,11 @@ function(compiler_options target)
         PRIVATE
             ${CURL_DEFS}
             ${OPENSSL_DEFS}
+            ${PROJ_DEFS}
+            ${LAZPERF_DEFS}
 			${BACKTRACE_DEFS}
+            ${TRACE_DEFS}
+            ${LOCK_STATS_DEFS}
     )
     target_include_directories(${target}
         PRIVATE
@@ -27,6 +31,8 @@ function(compiler_options target)
             ${PDAL_INCLUDE_DIRS}
             ${CURL_INCLUDE_DIR}
             ${OPENSSL_INCLUDE_DIR}
+            ${PROJ_INCLUDE_DIRS}
+            ${LAZPERF_INCLUDE_DIRS}
             ${LASZIP_DIRECTORIES}
 			${JSONCPP_INCLUDE_DIR}
     )
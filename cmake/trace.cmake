@@ -0,0 +1,5 @@
+option(WITH_TRACE "Choose if Entwine should record hot-path trace spans" FALSE)
+if (WITH_TRACE)
+    message("Configuring with trace spans")
+    set(TRACE_DEFS ENTWINE_TRACE)
+endif()
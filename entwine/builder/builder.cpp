@@ -20,19 +20,27 @@
 #include <entwine/builder/heuristics.hpp>
 #include <entwine/builder/registry.hpp>
 #include <entwine/builder/sequence.hpp>
+#include <entwine/builder/synthetic.hpp>
 #include <entwine/builder/thread-pools.hpp>
+#include <entwine/reader/snapshot.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/file-info.hpp>
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/reprojection.hpp>
+#include <entwine/types/rescaler.hpp>
 #include <entwine/types/scale-offset.hpp>
 #include <entwine/types/schema.hpp>
 #include <entwine/types/subset.hpp>
 #include <entwine/types/vector-point-table.hpp>
+#include <entwine/util/contention.hpp>
 #include <entwine/util/executor.hpp>
 #include <entwine/util/json.hpp>
+#include <entwine/util/las-reader.hpp>
+#include <entwine/util/memory.hpp>
 #include <entwine/util/pool.hpp>
+#include <entwine/util/reprojector.hpp>
+#include <entwine/util/trace.hpp>
 #include <entwine/util/unique.hpp>
 
 namespace entwine
@@ -42,6 +50,21 @@ namespace
 {
     const std::size_t inputRetryLimit(16);
     std::size_t reawakened(0);
+
+    // Accounts for a downloaded input for as long as it is in use.
+    class TmpUsage
+    {
+    public:
+        TmpUsage(uint64_t bytes) : m_bytes(bytes)
+        {
+            Memory::add(Memory::Category::Tmp, m_bytes);
+        }
+
+        ~TmpUsage() { Memory::sub(Memory::Category::Tmp, m_bytes); }
+
+    private:
+        const uint64_t m_bytes;
+    };
 }
 
 Builder::Builder(const Config& config, std::shared_ptr<arbiter::Arbiter> a)
@@ -66,7 +89,9 @@ Builder::Builder(const Config& config, std::shared_ptr<arbiter::Arbiter> a)
                 *m_out,
                 *m_tmp,
                 *m_threadPools,
-                m_isContinuation))
+                m_isContinuation,
+                m_config.sharedChunks(),
+                m_config.memoryLimit()))
     , m_sequence(makeUnique<Sequence>(*m_metadata, m_mutex))
     , m_verbose(m_config.verbose())
     , m_start(now())
@@ -84,6 +109,21 @@ void Builder::go(std::size_t max)
     m_start = now();
     m_reset = m_start;
 
+    const std::string trace(m_config.trace());
+    if (trace.size())
+    {
+        if (!Trace::compiled())
+        {
+            throw std::runtime_error(
+                    "Tracing requires entwine to be built WITH_TRACE");
+        }
+
+        Trace::start();
+        Trace::name("build");
+    }
+
+    if (Contention::compiled()) Contention::reset();
+
     bool done(false);
     const auto& files(m_metadata->files());
 
@@ -137,6 +177,8 @@ void Builder::go(std::size_t max)
                         " W: " << info.written <<
                         " R: " << info.read <<
                         " A: " << commify(info.alive) <<
+                        " M: " << commify(Memory::total().live >> 20) <<
+                            "MB" <<
                         std::endl;
                 }
 
@@ -146,6 +188,18 @@ void Builder::go(std::size_t max)
     });
 
     p.join();
+
+    if (verbose() && Contention::compiled())
+    {
+        std::cout << Contention::report() << std::endl;
+    }
+
+    if (trace.size())
+    {
+        Trace::stop();
+        m_arbiter->put(trace, Trace::toJson().dump());
+        if (verbose()) std::cout << "Wrote trace: " << trace << std::endl;
+    }
 }
 
 void Builder::cycle()
@@ -232,51 +286,28 @@ void Builder::doRun(const std::size_t max)
 
 void Builder::insertPath(const Origin originId, FileInfo& info)
 {
-    const std::string rawPath(info.path());
-    std::size_t tries(0);
-    std::unique_ptr<arbiter::LocalHandle> localHandle;
-
-    do
-    {
-        if (tries) std::this_thread::sleep_for(std::chrono::seconds(tries));
-
-        try
-        {
-            localHandle = m_arbiter->getLocalHandle(rawPath, *m_tmp);
-        }
-        catch (const std::exception& e)
-        {
-            if (verbose())
-            {
-                std::cout <<
-                    "Failed GET " << tries << " of " << rawPath << ": " <<
-                    e.what() << std::endl;
-            }
-        }
-        catch (...)
-        {
-            if (verbose())
-            {
-                std::cout <<
-                    "Failed GET " << tries << " of " << rawPath << ": " <<
-                    "unknown error" << std::endl;
-            }
-        }
-    }
-    while (!localHandle && ++tries < inputRetryLimit);
-
-    if (!localHandle) throw std::runtime_error("No local handle: " + rawPath);
-
-    const std::string& localPath(localHandle->localPath());
+    ENTWINE_TRACE_SPAN("insert-file", "build");
 
+    const std::string rawPath(info.path());
     uint64_t inserted(0);
     uint64_t pointId(0);
 
     Clipper clipper(*m_registry, originId);
 
+    // With native reprojection, each batch is reprojected here from the SRS
+    // of the pipeline's output, which is known once the pipeline is prepared.
+    const bool native(
+            !Synthetic::isSynthetic(rawPath) && m_config.nativeReprojection());
+    const std::string outSrs(native ? m_config.reprojection()->out() : "");
+    std::string inSrs;
+
     VectorPointTable table(m_metadata->schema());
-    table.setProcess([this, &table, &clipper, &inserted, &pointId, &originId]()
+    table.setProcess([
+            this, &table, &clipper, &inserted, &pointId, &originId,
+            native, &inSrs, &outSrs]()
     {
+        ENTWINE_TRACE_SPAN("insert-batch", "build");
+        if (native) Reprojector::transform(table, inSrs, outSrs);
         inserted += table.numPoints();
 
         if (inserted > m_sleepCount)
@@ -287,6 +318,16 @@ void Builder::insertPath(const Origin originId, FileInfo& info)
 
         std::unique_ptr<ScaleOffset> so(m_metadata->outSchema().scaleOffset());
 
+        // For scaled-resident builds, each point is rescaled into this buffer
+        // before insertion - the registry copies it out before we move on.
+        std::unique_ptr<Rescaler> rescaler;
+        std::vector<char> resident;
+        if (m_metadata->scaledResident())
+        {
+            rescaler = makeUnique<Rescaler>(m_metadata->outSchema(), *so);
+            resident.resize(m_metadata->outSchema().pointSize());
+        }
+
         Voxel voxel;
 
         PointStats pointStats;
@@ -310,7 +351,14 @@ void Builder::insertPath(const Origin originId, FileInfo& info)
             {
                 if (!boundsSubset || boundsSubset->contains(point))
                 {
-                    key.init(point);
+                    if (rescaler)
+                    {
+                        rescaler->scale(pr, resident.data());
+                        voxel.setData(resident.data());
+                    }
+
+                    voxel.locate(key);
+                    key.init(point, voxel.cell());
                     m_registry->addPoint(voxel, key, clipper);
                     pointStats.addInsert();
                 }
@@ -324,9 +372,75 @@ void Builder::insertPath(const Origin originId, FileInfo& info)
         }
     });
 
-    const json pipeline(m_config.pipeline(localPath));
+    if (Synthetic::isSynthetic(rawPath))
+    {
+        Synthetic::fromPath(rawPath).run(table);
+        return;
+    }
+
+    std::size_t tries(0);
+    std::unique_ptr<arbiter::LocalHandle> localHandle;
+
+    do
+    {
+        if (tries) std::this_thread::sleep_for(std::chrono::seconds(tries));
+
+        try
+        {
+            ENTWINE_TRACE_SPAN("fetch-file", "io");
+            localHandle = m_arbiter->getLocalHandle(rawPath, *m_tmp);
+        }
+        catch (const std::exception& e)
+        {
+            if (verbose())
+            {
+                std::cout <<
+                    "Failed GET " << tries << " of " << rawPath << ": " <<
+                    e.what() << std::endl;
+            }
+        }
+        catch (...)
+        {
+            if (verbose())
+            {
+                std::cout <<
+                    "Failed GET " << tries << " of " << rawPath << ": " <<
+                    "unknown error" << std::endl;
+            }
+        }
+    }
+    while (!localHandle && ++tries < inputRetryLimit);
+
+    if (!localHandle) throw std::runtime_error("No local handle: " + rawPath);
+
+    const std::string& localPath(localHandle->localPath());
+
+    uint64_t tmpBytes(0);
+    if (m_arbiter->isRemote(rawPath))
+    {
+        if (const auto size = m_arbiter->tryGetSize(localPath))
+        {
+            tmpBytes = *size;
+        }
+    }
+    const TmpUsage tmpUsage(tmpBytes);
+
+    const json pipeline(m_config.pipeline(localPath, native));
+
+    // Uncompressed LAS may be decoded without PDAL.  We don't read SRSes from
+    // LAS headers though, so with reprojection the input SRS must be forced.
+    std::unique_ptr<LasReader> las;
+    if (!native || m_config.reprojection()->hammer())
+    {
+        las = LasReader::create(pipeline, m_metadata->schema());
+    }
 
-    if (!Executor::get().run(table, pipeline))
+    if (las)
+    {
+        if (native) inSrs = m_config.reprojection()->in();
+        las->run(table);
+    }
+    else if (!Executor::get().run(table, pipeline, &inSrs))
     {
         throw std::runtime_error("Failed to execute: " + rawPath);
     }
@@ -344,11 +458,27 @@ void Builder::save(const std::string to)
 
 void Builder::save(const arbiter::Endpoint& ep)
 {
+    ENTWINE_TRACE_SPAN("save", "build");
+
+    // Once no more points are coming, chunks kept resident for other inputs
+    // may be released.
+    m_threadPools->workPool().join();
+    m_registry->residency().clear();
     m_threadPools->join();
     m_threadPools->workPool().resize(m_threadPools->size());
     m_threadPools->go();
 
-    if (verbose()) std::cout << "Reawakened: " << reawakened << std::endl;
+    if (verbose())
+    {
+        std::cout << "Reawakened: " << reawakened << std::endl;
+        if (m_registry->residency().enabled())
+        {
+            std::cout << "Shared chunks evicted: " <<
+                commify(m_registry->residency().stats().evicted) << std::endl;
+        }
+    }
+
+    m_metadata->overflowTuner().tally(m_registry->hierarchy());
 
     if (!m_metadata->subset())
     {
@@ -367,6 +497,18 @@ void Builder::save(const arbiter::Endpoint& ep)
 
     if (verbose()) std::cout << "Saving metadata..." << std::endl;
     m_metadata->save(*m_out, m_config);
+
+    // Subsets are snapshotted once merged.
+    if (!m_metadata->subset())
+    {
+        if (verbose()) std::cout << "Saving snapshot..." << std::endl;
+        Snapshot::save(
+                *m_out,
+                m_metadata->eptJson(),
+                m_metadata->buildJson(),
+                m_metadata->files().list(),
+                m_registry->hierarchy().map());
+    }
 }
 
 void Builder::merge(Builder& other, Clipper& clipper)
@@ -57,6 +57,7 @@ class Builder
 {
     friend class Clipper;
     friend class Merger;
+    friend class Remover;
     friend class Sequence;
 
 public:
@@ -10,25 +10,32 @@
 
 #include <entwine/builder/chunk.hpp>
 
+#include <algorithm>
+
+#include <entwine/builder/registry.hpp>
 #include <entwine/io/io.hpp>
+#include <entwine/types/node-order.hpp>
+#include <entwine/util/trace.hpp>
 
 namespace entwine
 {
 
 namespace
 {
-    SpinLock spin;
+    SpinLock spin { "chunk-info" };
     ReffedChunk::Info info;
 }
 
 ReffedChunk::ReffedChunk(
         const ChunkKey& key,
         const arbiter::Endpoint& out,
+        BundleStage& bundles,
         const arbiter::Endpoint& tmp,
         Hierarchy& hierarchy)
     : m_key(key)
     , m_metadata(m_key.metadata())
     , m_out(out)
+    , m_bundles(bundles)
     , m_tmp(tmp)
     , m_hierarchy(hierarchy)
 {
@@ -40,6 +47,7 @@ ReffedChunk::ReffedChunk(const ReffedChunk& o)
     : ReffedChunk(
             o.key(),
             o.out(),
+            o.bundles(),
             o.tmp(),
             o.hierarchy())
 {
@@ -56,7 +64,11 @@ ReffedChunk::~ReffedChunk()
 
 bool ReffedChunk::insert(Voxel& voxel, Key& key, Clipper& clipper)
 {
-    if (clipper.insert(*this)) ref(clipper);
+    if (clipper.insert(*this))
+    {
+        ref(clipper);
+        clipper.registry().residency().touch(*this);
+    }
     return m_chunk->insert(voxel, key, clipper);
 }
 
@@ -65,43 +77,68 @@ void ReffedChunk::ref(Clipper& clipper)
     const Origin o(clipper.origin());
     SpinGuard lock(m_spin);
 
-    if (m_refs.count(o))
+    const auto it(findRef(o));
+    if (it != m_refs.end())
     {
-        ++m_refs[o];
+        ++it->second;
         return;
     }
 
-    m_refs[o] = 1;
+    m_refs.emplace_back(o, 1);
 
     if (m_chunk && !m_chunk->remote()) return;
 
-    if (!m_chunk) m_chunk = makeUnique<Chunk>(*this);
-    if (m_chunk->remote()) m_chunk->init();
+    ENTWINE_TRACE_SPAN("chunk-ref", "chunk");
 
     const uint64_t np = m_hierarchy.get(m_key.get());
-    if (!np) return;
+    const bool sealed(np && sealable());
+
+    if (!m_chunk) m_chunk = makeUnique<Chunk>(*this, sealed);
+    else if (m_chunk->remote()) m_chunk->init(sealed);
+
+    if (!np || sealed) return;
 
     {
         SpinGuard lock(spin);
         ++info.read;
     }
 
-    VectorPointTable table(m_metadata.schema(), np);
+    VectorPointTable table(m_metadata.residentSchema(), np);
     table.setProcess([this, &table, &clipper]()
     {
         Voxel voxel;
         Key pk(m_metadata);
 
+        std::unique_ptr<ScaleOffset> so;
+        if (m_metadata.scaledResident())
+        {
+            so = m_metadata.outSchema().scaleOffset();
+        }
+
         for (auto it(table.begin()); it != table.end(); ++it)
         {
             voxel.initShallow(it.pointRef(), it.data());
-            pk.init(voxel.point(), m_key.depth());
+            if (so) voxel.unscale(*so);
+            voxel.locate(pk);
+            pk.init(voxel.point(), voxel.cell(), m_key.depth());
             insert(voxel, pk, clipper);
         }
     });
 
     const auto filename(m_key.toString() + m_metadata.postfix(m_key.depth()));
-    m_metadata.dataIo().read(m_out, m_tmp, filename, table);
+    m_metadata.dataIo().read(readEp(), m_tmp, filename, table);
+}
+
+void ReffedChunk::hold(const Origin o)
+{
+    SpinGuard lock(m_spin);
+
+    assert(m_chunk && !m_chunk->remote());
+    assert(!m_refs.empty());
+
+    const auto it(findRef(o));
+    if (it != m_refs.end()) ++it->second;
+    else m_refs.emplace_back(o, 1);
 }
 
 void ReffedChunk::unref(const Origin o)
@@ -109,24 +146,43 @@ void ReffedChunk::unref(const Origin o)
     SpinGuard lock(m_spin);
 
     assert(m_chunk);
-    assert(m_refs.count(o));
 
-    if (!--m_refs.at(o))
+    const auto it(findRef(o));
+    assert(it != m_refs.end());
+
+    if (!--it->second)
     {
-        m_refs.erase(o);
-        if (m_refs.empty())
+        m_refs.erase(it);
+        if (m_refs.empty() && m_chunk->sealed())
         {
-            BlockPointTable table(m_metadata.schema());
+            // Our existing data was never read, so it remains as written.
+            m_chunk->reset();
+        }
+        else if (m_refs.empty())
+        {
+            ENTWINE_TRACE_SPAN("chunk-unref", "chunk");
+
+            BlockPointTable table(m_metadata.residentSchema());
             uint64_t size(m_chunk->gridBlock().size());
             for (const auto& mb : m_chunk->overflowBlocks()) size += mb.size();
             table.reserve(size);
             table.insert(m_chunk->gridBlock());
             for (auto& mb : m_chunk->overflowBlocks()) table.insert(mb);
 
-            m_hierarchy.set(m_key.get(), table.size());
+            // A reawakened node already held the points of its last write.
+            const uint64_t previous(m_hierarchy.get(m_key.get()));
+            m_hierarchy.set(m_key.get(), size);
+            if (size)
+            {
+                m_metadata.overflowTuner().written(
+                        m_key.depth(),
+                        size,
+                        size > previous ? size - previous : 0);
+            }
+            sortNode(m_metadata, m_key.bounds(), table);
 
             m_metadata.dataIo().write(
-                    m_out,
+                    writeEp(),
                     m_tmp,
                     m_key.toString() + m_metadata.postfix(m_key.depth()),
                     m_key.bounds(),
@@ -140,6 +196,29 @@ void ReffedChunk::unref(const Origin o)
     }
 }
 
+bool ReffedChunk::sealable() const
+{
+    // Only nodes that have already overflowed into children are sealed, so
+    // new points may always be routed somewhere below them.  Sparse leaves
+    // are read and rewritten as usual.
+    if (!m_metadata.incremental()) return false;
+
+    for (std::size_t d(0); d < dirEnd(); ++d)
+    {
+        if (m_hierarchy.get(m_key.getStep(toDir(d)).get())) return true;
+    }
+
+    return false;
+}
+
+std::vector<ReffedChunk::Ref>::iterator ReffedChunk::findRef(const Origin o)
+{
+    return std::find_if(
+            m_refs.begin(),
+            m_refs.end(),
+            [o](const Ref& r) { return r.first == o; });
+}
+
 bool ReffedChunk::empty()
 {
     SpinGuard lock(m_spin);
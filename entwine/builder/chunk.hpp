@@ -13,13 +13,17 @@
 #include <cassert>
 #include <cstddef>
 #include <utility>
+#include <vector>
 
 #include <entwine/builder/clipper.hpp>
 #include <entwine/builder/hierarchy.hpp>
+#include <entwine/builder/overflow-tuner.hpp>
+#include <entwine/io/bundle.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/vector-point-table.hpp>
 #include <entwine/types/voxel.hpp>
+#include <entwine/util/memory.hpp>
 #include <entwine/util/spin-lock.hpp>
 #include <entwine/util/unique.hpp>
 
@@ -31,9 +35,12 @@ class Chunk;
 class ReffedChunk
 {
 public:
+    // Nodes which are bundled are read from and written to the local staging
+    // directory rather than the output - see BundleStage.
     ReffedChunk(
             const ChunkKey& key,
             const arbiter::Endpoint& out,
+            BundleStage& bundles,
             const arbiter::Endpoint& tmp,
             Hierarchy& hierarchy);
 
@@ -51,6 +58,10 @@ public:
 
     void ref(Clipper& clipper);
     void unref(Origin o);
+
+    // Take a reference on behalf of something other than an input, such as
+    // the residency set.  The chunk must already be held, and so awake.
+    void hold(Origin o);
     bool empty();
 
     Chunk& chunk() { assert(m_chunk); return *m_chunk; }
@@ -58,26 +69,50 @@ public:
     const ChunkKey& key() const { return m_key; }
     const Metadata& metadata() const { return m_metadata; }
     const arbiter::Endpoint& out() const { return m_out; }
+    BundleStage& bundles() const { return m_bundles; }
     const arbiter::Endpoint& tmp() const { return m_tmp; }
     Hierarchy& hierarchy() const { return m_hierarchy; }
 
     static Info latchInfo();
 
 private:
+    // Whether this node may be passed through by an incremental append.
+    bool sealable() const;
+
+    // Where our own data is read from, and written to.
+    const arbiter::Endpoint& readEp() const
+    {
+        return m_metadata.bundled(m_key.depth()) ?
+            m_bundles.read(m_key.get()) : m_out;
+    }
+
+    const arbiter::Endpoint& writeEp() const
+    {
+        return m_metadata.bundled(m_key.depth()) ?
+            m_bundles.write(m_key.get()) : m_out;
+    }
+
     ChunkKey m_key;
     const Metadata& m_metadata;
     const arbiter::Endpoint& m_out;
+    BundleStage& m_bundles;
     const arbiter::Endpoint& m_tmp;
     Hierarchy& m_hierarchy;
 
-    SpinLock m_spin;
+    // Reference counts for each origin holding this chunk.  Only as many
+    // origins as there are insertion threads hold it at once, so a flat list
+    // is cheaper than a map.
+    using Ref = std::pair<Origin, std::size_t>;
+    std::vector<Ref>::iterator findRef(Origin o);
+
+    SpinLock m_spin { "chunk-ref" };
     std::unique_ptr<Chunk> m_chunk;
-    std::map<Origin, std::size_t> m_refs;
+    std::vector<Ref> m_refs;
 };
 
 struct VoxelTube
 {
-    SpinLock spin;
+    SpinLock spin { "voxel-tube" };
     std::map<uint64_t, Voxel> map;
 };
 
@@ -85,10 +120,16 @@ class Chunk
 {
     static constexpr uint64_t blockSize = 256;
 
+    // Estimated footprints for memory accounting.  A tube's map node holds
+    // its value alongside three pointers and a color.
+    static constexpr uint64_t tubeBytes = sizeof(VoxelTube);
+    static constexpr uint64_t voxelBytes =
+        sizeof(std::pair<const uint64_t, Voxel>) + 32;
+
     struct Overflow
     {
         Overflow(Key& key) : key(key) { }
-        void step() { key.step(voxel.point()); }
+        void step() { key.step(voxel.point(), voxel.cell()); }
 
         Key key;
         Voxel voxel;
@@ -99,10 +140,10 @@ public:
     using OverflowList = std::vector<Overflow>;
     using OverflowListPtr = std::unique_ptr<OverflowList>;
 
-    Chunk(const ReffedChunk& ref)
+    Chunk(const ReffedChunk& ref, const bool sealed = false)
         : m_ref(ref)
         , m_span(m_ref.metadata().span())
-        , m_pointSize(m_ref.metadata().schema().pointSize())
+        , m_pointSize(m_ref.metadata().residentSchema().pointSize())
         , m_gridBlock(m_pointSize, 4096)
         , m_overflowBlocks { {
             MemBlock(m_pointSize, blockSize),
@@ -115,7 +156,7 @@ public:
             MemBlock(m_pointSize, blockSize)
         } }
     {
-        init();
+        init(sealed);
 
         m_children.reserve(dirEnd());
         for (std::size_t d(0); d < dirEnd(); ++d)
@@ -124,15 +165,23 @@ public:
             m_children.emplace_back(
                     key,
                     m_ref.out(),
+                    m_ref.bundles(),
                     m_ref.tmp(),
                     m_ref.hierarchy());
         }
     }
 
-    void init()
+    // A sealed chunk holds no points of its own - every point inserted into
+    // it passes through to its children, so its existing data is left as is.
+    void init(const bool sealed = false)
     {
         assert(!m_grid);
+        m_remote = false;
+        m_sealed = sealed;
+        if (m_sealed) return;
+
         m_grid = makeUnique<std::vector<VoxelTube>>(m_span * m_span);
+        Memory::add(Memory::Category::Grid, m_span * m_span * tubeBytes);
 
         for (std::size_t d(0); d < dirEnd(); ++d)
         {
@@ -143,8 +192,6 @@ public:
                 m_overflowLists[d] = makeUnique<OverflowList>();
             }
         }
-
-        m_remote = false;
     }
 
     bool terminus()
@@ -155,27 +202,50 @@ public:
         return result;
     }
 
+    ~Chunk() { reset(); }
+
     void reset()
     {
+        if (m_grid)
+        {
+            Memory::sub(
+                    Memory::Category::Grid,
+                    m_span * m_span * tubeBytes +
+                        m_gridBlock.size() * voxelBytes);
+        }
+
+        Memory::sub(
+                Memory::Category::Overflow,
+                m_overflowCount * sizeof(Overflow));
+
         m_grid.reset();
         m_overflowCount = 0;
         for (std::size_t d(0); d < dirEnd(); ++d) m_overflowLists[d].reset();
         m_remote = true;
+        m_sealed = false;
 
         m_gridBlock.clear();
         for (auto& o : m_overflowBlocks) o.clear();
     }
 
     bool remote() const { return m_remote; }
+    bool sealed() const { return m_sealed; }
 
-    ReffedChunk& step(const Point& p)
+    ReffedChunk& step(const Voxel& voxel)
     {
-        const Dir dir(getDirection(m_ref.key().bounds().mid(), p));
+        const Dir dir(m_ref.key().direction(voxel.point(), voxel.cell()));
         return m_children[toIntegral(dir)];
     }
 
     bool insert(Voxel& voxel, Key& key, Clipper& clipper)
     {
+        if (m_sealed)
+        {
+            key.step(voxel.point(), voxel.cell());
+            step(voxel).insert(voxel, key, clipper);
+            return false;
+        }
+
         const Xyz& pos(key.position());
         const std::size_t i((pos.y % m_span) * m_span + (pos.x % m_span));
         VoxelTube& tube((*m_grid)[i]);
@@ -185,16 +255,17 @@ public:
 
         if (dst.data())
         {
-            const Point& mid(key.bounds().mid());
-            if (voxel.point().sqDist3d(mid) < dst.point().sqDist3d(mid))
+            if (key.nearer(
+                        voxel.point(), voxel.cell(),
+                        dst.point(), dst.cell()))
             {
                 if (!insertOverflow(dst, key, clipper))
                 {
-                    key.step(dst.point());
-                    step(dst.point()).insert(dst, key, clipper);
+                    key.step(dst.point(), dst.cell());
+                    step(dst).insert(dst, key, clipper);
                 }
 
-                dst.initDeep(voxel.point(), voxel.data(), m_pointSize);
+                dst.initDeep(voxel, m_pointSize);
                 return true;
             }
         }
@@ -204,7 +275,8 @@ public:
                 SpinGuard lock(m_spin);
                 dst.setData(m_gridBlock.next());
             }
-            dst.initDeep(voxel.point(), voxel.data(), m_pointSize);
+            Memory::add(Memory::Category::Grid, voxelBytes);
+            dst.initDeep(voxel, m_pointSize);
             return true;
         }
 
@@ -216,8 +288,8 @@ public:
         }
         else
         {
-            key.step(voxel.point());
-            step(voxel.point()).insert(voxel, key, clipper);
+            key.step(voxel.point(), voxel.cell());
+            step(voxel).insert(voxel, key, clipper);
             return false;
         }
     }
@@ -233,7 +305,7 @@ private:
             return false;
         }
 
-        const Dir d(getDirection(m_ref.key().bounds().mid(), voxel.point()));
+        const Dir d(m_ref.key().direction(voxel.point(), voxel.cell()));
         const uint64_t i(toIntegral(d));
 
         OverflowListPtr& o(m_overflowLists[i]);
@@ -256,10 +328,15 @@ private:
         assert(o);
         Overflow overflow(key);
         overflow.voxel.setData(b.next());
-        overflow.voxel.initDeep(voxel.point(), voxel.data(), m_pointSize);
+        overflow.voxel.initDeep(voxel, m_pointSize);
         o->push_back(overflow);
+        Memory::add(Memory::Category::Overflow, sizeof(Overflow));
+
+        const uint64_t threshold(
+                m_ref.metadata().overflowTuner().threshold(
+                    m_ref.key().depth()));
 
-        if (++m_overflowCount < m_ref.metadata().overflowThreshold()) return;
+        if (++m_overflowCount < threshold) return;
 
         // See if our resident size is big enough to overflow.
         uint64_t gridSize(0);
@@ -269,9 +346,7 @@ private:
         }
 
         const uint64_t ourSize(gridSize + m_overflowCount);
-        const uint64_t maxSize(
-                m_span * m_span +
-                m_ref.metadata().overflowThreshold());
+        const uint64_t maxSize(m_span * m_span + threshold);
         if (ourSize < maxSize) return;
 
         // Find the overflow with the largest point count.
@@ -289,7 +364,7 @@ private:
 
         // Make sure our largest overflow is large enough to necessitate a
         // child node.
-        const uint64_t minSize(m_ref.metadata().overflowThreshold() / 2.0);
+        const uint64_t minSize(threshold / 2.0);
         if (selectedSize < minSize) return;
 
         doOverflow(clipper, selectedIndex);
@@ -307,7 +382,14 @@ private:
             m_children[index].insert(o.voxel, o.key, clipper);
         }
 
+        m_ref.metadata().overflowTuner().overflowed(
+                m_ref.key().depth(),
+                olist->size());
+
         m_overflowCount -= olist->size();
+        Memory::sub(
+                Memory::Category::Overflow,
+                olist->size() * sizeof(Overflow));
         olist.reset();
         b.clear();
     }
@@ -316,12 +398,13 @@ private:
     const uint64_t m_span;
     const uint64_t m_pointSize;
     bool m_remote = false;
+    bool m_sealed = false;
 
-    SpinLock m_spin;
+    SpinLock m_spin { "chunk-grid" };
     std::unique_ptr<std::vector<VoxelTube>> m_grid;
     MemBlock m_gridBlock;
 
-    SpinLock m_overflowSpin;
+    SpinLock m_overflowSpin { "chunk-overflow" };
     OverflowBlocks m_overflowBlocks;
     std::array<OverflowListPtr, 8> m_overflowLists;
     uint64_t m_overflowCount = 0;
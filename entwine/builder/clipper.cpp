@@ -31,6 +31,8 @@ bool Clipper::insert(ReffedChunk& c)
 
 void Clipper::clip()
 {
+    m_registry.residency().evict();
+
     if (m_count <= heuristics::clipCacheSize) return;
 
     std::size_t cur(minClipDepth);
@@ -55,32 +57,32 @@ void Clipper::clipAll()
         m_count -= m_clips[d].clip(true);
     }
     assert(!m_count);
+
+    m_registry.residency().evict();
 }
 
 bool Clipper::Clip::insert(ReffedChunk& c)
 {
-    const auto it(m_chunks.find(&c));
-    if (it == m_chunks.end())
+    if (&c == m_last)
     {
-        m_chunks[&c] = true;
-        return true;
-    }
-    else
-    {
-        it->second = true;
+        *m_lastTouched = true;
         return false;
     }
-}
 
-bool Clipper::Clip::Cmp::operator()(
-        const ReffedChunk* a,
-        const ReffedChunk* b) const
-{
-    return a->key().position() < b->key().position();
+    const auto result(m_chunks.emplace(&c, true));
+    if (!result.second) result.first->second = true;
+
+    m_last = &c;
+    m_lastTouched = &result.first->second;
+
+    return result.second;
 }
 
 std::size_t Clipper::Clip::clip(const bool force)
 {
+    m_last = nullptr;
+    m_lastTouched = nullptr;
+
     std::size_t n(0);
     for (auto it(m_chunks.begin()); it != m_chunks.end(); )
     {
@@ -94,6 +96,8 @@ std::size_t Clipper::Clip::clip(const bool force)
         }
         else
         {
+            // Still in use here, which counts as recent use globally.
+            m_clipper.registry().residency().touch(*it->first);
             it->second = false;
             ++it;
         }
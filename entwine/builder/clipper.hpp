@@ -12,7 +12,8 @@
 
 #include <cassert>
 #include <cstdint>
-#include <set>
+#include <unordered_map>
+#include <vector>
 
 #include <entwine/types/defs.hpp>
 #include <entwine/types/key.hpp>
@@ -38,12 +39,15 @@ class Clipper
     private:
         Clipper& m_clipper;
 
-        struct Cmp
-        {
-            bool operator()(const ReffedChunk* a, const ReffedChunk* b) const;
-        };
+        // Chunks held by this clipper at this depth, each with a flag noting
+        // whether it has been touched since the last clip.
+        std::unordered_map<ReffedChunk*, bool> m_chunks;
 
-        std::map<ReffedChunk*, bool, Cmp> m_chunks;
+        // Consecutive points mostly land in the same chunk, so the last one
+        // is remembered to skip the lookup.  Elements of an unordered_map are
+        // stable until erased, which happens only in clip().
+        ReffedChunk* m_last = nullptr;
+        bool* m_lastTouched = nullptr;
     };
 
 public:
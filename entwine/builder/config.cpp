@@ -10,9 +10,13 @@
 
 #include <entwine/builder/config.hpp>
 
+#include <algorithm>
+
 #include <entwine/builder/scan.hpp>
+#include <entwine/builder/synthetic.hpp>
 #include <entwine/io/ensure.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/reprojector.hpp>
 
 namespace entwine
 {
@@ -156,7 +160,8 @@ FileInfoList Config::input() const
     {
         if (j.is_object())
         {
-            if (Executor::get().good(j.at("path").get<std::string>()))
+            const std::string path(j.at("path").get<std::string>());
+            if (Synthetic::isSynthetic(path) || Executor::get().good(path))
             {
                 f.emplace_back(j);
             }
@@ -172,6 +177,13 @@ FileInfoList Config::input() const
 
         if (p.empty()) return;
 
+        // Synthetic paths are not resolved - they are generated on demand.
+        if (Synthetic::isSynthetic(p))
+        {
+            f.emplace_back(Synthetic::fromPath(p).path());
+            return;
+        }
+
         if (p.back() != '*')
         {
             if (arbiter::util::isDirectory(p)) p += '*';
@@ -198,7 +210,20 @@ FileInfoList Config::input() const
     return f;
 }
 
-json Config::pipeline(std::string filename) const
+bool Config::nativeReprojection() const
+{
+    if (!Reprojector::available() || !reprojection()) return false;
+
+    const json p(m_json.value("pipeline", json::array()));
+    if (!p.is_array()) return false;
+
+    return std::none_of(p.begin(), p.end(), [](const json& stage)
+    {
+        return stage.value("type", "") == "filters.reprojection";
+    });
+}
+
+json Config::pipeline(std::string filename, const bool native) const
 {
     const auto r(reprojection());
 
@@ -221,6 +246,9 @@ json Config::pipeline(std::string filename) const
             else reader["default_srs"] = r->in();
         }
 
+        // The output is then reprojected by our caller.
+        if (native && nativeReprojection()) return p;
+
         // Now set up the output.  If there's already a filters.reprojection in
         // the pipeline, we'll fill it in.  Otherwise, we'll add one to the end.
         auto it = std::find_if(p.begin(), p.end(), [](const json& stage)
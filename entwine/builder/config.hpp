@@ -43,11 +43,21 @@ public:
     //        and has its configuration merged in.
     Config prepare() const;
 
-    json pipeline(std::string filename) const;
+    // The PDAL pipeline for a file.  Any reprojection is appended to it as a
+    // filters.reprojection stage, unless `native` is set and reprojection is
+    // nativeReprojection(), in which case only the input SRS is applied, to
+    // the reader, and the caller reprojects the output with a Reprojector.
+    json pipeline(std::string filename, bool native = false) const;
+
+    // True if reprojection is configured and may be performed natively: that
+    // is, Entwine has PROJ and the pipeline has no reprojection stage of its
+    // own, whose placement among other filters must be kept.
+    bool nativeReprojection() const;
 
     FileInfoList input() const;
 
     std::string output() const { return m_json.value("output", ""); }
+    std::string trace() const { return m_json.value("trace", ""); }
     std::string tmp() const
     {
         return m_json.value("tmp", arbiter::getTempPath());
@@ -88,6 +98,19 @@ public:
     {
         return m_json.value("dataType", "laszip");
     }
+    std::string nodeOrder() const
+    {
+        if (m_json.count("nodeOrder"))
+        {
+            return m_json.at("nodeOrder").get<std::string>();
+        }
+
+        // LASzip output has always been sorted by GpsTime.  Columnar output
+        // delta-encodes XYZ, which benefits from spatially adjacent points.
+        if (dataType() == "columnar") return "morton";
+        return dataType() == "laszip" && schema().hasTime() ?
+            "gpstime" : "none";
+    }
     std::string hierType() const
     {
         return m_json.value("hierarchyType", "json");
@@ -133,8 +156,35 @@ public:
                 "overflowThreshold",
                 span() * span() * m_json.value("overflowRatio", 0.5));
     }
+    bool adaptiveOverflow() const
+    {
+        return m_json.value("adaptiveOverflow", false);
+    }
+
+    // Selection of points to remove from an existing build.
+    json origins() const { return m_json.value("origins", json::array()); }
+    Bounds region() const { return m_json.value("region", Bounds()); }
+    bool replace() const { return m_json.value("replace", false); }
+
+    bool incremental() const { return m_json.value("incremental", false); }
+
+    // Sharing is on by default only when memory is bounded.
+    std::size_t sharedChunks() const
+    {
+        return m_json.value(
+                "sharedChunks",
+                memoryLimit() ?
+                    heuristics::sharedChunksPerThread * workThreads() : 0);
+    }
+
+    // In bytes, although specified in megabytes.
+    uint64_t memoryLimit() const
+    {
+        return m_json.value("memoryLimit", 0ull) * 1024 * 1024;
+    }
 
     uint64_t hierarchyStep() const { return m_json.value("hierarchyStep", 0); }
+    uint64_t bundleDepth() const { return m_json.value("bundleDepth", 0); }
 
     Srs srs() const { return m_json.value("srs", Srs()); }
 
@@ -147,6 +197,10 @@ public:
     }
 
     bool absolute() const { return m_json.value("absolute", false); }
+    bool scaledResident() const
+    {
+        return m_json.value("scaledResident", false);
+    }
 
     uint64_t progressInterval() const
     {
@@ -23,6 +23,10 @@ const std::size_t sleepCount(65536 * 32);
 // A per-thread count of the minimum chunk-cache size to keep during clipping.
 const std::size_t clipCacheSize(64);
 
+// A per-work-thread count of the chunks kept resident across all inputs,
+// beyond those held by each input's clipper.
+const std::size_t sharedChunksPerThread(64);
+
 // When building, we are given a total thread count.  Because serialization is
 // more expensive than actually doing tree work, we'll allocate more threads to
 // the "clip" task than to the "work" task.  This parameter tunes the ratio of
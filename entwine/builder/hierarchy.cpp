@@ -12,6 +12,7 @@
 
 #include <entwine/io/ensure.hpp>
 #include <entwine/types/metadata.hpp>
+#include <entwine/util/trace.hpp>
 
 namespace entwine
 {
@@ -40,7 +41,11 @@ void Hierarchy::load(
 
         int64_t n(p.value().get<int64_t>());
         if (n < 0) load(m, ep, k);
-        else m_map[k] = static_cast<uint64_t>(n);
+        else
+        {
+            m_map[k] = static_cast<uint64_t>(n);
+            Memory::add(Memory::Category::Hierarchy, nodeBytes);
+        }
     }
 }
 
@@ -49,7 +54,9 @@ void Hierarchy::save(
         const arbiter::Endpoint& ep,
         Pool& pool) const
 {
-    json j;
+    ENTWINE_TRACE_SPAN("hierarchy-save", "build");
+
+    json j = json::object();
     const ChunkKey k(m);
     save(m, ep, pool, k, j);
 
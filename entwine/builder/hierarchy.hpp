@@ -17,6 +17,7 @@
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/key.hpp>
 #include <entwine/util/json.hpp>
+#include <entwine/util/memory.hpp>
 #include <entwine/util/pool.hpp>
 #include <entwine/util/spin-lock.hpp>
 
@@ -37,11 +38,20 @@ public:
             const arbiter::Endpoint& ep,
             bool exists);
 
+    ~Hierarchy()
+    {
+        Memory::sub(Memory::Category::Hierarchy, m_map.size() * nodeBytes);
+    }
+
     void set(const Dxyz& key, uint64_t val)
     {
         SpinGuard lock(m_spin);
         auto it(m_map.find(key));
-        if (it == m_map.end()) m_map[key] = val;
+        if (it == m_map.end())
+        {
+            m_map[key] = val;
+            Memory::add(Memory::Category::Hierarchy, nodeBytes);
+        }
         else it->second = val;
     }
 
@@ -114,7 +124,10 @@ private:
             const Dxyz& curr,
             Map& map) const;
 
-    mutable SpinLock m_spin;
+    // Estimated footprint of a map node, for memory accounting.
+    static constexpr uint64_t nodeBytes = sizeof(Map::value_type) + 32;
+
+    mutable SpinLock m_spin { "hierarchy" };
     Map m_map;
     mutable uint64_t m_step = 0;
 };
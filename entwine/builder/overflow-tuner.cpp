@@ -0,0 +1,185 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/builder/overflow-tuner.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include <entwine/builder/hierarchy.hpp>
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Node writes at a depth between adjustments of its threshold.
+    const uint64_t window(8);
+
+    // Beyond this fraction of arriving points being pushed down again, a
+    // depth is considered saturated.
+    const double maxChurn(0.5);
+
+    // Bounds on node size, relative to nominal, within which thresholds are
+    // raised and beyond which they are lowered.
+    const double growLimit(1.5);
+    const double shrinkLimit(2.0);
+
+    const double minScale(0.5);
+    const double maxScale(4.0);
+    const double step(1.25);
+}
+
+constexpr std::size_t OverflowTuner::maxDepth;
+
+OverflowTuner::OverflowTuner(
+        const uint64_t span,
+        const uint64_t threshold,
+        const bool adaptive)
+    : m_span(span)
+    , m_base(threshold)
+    , m_adaptive(adaptive)
+{
+    for (auto& t : m_thresholds) t = m_base;
+}
+
+void OverflowTuner::overflowed(const uint64_t depth, const uint64_t points)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Depth& d(m_depths[clamp(depth)]);
+    d.reinserted += points;
+    d.recentReinserted += points;
+}
+
+void OverflowTuner::written(
+        const uint64_t depth,
+        const uint64_t points,
+        const uint64_t added)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Depth& d(m_depths[clamp(depth)]);
+    ++d.writes;
+
+    ++d.recentWrites;
+    d.recentSize += points;
+    d.recentKept += added;
+
+    if (m_adaptive && d.recentWrites >= window) adapt(clamp(depth));
+}
+
+void OverflowTuner::tally(const Hierarchy& hierarchy)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Depth& d : m_depths)
+    {
+        d.nodes = 0;
+        d.kept = 0;
+        d.sumSquares = 0;
+        d.maxSize = 0;
+    }
+
+    for (const auto& p : hierarchy.map())
+    {
+        const uint64_t points(p.second);
+        if (!points) continue;
+
+        Depth& d(m_depths[clamp(p.first.d)]);
+        ++d.nodes;
+        d.kept += points;
+        d.sumSquares += static_cast<double>(points) * points;
+        d.maxSize = std::max(d.maxSize, points);
+    }
+}
+
+void OverflowTuner::adapt(const std::size_t depth)
+{
+    Depth& d(m_depths[depth]);
+
+    // Node size is judged by what was written, and churn by the points that
+    // stayed versus those pushed down over the same span of activity.
+    const double nominal(m_span * m_span + m_base);
+    const double mean(static_cast<double>(d.recentSize) / d.recentWrites);
+    const double churn(
+            static_cast<double>(d.recentReinserted) /
+            std::max<uint64_t>(d.recentReinserted + d.recentKept, 1));
+
+    if (mean > shrinkLimit * nominal) d.scale /= step;
+    else if (churn > maxChurn && mean < growLimit * nominal) d.scale *= step;
+    d.scale = std::min(std::max(d.scale, minScale), maxScale);
+
+    const uint64_t threshold(std::llround(m_base * d.scale));
+    m_thresholds[depth] = std::max<uint64_t>(threshold, 1);
+
+    d.recentWrites = 0;
+    d.recentSize = 0;
+    d.recentKept = 0;
+    d.recentReinserted = 0;
+}
+
+OverflowTuner::Stats OverflowTuner::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Stats s;
+    uint64_t kept(0);
+    double sumSquares(0);
+
+    for (const Depth& d : m_depths)
+    {
+        s.nodes += d.nodes;
+        s.reinserted += d.reinserted;
+        s.maxSize = std::max(s.maxSize, d.maxSize);
+        kept += d.kept;
+        sumSquares += d.sumSquares;
+    }
+
+    if (s.nodes)
+    {
+        s.meanSize = static_cast<double>(kept) / s.nodes;
+        const double variance(
+                std::max(sumSquares / s.nodes - s.meanSize * s.meanSize, 0.0));
+        if (s.meanSize) s.variation = std::sqrt(variance) / s.meanSize;
+    }
+
+    return s;
+}
+
+std::string OverflowTuner::summary() const
+{
+    const Stats s(stats());
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "\tNodes written: " << commify(s.nodes) << ", mean size " <<
+        commify(std::llround(s.meanSize)) << ", max " << commify(s.maxSize) <<
+        ", variation " << s.variation << std::endl;
+    ss << "\tPoints re-inserted by overflow: " << commify(s.reinserted) <<
+        std::endl;
+
+    if (m_adaptive)
+    {
+        ss << "\tAdaptive overflow thresholds:";
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::size_t i(0); i < maxDepth; ++i)
+        {
+            if (!m_depths[i].writes) continue;
+            ss << " " << i << ":" << commify(m_thresholds[i].load());
+        }
+        ss << std::endl;
+    }
+
+    return ss.str();
+}
+
+} // namespace entwine
@@ -0,0 +1,117 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace entwine
+{
+
+class Hierarchy;
+
+// Overflow thresholds for each depth of a build, and statistics about how
+// points move between nodes.
+//
+// With a fixed policy, every depth uses the configured threshold.  With an
+// adaptive policy, the threshold of each depth is scaled by what its nodes
+// have done so far:
+//      - where most points arriving at a depth are pushed down again by
+//        overflow, the nodes there are saturated, so the threshold is raised
+//        to spare those re-insertions, until nodes grow past a bound
+//      - where nodes come out far larger than nominal, it is lowered again
+//
+// Nominal node size is span * span + threshold.
+class OverflowTuner
+{
+public:
+    static constexpr std::size_t maxDepth = 64;
+
+    OverflowTuner(uint64_t span, uint64_t threshold, bool adaptive);
+
+    bool adaptive() const { return m_adaptive; }
+    uint64_t base() const { return m_base; }
+
+    uint64_t threshold(uint64_t depth) const
+    {
+        if (!m_adaptive) return m_base;
+        return m_thresholds[clamp(depth)].load(std::memory_order_relaxed);
+    }
+
+    // A node at this depth pushed this many points down into a child.
+    void overflowed(uint64_t depth, uint64_t points);
+
+    // A node at this depth was serialized holding this many points, of which
+    // `added` arrived since it was last serialized.  Reawakened nodes are
+    // serialized more than once, so only their additions count as kept.
+    void written(uint64_t depth, uint64_t points, uint64_t added);
+
+    // Take the final size of every node from the hierarchy, for the stats
+    // below, replacing any previous tally.
+    void tally(const Hierarchy& hierarchy);
+
+    struct Stats
+    {
+        uint64_t nodes = 0;
+        uint64_t reinserted = 0;
+        double meanSize = 0;
+
+        // Coefficient of variation of node sizes - lower is more uniform.
+        double variation = 0;
+        uint64_t maxSize = 0;
+    };
+
+    Stats stats() const;
+
+    // Lines for the build summary.
+    std::string summary() const;
+
+private:
+    static std::size_t clamp(uint64_t depth)
+    {
+        return depth < maxDepth ? depth : maxDepth - 1;
+    }
+
+    void adapt(std::size_t depth);
+
+    struct Depth
+    {
+        // Final node sizes, from the tally.
+        uint64_t nodes = 0;
+        uint64_t kept = 0;
+        double sumSquares = 0;
+        uint64_t maxSize = 0;
+
+        uint64_t writes = 0;
+        uint64_t reinserted = 0;
+
+        // Adaptation works from the activity since its last adjustment.
+        double scale = 1;
+        uint64_t recentWrites = 0;
+        uint64_t recentSize = 0;
+        uint64_t recentKept = 0;
+        uint64_t recentReinserted = 0;
+    };
+
+    const uint64_t m_span;
+    const uint64_t m_base;
+    const bool m_adaptive;
+
+    mutable std::mutex m_mutex;
+    std::array<Depth, maxDepth> m_depths;
+    std::array<std::atomic<uint64_t>, maxDepth> m_thresholds;
+};
+
+} // namespace entwine
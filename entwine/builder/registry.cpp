@@ -13,6 +13,7 @@
 #include <pdal/PointView.hpp>
 
 #include <entwine/builder/chunk.hpp>
+#include <entwine/io/bundle.hpp>
 #include <entwine/io/io.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/bounds.hpp>
@@ -26,24 +27,70 @@
 namespace entwine
 {
 
+namespace
+{
+    // Staged nodes are private to a build, so outputs sharing a temporary
+    // directory get their own.
+    std::string stageDir(const arbiter::Endpoint& out)
+    {
+        const std::string hash(
+                arbiter::crypto::encodeAsHex(
+                    arbiter::crypto::sha256(out.prefixedRoot())));
+        return "ept-bundle-" + hash.substr(0, 16);
+    }
+}
+
 Registry::Registry(
         const Metadata& metadata,
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
         ThreadPools& threadPools,
-        const bool exists)
+        const bool exists,
+        const std::size_t sharedChunks,
+        const uint64_t memoryLimit)
     : m_metadata(metadata)
     , m_dataEp(out.getSubEndpoint("ept-data"))
     , m_hierEp(out.getSubEndpoint("ept-hierarchy"))
+    , m_stageEp(tmp.getSubEndpoint(stageDir(out)))
     , m_tmp(tmp)
     , m_threadPools(threadPools)
     , m_hierarchy(m_metadata, m_hierEp, exists)
-    , m_root(ChunkKey(metadata), m_dataEp, tmp, m_hierarchy)
-{ }
+    , m_residency(threadPools.clipPool(), sharedChunks, memoryLimit)
+    , m_bundles(makeUnique<BundleStage>(
+                m_metadata,
+                m_stageEp,
+                m_dataEp,
+                m_hierEp,
+                exists ? m_hierarchy.map() : Bundle::Counts()))
+    , m_root(ChunkKey(metadata), m_dataEp, *m_bundles, tmp, m_hierarchy)
+{
+    if (!m_metadata.bundleDepth()) return;
+
+    if (!arbiter::mkdirp(m_stageEp.root()))
+    {
+        throw std::runtime_error("Couldn't create bundle staging directory");
+    }
+}
+
+Registry::~Registry()
+{
+    if (!m_metadata.bundleDepth()) return;
+
+    for (const auto& f : arbiter::glob(m_stageEp.root() + "*"))
+    {
+        arbiter::remove(f);
+    }
+    arbiter::remove(m_stageEp.root());
+}
 
 void Registry::save() const
 {
     m_hierarchy.save(m_metadata, m_hierEp, m_threadPools.workPool());
+
+    if (m_metadata.bundleDepth())
+    {
+        m_bundles->pack(m_hierarchy.map(), m_threadPools.workPool());
+    }
 }
 
 void Registry::merge(const Registry& other, Clipper& clipper)
@@ -55,22 +102,29 @@ void Registry::merge(const Registry& other, Clipper& clipper)
 
         if (dxyz.d < m_metadata.sharedDepth())
         {
-            VectorPointTable table(m_metadata.schema(), np);
+            VectorPointTable table(m_metadata.residentSchema(), np);
             table.setProcess([this, &table, &clipper, &dxyz]()
             {
                 Voxel voxel;
                 Key pk(m_metadata);
 
+                std::unique_ptr<ScaleOffset> so;
+                if (m_metadata.scaledResident())
+                {
+                    so = m_metadata.outSchema().scaleOffset();
+                }
+
                 for (auto it(table.begin()); it != table.end(); ++it)
                 {
                     voxel.initShallow(it.pointRef(), it.data());
-                    const Point point(voxel.point());
-                    pk.init(point, dxyz.d);
+                    if (so) voxel.unscale(*so);
+                    voxel.locate(pk);
+                    pk.init(voxel.point(), voxel.cell(), dxyz.d);
 
                     ReffedChunk* rc(&m_root);
                     for (uint64_t d(0); d < dxyz.d; ++d)
                     {
-                        rc = &rc->chunk().step(point);
+                        rc = &rc->chunk().step(voxel);
                     }
 
                     rc->insert(voxel, pk, clipper);
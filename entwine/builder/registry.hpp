@@ -19,7 +19,9 @@
 #include <entwine/builder/chunk.hpp>
 #include <entwine/builder/clipper.hpp>
 #include <entwine/builder/hierarchy.hpp>
+#include <entwine/builder/residency.hpp>
 #include <entwine/builder/thread-pools.hpp>
+#include <entwine/io/bundle.hpp>
 #include <entwine/types/key.hpp>
 #include <entwine/util/pool.hpp>
 #include <entwine/util/unique.hpp>
@@ -42,7 +44,11 @@ public:
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
             ThreadPools& threadPools,
-            bool exists = false);
+            bool exists = false,
+            std::size_t sharedChunks = 0,
+            uint64_t memoryLimit = 0);
+
+    ~Registry();
 
     void save() const;
     void merge(const Registry& other, Clipper& clipper);
@@ -56,17 +62,34 @@ public:
 
     Pool& workPool() { return m_threadPools.workPool(); }
     Pool& clipPool() { return m_threadPools.clipPool(); }
+    Residency& residency() { return m_residency; }
 
     const Metadata& metadata() const { return m_metadata; }
     const Hierarchy& hierarchy() const { return m_hierarchy; }
+    Hierarchy& hierarchy() { return m_hierarchy; }
+
+    // Where the data of a node is read and written while building, which is
+    // a local staging directory for bundled nodes.
+    const arbiter::Endpoint& readEp(const Dxyz& key) const
+    {
+        return m_metadata.bundled(key.d) ? m_bundles->read(key) : m_dataEp;
+    }
+
+    const arbiter::Endpoint& writeEp(const Dxyz& key) const
+    {
+        return m_metadata.bundled(key.d) ? m_bundles->write(key) : m_dataEp;
+    }
 
 private:
     const Metadata& m_metadata;
     const arbiter::Endpoint m_dataEp;
     const arbiter::Endpoint m_hierEp;
+    const arbiter::Endpoint m_stageEp;
     const arbiter::Endpoint& m_tmp;
     ThreadPools& m_threadPools;
     Hierarchy m_hierarchy;
+    Residency m_residency;
+    std::unique_ptr<BundleStage> m_bundles;
 
     ReffedChunk m_root;
 };
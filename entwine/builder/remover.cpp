@@ -0,0 +1,439 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/builder/remover.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/builder/hierarchy.hpp>
+#include <entwine/builder/registry.hpp>
+#include <entwine/io/io.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/dir.hpp>
+#include <entwine/types/file-info.hpp>
+#include <entwine/types/files.hpp>
+#include <entwine/types/key.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/node-order.hpp>
+#include <entwine/types/scale-offset.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/types/vector-point-table.hpp>
+#include <entwine/types/voxel.hpp>
+#include <entwine/util/json.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // A point of a node, located within the voxels of some depth.
+    struct Located
+    {
+        Point point;
+        Origin origin = invalidOrigin;
+        Xyz voxel;
+
+        // Squared distance to the center of its voxel.
+        double dist = 0;
+    };
+
+    std::vector<Located> locate(
+            const Metadata& m,
+            VectorPointTable& table,
+            const uint64_t depth)
+    {
+        std::unique_ptr<ScaleOffset> so;
+        if (m.scaledResident()) so = m.outSchema().scaleOffset();
+
+        const uint64_t n(table.data().size() / table.pointSize());
+        std::vector<Located> result(n);
+
+        Key key(m);
+        Voxel voxel;
+
+        for (uint64_t i(0); i < n; ++i)
+        {
+            const pdal::PointRef pr(table.at(i));
+            voxel.initShallow(pr, table.getPoint(i));
+            if (so) voxel.unscale(*so);
+
+            Located& l(result[i]);
+            l.point = voxel.point();
+            l.origin = pr.getFieldAs<uint64_t>(DimId::OriginId);
+
+            key.init(l.point, depth);
+            l.voxel = key.position();
+            l.dist = l.point.sqDist3d(key.bounds().mid());
+        }
+
+        return result;
+    }
+
+    ChunkKey toKey(const Metadata& m, const Dxyz& dxyz)
+    {
+        ChunkKey key(m);
+        for (uint64_t d(dxyz.d); d > 0; --d)
+        {
+            const uint64_t shift(d - 1);
+            key.step(toDir(
+                    ((dxyz.p.x >> shift) & 1 ? EwBit : 0) |
+                    ((dxyz.p.y >> shift) & 1 ? NsBit : 0) |
+                    ((dxyz.p.z >> shift) & 1 ? UdBit : 0)));
+        }
+        return key;
+    }
+
+    Dxyz parentOf(const Dxyz& dxyz)
+    {
+        return Dxyz(dxyz.d - 1, dxyz.p.x >> 1, dxyz.p.y >> 1, dxyz.p.z >> 1);
+    }
+}
+
+Remover::Remover(const Config& config)
+    : m_config(config)
+    , m_region(m_config.region())
+    , m_replace(m_config.replace())
+    , m_pool(
+            m_config.totalThreads(),
+            std::numeric_limits<std::size_t>::max(),
+            m_config.verbose())
+    , m_removed(0)
+    , m_rewritten(0)
+{
+    if (!m_config.isContinuation())
+    {
+        throw std::runtime_error("No existing build at " + m_config.output());
+    }
+
+    m_builder = makeUnique<Builder>(m_config);
+    const Metadata& m(m_builder->metadata());
+
+    if (m.subset())
+    {
+        throw std::runtime_error("Points cannot be removed from a subset");
+    }
+
+    if (!m.residentSchema().contains(DimId::OriginId))
+    {
+        throw std::runtime_error("Removal requires the OriginId dimension");
+    }
+
+    const Files& files(m.files());
+    for (const json& j : m_config.origins())
+    {
+        const Origin o(
+                j.is_string() ?
+                    files.find(j.get<std::string>()) :
+                    j.get<Origin>());
+
+        if (o >= files.size())
+        {
+            throw std::runtime_error("No origin matching " + j.dump());
+        }
+
+        m_origins.insert(o);
+    }
+
+    if (m_origins.empty() && !m_region.exists())
+    {
+        throw std::runtime_error("Nothing selected for removal");
+    }
+
+    if (m_replace && (m_origins.empty() || m_region.exists()))
+    {
+        throw std::runtime_error("Replacement applies to whole origins only");
+    }
+
+    // Points may only be removed from nodes overlapping the region, if there
+    // is one, and the bounds of the selected files, if we know them all.
+    m_affected = m_region.exists() ? m_region : m.boundsCubic();
+
+    if (m_origins.size())
+    {
+        Bounds files;
+        bool known(true);
+        for (const Origin o : m_origins)
+        {
+            if (const Bounds* b = m.files().get(o).boundsEpsilon())
+            {
+                if (files.exists()) files.grow(*b);
+                else files = *b;
+            }
+            else known = false;
+        }
+
+        if (known) m_affected = m_affected.intersection(files);
+    }
+}
+
+Remover::~Remover() { }
+
+void Remover::go()
+{
+    const Metadata& m(m_builder->metadata());
+    const bool verbose(m_config.verbose());
+
+    if (verbose)
+    {
+        std::cout << "Removing points";
+        if (m_origins.size()) std::cout << " from " << m_origins.size() <<
+            " origin" << (m_origins.size() > 1 ? "s" : "");
+        if (m_region.exists()) std::cout << " within " << m_region;
+        std::cout << std::endl;
+    }
+
+    if (m_affected.exists()) add(ChunkKey(m));
+    m_pool.await();
+
+    // Refill, shallowest first, any node emptied while its descendants were
+    // not.  Those at a single depth have disjoint subtrees.
+    m_refilling = true;
+    for (auto keys(orphaned()); keys.size(); keys = orphaned())
+    {
+        for (const ChunkKey& key : keys) add(key, Pulled(), true);
+        m_pool.await();
+    }
+
+    if (m_error.size()) throw std::runtime_error(m_error);
+
+    Files& files(m_builder->m_metadata->mutableFiles());
+    for (const auto& p : m_counts) files.remove(p.first, p.second);
+
+    if (!m_region.exists())
+    {
+        for (const Origin o : m_origins)
+        {
+            if (m_replace) files.reset(o);
+            else files.set(o, files.get(o).status(), "Removed");
+        }
+    }
+
+    if (verbose)
+    {
+        std::cout << "Removed " << commify(m_removed) << " points, " <<
+            "rewriting " << commify(m_rewritten) << " nodes" << std::endl;
+    }
+
+    m_builder->save();
+}
+
+bool Remover::matches(const Point& p, const Origin o) const
+{
+    if (m_origins.size() && !m_origins.count(o)) return false;
+    if (m_region.exists() && !m_region.contains(p)) return false;
+    return true;
+}
+
+void Remover::add(const ChunkKey& key, Pulled pulled, const bool fresh)
+{
+    m_pool.add([this, key, pulled, fresh]()
+    {
+        try
+        {
+            process(key, pulled, fresh);
+        }
+        catch (std::exception& e)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_error = "During " + key.toString() + ": " + e.what();
+        }
+    });
+}
+
+std::vector<char> Remover::read(const ChunkKey& key, const uint64_t np) const
+{
+    const Metadata& m(m_builder->metadata());
+    const std::size_t pointSize(m.residentSchema().pointSize());
+
+    std::vector<char> data;
+    data.reserve(np * pointSize);
+
+    VectorPointTable table(m.residentSchema(), np);
+    table.setProcess([&table, &data, pointSize]()
+    {
+        for (auto it(table.begin()); it != table.end(); ++it)
+        {
+            data.insert(data.end(), it.data(), it.data() + pointSize);
+        }
+    });
+
+    m.dataIo().read(
+            m_builder->registry().readEp(key.get()),
+            m_builder->tmpEndpoint(),
+            key.toString() + m.postfix(key.depth()),
+            table);
+
+    return data;
+}
+
+void Remover::process(
+        const ChunkKey& key,
+        const Pulled& pulled,
+        const bool fresh)
+{
+    const Metadata& m(m_builder->metadata());
+    Hierarchy& hierarchy(m_builder->registry().hierarchy());
+    const Schema& schema(m.residentSchema());
+
+    // Our points, less those which match and those pulled up by our parent.
+    VectorPointTable table(
+            schema,
+            fresh ? std::vector<char>() : read(key, hierarchy.get(key.get())));
+    const std::vector<Located> ours(locate(m, table, key.depth()));
+
+    BlockPointTable out(schema);
+    std::set<Xyz> occupied;
+    std::map<Origin, uint64_t> counts;
+    bool changed(fresh || pulled.size());
+
+    for (uint64_t i(0); i < ours.size(); ++i)
+    {
+        const Located& l(ours[i]);
+        if (std::binary_search(pulled.begin(), pulled.end(), i)) continue;
+
+        if (matches(l.point, l.origin))
+        {
+            ++counts[l.origin];
+            changed = true;
+        }
+        else
+        {
+            out.refs().push_back(table.getPoint(i));
+            occupied.insert(l.voxel);
+        }
+    }
+
+    // Fill each voxel left empty with the nearest remaining point of our
+    // children which falls within it, just as insertion would have.
+    std::vector<std::unique_ptr<VectorPointTable>> children(dirEnd());
+    std::vector<Pulled> pulls(dirEnd());
+
+    if (changed)
+    {
+        struct Best
+        {
+            std::size_t dir;
+            uint64_t index;
+            double dist;
+        };
+
+        std::map<Xyz, Best> best;
+
+        for (std::size_t d(0); d < dirEnd(); ++d)
+        {
+            const ChunkKey child(key.getStep(toDir(d)));
+            const uint64_t np(hierarchy.get(child.get()));
+            if (!np) continue;
+
+            children[d] = makeUnique<VectorPointTable>(schema, read(child, np));
+            const auto theirs(locate(m, *children[d], key.depth()));
+
+            for (uint64_t i(0); i < theirs.size(); ++i)
+            {
+                const Located& l(theirs[i]);
+                if (occupied.count(l.voxel) || matches(l.point, l.origin))
+                {
+                    continue;
+                }
+
+                const Best candidate { d, i, l.dist };
+                auto it(best.find(l.voxel));
+                if (it == best.end()) best[l.voxel] = candidate;
+                else if (l.dist < it->second.dist) it->second = candidate;
+            }
+        }
+
+        for (const auto& p : best)
+        {
+            const Best& b(p.second);
+            pulls[b.dir].push_back(b.index);
+            out.refs().push_back(children[b.dir]->getPoint(b.index));
+        }
+
+        for (Pulled& p : pulls) std::sort(p.begin(), p.end());
+
+        if (out.size())
+        {
+            sortNode(m, key.bounds(), out);
+            m.dataIo().write(
+                    m_builder->registry().writeEp(key.get()),
+                    m_builder->tmpEndpoint(),
+                    key.toString() + m.postfix(key.depth()),
+                    key.bounds(),
+                    out);
+        }
+
+        // An emptied node remains in storage, but no longer in the hierarchy.
+        hierarchy.set(key.get(), out.size());
+        ++m_rewritten;
+    }
+
+    if (counts.size())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& p : counts)
+        {
+            m_counts[p.first] += p.second;
+            m_removed += p.second;
+        }
+    }
+
+    // Continue wherever points were pulled up, or may yet be removed.  While
+    // refilling, every removal has already been made.
+    for (std::size_t d(0); d < dirEnd(); ++d)
+    {
+        const ChunkKey child(key.getStep(toDir(d)));
+        if (!hierarchy.get(child.get())) continue;
+
+        if (
+                pulls[d].size() ||
+                (!m_refilling && child.bounds().overlaps(m_affected)))
+        {
+            add(child, pulls[d]);
+        }
+    }
+}
+
+std::vector<ChunkKey> Remover::orphaned() const
+{
+    const Metadata& m(m_builder->metadata());
+    const Hierarchy& hierarchy(m_builder->registry().hierarchy());
+
+    std::set<Dxyz> orphans;
+    uint64_t depth(std::numeric_limits<uint64_t>::max());
+
+    for (const auto& p : hierarchy.map())
+    {
+        const Dxyz& dxyz(p.first);
+        if (!p.second || !dxyz.d) continue;
+
+        const Dxyz parent(parentOf(dxyz));
+        if (hierarchy.get(parent)) continue;
+
+        if (parent.d < depth)
+        {
+            depth = parent.d;
+            orphans.clear();
+        }
+
+        if (parent.d == depth) orphans.insert(parent);
+    }
+
+    std::vector<ChunkKey> keys;
+    for (const Dxyz& dxyz : orphans) keys.push_back(toKey(m, dxyz));
+    return keys;
+}
+
+} // namespace entwine
@@ -0,0 +1,93 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <entwine/builder/config.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/defs.hpp>
+#include <entwine/util/pool.hpp>
+
+namespace entwine
+{
+
+class Builder;
+class Point;
+struct ChunkKey;
+
+// Removes points from an existing build, by the origin file they came from,
+// by region, or by both, in which case a point must match each to be removed.
+//
+// Only nodes which may contain matching points are read.  Where a node loses
+// points, the voxels they leave empty are refilled from its children with the
+// point nearest to each voxel's center - as if those points had been there
+// all along - so coarse depths keep their density.  Those children are in
+// turn refilled from theirs, and so on.  Subtrees are processed in parallel.
+class Remover
+{
+public:
+    Remover(const Config& config);
+    ~Remover();
+
+    void go();
+
+    uint64_t removed() const { return m_removed; }
+    uint64_t rewritten() const { return m_rewritten; }
+
+private:
+    // Indices, within the file of a node, of points pulled up by its parent.
+    using Pulled = std::vector<uint64_t>;
+
+    bool matches(const Point& p, Origin o) const;
+    std::vector<char> read(const ChunkKey& key, uint64_t np) const;
+
+    void add(const ChunkKey& key, Pulled pulled = Pulled(), bool fresh = false);
+    void process(const ChunkKey& key, const Pulled& pulled, bool fresh);
+
+    // Nodes emptied of points while their descendants still hold some, which
+    // must be refilled to keep the hierarchy connected.
+    std::vector<ChunkKey> orphaned() const;
+
+    const Config m_config;
+    std::unique_ptr<Builder> m_builder;
+
+    std::set<Origin> m_origins;
+    Bounds m_region;
+
+    // The bounds within which removals may occur.
+    Bounds m_affected;
+
+    bool m_replace = false;
+
+    // Set once every removal is done, after which only nodes whose points are
+    // pulled up by a refill change.
+    bool m_refilling = false;
+
+    Pool m_pool;
+
+    std::mutex m_mutex;
+    std::map<Origin, uint64_t> m_counts;
+    std::string m_error;
+
+    std::atomic<uint64_t> m_removed;
+    std::atomic<uint64_t> m_rewritten;
+};
+
+} // namespace entwine
@@ -0,0 +1,122 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/builder/residency.hpp>
+
+#include <entwine/builder/chunk.hpp>
+#include <entwine/util/memory.hpp>
+#include <entwine/util/pool.hpp>
+
+namespace entwine
+{
+
+Residency::Residency(
+        Pool& clipPool,
+        const std::size_t capacity,
+        const uint64_t memoryLimit)
+    : m_pool(clipPool)
+    , m_capacity(capacity)
+    , m_memoryLimit(memoryLimit)
+{ }
+
+void Residency::touch(ReffedChunk& chunk)
+{
+    if (!enabled()) return;
+
+    SpinGuard lock(m_spin);
+
+    const auto it(m_index.find(&chunk));
+    if (it != m_index.end())
+    {
+        m_order.splice(m_order.begin(), m_order, it->second);
+        return;
+    }
+
+    // This reference is taken while we are locked, so an eviction of this
+    // chunk can't release it before it is held.
+    chunk.hold(residentOrigin);
+    m_order.push_front(&chunk);
+    m_index[&chunk] = m_order.begin();
+}
+
+void Residency::evict()
+{
+    if (!enabled()) return;
+
+    std::vector<ReffedChunk*> victims;
+
+    {
+        SpinGuard lock(m_spin);
+        while (m_order.size() > m_capacity)
+        {
+            victims.push_back(m_order.back());
+            m_index.erase(m_order.back());
+            m_order.pop_back();
+        }
+        m_evicted += victims.size();
+    }
+
+    // Adding to the pool may block, so this happens outside of our lock.
+    release(victims);
+
+    // Under memory pressure, release the least recently used chunks one at a
+    // time until we are back under our limit.  These releases are performed
+    // on this thread, so that their memory is freed before we check again.
+    while (m_memoryLimit && Memory::total().live > m_memoryLimit)
+    {
+        ReffedChunk* victim(nullptr);
+
+        {
+            SpinGuard lock(m_spin);
+            if (m_order.empty()) return;
+
+            victim = m_order.back();
+            m_index.erase(victim);
+            m_order.pop_back();
+            ++m_evicted;
+        }
+
+        victim->unref(residentOrigin);
+    }
+}
+
+void Residency::clear()
+{
+    std::vector<ReffedChunk*> victims;
+
+    {
+        SpinGuard lock(m_spin);
+        victims.assign(m_order.begin(), m_order.end());
+        m_order.clear();
+        m_index.clear();
+    }
+
+    release(victims);
+}
+
+Residency::Stats Residency::stats() const
+{
+    SpinGuard lock(m_spin);
+
+    Stats s;
+    s.held = m_order.size();
+    s.evicted = m_evicted;
+    return s;
+}
+
+void Residency::release(const std::vector<ReffedChunk*>& chunks)
+{
+    for (ReffedChunk* c : chunks)
+    {
+        m_pool.add([c]() { c->unref(residentOrigin); });
+    }
+}
+
+} // namespace entwine
@@ -0,0 +1,80 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include <entwine/types/defs.hpp>
+#include <entwine/util/spin-lock.hpp>
+
+namespace entwine
+{
+
+class Pool;
+class ReffedChunk;
+
+// The origin under which the residency set holds its chunk references.
+static constexpr Origin residentOrigin = invalidOrigin - 1;
+
+// Chunks kept awake across all of the inputs of a build.
+//
+// Each input's Clipper releases the chunks it has stopped using, after which
+// a chunk held by no other input is serialized - even if another input is
+// about to need it, in which case it is reawakened from storage.  While this
+// set is enabled, each chunk in use also holds a reference from it, so chunks
+// remain resident until evicted here: least recently used first, when more
+// than our capacity are held or while tracked memory exceeds its limit.
+class Residency
+{
+public:
+    // A zero capacity disables sharing.  A zero memory limit is unbounded.
+    Residency(Pool& clipPool, std::size_t capacity, uint64_t memoryLimit);
+
+    bool enabled() const { return m_capacity; }
+
+    // Mark a chunk, to which the caller already holds a reference, as the
+    // most recently used.
+    void touch(ReffedChunk& chunk);
+
+    // Release the least recently used chunks beyond our bounds.
+    void evict();
+
+    // Release every chunk, once all inputs have been inserted.
+    void clear();
+
+    struct Stats
+    {
+        std::size_t held = 0;
+        std::size_t evicted = 0;
+    };
+
+    Stats stats() const;
+
+private:
+    void release(const std::vector<ReffedChunk*>& chunks);
+
+    Pool& m_pool;
+    const std::size_t m_capacity;
+    const uint64_t m_memoryLimit;
+
+    using Order = std::list<ReffedChunk*>;
+
+    mutable SpinLock m_spin { "residency" };
+    Order m_order;  // Most recently used first.
+    std::unordered_map<ReffedChunk*, Order::iterator> m_index;
+    std::size_t m_evicted = 0;
+};
+
+} // namespace entwine
@@ -17,6 +17,7 @@
 #include <pdal/util/IStream.hpp>
 #include <pdal/util/OStream.hpp>
 
+#include <entwine/builder/synthetic.hpp>
 #include <entwine/builder/thread-pools.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/reprojection.hpp>
@@ -114,6 +115,18 @@ Config Scan::go()
 
 void Scan::add(FileInfo& f)
 {
+    if (Synthetic::isSynthetic(f.path()))
+    {
+        if (m_re)
+        {
+            throw std::runtime_error(
+                    "Synthetic inputs cannot be reprojected: " + f.path());
+        }
+
+        add(f, *Synthetic::fromPath(f.path()).preview());
+        return;
+    }
+
     if (!Executor::get().good(f.path())) return;
 
     m_pool->add([this, &f]()
@@ -236,14 +249,17 @@ void Scan::add(FileInfo& f, const std::string localPath)
     const json pipeline(m_in.pipeline(localPath));
 
     auto preview(Executor::get().preview(pipeline, m_in.trustHeaders()));
-    if (!preview) return;
+    if (preview) add(f, *preview);
+}
 
-    f.set(*preview);
+void Scan::add(FileInfo& f, const ScanInfo& preview)
+{
+    f.set(preview);
 
     DimList dims;
-    for (const std::string name : preview->dimNames) dims.emplace_back(name);
+    for (const std::string name : preview.dimNames) dims.emplace_back(name);
 
-    const Scale scale(preview->scale ? *preview->scale : 1);
+    const Scale scale(preview.scale ? *preview.scale : 1);
     if (!scale.x || !scale.y || !scale.z)
     {
         throw std::runtime_error(
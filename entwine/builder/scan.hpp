@@ -49,6 +49,7 @@ private:
     void addRanged(FileInfo& f);
 
     void add(FileInfo& f, std::string localPath);
+    void add(FileInfo& f, const ScanInfo& preview);
     Config aggregate();
 
     const Config m_in;
@@ -0,0 +1,558 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/builder/synthetic.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <pdal/io/BufferReader.hpp>
+#include <pdal/io/LasWriter.hpp>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/vector-point-table.hpp>
+#include <entwine/util/executor.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    const std::string prefix("synthetic://");
+    const double pi(3.14159265358979323846);
+
+    // The finalizer of splitmix64.
+    uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // A splitmix64 sequence.  Cheap to construct, so each point gets its own,
+    // seeded from its index, rather than sharing sequential state.
+    class Stream
+    {
+    public:
+        explicit Stream(uint64_t state) : m_state(state) { }
+
+        uint64_t next() { return mix(m_state += 0x9e3779b97f4a7c15ULL); }
+
+        // In [0, 1).
+        double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+        double normal()
+        {
+            const double u(std::max(unit(), 1e-300));
+            return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * pi * unit());
+        }
+
+    private:
+        uint64_t m_state;
+    };
+
+    // Function-local, since a Synthetic may itself be a static.
+    const DimList& generated()
+    {
+        static const DimList dims {
+            DimId::Intensity,
+            DimId::ReturnNumber,
+            DimId::NumberOfReturns,
+            DimId::Classification,
+            DimId::GpsTime,
+            DimId::Red,
+            DimId::Green,
+            DimId::Blue
+        };
+        return dims;
+    }
+
+    DimList toDims(const json& j)
+    {
+        DimList dims;
+        for (const json& entry : j)
+        {
+            const std::string name(entry.get<std::string>());
+            if (name == "X" || name == "Y" || name == "Z") continue;
+
+            const DimList& all(generated());
+            auto it = std::find_if(
+                    all.begin(),
+                    all.end(),
+                    [&name](const DimInfo& d) { return d.name() == name; });
+
+            if (it == all.end())
+            {
+                throw std::runtime_error(
+                        "Synthetic dimension not supported: " + name);
+            }
+
+            dims.push_back(*it);
+        }
+        return dims;
+    }
+
+    std::vector<std::string> split(const std::string& s, const char delim)
+    {
+        std::vector<std::string> result;
+        if (s.empty()) return result;
+
+        std::size_t pos(0);
+        std::size_t end(0);
+        do
+        {
+            end = s.find(delim, pos);
+            result.push_back(s.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        while (end != std::string::npos);
+
+        return result;
+    }
+
+    uint16_t color(double base, double range, double f)
+    {
+        return static_cast<uint16_t>(base + range * f);
+    }
+}
+
+Synthetic::Synthetic(const json& j)
+    : m_distribution(toDistribution(j.value("distribution", "terrain")))
+    , m_points(j.value("points", uint64_t(1000000)))
+    , m_seed(j.value("seed", uint64_t(0)))
+    , m_bounds(j.count("bounds") ?
+            Bounds(j.at("bounds")) : Bounds(0, 0, 0, 1000, 1000, 100))
+    , m_scale(j.value("scale", 0.01))
+    , m_dims(j.count("dims") ? toDims(j.at("dims")) : generated())
+{
+    if (!(m_scale > 0))
+    {
+        throw std::runtime_error("Invalid synthetic scale: " + j.dump());
+    }
+
+    if (
+            !(m_bounds.width() > 0) ||
+            !(m_bounds.depth() > 0) ||
+            !(m_bounds.height() > 0))
+    {
+        throw std::runtime_error("Invalid synthetic bounds: " + j.dump());
+    }
+
+    if (m_distribution == Distribution::Urban)
+    {
+        const uint64_t base(mix(m_seed) ^ 0x853c49e6748fea9bULL);
+        for (uint64_t i(0); i < 256; ++i)
+        {
+            Stream s(mix(base + i));
+
+            Cluster c;
+            c.x = 0.05 + 0.9 * s.unit();
+            c.y = 0.05 + 0.9 * s.unit();
+            c.width = 0.005 + 0.025 * s.unit();
+            c.depth = 0.005 + 0.025 * s.unit();
+            c.height = 0.05 + 0.55 * s.unit();
+            m_clusters.push_back(c);
+        }
+    }
+}
+
+bool Synthetic::isSynthetic(const std::string& path)
+{
+    return path.compare(0, prefix.size(), prefix) == 0;
+}
+
+Synthetic Synthetic::fromPath(const std::string& path)
+{
+    if (!isSynthetic(path))
+    {
+        throw std::runtime_error("Not a synthetic path: " + path);
+    }
+
+    const std::string rest(path.substr(prefix.size()));
+    const std::size_t q(rest.find('?'));
+
+    json j(json::object());
+    if (q) j["distribution"] = rest.substr(0, q);
+
+    if (q == std::string::npos) return Synthetic(j);
+
+    for (const std::string& param : split(rest.substr(q + 1), '&'))
+    {
+        const std::size_t eq(param.find('='));
+        if (eq == std::string::npos)
+        {
+            throw std::runtime_error("Invalid synthetic parameter: " + param);
+        }
+
+        const std::string k(param.substr(0, eq));
+        const std::string v(param.substr(eq + 1));
+
+        if (k == "points") j[k] = std::stoull(v);
+        else if (k == "seed") j[k] = std::stoull(v);
+        else if (k == "scale") j[k] = std::stod(v);
+        else if (k == "bounds")
+        {
+            json b(json::array());
+            for (const std::string& s : split(v, ','))
+            {
+                b.push_back(std::stod(s));
+            }
+            j[k] = b;
+        }
+        else if (k == "dims") j[k] = split(v, ',');
+        else throw std::runtime_error("Invalid synthetic parameter: " + k);
+    }
+
+    return Synthetic(j);
+}
+
+std::string Synthetic::path() const
+{
+    std::string bounds;
+    for (std::size_t i(0); i < 6; ++i)
+    {
+        if (i) bounds += ',';
+        bounds += json(m_bounds[i]).dump();
+    }
+
+    std::string dims;
+    for (const DimInfo& d : m_dims)
+    {
+        if (dims.size()) dims += ',';
+        dims += d.name();
+    }
+
+    return prefix + toString(m_distribution) +
+        "?points=" + std::to_string(m_points) +
+        "&seed=" + std::to_string(m_seed) +
+        "&scale=" + json(m_scale).dump() +
+        "&bounds=" + bounds +
+        "&dims=" + dims;
+}
+
+json Synthetic::toJson() const
+{
+    json dims(json::array());
+    for (const DimInfo& d : m_dims) dims.push_back(d.name());
+
+    return json {
+        { "distribution", toString(m_distribution) },
+        { "points", m_points },
+        { "seed", m_seed },
+        { "scale", m_scale },
+        { "bounds", m_bounds },
+        { "dims", dims }
+    };
+}
+
+Schema Synthetic::schema() const
+{
+    DimList dims {
+        DimInfo(DimId::X, DimType::Signed32, m_scale),
+        DimInfo(DimId::Y, DimType::Signed32, m_scale),
+        DimInfo(DimId::Z, DimType::Signed32, m_scale)
+    };
+    dims.insert(dims.end(), m_dims.begin(), m_dims.end());
+    return Schema(dims);
+}
+
+std::unique_ptr<ScanInfo> Synthetic::preview() const
+{
+    auto info(makeUnique<ScanInfo>());
+
+    info->bounds = m_bounds;
+    info->points = m_points;
+    info->scale = makeUnique<Scale>(m_scale);
+    info->metadata = json { { "synthetic", toJson() } };
+
+    info->dimNames = { "X", "Y", "Z" };
+    for (const DimInfo& d : m_dims) info->dimNames.push_back(d.name());
+
+    return info;
+}
+
+void Synthetic::fill(pdal::PointRef& pr, const uint64_t index) const
+{
+    Stream s(mix(mix(m_seed) + index));
+
+    double fx(0);
+    double fy(0);
+    double fz(0);
+    uint8_t cls(1);
+    uint8_t returns(1);
+
+    switch (m_distribution)
+    {
+        case Distribution::Uniform:
+        {
+            fx = s.unit();
+            fy = s.unit();
+            fz = s.unit();
+            break;
+        }
+        case Distribution::Urban:
+        {
+            if (s.unit() < 0.25)
+            {
+                fx = s.unit();
+                fy = s.unit();
+                fz = 0.02 * s.unit();
+                cls = 2;
+                break;
+            }
+
+            // Squaring skews the choice toward low-numbered clusters.
+            const double u(s.unit());
+            const Cluster& c(m_clusters[
+                    std::min<std::size_t>(
+                        m_clusters.size() - 1,
+                        u * u * m_clusters.size())]);
+
+            fx = c.x + (s.unit() - 0.5) * c.width;
+            fy = c.y + (s.unit() - 0.5) * c.depth;
+
+            if (s.unit() < 0.5) fz = c.height;
+            else
+            {
+                fz = s.unit() * c.height;
+                switch (s.next() % 4)
+                {
+                    case 0: fx = c.x - c.width / 2; break;
+                    case 1: fx = c.x + c.width / 2; break;
+                    case 2: fy = c.y - c.depth / 2; break;
+                    default: fy = c.y + c.depth / 2; break;
+                }
+            }
+
+            cls = 6;
+            break;
+        }
+        case Distribution::Terrain:
+        {
+            fx = s.unit();
+            fy = s.unit();
+
+            const double ground(
+                    0.3 +
+                    0.15 * std::sin(fx * 6 * pi) * std::cos(fy * 4 * pi) +
+                    0.005 * s.normal());
+
+            const double c(s.unit());
+            cls = c < 0.7 ? 2 : c < 0.9 ? 5 : 6;
+
+            const double above(
+                    cls == 2 ? 0 : s.unit() * (cls == 5 ? 0.3 : 0.15));
+            fz = ground + above;
+
+            if (cls == 5) returns = 1 + s.next() % 3;
+            break;
+        }
+        case Distribution::Pathological:
+        {
+            switch (index % 4)
+            {
+                case 0:
+                {
+                    // Groups of 64 exact duplicates.
+                    Stream g(mix(mix(m_seed) ^ (index / 256)));
+                    fx = g.unit();
+                    fy = g.unit();
+                    fz = g.unit();
+                    break;
+                }
+                case 1:
+                {
+                    // On the faces, edges, and corners of the bounds.
+                    const uint64_t bits(s.next());
+                    auto pick([&s](uint64_t b) -> double
+                    {
+                        return b == 0 ? 0.0 : b == 1 ? 1.0 : s.unit();
+                    });
+                    fx = pick(bits & 3);
+                    fy = pick((bits >> 2) & 3);
+                    fz = pick((bits >> 4) & 3);
+                    break;
+                }
+                case 2:
+                {
+                    // Sixteen vertical lines.
+                    const double line(s.next() % 16);
+                    fx = (line + 0.5) / 16;
+                    fy = 1 - fx;
+                    fz = s.unit();
+                    break;
+                }
+                default:
+                {
+                    // Four clusters far smaller than the scale allows.
+                    const double k(s.next() % 4);
+                    fx = 0.2 + 0.2 * k + 1e-6 * s.unit();
+                    fy = 0.8 - 0.2 * k + 1e-6 * s.unit();
+                    fz = 0.5 + 1e-6 * s.unit();
+                    break;
+                }
+            }
+            break;
+        }
+    }
+
+    fx = std::max(0.0, std::min(1.0, fx));
+    fy = std::max(0.0, std::min(1.0, fy));
+    fz = std::max(0.0, std::min(1.0, fz));
+
+    const Point& mn(m_bounds.min());
+    pr.setField(DimId::X, mn.x + fx * m_bounds.width());
+    pr.setField(DimId::Y, mn.y + fy * m_bounds.depth());
+    pr.setField(DimId::Z, mn.z + fz * m_bounds.height());
+
+    // Drawn regardless of our dimensions, so that the values of each do not
+    // depend on which others are present.
+    const uint16_t intensity(s.next() % 4096);
+    const uint8_t returnNumber(1 + s.next() % returns);
+
+    for (const DimInfo& d : m_dims)
+    {
+        switch (d.id())
+        {
+            case DimId::Intensity:
+                pr.setField(d.id(), intensity);
+                break;
+            case DimId::ReturnNumber:
+                pr.setField(d.id(), returnNumber);
+                break;
+            case DimId::NumberOfReturns:
+                pr.setField(d.id(), returns);
+                break;
+            case DimId::Classification:
+                pr.setField(d.id(), cls);
+                break;
+            case DimId::GpsTime:
+                pr.setField(d.id(), index * 0.00001);
+                break;
+            case DimId::Red:
+                pr.setField(d.id(), color(cls == 6 ? 40000 : 15000, 20000, fz));
+                break;
+            case DimId::Green:
+                pr.setField(d.id(), color(cls == 5 ? 40000 : 15000, 20000, fz));
+                break;
+            case DimId::Blue:
+                pr.setField(d.id(), color(cls == 2 ? 10000 : 15000, 20000, fz));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void Synthetic::run(
+        VectorPointTable& table,
+        uint64_t begin,
+        uint64_t end) const
+{
+    if (!end) end = m_points;
+
+    const uint64_t capacity(table.capacity());
+    pdal::PointRef pr(table, 0);
+
+    while (begin < end)
+    {
+        const uint64_t n(std::min(capacity, end - begin));
+        for (uint64_t i(0); i < n; ++i)
+        {
+            pr.setPointId(i);
+            fill(pr, begin + i);
+        }
+
+        table.clear(n);
+        begin += n;
+    }
+}
+
+void Synthetic::write(
+        const std::string& path,
+        const uint64_t begin,
+        uint64_t end) const
+{
+    if (!end) end = m_points;
+
+    const std::string ext(arbiter::Arbiter::getExtension(path));
+    if (ext != "las" && ext != "laz")
+    {
+        throw std::runtime_error("Synthetic output must be LAS/LAZ: " + path);
+    }
+
+    const Schema absolute(Schema::makeAbsolute(schema()));
+
+    MemBlock block(absolute.pointSize(), 65536);
+    for (uint64_t i(begin); i < end; ++i) block.next();
+
+    BlockPointTable table(absolute);
+    table.insert(block);
+
+    pdal::PointRef pr(table, 0);
+    for (uint64_t i(begin); i < end; ++i)
+    {
+        pr.setPointId(i - begin);
+        fill(pr, i);
+    }
+
+    pdal::BufferReader reader;
+    auto view(std::make_shared<pdal::PointView>(table));
+    for (std::size_t i(0); i < table.size(); ++i) view->getOrAddPoint(i);
+    reader.addView(view);
+
+    pdal::Options options;
+    options.add("filename", path);
+    options.add("minor_version", 2);
+    options.add("dataformat_id", 3);
+    options.add("scale_x", m_scale);
+    options.add("scale_y", m_scale);
+    options.add("scale_z", m_scale);
+    options.add("offset_x", "auto");
+    options.add("offset_y", "auto");
+    options.add("offset_z", "auto");
+    if (ext == "laz") options.add("compression", "laszip");
+
+    auto lock(Executor::getLock());
+
+    pdal::LasWriter writer;
+    writer.setOptions(options);
+    writer.setInput(reader);
+    writer.prepare(table);
+
+    lock.unlock();
+
+    writer.execute(table);
+}
+
+std::string Synthetic::toString(const Distribution d)
+{
+    switch (d)
+    {
+        case Distribution::Uniform: return "uniform";
+        case Distribution::Urban: return "urban";
+        case Distribution::Terrain: return "terrain";
+        case Distribution::Pathological: return "pathological";
+        default: throw std::runtime_error("Invalid synthetic distribution");
+    }
+}
+
+Synthetic::Distribution Synthetic::toDistribution(const std::string& s)
+{
+    if (s == "uniform") return Distribution::Uniform;
+    if (s == "urban") return Distribution::Urban;
+    if (s == "terrain") return Distribution::Terrain;
+    if (s == "pathological") return Distribution::Pathological;
+    throw std::runtime_error("Invalid synthetic distribution: " + s);
+}
+
+} // namespace entwine
@@ -0,0 +1,123 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pdal/PointRef.hpp>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/dim-info.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+
+class ScanInfo;
+class VectorPointTable;
+
+// A deterministic point source for scale testing, requiring neither PDAL
+// readers nor any input data.  Each point is a pure function of the seed and
+// its index, so any range of a dataset may be generated independently, in any
+// order, with identical results.
+//
+// Synthetic inputs are addressed by path, so they may be given anywhere an
+// input file may be given:
+//
+//      synthetic://<distribution>?points=<n>&seed=<n>&scale=<s>
+//          &bounds=<xmin,ymin,zmin,xmax,ymax,zmax>&dims=<name,name,...>
+//
+// All parameters are optional.  The pipeline, including any reprojection, is
+// not applied to synthetic inputs.
+class Synthetic
+{
+public:
+    enum class Distribution
+    {
+        // Uniformly random throughout the bounds.
+        Uniform,
+
+        // Dense clusters of buildings of varying popularity over sparse
+        // ground, so node occupancy is highly skewed.
+        Urban,
+
+        // A 2.5D rolling surface with vegetation and structures above it.
+        Terrain,
+
+        // Adversarial cases: groups of exact duplicates, points on the faces
+        // and corners of the bounds, vertical lines, and tiny clusters.
+        Pathological
+    };
+
+    explicit Synthetic(const json& j = json::object());
+
+    static bool isSynthetic(const std::string& path);
+    static Synthetic fromPath(const std::string& path);
+
+    // The canonical path for this source, containing every parameter.
+    std::string path() const;
+    json toJson() const;
+
+    Distribution distribution() const { return m_distribution; }
+    uint64_t points() const { return m_points; }
+    uint64_t seed() const { return m_seed; }
+    const Bounds& bounds() const { return m_bounds; }
+    double scale() const { return m_scale; }
+
+    // XYZ, scaled by our scale factor, followed by the generated dimensions.
+    Schema schema() const;
+
+    // The result of a scan of this source, without generating any points.
+    std::unique_ptr<ScanInfo> preview() const;
+
+    // Populate the dimensions of our schema for the point at this index.  The
+    // point's layout must contain them.
+    void fill(pdal::PointRef& pr, uint64_t index) const;
+
+    // Generate points [begin, end) into the table, one capacity-sized batch
+    // at a time, as a streaming PDAL reader would.  An end of zero means the
+    // end of the dataset.
+    void run(VectorPointTable& table, uint64_t begin = 0, uint64_t end = 0)
+        const;
+
+    // Write points [begin, end) to a LAS or LAZ file, depending on the
+    // extension of the path.  These are held in memory while writing.
+    void write(const std::string& path, uint64_t begin = 0, uint64_t end = 0)
+        const;
+
+    static std::string toString(Distribution d);
+    static Distribution toDistribution(const std::string& s);
+
+private:
+    struct Cluster
+    {
+        double x = 0;
+        double y = 0;
+        double width = 0;
+        double depth = 0;
+        double height = 0;
+    };
+
+    const Distribution m_distribution;
+    const uint64_t m_points;
+    const uint64_t m_seed;
+    const Bounds m_bounds;
+    const double m_scale;
+    const DimList m_dims;
+
+    std::vector<Cluster> m_clusters;
+};
+
+} // namespace entwine
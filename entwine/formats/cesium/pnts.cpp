@@ -35,11 +35,19 @@ std::vector<char> Pnts::build()
         buildNormals(table);
     });
 
-    m_tileset.metadata().dataIo().read(
-            m_tileset.in().getSubEndpoint("ept-data"),
-            m_tileset.tmp(),
-            m_key.get().toString(),
-            table);
+    const Metadata& m(m_tileset.metadata());
+    if (m.bundled(m_key.depth()))
+    {
+        m_tileset.bundles().read(m_tileset.tmp(), m_key.get(), table);
+    }
+    else
+    {
+        m.dataIo().read(
+                m_tileset.in().getSubEndpoint("ept-data"),
+                m_tileset.tmp(),
+                m_key.get().toString(),
+                table);
+    }
 
     return buildFile();
 }
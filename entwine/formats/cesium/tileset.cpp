@@ -24,6 +24,7 @@ Tileset::Tileset(const json& config)
     , m_tmp(m_arbiter.getEndpoint(
                 config.value("tmp", arbiter::getTempPath())))
     , m_metadata(m_in)
+    , m_bundles(m_metadata, m_in)
     , m_colorType(getColorType(config))
     , m_truncate(config.value("truncate", false))
     , m_hasNormals(
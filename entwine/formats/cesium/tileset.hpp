@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <entwine/io/bundle.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/key.hpp>
 #include <entwine/types/metadata.hpp>
@@ -45,6 +46,7 @@ public:
     const arbiter::Endpoint& tmp() const { return m_tmp; }
 
     const Metadata& metadata() const { return m_metadata; }
+    const BundleReader& bundles() const { return m_bundles; }
     bool hasColor() const { return m_colorType != ColorType::None; }
     bool hasNormals() const { return m_hasNormals; }
     bool truncate() const { return m_truncate; }
@@ -75,6 +77,7 @@ private:
     const arbiter::Endpoint m_tmp;
 
     const Metadata m_metadata;
+    const BundleReader m_bundles;
     const ColorType m_colorType;
     const bool m_truncate;
     const bool m_hasNormals;
@@ -0,0 +1,753 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/formats/copc/exporter.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <stdexcept>
+
+#ifdef ENTWINE_LAZPERF
+#include <lazperf/lazperf.hpp>
+#include <lazperf/writers.hpp>
+#endif
+
+#include <entwine/io/io.hpp>
+#include <entwine/reader/hierarchy-reader.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/types/srs.hpp>
+#include <entwine/types/vector-point-table.hpp>
+#include <entwine/util/time.hpp>
+#include <entwine/util/trace.hpp>
+
+namespace entwine
+{
+namespace copc
+{
+
+namespace
+{
+    const uint16_t headerSize(375);
+    const uint64_t evlrHeaderSize(60);
+    const uint64_t infoSize(160);
+    const uint64_t entrySize(32);
+
+    // Global encoding bit marking the SRS as WKT, required for formats 6+.
+    const uint16_t wktBit(0x10);
+
+    template <typename T>
+    void put(std::vector<char>& v, const T t)
+    {
+        const char* pos(reinterpret_cast<const char*>(&t));
+        v.insert(v.end(), pos, pos + sizeof(T));
+    }
+
+    // A fixed-width, zero-padded string field.
+    void put(std::vector<char>& v, const std::string& s, const std::size_t n)
+    {
+        const std::size_t size(std::min(s.size(), n));
+        v.insert(v.end(), s.data(), s.data() + size);
+        v.insert(v.end(), n - size, 0);
+    }
+
+    template <typename T>
+    void write(char* pos, const T t)
+    {
+        std::memcpy(pos, &t, sizeof(T));
+    }
+
+    void putVlrHeader(
+            std::vector<char>& v,
+            const std::string& user,
+            const uint16_t record,
+            const uint16_t length,
+            const std::string& description)
+    {
+        put<uint16_t>(v, 0);
+        put(v, user, 16);
+        put(v, record);
+        put(v, length);
+        put(v, description, 32);
+    }
+
+    template <typename T>
+    T clampTo(const double v)
+    {
+        return static_cast<T>(std::min<double>(
+                    std::max<double>(v, std::numeric_limits<T>::lowest()),
+                    std::numeric_limits<T>::max()));
+    }
+
+    std::size_t recordLength(const uint8_t format)
+    {
+        return format == 8 ? 38 : format == 7 ? 36 : 30;
+    }
+
+    // Dimensions with a place in point formats 6 through 8.
+    bool isStandard(const DimId id, const uint8_t format)
+    {
+        switch (id)
+        {
+            case DimId::X: case DimId::Y: case DimId::Z:
+            case DimId::Intensity:
+            case DimId::ReturnNumber: case DimId::NumberOfReturns:
+            case DimId::ScanDirectionFlag: case DimId::EdgeOfFlightLine:
+            case DimId::Classification: case DimId::ClassFlags:
+            case DimId::Synthetic: case DimId::KeyPoint:
+            case DimId::Withheld: case DimId::Overlap:
+            case DimId::ScanChannel: case DimId::ScanAngleRank:
+            case DimId::UserData: case DimId::PointSourceId:
+            case DimId::GpsTime:
+                return true;
+            case DimId::Red: case DimId::Green: case DimId::Blue:
+                return format >= 7;
+            case DimId::Infrared:
+                return format == 8;
+            default:
+                return false;
+        }
+    }
+}
+
+Exporter::Totals::Totals()
+    : min(
+            std::numeric_limits<double>::max(),
+            std::numeric_limits<double>::max(),
+            std::numeric_limits<double>::max())
+    , max(
+            std::numeric_limits<double>::lowest(),
+            std::numeric_limits<double>::lowest(),
+            std::numeric_limits<double>::lowest())
+    , timeMin(std::numeric_limits<double>::max())
+    , timeMax(std::numeric_limits<double>::lowest())
+{
+    std::fill(returns, returns + 15, 0);
+}
+
+void Exporter::Totals::add(const Totals& o)
+{
+    min = Point::min(min, o.min);
+    max = Point::max(max, o.max);
+    timeMin = std::min(timeMin, o.timeMin);
+    timeMax = std::max(timeMax, o.timeMax);
+    for (std::size_t i(0); i < 15; ++i) returns[i] += o.returns[i];
+}
+
+Exporter::Exporter(const json& config)
+    : m_arbiter(config.value("arbiter", json()).dump())
+    , m_in(m_arbiter.getEndpoint(config.at("input").get<std::string>()))
+    , m_tmp(m_arbiter.getEndpoint(
+                config.value("tmp", arbiter::getTempPath())))
+    , m_output(config.at("output").get<std::string>())
+    , m_metadata(m_in)
+    , m_bundles(m_metadata, m_in)
+    , m_hierarchyStep(config.value("hierarchyStep", 0))
+    , m_pool(std::max<uint64_t>(1, config.value("threads", 8)), 2)
+{
+    const Schema& schema(m_metadata.outSchema());
+
+    if (schema.contains(DimId::Red) &&
+            schema.contains(DimId::Green) &&
+            schema.contains(DimId::Blue))
+    {
+        m_format = schema.contains(DimId::Infrared) ? 8 : 7;
+    }
+    m_recordLength = recordLength(m_format);
+
+    for (const DimInfo& dim : schema.dims())
+    {
+        if (!isStandard(dim.id(), m_format)) m_dropped.push_back(dim.name());
+    }
+
+    // Absolute outputs have no scale of their own.
+    const Bounds& bounds(m_metadata.boundsCubic());
+    if (schema.isScaled())
+    {
+        m_scale = schema.scale();
+        m_offset = schema.offset();
+    }
+    else
+    {
+        m_scale = Scale(0.01);
+        m_offset = bounds.mid().round();
+    }
+
+    for (const Point& p : { bounds.min(), bounds.max() })
+    {
+        const Point q((p - m_offset) / m_scale);
+        for (std::size_t i(0); i < 3; ++i)
+        {
+            if (std::abs(q[i]) > std::numeric_limits<int32_t>::max())
+            {
+                throw std::runtime_error(
+                        "Bounds are too large for 32-bit scaled coordinates");
+            }
+        }
+    }
+
+    m_wkt = m_metadata.srs().wkt();
+
+    arbiter::mkdirp(m_tmp.root());
+    if (m_arbiter.isLocal(m_output))
+    {
+        m_localPath = arbiter::expandTilde(m_output);
+        arbiter::mkdirp(arbiter::util::getNonBasename(m_localPath));
+    }
+    else
+    {
+        m_localPath = arbiter::expandTilde(m_tmp.fullPath(
+                    arbiter::crypto::encodeAsHex(m_output) + ".copc.laz"));
+    }
+}
+
+Exporter::~Exporter() { m_pool.join(); }
+
+bool Exporter::available()
+{
+#ifdef ENTWINE_LAZPERF
+    return true;
+#else
+    return false;
+#endif
+}
+
+Exporter::Stats Exporter::go()
+{
+    if (!available())
+    {
+        throw std::runtime_error(
+                "COPC export requires Entwine to be built with lazperf");
+    }
+
+    const auto start(now());
+
+    m_file.open(
+            m_localPath,
+            std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.good())
+    {
+        throw std::runtime_error("Could not open " + m_localPath);
+    }
+
+    // Everything ahead of the point data has a size which is known up front,
+    // so chunks may be written as soon as they are compressed.
+    m_pointOffset = headerSize + vlrs(0, 0).size();
+    m_end = m_pointOffset + 8;
+
+    const HierarchyReader reader(m_in);
+    for (const auto& p : reader.keys())
+    {
+        const Dxyz key(p.first);
+        const uint64_t np(p.second);
+        if (!np) continue;
+
+        m_pool.add([this, key, np]() { exportNode(key, np); });
+    }
+
+    m_pool.join();
+    if (!m_pool.errors().empty())
+    {
+        throw std::runtime_error("COPC export failed: " + m_pool.errors()[0]);
+    }
+
+    if (m_entries.empty()) throw std::runtime_error("No points to export");
+
+    // The chunk table follows the chunks, and its offset leads them.
+    const uint64_t tableOffset(m_end);
+    const std::vector<char> table(chunkTable());
+
+    const uint64_t evlrOffset(tableOffset + table.size());
+    uint64_t rootOffset(0);
+    uint64_t rootSize(0);
+    const std::vector<char> pages(
+            hierarchy(evlrOffset + evlrHeaderSize, rootOffset, rootSize));
+
+    std::vector<char> evlr;
+    put<uint16_t>(evlr, 0);
+    put(evlr, "copc", 16);
+    put<uint16_t>(evlr, 1000);
+    put<uint64_t>(evlr, pages.size());
+    put(evlr, "EPT hierarchy", 32);
+    evlr.insert(evlr.end(), pages.begin(), pages.end());
+
+    const std::vector<char> head(header(evlrOffset));
+    const std::vector<char> vlr(vlrs(rootOffset, rootSize));
+
+    m_file.seekp(0);
+    m_file.write(head.data(), head.size());
+    m_file.write(vlr.data(), vlr.size());
+    m_file.write(reinterpret_cast<const char*>(&tableOffset), 8);
+
+    m_file.seekp(tableOffset);
+    m_file.write(table.data(), table.size());
+    m_file.write(evlr.data(), evlr.size());
+    m_file.close();
+
+    if (!m_file) throw std::runtime_error("Failed to write " + m_localPath);
+
+    if (!m_arbiter.isLocal(m_output))
+    {
+        m_arbiter.copy(m_localPath, m_output);
+        arbiter::remove(m_localPath);
+    }
+
+    Stats stats;
+    for (const auto& p : m_entries) stats.points += p.second.points;
+    stats.nodes = m_entries.size();
+    stats.bytes = evlrOffset + evlr.size();
+    stats.seconds = since<std::chrono::milliseconds>(start) / 1000.0;
+    return stats;
+}
+
+void Exporter::exportNode(const Dxyz& key, const uint64_t np)
+{
+    Totals totals;
+    const std::vector<char> records(encode(key, np, totals));
+    const uint64_t points(records.size() / m_recordLength);
+    if (!points) return;
+
+    std::vector<char> chunk;
+
+#ifdef ENTWINE_LAZPERF
+    {
+        ENTWINE_TRACE_SPAN("copc-compress", "io");
+
+        lazperf::writer::chunk_compressor compressor(m_format, 0);
+        for (uint64_t i(0); i < points; ++i)
+        {
+            compressor.compress(records.data() + i * m_recordLength);
+        }
+
+        const std::vector<unsigned char> done(compressor.done());
+        chunk.assign(done.begin(), done.end());
+    }
+#endif
+
+    ENTWINE_TRACE_SPAN("copc-write", "io");
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Entry& entry(m_entries[key]);
+    entry.offset = m_end;
+    entry.size = chunk.size();
+    entry.points = points;
+    m_end += chunk.size();
+
+    m_file.seekp(entry.offset);
+    m_file.write(chunk.data(), chunk.size());
+    if (!m_file) throw std::runtime_error("Failed to write " + m_localPath);
+
+    m_totals.add(totals);
+}
+
+std::vector<char> Exporter::encode(
+        const Dxyz& key,
+        const uint64_t np,
+        Totals& totals) const
+{
+    ENTWINE_TRACE_SPAN("copc-encode", "io");
+
+    const Schema& schema(m_metadata.schema());
+    auto has([&schema](DimId id) { return schema.contains(id); });
+
+    const bool intensity(has(DimId::Intensity));
+    const bool returnNumber(has(DimId::ReturnNumber));
+    const bool numberOfReturns(has(DimId::NumberOfReturns));
+    const bool scanDirection(has(DimId::ScanDirectionFlag));
+    const bool edge(has(DimId::EdgeOfFlightLine));
+    const bool classification(has(DimId::Classification));
+    const bool classFlags(has(DimId::ClassFlags));
+    const bool synthetic(has(DimId::Synthetic));
+    const bool keyPoint(has(DimId::KeyPoint));
+    const bool withheld(has(DimId::Withheld));
+    const bool overlap(has(DimId::Overlap));
+    const bool channel(has(DimId::ScanChannel));
+    const bool scanAngle(has(DimId::ScanAngleRank));
+    const bool userData(has(DimId::UserData));
+    const bool pointSourceId(has(DimId::PointSourceId));
+    const bool gpsTime(has(DimId::GpsTime));
+
+    const DimId xyz[3] = { DimId::X, DimId::Y, DimId::Z };
+
+    const std::size_t length(m_recordLength);
+    std::vector<char> records;
+    records.reserve(np * length);
+
+    VectorPointTable table(schema);
+    table.setProcess([&]()
+    {
+        for (const auto& pr : table)
+        {
+            records.resize(records.size() + length, 0);
+            char* r(records.data() + records.size() - length);
+
+            for (std::size_t i(0); i < 3; ++i)
+            {
+                const double v(pr.getFieldAs<double>(xyz[i]));
+                const int32_t n(clampTo<int32_t>(
+                            std::llround((v - m_offset[i]) / m_scale[i])));
+                write(r + i * 4, n);
+
+                const double stored(n * m_scale[i] + m_offset[i]);
+                totals.min[i] = std::min(totals.min[i], stored);
+                totals.max[i] = std::max(totals.max[i], stored);
+            }
+
+            if (intensity)
+            {
+                write(r + 12, pr.getFieldAs<uint16_t>(DimId::Intensity));
+            }
+
+            uint8_t rn(0);
+            uint8_t nr(0);
+            if (returnNumber)
+            {
+                rn = pr.getFieldAs<uint8_t>(DimId::ReturnNumber) & 0x0F;
+            }
+            if (numberOfReturns)
+            {
+                nr = pr.getFieldAs<uint8_t>(DimId::NumberOfReturns) & 0x0F;
+            }
+            write<uint8_t>(r + 14, rn | (nr << 4));
+            if (rn) ++totals.returns[rn - 1];
+
+            uint8_t flags(0);
+            if (classFlags)
+            {
+                flags = pr.getFieldAs<uint8_t>(DimId::ClassFlags) & 0x0F;
+            }
+            if (synthetic && pr.getFieldAs<uint8_t>(DimId::Synthetic))
+            {
+                flags |= 0x01;
+            }
+            if (keyPoint && pr.getFieldAs<uint8_t>(DimId::KeyPoint))
+            {
+                flags |= 0x02;
+            }
+            if (withheld && pr.getFieldAs<uint8_t>(DimId::Withheld))
+            {
+                flags |= 0x04;
+            }
+            if (overlap && pr.getFieldAs<uint8_t>(DimId::Overlap))
+            {
+                flags |= 0x08;
+            }
+            if (channel)
+            {
+                flags |= (pr.getFieldAs<uint8_t>(DimId::ScanChannel) & 3) << 4;
+            }
+            if (scanDirection &&
+                    pr.getFieldAs<uint8_t>(DimId::ScanDirectionFlag))
+            {
+                flags |= 0x40;
+            }
+            if (edge && pr.getFieldAs<uint8_t>(DimId::EdgeOfFlightLine))
+            {
+                flags |= 0x80;
+            }
+            write(r + 15, flags);
+
+            if (classification)
+            {
+                write(r + 16, pr.getFieldAs<uint8_t>(DimId::Classification));
+            }
+            if (userData)
+            {
+                write(r + 17, pr.getFieldAs<uint8_t>(DimId::UserData));
+            }
+            if (scanAngle)
+            {
+                // Stored in increments of 0.006 degrees.
+                const double degrees(
+                        pr.getFieldAs<double>(DimId::ScanAngleRank));
+                write(r + 18, clampTo<int16_t>(std::round(degrees / 0.006)));
+            }
+            if (pointSourceId)
+            {
+                write(r + 20, pr.getFieldAs<uint16_t>(DimId::PointSourceId));
+            }
+            if (gpsTime)
+            {
+                const double t(pr.getFieldAs<double>(DimId::GpsTime));
+                write(r + 22, t);
+                totals.timeMin = std::min(totals.timeMin, t);
+                totals.timeMax = std::max(totals.timeMax, t);
+            }
+
+            if (m_format >= 7)
+            {
+                write(r + 30, pr.getFieldAs<uint16_t>(DimId::Red));
+                write(r + 32, pr.getFieldAs<uint16_t>(DimId::Green));
+                write(r + 34, pr.getFieldAs<uint16_t>(DimId::Blue));
+            }
+            if (m_format == 8)
+            {
+                write(r + 36, pr.getFieldAs<uint16_t>(DimId::Infrared));
+            }
+        }
+    });
+
+    if (m_metadata.bundled(key.d)) m_bundles.read(m_tmp, key, table);
+    else
+    {
+        m_metadata.dataIo().read(
+                m_in.getSubEndpoint("ept-data"),
+                m_tmp,
+                key.toString(),
+                table);
+    }
+
+    return records;
+}
+
+std::vector<char> Exporter::header(const uint64_t evlrOffset) const
+{
+    uint64_t points(0);
+    for (const auto& p : m_entries) points += p.second.points;
+
+    const std::time_t t(std::time(nullptr));
+    const std::tm* tm(std::gmtime(&t));
+
+    std::vector<char> v;
+    v.reserve(headerSize);
+
+    put(v, "LASF", 4);
+    put<uint16_t>(v, 0);                    // File source ID.
+    put<uint16_t>(v, wktBit);
+    put(v, "", 16);                         // Project GUID.
+    put<uint8_t>(v, 1);
+    put<uint8_t>(v, 4);
+    put(v, "Entwine", 32);
+    put(v, "Entwine " + currentEntwineVersion().toString(), 32);
+    put<uint16_t>(v, tm->tm_yday + 1);
+    put<uint16_t>(v, tm->tm_year + 1900);
+    put<uint16_t>(v, headerSize);
+    put<uint32_t>(v, m_pointOffset);
+    put<uint32_t>(v, m_wkt.empty() ? 2 : 3);
+    put<uint8_t>(v, m_format | 0x80);       // The high bit marks compression.
+    put<uint16_t>(v, m_recordLength);
+
+    // Legacy counts must be zero for point formats 6 and above.
+    put<uint32_t>(v, 0);
+    for (std::size_t i(0); i < 5; ++i) put<uint32_t>(v, 0);
+
+    for (std::size_t i(0); i < 3; ++i) put<double>(v, m_scale[i]);
+    for (std::size_t i(0); i < 3; ++i) put<double>(v, m_offset[i]);
+    for (std::size_t i(0); i < 3; ++i)
+    {
+        put<double>(v, m_totals.max[i]);
+        put<double>(v, m_totals.min[i]);
+    }
+
+    put<uint64_t>(v, 0);                    // Waveform data.
+    put<uint64_t>(v, evlrOffset);
+    put<uint32_t>(v, 1);
+    put<uint64_t>(v, points);
+    for (std::size_t i(0); i < 15; ++i) put<uint64_t>(v, m_totals.returns[i]);
+
+    assert(v.size() == headerSize);
+    return v;
+}
+
+std::vector<char> Exporter::vlrs(
+        const uint64_t rootOffset,
+        const uint64_t rootSize) const
+{
+    std::vector<char> v;
+
+    // The COPC info VLR must come first.
+    {
+        const Bounds& b(m_metadata.boundsCubic());
+        const bool time(m_totals.timeMin <= m_totals.timeMax);
+
+        putVlrHeader(v, "copc", 1, infoSize, "COPC info");
+        put<double>(v, b.mid().x);
+        put<double>(v, b.mid().y);
+        put<double>(v, b.mid().z);
+        put<double>(v, b.width() / 2.0);
+        put<double>(v, b.width() / m_metadata.span());
+        put<uint64_t>(v, rootOffset);
+        put<uint64_t>(v, rootSize);
+        put<double>(v, time ? m_totals.timeMin : 0);
+        put<double>(v, time ? m_totals.timeMax : 0);
+        for (std::size_t i(0); i < 11; ++i) put<uint64_t>(v, 0);
+    }
+
+    // LASzip parameters for layered chunks of variable size.
+    {
+        std::vector<std::array<uint16_t, 3>> items { { { 10, 30, 3 } } };
+        if (m_format == 7) items.push_back({ { 11, 6, 3 } });
+        if (m_format == 8) items.push_back({ { 12, 8, 3 } });
+
+        putVlrHeader(
+                v,
+                "laszip encoded",
+                22204,
+                34 + 6 * items.size(),
+                "lazperf variant");
+        put<uint16_t>(v, 3);                // Layered, chunked compressor.
+        put<uint16_t>(v, 0);                // Arithmetic coder.
+        put<uint8_t>(v, 3);
+        put<uint8_t>(v, 4);
+        put<uint16_t>(v, 3);
+        put<uint32_t>(v, 0);                // Options.
+        put<uint32_t>(v, std::numeric_limits<uint32_t>::max());
+        put<int64_t>(v, -1);                // Special EVLR count.
+        put<int64_t>(v, -1);                // Special EVLR offset.
+        put<uint16_t>(v, items.size());
+        for (const auto& item : items)
+        {
+            for (const uint16_t field : item) put(v, field);
+        }
+    }
+
+    if (!m_wkt.empty())
+    {
+        putVlrHeader(v, "LASF_Projection", 2112, m_wkt.size() + 1, "WKT");
+        put(v, m_wkt, m_wkt.size() + 1);
+    }
+
+    return v;
+}
+
+std::vector<char> Exporter::chunkTable() const
+{
+    std::vector<char> v;
+
+#ifdef ENTWINE_LAZPERF
+    // Chunks are listed in the order in which they appear in the file, each
+    // with its point count and size in bytes.
+    std::vector<Entry> entries;
+    for (const auto& p : m_entries) entries.push_back(p.second);
+    std::sort(
+            entries.begin(),
+            entries.end(),
+            [](const Entry& a, const Entry& b) { return a.offset < b.offset; });
+
+    std::vector<lazperf::chunk> chunks;
+    for (const Entry& e : entries) chunks.push_back({ e.points, e.size });
+
+    lazperf::compress_chunk_table(
+            [&v](const unsigned char* data, std::size_t size)
+            {
+                v.insert(v.end(), data, data + size);
+            },
+            chunks,
+            true);
+#endif
+
+    return v;
+}
+
+std::vector<char> Exporter::hierarchy(
+        const uint64_t payloadOffset,
+        uint64_t& rootOffset,
+        uint64_t& rootSize) const
+{
+    const Dxyz root;
+    auto isPageRoot([this](const Dxyz& k) -> bool
+    {
+        return !k.d || (m_hierarchyStep && k.d % m_hierarchyStep == 0);
+    });
+
+    // The nearest page root above this key.
+    auto parentPage([this](const Dxyz& k) -> Dxyz
+    {
+        uint64_t d(k.d - 1);
+        if (m_hierarchyStep) d -= d % m_hierarchyStep;
+        else d = 0;
+
+        const uint64_t shift(k.d - d);
+        return Dxyz(d, k.x >> shift, k.y >> shift, k.z >> shift);
+    });
+
+    // Each page holds the nodes beneath its root, down to the roots of the
+    // next pages, along with a pointer to each of those pages.
+    std::map<Dxyz, std::vector<Dxyz>> nodes;
+    std::map<Dxyz, std::vector<Dxyz>> children;
+    nodes[root];
+
+    for (const auto& p : m_entries)
+    {
+        const Dxyz& key(p.first);
+        nodes[isPageRoot(key) ? key : parentPage(key)].push_back(key);
+    }
+
+    // Link each page from the one above it, creating empty pages where a
+    // page root itself holds no points.
+    std::vector<Dxyz> unlinked;
+    for (const auto& p : nodes) if (p.first.d) unlinked.push_back(p.first);
+
+    while (!unlinked.empty())
+    {
+        const Dxyz key(unlinked.back());
+        unlinked.pop_back();
+
+        const Dxyz parent(parentPage(key));
+        if (!nodes.count(parent) && parent.d) unlinked.push_back(parent);
+        nodes[parent];
+        children[parent].push_back(key);
+    }
+
+    for (auto& p : children) std::sort(p.second.begin(), p.second.end());
+
+    std::map<Dxyz, Entry> pages;
+    uint64_t offset(payloadOffset);
+    for (const auto& p : nodes)
+    {
+        const uint64_t count(p.second.size() + children[p.first].size());
+        Entry& page(pages[p.first]);
+        page.offset = offset;
+        page.size = count * entrySize;
+        offset += page.size;
+    }
+
+    std::vector<char> v;
+    auto putEntry([&v](
+                const Dxyz& k,
+                const uint64_t offset,
+                const int32_t size,
+                const int32_t count)
+    {
+        put<int32_t>(v, k.d);
+        put<int32_t>(v, k.x);
+        put<int32_t>(v, k.y);
+        put<int32_t>(v, k.z);
+        put<uint64_t>(v, offset);
+        put<int32_t>(v, size);
+        put<int32_t>(v, count);
+    });
+
+    for (const auto& p : nodes)
+    {
+        for (const Dxyz& k : p.second)
+        {
+            const Entry& e(m_entries.at(k));
+            putEntry(k, e.offset, e.size, e.points);
+        }
+        for (const Dxyz& k : children[p.first])
+        {
+            const Entry& page(pages.at(k));
+            putEntry(k, page.offset, page.size, -1);
+        }
+    }
+
+    rootOffset = pages.at(root).offset;
+    rootSize = pages.at(root).size;
+    return v;
+}
+
+} // namespace copc
+} // namespace entwine
@@ -0,0 +1,145 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <entwine/io/bundle.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/key.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/util/json.hpp>
+#include <entwine/util/pool.hpp>
+
+namespace entwine
+{
+namespace copc
+{
+
+// Writes a completed EPT output as a single Cloud Optimized Point Cloud file:
+// LAZ 1.4 in which each octree node is one variably sized LASzip chunk, with
+// the node hierarchy in an EVLR so that clients may fetch any node by range.
+//
+// The octree of the EPT output is kept as is, so its nodes are simply read,
+// re-encoded, and compressed in parallel.  Each compressed chunk is written at
+// the next free offset as it completes, since the size of a chunk is not
+// known until then, while the header and VLRs ahead of the point data are
+// sized up front.  The chunk table and hierarchy pages follow the chunks.
+//
+// The point format is 6, or 7 or 8 if the schema has RGB or RGB and NIR.
+// Dimensions without a place in that format, such as OriginId, are dropped.
+//
+// LAZ encoding requires lazperf - see available().
+class Exporter
+{
+public:
+    // Options are "input", "output", "tmp", "threads", and "arbiter", as for
+    // the other formats, and "hierarchyStep", the depth interval at which the
+    // hierarchy is split into pages.  By default, it is a single page.
+    Exporter(const json& config);
+    ~Exporter();
+
+    static bool available();
+
+    struct Stats
+    {
+        uint64_t points = 0;
+        uint64_t nodes = 0;
+        uint64_t bytes = 0;
+        double seconds = 0;
+    };
+
+    Stats go();
+
+    const arbiter::Endpoint& in() const { return m_in; }
+    const std::string& output() const { return m_output; }
+    const Metadata& metadata() const { return m_metadata; }
+    uint8_t pointFormat() const { return m_format; }
+    std::size_t threads() const { return m_pool.numThreads(); }
+
+    // Schema dimensions which have no place in the output point format.
+    const std::vector<std::string>& dropped() const { return m_dropped; }
+
+private:
+    // The location of a compressed node within the output.
+    struct Entry
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t points = 0;
+    };
+
+    // Totals gathered from each node for the header.
+    struct Totals
+    {
+        Totals();
+        void add(const Totals& other);
+
+        Point min;
+        Point max;
+        double timeMin;
+        double timeMax;
+        uint64_t returns[15];
+    };
+
+    void exportNode(const Dxyz& key, uint64_t np);
+    std::vector<char> encode(
+            const Dxyz& key,
+            uint64_t np,
+            Totals& totals) const;
+
+    std::vector<char> header(uint64_t evlrOffset) const;
+    std::vector<char> vlrs(uint64_t rootOffset, uint64_t rootSize) const;
+    std::vector<char> chunkTable() const;
+
+    // Returns the hierarchy EVLR payload, with the offset and size of the
+    // root page, given the offset at which the payload will be written.
+    std::vector<char> hierarchy(
+            uint64_t payloadOffset,
+            uint64_t& rootOffset,
+            uint64_t& rootSize) const;
+
+    arbiter::Arbiter m_arbiter;
+    const arbiter::Endpoint m_in;
+    const arbiter::Endpoint m_tmp;
+    const std::string m_output;
+    const Metadata m_metadata;
+    const BundleReader m_bundles;
+    const uint64_t m_hierarchyStep;
+
+    uint8_t m_format = 6;
+    uint16_t m_recordLength = 30;
+    Scale m_scale;
+    Offset m_offset;
+    std::vector<std::string> m_dropped;
+    std::string m_wkt;
+
+    // Where the file is written, which is the output itself if it is local.
+    std::string m_localPath;
+    uint64_t m_pointOffset = 0;
+
+    mutable Pool m_pool;
+
+    std::mutex m_mutex;
+    std::fstream m_file;
+    uint64_t m_end = 0;
+    std::map<Dxyz, Entry> m_entries;
+    Totals m_totals;
+};
+
+} // namespace copc
+} // namespace entwine
@@ -11,12 +11,15 @@
 #include <entwine/io/binary.hpp>
 
 #include <algorithm>
+#include <limits>
 
 #include <pdal/PointRef.hpp>
 
 #include <entwine/types/binary-point-table.hpp>
 #include <entwine/types/scale-offset.hpp>
 #include <entwine/util/executor.hpp>
+#include <entwine/util/scratch.hpp>
+#include <entwine/util/trace.hpp>
 
 namespace entwine
 {
@@ -28,8 +31,11 @@ void Binary::write(
         const Bounds& bounds,
         BlockPointTable& src) const
 {
-    const auto packed(pack(src));
+    ENTWINE_TRACE_SPAN("binary-write", "io");
+
+    std::vector<char> packed(pack(src));
     ensurePut(out, filename + ".bin", packed);
+    Scratch::give(std::move(packed));
 }
 
 void Binary::read(
@@ -38,16 +44,78 @@ void Binary::read(
         const std::string& filename,
         VectorPointTable& dst) const
 {
-    auto packed(*ensureGet(out, filename + ".bin"));
+    ENTWINE_TRACE_SPAN("binary-read", "io");
+
+    auto packed(*ensureGetParallel(out, filename + ".bin"));
     unpack(dst, std::move(packed));
 }
 
+bool Binary::readPartial(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        VectorPointTable& dst,
+        const DimSet& dims,
+        const uint64_t points) const
+{
+    ENTWINE_TRACE_SPAN("binary-read-partial", "io");
+
+    const uint64_t size(partialSize(dims, points));
+    if (size == std::numeric_limits<uint64_t>::max())
+    {
+        read(out, tmp, filename, dst);
+        return false;
+    }
+
+    auto packed(*ensureGetRange(out, filename + ".bin", 0, size));
+    unpack(dst, std::move(packed));
+    return false;
+}
+
+bool Binary::readBuffer(
+        std::vector<char> data,
+        VectorPointTable& dst,
+        const DimSet& dims,
+        const uint64_t points) const
+{
+    ENTWINE_TRACE_SPAN("binary-read-buffer", "io");
+
+    unpack(dst, std::move(data));
+    return false;
+}
+
+uint64_t Binary::partialSize(const DimSet& dims, const uint64_t points) const
+{
+    const uint64_t pointSize(m_metadata.outSchema().pointSize());
+    if (points >= std::numeric_limits<uint64_t>::max() / pointSize)
+    {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return points * pointSize;
+}
+
 std::vector<char> Binary::pack(BlockPointTable& src) const
 {
     const uint64_t np(src.size());
 
+    // Every byte of each point is written below, so a scratch buffer with
+    // stale contents is fine here.
     const Schema& outSchema(m_metadata.outSchema());
-    VectorPointTable dst(outSchema, np);
+    VectorPointTable dst(
+            outSchema,
+            Scratch::take(np * outSchema.pointSize()));
+
+    // Resident data is already in our output layout.
+    if (scaled(src))
+    {
+        const uint64_t pointSize(outSchema.pointSize());
+        for (uint64_t i(0); i < np; ++i)
+        {
+            const char* pos(src.getPoint(i));
+            std::copy(pos, pos + pointSize, dst.getPoint(i));
+        }
+        return dst.acquire();
+    }
 
     // Handle XYZ separately since we might need to scale/offset them.
     pdal::DimTypeList dimTypes(outSchema.pdalLayout().dimTypes());
@@ -94,7 +162,7 @@ std::vector<char> Binary::pack(BlockPointTable& src) const
         }
     }
 
-    return dst.data();
+    return dst.acquire();
 }
 
 void Binary::unpack(VectorPointTable& dst, std::vector<char>&& packed) const
@@ -104,9 +172,17 @@ void Binary::unpack(VectorPointTable& dst, std::vector<char>&& packed) const
     const uint64_t np(src.capacity());
     assert(np <= dst.capacity());
 
-    // For reading, our destination schema will always be normalized (i.e. XYZ
-    // as doubles).  So we can just copy the full dimension list and then
-    // transform XYZ in place, if necessary.
+    if (scaled(dst))
+    {
+        std::copy(src.data().begin(), src.data().end(), dst.getPoint(0));
+        dst.clear(np);
+        Scratch::give(src.acquire());
+        return;
+    }
+
+    // Otherwise our destination schema is normalized (i.e. XYZ as doubles).
+    // So we can just copy the full dimension list and then transform XYZ in
+    // place, if necessary.
     const auto& layout(m_metadata.schema().pdalLayout());
     pdal::DimTypeList dimTypes(layout.dimTypes());
 
@@ -147,6 +223,7 @@ void Binary::unpack(VectorPointTable& dst, std::vector<char>&& packed) const
     }
 
     dst.clear(np);
+    Scratch::give(src.acquire());
 }
 
 } // namespace entwine
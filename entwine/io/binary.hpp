@@ -23,6 +23,7 @@ public:
     Binary(const Metadata& m) : DataIo(m) { }
 
     virtual std::string type() const override { return "binary"; }
+    virtual std::string extension() const override { return ".bin"; }
 
     virtual void write(
             const arbiter::Endpoint& out,
@@ -37,7 +38,31 @@ public:
             const std::string& filename,
             VectorPointTable& table) const override;
 
+    // Fetches only the byte range of the requested leading points.
+    virtual bool readPartial(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            VectorPointTable& table,
+            const DimSet& dims,
+            uint64_t points) const override;
+
+    virtual uint64_t partialSize(
+            const DimSet& dims,
+            uint64_t points) const override;
+
+    virtual bool readsBuffers() const override { return true; }
+
+    virtual bool readBuffer(
+            std::vector<char> data,
+            VectorPointTable& table,
+            const DimSet& dims,
+            uint64_t points) const override;
+
 protected:
+    // The packed buffer comes from, and the unpacked buffer is returned to,
+    // the thread's Scratch pool.  Callers of pack() should give the result
+    // back once they are done with it.
     std::vector<char> pack(BlockPointTable& src) const;
     void unpack(VectorPointTable& dst, std::vector<char>&& buffer) const;
 };
@@ -0,0 +1,344 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/io/bundle.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <entwine/io/io.hpp>
+#include <entwine/io/local-io.hpp>
+#include <entwine/io/output-stream.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/util/json.hpp>
+#include <entwine/util/memory.hpp>
+#include <entwine/util/pool.hpp>
+#include <entwine/util/trace.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Extracted nodes are named uniquely to this process, since several
+    // readers may share a temporary directory.
+    std::string tmpPrefix()
+    {
+        static const std::string prefix([]()
+        {
+            std::random_device rd;
+            const uint64_t a(rd());
+            const uint64_t b(rd());
+            const uint64_t now(
+                    std::chrono::steady_clock::now()
+                        .time_since_epoch().count());
+            return std::to_string(((a << 32) | b) ^ now);
+        }());
+        return prefix;
+    }
+
+    std::atomic_size_t tmpCounter(0);
+
+    // The bundled nodes of a hierarchy, grouped by bundle.
+    using Groups = std::map<Dxyz, std::vector<Dxyz>>;
+
+    Groups group(const Metadata& m, const Bundle::Counts& hierarchy)
+    {
+        Groups groups;
+        for (const auto& p : hierarchy)
+        {
+            const Dxyz& key(p.first);
+            if (p.second && m.bundled(key.d))
+            {
+                groups[Bundle::root(key, m.bundleDepth())].push_back(key);
+            }
+        }
+        return groups;
+    }
+
+    // A node fetched from its bundle into our temporary directory, for data
+    // types which only read nodes by name.
+    class Extracted
+    {
+    public:
+        Extracted(
+                const arbiter::Endpoint& tmp,
+                const std::string& name,
+                const std::vector<char>& data)
+            : m_path(arbiter::expandTilde(tmp.fullPath(name)))
+            , m_size(data.size())
+        {
+            LocalIo::get().write(m_path, data);
+            Memory::add(Memory::Category::Tmp, m_size);
+        }
+
+        ~Extracted()
+        {
+            arbiter::remove(m_path);
+            Memory::sub(Memory::Category::Tmp, m_size);
+        }
+
+    private:
+        const std::string m_path;
+        const uint64_t m_size;
+    };
+}
+
+Dxyz Bundle::root(const Dxyz& key, const uint64_t depth)
+{
+    assert(key.d >= depth);
+    const uint64_t shift(key.d - depth);
+    return Dxyz(depth, key.x >> shift, key.y >> shift, key.z >> shift);
+}
+
+Bundle::Index Bundle::loadIndex(
+        const arbiter::Endpoint& hierEp,
+        const Dxyz& root)
+{
+    const json j(json::parse(ensureGetString(hierEp, indexFilename(root))));
+
+    Index index;
+    for (const auto& p : j.items())
+    {
+        const json& r(p.value());
+        index[Dxyz(p.key())] =
+            Range(r.at(0).get<uint64_t>(), r.at(1).get<uint64_t>());
+    }
+    return index;
+}
+
+void Bundle::pack(
+        const Metadata& m,
+        const Dxyz& root,
+        const std::vector<Dxyz>& nodes,
+        const arbiter::Endpoint& stage,
+        const arbiter::Endpoint& dataEp,
+        const arbiter::Endpoint& hierEp)
+{
+    ENTWINE_TRACE_SPAN("bundle-pack", "io");
+
+    const std::string ext(m.dataIo().extension());
+    OutputStream stream(dataEp, filename(root));
+    json index(json::object());
+
+    for (const Dxyz& key : nodes)
+    {
+        const auto node(ensureGet(stage, key.toString() + ext));
+        index[key.toString()] = json::array({ stream.size(), node->size() });
+        stream.write(*node);
+    }
+
+    stream.close();
+    ensurePut(hierEp, indexFilename(root), index.dump());
+}
+
+void Bundle::unpack(
+        const Metadata& m,
+        const Dxyz& root,
+        const arbiter::Endpoint& dataEp,
+        const arbiter::Endpoint& hierEp,
+        const arbiter::Endpoint& stage)
+{
+    ENTWINE_TRACE_SPAN("bundle-unpack", "io");
+
+    const std::string ext(m.dataIo().extension());
+    const Index index(loadIndex(hierEp, root));
+    const auto data(ensureGetParallel(dataEp, filename(root)));
+
+    // The nodes of a bundle are staged as a single batch of writes.
+    std::vector<std::vector<char>> nodes;
+    std::vector<LocalIo::Write> writes;
+    nodes.reserve(index.size());
+
+    for (const auto& p : index)
+    {
+        const Range& r(p.second);
+        if (r.first + r.second > data->size())
+        {
+            throw std::runtime_error("Truncated bundle: " + filename(root));
+        }
+
+        const auto begin(data->begin() + r.first);
+        nodes.emplace_back(begin, begin + r.second);
+        writes.emplace_back(
+                arbiter::expandTilde(stage.fullPath(p.first.toString() + ext)),
+                nodes.back());
+    }
+
+    LocalIo::get().write(writes);
+}
+
+BundleStage::BundleStage(
+        const Metadata& metadata,
+        const arbiter::Endpoint& stage,
+        const arbiter::Endpoint& dataEp,
+        const arbiter::Endpoint& hierEp,
+        const Bundle::Counts& existing)
+    : m_metadata(metadata)
+    , m_stage(stage)
+    , m_dataEp(dataEp)
+    , m_hierEp(hierEp)
+{
+    for (const auto& g : group(m_metadata, existing)) m_packed.insert(g.first);
+}
+
+BundleStage::Entry& BundleStage::stage(const Dxyz& key)
+{
+    const Dxyz root(Bundle::root(key, m_metadata.bundleDepth()));
+
+    Entry* entry(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it(m_entries.find(root));
+        if (it == m_entries.end())
+        {
+            it = m_entries.emplace(
+                    std::piecewise_construct,
+                    std::forward_as_tuple(root),
+                    std::forward_as_tuple()).first;
+            it->second.staged = !m_packed.count(root);
+        }
+        entry = &it->second;
+    }
+
+    // Other nodes of this bundle wait for it to be unpacked, while other
+    // bundles may be unpacked concurrently.
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (!entry->staged)
+    {
+        Bundle::unpack(m_metadata, root, m_dataEp, m_hierEp, m_stage);
+        entry->staged = true;
+    }
+    return *entry;
+}
+
+const arbiter::Endpoint& BundleStage::read(const Dxyz& key)
+{
+    stage(key);
+    return m_stage;
+}
+
+const arbiter::Endpoint& BundleStage::write(const Dxyz& key)
+{
+    Entry& entry(stage(key));
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    entry.dirty = true;
+    return m_stage;
+}
+
+uint64_t BundleStage::pack(const Bundle::Counts& hierarchy, Pool& pool)
+{
+    std::vector<std::pair<Dxyz, std::vector<Dxyz>>> dirty;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& g : group(m_metadata, hierarchy))
+        {
+            const auto it(m_entries.find(g.first));
+            if (it == m_entries.end()) continue;
+
+            Entry& entry(it->second);
+            std::lock_guard<std::mutex> entryLock(entry.mutex);
+            if (!entry.dirty) continue;
+
+            entry.dirty = false;
+            dirty.emplace_back(g.first, std::move(g.second));
+        }
+    }
+
+    for (const auto& g : dirty)
+    {
+        pool.add([this, &g]()
+        {
+            Bundle::pack(
+                    m_metadata,
+                    g.first,
+                    g.second,
+                    m_stage,
+                    m_dataEp,
+                    m_hierEp);
+        });
+    }
+
+    pool.await();
+    return dirty.size();
+}
+
+BundleReader::BundleReader(
+        const Metadata& metadata,
+        const arbiter::Endpoint& out)
+    : m_metadata(metadata)
+    , m_dataEp(out.getSubEndpoint("ept-data"))
+    , m_hierEp(out.getSubEndpoint("ept-hierarchy"))
+{ }
+
+Bundle::Range BundleReader::range(const Dxyz& key) const
+{
+    const Dxyz root(Bundle::root(key, m_metadata.bundleDepth()));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it(m_indexes.find(root));
+    if (it == m_indexes.end())
+    {
+        it = m_indexes.emplace(root, Bundle::loadIndex(m_hierEp, root)).first;
+    }
+
+    const auto r(it->second.find(key));
+    if (r == it->second.end())
+    {
+        throw std::runtime_error("Missing from bundle: " + key.toString());
+    }
+    return r->second;
+}
+
+bool BundleReader::read(
+        const arbiter::Endpoint& tmp,
+        const Dxyz& key,
+        VectorPointTable& table,
+        const DimSet& dims,
+        const uint64_t points) const
+{
+    ENTWINE_TRACE_SPAN("bundle-read", "io");
+
+    const DataIo& io(m_metadata.dataIo());
+
+    // Fetch only as much of the node as this read needs.
+    const Bundle::Range r(range(key));
+    const uint64_t size(std::min(r.second, io.partialSize(dims, points)));
+    const std::string bundle(
+            Bundle::filename(Bundle::root(key, m_metadata.bundleDepth())));
+    const auto data(ensureGetRange(m_dataEp, bundle, r.first, r.first + size));
+
+    if (data->size() != size)
+    {
+        throw std::runtime_error("Truncated bundle: " + bundle);
+    }
+
+    if (io.readsBuffers())
+    {
+        return io.readBuffer(std::move(*data), table, dims, points);
+    }
+
+    // Otherwise the node is read by name, from a temporary file.
+    const std::string name(
+            key.toString() + "-" + tmpPrefix() + "-" +
+            std::to_string(++tmpCounter));
+    const Extracted extracted(tmp, name + io.extension(), *data);
+
+    return io.readPartial(tmp, tmp, name, table, dims, points);
+}
+
+} // namespace entwine
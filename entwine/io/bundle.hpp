@@ -0,0 +1,161 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/defs.hpp>
+#include <entwine/types/key.hpp>
+
+namespace entwine
+{
+
+class Metadata;
+class Pool;
+class VectorPointTable;
+
+// Deep nodes are small and numerous, so storing each as its own object makes
+// for very large object counts.  With a bundle depth configured, each node at
+// that depth is stored along with its entire subtree as a single object in
+// ept-data, named <root>.bundle.  The byte range of each node within it is
+// recorded alongside the hierarchy in ept-hierarchy/<root>-bundle.json as:
+//
+//      { "<d-x-y-z>": [offset, size], ... }
+//
+// Each range holds exactly what would otherwise be the node's own file, so
+// nodes are read by fetching their range.
+//
+// While building, bundled nodes are staged as individual files in a local
+// directory and packed when the build is saved - see BundleStage.
+class Bundle
+{
+public:
+    using Range = std::pair<uint64_t, uint64_t>;
+    using Index = std::map<Dxyz, Range>;
+    using Counts = std::map<Dxyz, uint64_t>;
+
+    // The node at the bundle depth whose subtree contains this one.
+    static Dxyz root(const Dxyz& key, uint64_t depth);
+
+    static std::string filename(const Dxyz& root)
+    {
+        return root.toString() + ".bundle";
+    }
+
+    static std::string indexFilename(const Dxyz& root)
+    {
+        return root.toString() + "-bundle.json";
+    }
+
+    static Index loadIndex(const arbiter::Endpoint& hierEp, const Dxyz& root);
+
+    // Pack the staged nodes of a bundle into the output, along with its
+    // index.
+    static void pack(
+            const Metadata& metadata,
+            const Dxyz& root,
+            const std::vector<Dxyz>& nodes,
+            const arbiter::Endpoint& stage,
+            const arbiter::Endpoint& dataEp,
+            const arbiter::Endpoint& hierEp);
+
+    // The inverse of pack, to continue an existing build.
+    static void unpack(
+            const Metadata& metadata,
+            const Dxyz& root,
+            const arbiter::Endpoint& dataEp,
+            const arbiter::Endpoint& hierEp,
+            const arbiter::Endpoint& stage);
+};
+
+// The staging directory of the bundled nodes of a build.  When continuing a
+// build, each existing bundle is unpacked only once one of its nodes is first
+// read or written, and only bundles with rewritten nodes are packed again.
+class BundleStage
+{
+public:
+    // The existing hierarchy is empty for a new build.
+    BundleStage(
+            const Metadata& metadata,
+            const arbiter::Endpoint& stage,
+            const arbiter::Endpoint& dataEp,
+            const arbiter::Endpoint& hierEp,
+            const Bundle::Counts& existing);
+
+    // The endpoint from which to read this bundled node.
+    const arbiter::Endpoint& read(const Dxyz& key);
+
+    // The endpoint to which to write this bundled node, marking its bundle to
+    // be packed on the next save.
+    const arbiter::Endpoint& write(const Dxyz& key);
+
+    // Pack the bundles with rewritten nodes.  Returns the number of bundles
+    // written.
+    uint64_t pack(const Bundle::Counts& hierarchy, Pool& pool);
+
+private:
+    struct Entry
+    {
+        std::mutex mutex;
+        bool staged = false;
+        bool dirty = false;
+    };
+
+    Entry& stage(const Dxyz& key);
+
+    const Metadata& m_metadata;
+    const arbiter::Endpoint& m_stage;
+    const arbiter::Endpoint& m_dataEp;
+    const arbiter::Endpoint& m_hierEp;
+
+    // The bundles present in the output when we started.
+    std::set<Dxyz> m_packed;
+
+    std::mutex m_mutex;
+    std::map<Dxyz, Entry> m_entries;
+};
+
+// Reads nodes of a bundled output, fetching the index of each bundle on first
+// use.
+class BundleReader
+{
+public:
+    BundleReader(const Metadata& metadata, const arbiter::Endpoint& out);
+
+    // Read a bundled node, with the semantics of DataIo::readPartial.  Only
+    // the leading bytes of the node which the read needs are fetched.
+    bool read(
+            const arbiter::Endpoint& tmp,
+            const Dxyz& key,
+            VectorPointTable& table,
+            const DimSet& dims = DimSet(),
+            uint64_t points = std::numeric_limits<uint64_t>::max()) const;
+
+private:
+    Bundle::Range range(const Dxyz& key) const;
+
+    const Metadata& m_metadata;
+    const arbiter::Endpoint m_dataEp;
+    const arbiter::Endpoint m_hierEp;
+
+    mutable std::mutex m_mutex;
+    mutable std::map<Dxyz, Bundle::Index> m_indexes;
+};
+
+} // namespace entwine
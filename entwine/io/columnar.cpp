@@ -0,0 +1,677 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/io/columnar.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <pdal/compression/ZstdCompression.hpp>
+
+#include <entwine/types/schema.hpp>
+#include <entwine/util/scratch.hpp>
+#include <entwine/util/trace.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    using Codec = Columnar::Codec;
+
+    const char magic[4] = { 'E', 'C', 'O', 'L' };
+    const uint32_t version(1);
+
+    // Fixed-size prefix: magic, version, header size.
+    const uint64_t prefixSize(12);
+
+    // Size of the initial header fetch - for typical schemas the entire
+    // header index fits within this.
+    const uint64_t headerFetchSize(4096);
+
+    // Points per row group.  Each column is encoded separately per group, so
+    // this is the granularity of prefix reads.
+    const uint64_t groupSize(16384);
+
+    // Values per independently bit-packed block of a delta column.
+    const uint64_t deltaBlockSize(1024);
+
+    struct Column
+    {
+        std::string name;
+        DimType type = DimType::None;
+        Codec codec = Codec::Zstd;
+    };
+
+    // The location of one column of one row group.
+    struct Block
+    {
+        uint64_t group = 0;
+        uint64_t column = 0;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    template<typename T>
+    void put(std::vector<char>& data, T v)
+    {
+        const char* pos(reinterpret_cast<const char*>(&v));
+        data.insert(data.end(), pos, pos + sizeof(T));
+    }
+
+    class Unpacker
+    {
+    public:
+        Unpacker(const std::vector<char>& data) : m_data(data) { }
+
+        template<typename T>
+        T get()
+        {
+            T v;
+            check(sizeof(T));
+            std::memcpy(&v, m_data.data() + m_pos, sizeof(T));
+            m_pos += sizeof(T);
+            return v;
+        }
+
+        std::string getString(uint64_t size)
+        {
+            check(size);
+            const std::string s(m_data.data() + m_pos, size);
+            m_pos += size;
+            return s;
+        }
+
+    private:
+        void check(uint64_t size) const
+        {
+            if (m_pos + size > m_data.size())
+            {
+                throw std::runtime_error("Invalid columnar data");
+            }
+        }
+
+        const std::vector<char>& m_data;
+        uint64_t m_pos = 0;
+    };
+
+    bool isSpatial(DimId id)
+    {
+        return id == DimId::X || id == DimId::Y || id == DimId::Z;
+    }
+
+    Codec selectCodec(const DimInfo& dim)
+    {
+        if (isSpatial(dim.id()) &&
+                pdal::Dimension::base(dim.type()) !=
+                    pdal::Dimension::BaseType::Floating)
+        {
+            return Codec::Delta;
+        }
+
+        if (dim.id() == DimId::Classification && dim.size() == 1)
+        {
+            return Codec::Rle;
+        }
+
+        return Codec::Zstd;
+    }
+
+    int64_t getInt(const char* pos, DimType type)
+    {
+        switch (type)
+        {
+            case DimType::Signed8:
+                { int8_t v; std::memcpy(&v, pos, 1); return v; }
+            case DimType::Signed16:
+                { int16_t v; std::memcpy(&v, pos, 2); return v; }
+            case DimType::Signed32:
+                { int32_t v; std::memcpy(&v, pos, 4); return v; }
+            case DimType::Signed64:
+                { int64_t v; std::memcpy(&v, pos, 8); return v; }
+            case DimType::Unsigned8:
+                { uint8_t v; std::memcpy(&v, pos, 1); return v; }
+            case DimType::Unsigned16:
+                { uint16_t v; std::memcpy(&v, pos, 2); return v; }
+            case DimType::Unsigned32:
+                { uint32_t v; std::memcpy(&v, pos, 4); return v; }
+            case DimType::Unsigned64:
+                { uint64_t v; std::memcpy(&v, pos, 8); return v; }
+            default:
+                throw std::runtime_error("Invalid delta column type");
+        }
+    }
+
+    void setInt(char* pos, DimType type, int64_t v)
+    {
+        // Truncation to the column width restores the original value, since
+        // every value was read from a column of this type.
+        std::memcpy(pos, &v, pdal::Dimension::size(type));
+    }
+
+    std::vector<char> compress(const std::vector<char>& data)
+    {
+        std::vector<char> compressed;
+        pdal::ZstdCompressor compressor(
+                [&compressed](char* pos, std::size_t size)
+                {
+                    compressed.insert(compressed.end(), pos, pos + size);
+                },
+                3 /* ZSTD_CLEVEL_DEFAULT */);
+
+        compressor.compress(data.data(), data.size());
+        compressor.done();
+        return compressed;
+    }
+
+    std::vector<char> decompress(const std::vector<char>& data)
+    {
+        std::vector<char> uncompressed;
+        pdal::ZstdDecompressor dec(
+                [&uncompressed](char* pos, std::size_t size)
+                {
+                    uncompressed.insert(uncompressed.end(), pos, pos + size);
+                });
+
+        dec.decompress(data.data(), data.size());
+        return uncompressed;
+    }
+
+    std::vector<char> encode(
+            const std::vector<char>& column,
+            const DimInfo& dim,
+            const Codec codec)
+    {
+        switch (codec)
+        {
+            case Codec::Delta:
+            {
+                const uint64_t size(dim.size());
+                std::vector<int64_t> values(column.size() / size);
+                for (uint64_t i(0); i < values.size(); ++i)
+                {
+                    values[i] = getInt(column.data() + i * size, dim.type());
+                }
+                return Columnar::encodeDelta(values);
+            }
+            case Codec::Rle: return Columnar::encodeRle(column);
+            case Codec::Zstd: return compress(column);
+        }
+        throw std::runtime_error("Invalid column codec");
+    }
+
+    std::vector<char> decode(
+            const std::vector<char>& data,
+            const Column& column,
+            const uint64_t np)
+    {
+        switch (column.codec)
+        {
+            case Codec::Delta:
+            {
+                const std::vector<int64_t> values(
+                        Columnar::decodeDelta(data, np));
+
+                const uint64_t size(pdal::Dimension::size(column.type));
+                std::vector<char> result(np * size);
+                for (uint64_t i(0); i < np; ++i)
+                {
+                    setInt(result.data() + i * size, column.type, values[i]);
+                }
+                return result;
+            }
+            case Codec::Rle: return Columnar::decodeRle(data, np);
+            case Codec::Zstd: return decompress(data);
+        }
+        throw std::runtime_error("Invalid column codec");
+    }
+}
+
+std::vector<char> Columnar::encodeDelta(const std::vector<int64_t>& values)
+{
+    std::vector<char> data;
+    std::vector<uint64_t> zigzag(deltaBlockSize);
+
+    uint64_t prev(0);
+
+    for (uint64_t begin(0); begin < values.size(); begin += deltaBlockSize)
+    {
+        const uint64_t n(std::min(deltaBlockSize, values.size() - begin));
+
+        uint64_t bits(0);
+        for (uint64_t i(0); i < n; ++i)
+        {
+            const uint64_t curr(values[begin + i]);
+            const uint64_t delta(curr - prev);
+            prev = curr;
+
+            zigzag[i] = (delta << 1) ^
+                static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63);
+            bits |= zigzag[i];
+        }
+
+        uint8_t width(0);
+        while (width < 64 && (bits >> width)) ++width;
+        data.push_back(width);
+
+        // Pack each value into the minimal width, least significant bits
+        // first, padding only at the end of the block.
+        uint8_t acc(0);
+        uint8_t pending(0);
+
+        for (uint64_t i(0); i < n; ++i)
+        {
+            const uint64_t v(zigzag[i]);
+
+            uint8_t got(0);
+            while (got < width)
+            {
+                const uint8_t take(std::min<uint8_t>(width - got, 8 - pending));
+                acc |= ((v >> got) & ((1u << take) - 1)) << pending;
+                pending += take;
+                got += take;
+
+                if (pending == 8)
+                {
+                    data.push_back(acc);
+                    acc = 0;
+                    pending = 0;
+                }
+            }
+        }
+
+        if (pending) data.push_back(acc);
+    }
+
+    return data;
+}
+
+std::vector<int64_t> Columnar::decodeDelta(
+        const std::vector<char>& data,
+        const uint64_t np)
+{
+    std::vector<int64_t> values(np);
+    const uint8_t* pos(reinterpret_cast<const uint8_t*>(data.data()));
+    const uint8_t* end(pos + data.size());
+
+    uint64_t prev(0);
+
+    for (uint64_t begin(0); begin < np; begin += deltaBlockSize)
+    {
+        const uint64_t n(std::min(deltaBlockSize, np - begin));
+
+        if (pos == end) throw std::runtime_error("Invalid delta column");
+        const uint8_t width(*pos++);
+
+        if (pos + (n * width + 7) / 8 > end)
+        {
+            throw std::runtime_error("Invalid delta column");
+        }
+
+        uint8_t avail(0);
+        uint8_t acc(0);
+
+        for (uint64_t i(0); i < n; ++i)
+        {
+            uint64_t v(0);
+            uint8_t got(0);
+            while (got < width)
+            {
+                if (!avail)
+                {
+                    acc = *pos++;
+                    avail = 8;
+                }
+
+                const uint8_t take(std::min<uint8_t>(width - got, avail));
+                v |= static_cast<uint64_t>(acc & ((1u << take) - 1)) << got;
+                acc >>= take;
+                avail -= take;
+                got += take;
+            }
+
+            const uint64_t delta((v >> 1) ^ (~(v & 1) + 1));
+            prev += delta;
+            values[begin + i] = prev;
+        }
+    }
+
+    return values;
+}
+
+std::vector<char> Columnar::encodeRle(const std::vector<char>& bytes)
+{
+    std::vector<char> data;
+
+    uint64_t i(0);
+    while (i < bytes.size())
+    {
+        const char value(bytes[i]);
+        uint32_t run(1);
+        while (
+                i + run < bytes.size() &&
+                bytes[i + run] == value &&
+                run < std::numeric_limits<uint32_t>::max())
+        {
+            ++run;
+        }
+
+        data.push_back(value);
+        put(data, run);
+        i += run;
+    }
+
+    return data;
+}
+
+std::vector<char> Columnar::decodeRle(
+        const std::vector<char>& data,
+        const uint64_t np)
+{
+    std::vector<char> bytes;
+    bytes.reserve(np);
+
+    Unpacker unpacker(data);
+    while (bytes.size() < np)
+    {
+        const char value(unpacker.get<char>());
+        const uint32_t run(unpacker.get<uint32_t>());
+        if (bytes.size() + run > np)
+        {
+            throw std::runtime_error("Invalid RLE column");
+        }
+        bytes.insert(bytes.end(), run, value);
+    }
+
+    return bytes;
+}
+
+void Columnar::write(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        const Bounds& bounds,
+        BlockPointTable& src) const
+{
+    ENTWINE_TRACE_SPAN("columnar-write", "io");
+
+    std::vector<char> rows(pack(src));
+
+    const Schema& schema(m_metadata.outSchema());
+    const pdal::PointLayout& layout(schema.pdalLayout());
+    const uint64_t pointSize(schema.pointSize());
+    const uint64_t np(rows.size() / pointSize);
+    const uint64_t numGroups((np + groupSize - 1) / groupSize);
+
+    std::vector<Column> columns;
+    for (const DimInfo& dim : schema.dims())
+    {
+        Column c;
+        c.name = dim.name();
+        c.type = dim.type();
+        c.codec = selectCodec(dim);
+        columns.push_back(c);
+    }
+
+    // Blocks are laid out group-major, so any prefix of row groups is a
+    // contiguous range of the file.
+    std::vector<std::vector<char>> encoded;
+    for (uint64_t g(0); g < numGroups; ++g)
+    {
+        const uint64_t begin(g * groupSize);
+        const uint64_t n(std::min(groupSize, np - begin));
+
+        for (uint64_t c(0); c < columns.size(); ++c)
+        {
+            const DimInfo& dim(schema.dims()[c]);
+            const uint64_t size(dim.size());
+            const uint64_t offset(layout.dimOffset(dim.id()));
+
+            std::vector<char> column(n * size);
+            for (uint64_t i(0); i < n; ++i)
+            {
+                const char* pos(rows.data() + (begin + i) * pointSize + offset);
+                std::copy(pos, pos + size, column.data() + i * size);
+            }
+
+            encoded.push_back(encode(column, dim, columns[c].codec));
+        }
+    }
+
+    uint64_t headerSize(prefixSize + sizeof(uint64_t) + sizeof(uint32_t) * 2);
+    for (const Column& c : columns)
+    {
+        headerSize += sizeof(uint16_t) + c.name.size() + sizeof(uint16_t) +
+            sizeof(uint8_t);
+    }
+    headerSize += encoded.size() * sizeof(uint64_t) * 2;
+
+    std::vector<char> data(magic, magic + sizeof(magic));
+    put(data, version);
+    put(data, static_cast<uint32_t>(headerSize));
+    put(data, np);
+    put(data, static_cast<uint32_t>(groupSize));
+    put(data, static_cast<uint32_t>(columns.size()));
+
+    for (const Column& c : columns)
+    {
+        put(data, static_cast<uint16_t>(c.name.size()));
+        data.insert(data.end(), c.name.begin(), c.name.end());
+        put(data, static_cast<uint16_t>(c.type));
+        put(data, static_cast<uint8_t>(c.codec));
+    }
+
+    uint64_t offset(headerSize);
+    for (const auto& e : encoded)
+    {
+        put(data, offset);
+        put(data, static_cast<uint64_t>(e.size()));
+        offset += e.size();
+    }
+
+    Scratch::give(std::move(rows));
+
+    assert(data.size() == headerSize);
+    for (const auto& e : encoded) data.insert(data.end(), e.begin(), e.end());
+
+    ensurePut(out, filename + ".col", data);
+}
+
+void Columnar::read(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        VectorPointTable& dst) const
+{
+    ENTWINE_TRACE_SPAN("columnar-read", "io");
+
+    readPartial(
+            out,
+            tmp,
+            filename,
+            dst,
+            DimSet(),
+            std::numeric_limits<uint64_t>::max());
+}
+
+bool Columnar::readPartial(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        VectorPointTable& dst,
+        const DimSet& dims,
+        const uint64_t points) const
+{
+    ENTWINE_TRACE_SPAN("columnar-read-partial", "io");
+
+    const std::string path(filename + ".col");
+    const Fetch fetch([&out, &path](uint64_t begin, uint64_t end)
+    {
+        return std::move(*ensureGetRange(out, path, begin, end));
+    });
+
+    return readColumns(path, fetch, dst, dims, points);
+}
+
+bool Columnar::readBuffer(
+        std::vector<char> data,
+        VectorPointTable& dst,
+        const DimSet& dims,
+        const uint64_t points) const
+{
+    ENTWINE_TRACE_SPAN("columnar-read-buffer", "io");
+
+    const Fetch fetch([&data](uint64_t begin, uint64_t end)
+    {
+        begin = std::min<uint64_t>(begin, data.size());
+        end = std::min<uint64_t>(end, data.size());
+        return std::vector<char>(data.begin() + begin, data.begin() + end);
+    });
+
+    return readColumns("in-memory node", fetch, dst, dims, points);
+}
+
+bool Columnar::readColumns(
+        const std::string& path,
+        const Fetch& fetch,
+        VectorPointTable& dst,
+        const DimSet& dims,
+        const uint64_t points) const
+{
+    std::vector<char> header(fetch(0, headerFetchSize));
+
+    {
+        Unpacker unpacker(header);
+        if (unpacker.getString(sizeof(magic)) != std::string(magic, 4))
+        {
+            throw std::runtime_error("Invalid columnar magic: " + path);
+        }
+
+        if (unpacker.get<uint32_t>() != version)
+        {
+            throw std::runtime_error("Unsupported columnar version: " + path);
+        }
+
+        const uint32_t headerSize(unpacker.get<uint32_t>());
+        if (headerSize > header.size())
+        {
+            header = fetch(0, headerSize);
+        }
+    }
+
+    Unpacker unpacker(header);
+    unpacker.getString(prefixSize);
+
+    const uint64_t np(unpacker.get<uint64_t>());
+    const uint64_t fileGroupSize(unpacker.get<uint32_t>());
+    const uint64_t numColumns(unpacker.get<uint32_t>());
+
+    if (!fileGroupSize) throw std::runtime_error("Invalid group size: " + path);
+    const uint64_t numGroups((np + fileGroupSize - 1) / fileGroupSize);
+
+    std::vector<Column> columns;
+    for (uint64_t i(0); i < numColumns; ++i)
+    {
+        Column c;
+        c.name = unpacker.getString(unpacker.get<uint16_t>());
+        c.type = static_cast<DimType>(unpacker.get<uint16_t>());
+        c.codec = static_cast<Codec>(unpacker.get<uint8_t>());
+        columns.push_back(c);
+    }
+
+    const Schema& schema(m_metadata.outSchema());
+    const pdal::PointLayout& layout(schema.pdalLayout());
+    const uint64_t pointSize(schema.pointSize());
+
+    // Only fetch the row groups covering the requested prefix, and within
+    // them only the columns we need.
+    const uint64_t groups(
+            std::min(numGroups, points / fileGroupSize +
+                (points % fileGroupSize ? 1 : 0)));
+    const uint64_t count(std::min(np, groups * fileGroupSize));
+
+    std::vector<Block> blocks;
+    for (uint64_t g(0); g < numGroups; ++g)
+    {
+        for (uint64_t c(0); c < numColumns; ++c)
+        {
+            Block b;
+            b.group = g;
+            b.column = c;
+            b.offset = unpacker.get<uint64_t>();
+            b.size = unpacker.get<uint64_t>();
+
+            if (g < groups &&
+                    (dims.empty() || dims.count(schema.getId(columns[c].name))))
+            {
+                blocks.push_back(b);
+            }
+        }
+    }
+
+    // Dimensions we don't read must be zeroed.
+    std::vector<char> rows(Scratch::take(count * pointSize));
+    if (!dims.empty()) std::fill(rows.begin(), rows.end(), 0);
+
+    // Blocks are stored in order, so adjacent selections are fetched with a
+    // single ranged read.
+    auto it(blocks.begin());
+    while (it != blocks.end())
+    {
+        auto run(it);
+        uint64_t end(it->offset + it->size);
+        while (++run != blocks.end() && run->offset == end) end += run->size;
+
+        const uint64_t begin(it->offset);
+        const std::vector<char> fetched(fetch(begin, end));
+
+        if (fetched.size() != end - begin)
+        {
+            throw std::runtime_error("Truncated columnar data: " + path);
+        }
+
+        for ( ; it != run; ++it)
+        {
+            const Column& c(columns[it->column]);
+            const uint64_t first(it->group * fileGroupSize);
+            const uint64_t n(std::min(fileGroupSize, np - first));
+
+            const auto pos(fetched.begin() + (it->offset - begin));
+            const std::vector<char> column(
+                    decode(std::vector<char>(pos, pos + it->size), c, n));
+
+            const DimId id(schema.getId(c.name));
+            const uint64_t size(pdal::Dimension::size(c.type));
+            const uint64_t offset(layout.dimOffset(id));
+
+            if (column.size() != n * size)
+            {
+                throw std::runtime_error("Invalid column size: " + c.name);
+            }
+
+            for (uint64_t i(0); i < n; ++i)
+            {
+                const char* src(column.data() + i * size);
+                std::copy(
+                        src,
+                        src + size,
+                        rows.data() + (first + i) * pointSize + offset);
+            }
+        }
+    }
+
+    unpack(dst, std::move(rows));
+    return true;
+}
+
+} // namespace entwine
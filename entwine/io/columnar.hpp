@@ -0,0 +1,102 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <entwine/io/binary.hpp>
+
+namespace entwine
+{
+
+// Stores each node as a header index followed by one encoded block per
+// dimension per row group, so readers may fetch and decode only the
+// dimensions, and the leading row groups, that they need.
+//
+// Scaled integral XYZ are delta-encoded and bit-packed, Classification is
+// run-length encoded, and everything else is compressed with zstandard.
+class Columnar : public Binary
+{
+public:
+    Columnar(const Metadata& m) : Binary(m) { }
+
+    enum class Codec : uint8_t
+    {
+        Zstd = 0,
+        Delta = 1,
+        Rle = 2
+    };
+
+    virtual std::string type() const override { return "columnar"; }
+    virtual std::string extension() const override { return ".col"; }
+
+    virtual void write(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            const Bounds& bounds,
+            BlockPointTable& table) const override;
+
+    virtual void read(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            VectorPointTable& table) const override;
+
+    virtual bool readPartial(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            VectorPointTable& table,
+            const DimSet& dims,
+            uint64_t points) const override;
+
+    virtual bool readBuffer(
+            std::vector<char> data,
+            VectorPointTable& table,
+            const DimSet& dims,
+            uint64_t points) const override;
+
+    // Columns are located by the header, so the entire file is needed.
+    virtual uint64_t partialSize(
+            const DimSet& dims,
+            uint64_t points) const override
+    {
+        return DataIo::partialSize(dims, points);
+    }
+
+    // Exposed for testing.
+    static std::vector<char> encodeDelta(const std::vector<int64_t>& values);
+    static std::vector<int64_t> decodeDelta(
+            const std::vector<char>& data,
+            uint64_t np);
+
+    static std::vector<char> encodeRle(const std::vector<char>& bytes);
+    static std::vector<char> decodeRle(
+            const std::vector<char>& data,
+            uint64_t np);
+
+private:
+    // Fetches the byte range [begin, end) of a node's file.
+    using Fetch = std::function<std::vector<char>(uint64_t, uint64_t)>;
+
+    bool readColumns(
+            const std::string& path,
+            const Fetch& fetch,
+            VectorPointTable& table,
+            const DimSet& dims,
+            uint64_t points) const;
+};
+
+} // namespace entwine
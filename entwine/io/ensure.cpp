@@ -10,11 +10,18 @@
 
 #include <entwine/io/ensure.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <iostream>
 #include <mutex>
 #include <thread>
 
+#include <entwine/io/local-io.hpp>
+#include <entwine/util/pool.hpp>
+#include <entwine/util/trace.hpp>
+#include <entwine/util/unique.hpp>
+
 namespace
 {
     const std::size_t retries(40);
@@ -22,6 +29,7 @@ namespace
 
     void sleep(std::size_t tried, std::string method, std::string path)
     {
+        ENTWINE_TRACE_SPAN("retry", "wait");
         std::this_thread::sleep_for(std::chrono::seconds(tried));
 
         std::lock_guard<std::mutex> lock(mutex);
@@ -45,11 +53,23 @@ namespace
 namespace entwine
 {
 
+namespace
+{
+    std::string localPath(
+            const arbiter::Endpoint& endpoint,
+            const std::string& path)
+    {
+        return arbiter::expandTilde(endpoint.fullPath(path));
+    }
+}
+
 void ensurePut(
         const arbiter::Endpoint& endpoint,
         const std::string& path,
         const std::vector<char>& data)
 {
+    ENTWINE_TRACE_SPAN("put", "io");
+
     bool done(false);
     std::size_t tried(0);
 
@@ -57,7 +77,11 @@ void ensurePut(
     {
         try
         {
-            endpoint.put(path, data);
+            if (endpoint.isLocal())
+            {
+                LocalIo::get().write(localPath(endpoint, path), data);
+            }
+            else endpoint.put(path, data);
             done = true;
         }
         catch (...)
@@ -71,10 +95,40 @@ void ensurePut(
     }
 }
 
+std::string ensurePutPart(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const std::string& uploadId,
+        const std::size_t partNumber,
+        const std::vector<char>& data)
+{
+    ENTWINE_TRACE_SPAN("put-part", "io");
+
+    std::size_t tried(0);
+
+    while (true)
+    {
+        try
+        {
+            return endpoint.putPart(path, uploadId, partNumber, data);
+        }
+        catch (...)
+        {
+            if (++tried < retries)
+            {
+                sleep(tried, "PUT part", endpoint.prefixedRoot() + path);
+            }
+            else suicide("PUT part");
+        }
+    }
+}
+
 std::unique_ptr<std::vector<char>> ensureGet(
         const arbiter::Endpoint& endpoint,
         const std::string& path)
 {
+    ENTWINE_TRACE_SPAN("get", "io");
+
     std::unique_ptr<std::vector<char>> data;
 
     bool done(false);
@@ -82,7 +136,9 @@ std::unique_ptr<std::vector<char>> ensureGet(
 
     while (!done)
     {
-        data = endpoint.tryGetBinary(path);
+        data = endpoint.isLocal() ?
+            LocalIo::get().read(localPath(endpoint, path)) :
+            endpoint.tryGetBinary(path);
 
         if (data)
         {
@@ -101,6 +157,135 @@ std::unique_ptr<std::vector<char>> ensureGet(
     return data;
 }
 
+std::unique_ptr<std::vector<char>> ensureGetRange(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const uint64_t begin,
+        const uint64_t end)
+{
+    ENTWINE_TRACE_SPAN("get-range", "io");
+
+    assert(begin <= end);
+    if (begin == end) return makeUnique<std::vector<char>>();
+
+    std::unique_ptr<std::vector<char>> data;
+
+    if (endpoint.isLocal())
+    {
+        // Clamped to the file size, so callers may request an open-ended
+        // range.
+        const std::string filename(localPath(endpoint, path));
+
+        std::size_t tried(0);
+        while (!(data = LocalIo::get().read(filename, begin, end)))
+        {
+            if (++tried < retries) sleep(tried, "GET", filename);
+            else suicide("GET");
+        }
+    }
+    else if (endpoint.isHttpDerived())
+    {
+        arbiter::http::Headers headers;
+        headers["Range"] =
+            "bytes=" + std::to_string(begin) + "-" + std::to_string(end - 1);
+
+        std::size_t tried(0);
+        while (!data)
+        {
+            data = endpoint.tryGetBinary(path, headers);
+            if (data) break;
+
+            // A range starting at or past the end of the file is rejected by
+            // the server.  Like local reads, the result is instead clamped to
+            // the file size, so it is empty.
+            if (const auto size = endpoint.tryGetSize(path))
+            {
+                if (*size <= begin) return makeUnique<std::vector<char>>();
+            }
+
+            if (++tried < retries)
+            {
+                sleep(tried, "GET", endpoint.prefixedRoot() + path);
+            }
+            else suicide("GET");
+        }
+    }
+    else
+    {
+        data = ensureGet(endpoint, path);
+        const uint64_t size(data->size());
+        data->erase(data->begin() + std::min(end, size), data->end());
+        data->erase(data->begin(), data->begin() + std::min(begin, size));
+    }
+
+    return data;
+}
+
+std::unique_ptr<std::vector<char>> ensureGetParallel(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const uint64_t partSize,
+        const std::size_t threads)
+{
+    if (!endpoint.isHttpDerived() || !partSize)
+    {
+        return ensureGet(endpoint, path);
+    }
+
+    // Speculatively fetch the first part.  If the file fits within it, or the
+    // server ignored our range and sent everything, we're done.  An empty file
+    // yields an empty first part.
+    std::unique_ptr<std::vector<char>> data(
+            ensureGetRange(endpoint, path, 0, partSize));
+    if (data->size() != partSize) return data;
+
+    std::unique_ptr<std::size_t> size;
+    std::size_t tried(0);
+    while (!(size = endpoint.tryGetSize(path)))
+    {
+        if (++tried < retries)
+        {
+            sleep(tried, "HEAD", endpoint.prefixedRoot() + path);
+        }
+        else suicide("HEAD");
+    }
+
+    if (*size <= partSize) return data;
+
+    data->resize(*size);
+
+    const uint64_t parts((*size + partSize - 1) / partSize);
+    Pool pool(std::min<uint64_t>(threads, parts - 1), parts, false);
+
+    char* dst(data->data());
+    for (uint64_t part(1); part < parts; ++part)
+    {
+        const uint64_t begin(part * partSize);
+        const uint64_t end(std::min<uint64_t>(begin + partSize, *size));
+
+        pool.add([&endpoint, &path, dst, begin, end]()
+        {
+            const auto chunk(ensureGetRange(endpoint, path, begin, end));
+            if (chunk->size() != end - begin)
+            {
+                throw std::runtime_error("Unexpected ranged GET size");
+            }
+            std::copy(chunk->begin(), chunk->end(), dst + begin);
+        });
+    }
+
+    pool.join();
+
+    if (!pool.errors().empty())
+    {
+        throw std::runtime_error(
+                "Failed parallel GET of " + endpoint.prefixedRoot() + path +
+                ": " + pool.errors().front());
+    }
+
+    return data;
+}
+
 std::string ensureGetString(
         const arbiter::Endpoint& endpoint,
         const std::string& path)
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -32,10 +33,36 @@ inline void ensurePut(
     ensurePut(endpoint, path, std::vector<char>(data.begin(), data.end()));
 }
 
+// Upload one part of a multipart upload, numbered from 1, with the retries of
+// ensurePut.  Returns the ETag of the part.
+std::string ensurePutPart(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const std::string& uploadId,
+        std::size_t partNumber,
+        const std::vector<char>& data);
+
 std::unique_ptr<std::vector<char>> ensureGet(
         const arbiter::Endpoint& endpoint,
         const std::string& path);
 
+// Fetch the byte range [begin, end) of a file.  The result may be shorter than
+// requested, or empty, if the range extends past the end of the file.
+std::unique_ptr<std::vector<char>> ensureGetRange(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        uint64_t begin,
+        uint64_t end);
+
+// Fetch a file, splitting remote files larger than partSize into ranged GETs
+// of that size which are run in parallel and assembled in memory.  Files no
+// larger than a single part cost a single request.
+std::unique_ptr<std::vector<char>> ensureGetParallel(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        uint64_t partSize = 4 * 1024 * 1024,
+        std::size_t threads = 8);
+
 std::string ensureGetString(
         const arbiter::Endpoint& endpoint,
         const std::string& path);
@@ -11,8 +11,11 @@
 #pragma once
 
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <entwine/io/ensure.hpp>
 #include <entwine/types/metadata.hpp>
@@ -31,6 +34,9 @@ public:
 
     virtual std::string type() const = 0;
 
+    // The suffix appended to the filename of each node.
+    virtual std::string extension() const = 0;
+
     virtual void write(
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
@@ -46,7 +52,57 @@ public:
             VectorPointTable& table) const
     { }
 
+    // Read at least the given dimensions, where an empty set means all of
+    // them, for at least the first `points` points of the node.  Returns true
+    // if only the requested dimensions were read, in which case the others
+    // are zeroed, or false if every dimension was read.  Data types without
+    // support for partial reads read the entire node.
+    virtual bool readPartial(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            VectorPointTable& table,
+            const DimSet& dims,
+            uint64_t points) const
+    {
+        read(out, tmp, filename, table);
+        return false;
+    }
+
+    // The number of leading bytes of a node's file which suffice for the
+    // readPartial above, or the maximum value if the entire file is needed.
+    virtual uint64_t partialSize(const DimSet& dims, uint64_t points) const
+    {
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+    // Whether readBuffer below is supported.  Data types which hand their
+    // files to PDAL by name must read them from a file.
+    virtual bool readsBuffers() const { return false; }
+
+    // Read a node from the contents of its file, already in memory, with the
+    // semantics of readPartial.  The data may be only the leading
+    // partialSize() bytes of the file.
+    virtual bool readBuffer(
+            std::vector<char> data,
+            VectorPointTable& table,
+            const DimSet& dims,
+            uint64_t points) const
+    {
+        throw std::runtime_error("Cannot read " + type() + " from memory");
+    }
+
 protected:
+    // True if the XYZ values of this table are stored as scaled integers in
+    // the output schema layout, rather than as absolute doubles.  This is the
+    // case for builder tables of a scaled-resident build.
+    bool scaled(const pdal::BasePointTable& table) const
+    {
+        return m_metadata.scaledResident() &&
+            table.layout()->dimType(pdal::Dimension::Id::X) !=
+                pdal::Dimension::Type::Double;
+    }
+
     const Metadata& m_metadata;
 };
 
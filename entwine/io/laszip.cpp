@@ -10,23 +10,93 @@
 
 #include <entwine/io/laszip.hpp>
 
-#include <pdal/filters/SortFilter.hpp>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
 #include <pdal/io/BufferReader.hpp>
 #include <pdal/io/LasReader.hpp>
 #include <pdal/io/LasWriter.hpp>
 
+#include <entwine/io/local-io.hpp>
+#include <entwine/io/output-stream.hpp>
+#include <entwine/types/rescaler.hpp>
 #include <entwine/util/executor.hpp>
+#include <entwine/util/memory.hpp>
+#include <entwine/util/trace.hpp>
+#include <entwine/util/unique.hpp>
 
 namespace entwine
 {
 
+namespace
+{
+    std::atomic_size_t tmpCounter(0);
+
+    class TmpFile
+    {
+    public:
+        TmpFile(
+                const arbiter::Endpoint& tmp,
+                const std::string& name,
+                const std::vector<char>& data)
+            : m_path(arbiter::expandTilde(tmp.fullPath(name)))
+            , m_size(data.size())
+        {
+            LocalIo::get().write(m_path, data);
+            Memory::add(Memory::Category::Tmp, m_size);
+        }
+
+        ~TmpFile()
+        {
+            arbiter::remove(m_path);
+            Memory::sub(Memory::Category::Tmp, m_size);
+        }
+
+        const std::string& path() const { return m_path; }
+
+    private:
+        const std::string m_path;
+        const uint64_t m_size;
+    };
+}
+
 void Laz::write(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
         const std::string& filename,
         const Bounds& bounds,
-        BlockPointTable& table) const
+        BlockPointTable& src) const
 {
+    ENTWINE_TRACE_SPAN("laszip-write", "io");
+
+    // LasWriter expects absolute coordinates, so resident data from a
+    // scaled-resident build is unscaled into a temporary block first.
+    std::unique_ptr<MemBlock> block;
+    std::unique_ptr<BlockPointTable> absolute;
+
+    if (scaled(src))
+    {
+        const Schema& schema(m_metadata.schema());
+        block = makeUnique<MemBlock>(schema.pointSize(), src.size());
+        absolute = makeUnique<BlockPointTable>(schema);
+
+        std::unique_ptr<ScaleOffset> so(m_metadata.outSchema().scaleOffset());
+        Rescaler rescaler(schema, *so);
+
+        pdal::PointRef pr(src, 0);
+        for (uint64_t i(0); i < src.size(); ++i)
+        {
+            pr.setPointId(i);
+            rescaler.unscale(pr, block->next());
+        }
+
+        absolute->insert(*block);
+    }
+
+    BlockPointTable& table(absolute ? *absolute : src);
+
     const bool local(out.isLocal());
     const std::string localDir(
             local ? out.prefixedRoot() : tmp.prefixedRoot());
@@ -65,24 +135,10 @@ void Laz::write(
 
     auto lock(Executor::getLock());
 
-    pdal::Stage* prev(&reader);
-
-    std::unique_ptr<pdal::SortFilter> sort;
-    if (outSchema.contains("GpsTime"))
-    {
-        sort = makeUnique<pdal::SortFilter>();
-
-        pdal::Options so;
-        so.add("dimension", "GpsTime");
-        sort->setOptions(so);
-        sort->setInput(*prev);
-
-        prev = sort.get();
-    }
-
+    // Points are already in the configured node order - see sortNode.
     pdal::LasWriter writer;
     writer.setOptions(options);
-    writer.setInput(*prev);
+    writer.setInput(reader);
     writer.prepare(table);
 
     lock.unlock();
@@ -91,8 +147,32 @@ void Laz::write(
 
     if (!local)
     {
-        ensurePut(out, filename + ".laz", tmp.getBinary(localFile));
-        arbiter::remove(tmp.prefixedRoot() + localFile);
+        // Copy the file to its destination through an OutputStream.  For S3
+        // it is uploaded in parts, so it is never held in memory whole.  Other
+        // remote drivers still receive it with a single PUT - see PartSink.
+        const std::string localPath(arbiter::expandTilde(localDir + localFile));
+
+        {
+            std::ifstream file(localPath, std::ios::in | std::ios::binary);
+            if (!file) throw std::runtime_error("Could not open " + localPath);
+
+            OutputStream stream(out, filename + ".laz");
+
+            std::vector<char> buffer(1024 * 1024);
+            while (file.read(buffer.data(), buffer.size()) || file.gcount())
+            {
+                stream.write(buffer.data(), file.gcount());
+            }
+
+            if (!file.eof())
+            {
+                throw std::runtime_error("Could not read " + localPath);
+            }
+
+            stream.close();
+        }
+
+        arbiter::remove(localPath);
     }
 }
 
@@ -100,13 +180,81 @@ void Laz::read(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
         const std::string& filename,
-        VectorPointTable& table) const
+        VectorPointTable& dst) const
 {
-    auto handle(out.getLocalHandle(filename + ".laz"));
+    ENTWINE_TRACE_SPAN("laszip-read", "io");
+
+    readPartial(
+            out,
+            tmp,
+            filename,
+            dst,
+            DimSet(),
+            std::numeric_limits<uint64_t>::max());
+}
+
+bool Laz::readPartial(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        VectorPointTable& dst,
+        const DimSet& dims,
+        const uint64_t points) const
+{
+    ENTWINE_TRACE_SPAN("laszip-read-partial", "io");
+
+    // LasReader needs a local file.  Remote nodes are fetched in parallel
+    // parts into memory and then written to our temporary directory.
+    std::unique_ptr<TmpFile> remote;
+    if (!out.isLocal())
+    {
+        remote = makeUnique<TmpFile>(
+                tmp,
+                arbiter::crypto::encodeAsHex(filename) + "-" +
+                    std::to_string(++tmpCounter) + ".laz",
+                *ensureGetParallel(out, filename + ".laz"));
+    }
+
+    const std::string localPath(
+            remote ?
+                remote->path() :
+                arbiter::expandTilde(out.fullPath(filename + ".laz")));
+
+    // LasReader produces absolute coordinates - for a scaled-resident
+    // destination, read into an absolute table and rescale as we go.
+    std::unique_ptr<VectorPointTable> absolute;
+    std::unique_ptr<ScaleOffset> so;
+    std::unique_ptr<Rescaler> rescaler;
+
+    if (scaled(dst))
+    {
+        const Schema& schema(m_metadata.schema());
+        absolute = makeUnique<VectorPointTable>(schema, dst.capacity());
+        so = m_metadata.outSchema().scaleOffset();
+        rescaler = makeUnique<Rescaler>(m_metadata.outSchema(), *so);
+
+        VectorPointTable& tmp(*absolute);
+        Rescaler& r(*rescaler);
+        tmp.setProcess([&tmp, &dst, &r]()
+        {
+            pdal::PointId i(0);
+            for (auto it(tmp.begin()); it != tmp.end(); ++it)
+            {
+                r.scale(it.pointRef(), dst.getPoint(i++));
+            }
+            dst.clear(i);
+        });
+    }
+
+    pdal::StreamPointTable& table(
+            absolute ?
+                static_cast<pdal::StreamPointTable&>(*absolute) :
+                static_cast<pdal::StreamPointTable&>(dst));
 
     pdal::Options o;
-    o.add("filename", handle->localPath());
+    o.add("filename", localPath);
     o.add("use_eb_vlr", true);
+    if (points < std::numeric_limits<uint64_t>::max()) o.add("count", points);
 
     pdal::LasReader reader;
     reader.setOptions(o);
@@ -117,6 +265,7 @@ void Laz::read(
     }
 
     reader.execute(table);
+    return false;
 }
 
 } // namespace entwine
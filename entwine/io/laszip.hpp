@@ -28,6 +28,7 @@ public:
     }
 
     virtual std::string type() const override { return "laszip"; }
+    virtual std::string extension() const override { return ".laz"; }
 
     virtual void write(
             const arbiter::Endpoint& out,
@@ -41,6 +42,16 @@ public:
             const arbiter::Endpoint& tmp,
             const std::string& filename,
             VectorPointTable& table) const override;
+
+    // Decompresses only the LAZ chunks containing the requested leading
+    // points.  The file itself is still fetched in full.
+    virtual bool readPartial(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            VectorPointTable& table,
+            const DimSet& dims,
+            uint64_t points) const override;
 };
 
 } // namespace entwine
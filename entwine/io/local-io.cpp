@@ -0,0 +1,215 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/io/local-io.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <entwine/util/trace.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+// A read or write of a range of an open file, which is complete once all of
+// its bytes are transferred, or upon error or end of file.
+struct LocalIo::Op
+{
+    int fd = -1;
+    bool write = false;
+    char* data = nullptr;
+    uint64_t size = 0;
+    uint64_t offset = 0;
+
+    uint64_t done = 0;
+    int error = 0;
+};
+
+namespace
+{
+    std::string describe(const int error) { return std::strerror(error); }
+
+#ifndef _WIN32
+    class File
+    {
+    public:
+        File(const std::string& path, const bool write)
+            : m_fd(write ?
+                    ::open(
+                        path.c_str(),
+                        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                        0644) :
+                    ::open(path.c_str(), O_RDONLY | O_CLOEXEC))
+            , m_error(m_fd < 0 ? errno : 0)
+        { }
+
+        ~File() { close(); }
+
+        int fd() const { return m_fd; }
+        int error() const { return m_error; }
+
+        uint64_t size() const
+        {
+            struct stat st;
+            return ::fstat(m_fd, &st) ? 0 : st.st_size;
+        }
+
+        // Errors of deferred writes may only surface here.
+        int close()
+        {
+            if (m_fd >= 0 && ::close(m_fd)) m_error = errno;
+            m_fd = -1;
+            return m_error;
+        }
+
+    private:
+        int m_fd;
+        int m_error;
+    };
+#endif
+}
+
+void LocalIo::run(std::vector<Op>& ops)
+{
+#ifndef _WIN32
+    for (Op& op : ops)
+    {
+        while (op.done < op.size && !op.error)
+        {
+            char* pos(op.data + op.done);
+            const std::size_t size(op.size - op.done);
+            const off_t offset(op.offset + op.done);
+
+            const ssize_t n(op.write ?
+                    ::pwrite(op.fd, pos, size, offset) :
+                    ::pread(op.fd, pos, size, offset));
+
+            if (n > 0) op.done += n;
+            else if (!n) { if (op.write) op.error = EIO; break; }
+            else if (errno != EINTR && errno != EAGAIN) op.error = errno;
+        }
+    }
+#endif
+}
+
+void LocalIo::write(const std::string& path, const std::vector<char>& data)
+{
+    write(std::vector<Write> { Write(path, data) });
+}
+
+void LocalIo::write(const std::vector<Write>& writes)
+{
+    ENTWINE_TRACE_SPAN("local-write", "io");
+
+#ifndef _WIN32
+    std::vector<std::unique_ptr<File>> files;
+    std::vector<Op> ops;
+
+    for (const Write& w : writes)
+    {
+        files.push_back(makeUnique<File>(w.path, true));
+        const File& file(*files.back());
+        if (file.fd() < 0)
+        {
+            throw std::runtime_error(
+                    "Could not open " + w.path + " for writing: " +
+                    describe(file.error()));
+        }
+
+        Op op;
+        op.fd = file.fd();
+        op.write = true;
+        op.data = const_cast<char*>(w.data->data());
+        op.size = w.data->size();
+        ops.push_back(op);
+    }
+
+    run(ops);
+
+    std::string error;
+    for (std::size_t i(0); i < writes.size(); ++i)
+    {
+        const int e(ops[i].error ? ops[i].error : files[i]->close());
+        if (e && error.empty())
+        {
+            error = "Error writing " + writes[i].path + ": " + describe(e);
+        }
+    }
+
+    if (!error.empty()) throw std::runtime_error(error);
+#else
+    for (const Write& w : writes)
+    {
+        std::ofstream file(
+                w.path,
+                std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(w.data->data(), w.data->size());
+        if (!file.good()) throw std::runtime_error("Error writing " + w.path);
+    }
+#endif
+}
+
+std::unique_ptr<std::vector<char>> LocalIo::read(
+        const std::string& path,
+        const uint64_t begin,
+        const uint64_t end)
+{
+    ENTWINE_TRACE_SPAN("local-read", "io");
+
+    std::unique_ptr<std::vector<char>> data;
+
+#ifndef _WIN32
+    File file(path, false);
+    if (file.fd() < 0) return data;
+
+    const uint64_t stop(std::min(end, file.size()));
+    const uint64_t start(std::min(begin, stop));
+    data = makeUnique<std::vector<char>>(stop - start);
+
+    std::vector<Op> ops(1);
+    Op& op(ops.front());
+    op.fd = file.fd();
+    op.data = data->data();
+    op.size = data->size();
+    op.offset = start;
+
+    run(ops);
+
+    if (op.error) data.reset();
+    else data->resize(op.done);
+#else
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.good()) return data;
+
+    file.seekg(0, std::ios::end);
+    const uint64_t size(std::max<std::streamoff>(file.tellg(), 0));
+    const uint64_t stop(std::min(end, size));
+    const uint64_t start(std::min(begin, stop));
+
+    data = makeUnique<std::vector<char>>(stop - start);
+    file.seekg(start);
+    file.read(data->data(), data->size());
+    data->resize(std::max<std::streamsize>(file.gcount(), 0));
+#endif
+
+    return data;
+}
+
+} // namespace entwine
@@ -0,0 +1,68 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace entwine
+{
+
+// Reads and writes whole local files, or ranges of them, for local outputs and
+// temporary files, with blocking calls from the calling thread.
+class LocalIo
+{
+public:
+    static LocalIo& get()
+    {
+        static LocalIo io;
+        return io;
+    }
+
+    struct Write
+    {
+        Write(const std::string& path, const std::vector<char>& data)
+            : path(path)
+            , data(&data)
+        { }
+
+        std::string path;
+        const std::vector<char>* data;
+    };
+
+    // Write files in full, creating or truncating them.  Throws if any write
+    // fails, after all have completed.
+    void write(const std::string& path, const std::vector<char>& data);
+    void write(const std::vector<Write>& writes);
+
+    // Read the byte range [begin, end) of a file.  The result is clamped to
+    // the file size, and is null if the file could not be opened.
+    std::unique_ptr<std::vector<char>> read(
+            const std::string& path,
+            uint64_t begin = 0,
+            uint64_t end = std::numeric_limits<uint64_t>::max());
+
+private:
+    struct Op;
+
+    LocalIo() { }
+
+    // Run each op to completion.
+    void run(std::vector<Op>& ops);
+
+    LocalIo(const LocalIo&) = delete;
+    LocalIo& operator=(const LocalIo&) = delete;
+};
+
+} // namespace entwine
@@ -0,0 +1,362 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/io/output-stream.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <entwine/io/ensure.hpp>
+#include <entwine/io/local-io.hpp>
+#include <entwine/util/pool.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Uploads the parts of every stream.  Each stream bounds its own parts in
+    // flight, so this queue holds at most their windows.
+    Pool& uploadPool()
+    {
+        static Pool pool(8, 1024, false);
+        return pool;
+    }
+
+    // Writes parts in place into a temporary file, which is renamed over the
+    // destination on completion.
+    class LocalSink : public PartSink
+    {
+    public:
+        LocalSink(const std::string& path)
+            : m_path(path)
+            , m_partial(path + ".partial")
+        { }
+
+        ~LocalSink()
+        {
+            if (m_file.is_open())
+            {
+                m_file.close();
+                std::remove(m_partial.c_str());
+            }
+        }
+
+        virtual void write(const std::vector<char>& data) override
+        {
+            LocalIo::get().write(m_path, data);
+        }
+
+        virtual void begin() override
+        {
+            m_file.open(m_partial, std::ios::out | std::ios::binary);
+            if (!m_file.good())
+            {
+                throw std::runtime_error("Could not open " + m_partial);
+            }
+        }
+
+        virtual void put(
+                uint64_t part,
+                uint64_t offset,
+                const std::vector<char>& data) override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_file.seekp(offset);
+            m_file.write(data.data(), data.size());
+            if (!m_file.good())
+            {
+                throw std::runtime_error("Could not write " + m_partial);
+            }
+        }
+
+        virtual void done(uint64_t size) override
+        {
+            m_file.close();
+            if (std::rename(m_partial.c_str(), m_path.c_str()))
+            {
+                throw std::runtime_error("Could not rename " + m_partial);
+            }
+        }
+
+    private:
+        const std::string m_path;
+        const std::string m_partial;
+        std::ofstream m_file;
+        std::mutex m_mutex;
+    };
+
+    // Sends each part as a part of an S3 multipart upload, which is aborted if
+    // the output is abandoned.
+    class MultipartSink : public PartSink
+    {
+    public:
+        MultipartSink(
+                const arbiter::Endpoint& endpoint,
+                const std::string& path)
+            : m_endpoint(endpoint)
+            , m_path(path)
+        { }
+
+        ~MultipartSink()
+        {
+            if (m_id.empty() || m_done) return;
+
+            try
+            {
+                m_endpoint.abortMultipart(m_path, m_id);
+            }
+            catch (...)
+            {
+                std::cout << "Could not abort upload to " << m_path <<
+                    std::endl;
+            }
+        }
+
+        virtual uint64_t minPartSize() const override
+        {
+            return 5 * 1024 * 1024;
+        }
+
+        virtual void write(const std::vector<char>& data) override
+        {
+            ensurePut(m_endpoint, m_path, data);
+        }
+
+        virtual void begin() override
+        {
+            m_id = m_endpoint.initiateMultipart(m_path);
+        }
+
+        virtual void put(
+                uint64_t part,
+                uint64_t offset,
+                const std::vector<char>& data) override
+        {
+            const std::string etag(
+                    ensurePutPart(m_endpoint, m_path, m_id, part + 1, data));
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_etags.size() <= part) m_etags.resize(part + 1);
+            m_etags[part] = etag;
+        }
+
+        virtual void done(uint64_t size) override
+        {
+            m_endpoint.completeMultipart(m_path, m_id, m_etags);
+            m_done = true;
+        }
+
+    private:
+        const arbiter::Endpoint m_endpoint;
+        const std::string m_path;
+
+        std::string m_id;
+        std::vector<std::string> m_etags;
+        std::mutex m_mutex;
+        bool m_done = false;
+    };
+
+    // Assembles the parts in memory and sends them with a single PUT, for
+    // remote drivers which arbiter cannot upload in parts.
+    class BufferedSink : public PartSink
+    {
+    public:
+        BufferedSink(const arbiter::Endpoint& endpoint, const std::string& path)
+            : m_endpoint(endpoint)
+            , m_path(path)
+        { }
+
+        virtual void write(const std::vector<char>& data) override
+        {
+            ensurePut(m_endpoint, m_path, data);
+        }
+
+        virtual void put(
+                uint64_t part,
+                uint64_t offset,
+                const std::vector<char>& data) override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_data.size() < offset + data.size())
+            {
+                m_data.resize(offset + data.size());
+            }
+            std::copy(data.begin(), data.end(), m_data.begin() + offset);
+        }
+
+        virtual void done(uint64_t size) override
+        {
+            m_data.resize(size);
+            ensurePut(m_endpoint, m_path, m_data);
+        }
+
+    private:
+        const arbiter::Endpoint m_endpoint;
+        const std::string m_path;
+        std::vector<char> m_data;
+        std::mutex m_mutex;
+    };
+}
+
+std::unique_ptr<PartSink> PartSink::create(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path)
+{
+    if (endpoint.isLocal())
+    {
+        const std::string full(arbiter::expandTilde(endpoint.fullPath(path)));
+        arbiter::mkdirp(arbiter::util::getNonBasename(full));
+        return makeUnique<LocalSink>(full);
+    }
+
+    if (endpoint.supportsMultipart())
+    {
+        return makeUnique<MultipartSink>(endpoint, path);
+    }
+
+    return makeUnique<BufferedSink>(endpoint, path);
+}
+
+OutputStream::OutputStream(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const uint64_t partSize,
+        const std::size_t window)
+    : OutputStream(PartSink::create(endpoint, path), partSize, window)
+{ }
+
+OutputStream::OutputStream(
+        std::unique_ptr<PartSink> sink,
+        const uint64_t partSize,
+        const std::size_t window)
+    : m_sink(std::move(sink))
+    , m_partSize(std::max(partSize, m_sink->minPartSize()))
+    , m_window(std::max<std::size_t>(window, 1))
+{ }
+
+OutputStream::~OutputStream()
+{
+    await();
+}
+
+void OutputStream::write(const char* data, uint64_t size)
+{
+    if (m_closed) throw std::runtime_error("Write to closed OutputStream");
+
+    while (size)
+    {
+        // A full part is flushed only once more data follows it, so that an
+        // output of a single part is written whole by close().
+        if (m_buffer.size() == m_partSize) flush();
+
+        const uint64_t n(std::min(size, m_partSize - m_buffer.size()));
+        m_buffer.insert(m_buffer.end(), data, data + n);
+        data += n;
+        size -= n;
+    }
+}
+
+void OutputStream::flush()
+{
+    if (!m_parts) m_sink->begin();
+
+    auto part(std::make_shared<std::vector<char>>());
+    part->swap(m_buffer);
+
+    const uint64_t index(m_parts++);
+    const uint64_t offset(m_offset);
+    m_offset += part->size();
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_inflight < m_window; });
+        if (m_error) std::rethrow_exception(m_error);
+        ++m_inflight;
+    }
+
+    auto task([this, part, index, offset]()
+    {
+        std::exception_ptr error;
+
+        try
+        {
+            m_sink->put(index, offset, *part);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (error && !m_error) m_error = error;
+        --m_inflight;
+        m_cv.notify_all();
+    });
+
+    try
+    {
+        uploadPool().add(task);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_inflight;
+        throw;
+    }
+}
+
+void OutputStream::await()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() { return !m_inflight; });
+}
+
+void OutputStream::close()
+{
+    if (m_closed) return;
+    m_closed = true;
+
+    if (!m_parts)
+    {
+        m_sink->write(m_buffer);
+        return;
+    }
+
+    flush();
+    await();
+
+    if (m_error) std::rethrow_exception(m_error);
+    m_sink->done(m_offset);
+}
+
+OutputStream::int_type OutputStream::overflow(const int_type c)
+{
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        return traits_type::not_eof(c);
+    }
+
+    const char ch(traits_type::to_char_type(c));
+    write(&ch, 1);
+    return c;
+}
+
+std::streamsize OutputStream::xsputn(const char* s, const std::streamsize n)
+{
+    write(s, n);
+    return n;
+}
+
+} // namespace entwine
@@ -0,0 +1,120 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+
+namespace entwine
+{
+
+// Destination for the output of an OutputStream.  An output which fits in a
+// single part is written with write().  Otherwise begin() is called, then the
+// parts are put, possibly concurrently and out of order, and then done() is
+// called.  If the output is abandoned after begin(), the sink is destroyed
+// without done().
+class PartSink
+{
+public:
+    virtual ~PartSink() { }
+
+    // Local endpoints are written in place, and S3 outputs are sent as
+    // multipart uploads.  Other remote drivers cannot upload in parts, so
+    // their parts are assembled in memory and sent with a single PUT.
+    static std::unique_ptr<PartSink> create(
+            const arbiter::Endpoint& endpoint,
+            const std::string& path);
+
+    // The smallest part size which the destination accepts.
+    virtual uint64_t minPartSize() const { return 1; }
+
+    virtual void write(const std::vector<char>& data) = 0;
+
+    virtual void begin() { }
+
+    // Parts are numbered from zero.  All but the last are of the same size.
+    virtual void put(
+            uint64_t part,
+            uint64_t offset,
+            const std::vector<char>& data) = 0;
+
+    virtual void done(uint64_t size) = 0;
+};
+
+// A write-only stream to an endpoint.  Data is buffered into parts, which are
+// uploaded by a pool shared by all streams as they fill, so encoding may
+// overlap with output.  At most `window` parts of a stream are in flight at
+// once, which bounds its memory usage wherever the sink does not hold the
+// whole output.  An output which fits in a single part is written from
+// close(), on the calling thread.
+//
+// This is a std::streambuf, so it may back a std::ostream.
+class OutputStream : public std::streambuf
+{
+public:
+    OutputStream(
+            const arbiter::Endpoint& endpoint,
+            const std::string& path,
+            uint64_t partSize = 8 * 1024 * 1024,
+            std::size_t window = 4);
+
+    OutputStream(
+            std::unique_ptr<PartSink> sink,
+            uint64_t partSize = 8 * 1024 * 1024,
+            std::size_t window = 4);
+
+    // If close() was not called, the output is abandoned.
+    ~OutputStream();
+
+    void write(const char* data, uint64_t size);
+    void write(const std::vector<char>& data)
+    {
+        write(data.data(), data.size());
+    }
+
+    // Flush all outstanding parts and complete the output.  Throws if any
+    // part failed.
+    void close();
+
+    uint64_t size() const { return m_offset + m_buffer.size(); }
+
+protected:
+    virtual int_type overflow(int_type c) override;
+    virtual std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+private:
+    void flush();
+    void await();
+
+    std::unique_ptr<PartSink> m_sink;
+    const uint64_t m_partSize;
+    const std::size_t m_window;
+
+    std::vector<char> m_buffer;
+    uint64_t m_offset = 0;
+    uint64_t m_parts = 0;
+    bool m_closed = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::size_t m_inflight = 0;
+    std::exception_ptr m_error;
+};
+
+} // namespace entwine
@@ -10,8 +10,14 @@
 
 #include <entwine/io/zstandard.hpp>
 
+#include <limits>
+
 #include <pdal/compression/ZstdCompression.hpp>
 
+#include <entwine/io/output-stream.hpp>
+#include <entwine/util/scratch.hpp>
+#include <entwine/util/trace.hpp>
+
 namespace entwine
 {
 
@@ -22,18 +28,22 @@ void Zstandard::write(
         const Bounds& bounds,
         BlockPointTable& src) const
 {
-    const std::vector<char> uncompressed(pack(src));
+    ENTWINE_TRACE_SPAN("zstandard-write", "io");
 
-    std::vector<char> compressed;
-    pdal::ZstdCompressor compressor([&compressed](char* pos, std::size_t size)
+    std::vector<char> uncompressed(pack(src));
+
+    // Compressed output is uploaded as it is produced.
+    OutputStream stream(out, filename + ".zst");
+    pdal::ZstdCompressor compressor([&stream](char* pos, std::size_t size)
     {
-        compressed.insert(compressed.end(), pos, pos + size);
+        stream.write(pos, size);
     }, 3 /* ZSTD_CLEVEL_DEFAULT */);
 
     compressor.compress(uncompressed.data(), uncompressed.size());
     compressor.done();
 
-    ensurePut(out, filename + ".zst", compressed);
+    stream.close();
+    Scratch::give(std::move(uncompressed));
 }
 
 void Zstandard::read(
@@ -42,9 +52,24 @@ void Zstandard::read(
         const std::string& filename,
         VectorPointTable& dst) const
 {
-    auto compressed(*ensureGet(out, filename + ".zst"));
+    ENTWINE_TRACE_SPAN("zstandard-read", "io");
+
+    readBuffer(
+            std::move(*ensureGetParallel(out, filename + ".zst")),
+            dst,
+            DimSet(),
+            std::numeric_limits<uint64_t>::max());
+}
+
+bool Zstandard::readBuffer(
+        std::vector<char> compressed,
+        VectorPointTable& dst,
+        const DimSet& dims,
+        const uint64_t points) const
+{
+    ENTWINE_TRACE_SPAN("zstandard-read-buffer", "io");
 
-    std::vector<char> uncompressed;
+    std::vector<char> uncompressed(Scratch::take(0));
     pdal::ZstdDecompressor dec([&uncompressed](char* pos, std::size_t size)
     {
         uncompressed.insert(uncompressed.end(), pos, pos + size);
@@ -52,7 +77,9 @@ void Zstandard::read(
 
     dec.decompress(compressed.data(), compressed.size());
 
+    Scratch::give(std::move(compressed));
     unpack(dst, std::move(uncompressed));
+    return false;
 }
 
 } // namespace entwine
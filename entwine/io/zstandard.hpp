@@ -19,6 +19,7 @@ public:
     Zstandard(const Metadata& m) : Binary(m) { }
 
     virtual std::string type() const override { return "zstandard"; }
+    virtual std::string extension() const override { return ".zst"; }
 
     virtual void write(
             const arbiter::Endpoint& out,
@@ -32,6 +33,21 @@ public:
             const arbiter::Endpoint& tmp,
             const std::string& filename,
             VectorPointTable& table) const override;
+
+    virtual bool readBuffer(
+            std::vector<char> data,
+            VectorPointTable& table,
+            const DimSet& dims,
+            uint64_t points) const override;
+
+    // The compressed stream must be fetched in full, so the partial reads of
+    // Binary fall back to a full read.
+    virtual uint64_t partialSize(
+            const DimSet& dims,
+            uint64_t points) const override
+    {
+        return DataIo::partialSize(dims, points);
+    }
 };
 
 } // namespace entwine
@@ -10,7 +10,12 @@
 
 #include <entwine/reader/cache.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+
 #include <entwine/reader/reader.hpp>
+#include <entwine/util/trace.hpp>
 
 namespace entwine
 {
@@ -22,19 +27,130 @@ bool operator<(const GlobalId& a, const GlobalId& b)
 
 std::deque<SharedChunkReader> Cache::acquire(
         const Reader& reader,
-        const std::vector<Dxyz>& keys)
+        const std::vector<ChunkRequest>& requests,
+        const DimSet& dims)
 {
+    ENTWINE_TRACE_SPAN("cache-acquire", "query");
+
     std::deque<SharedChunkReader> block;
 
+    // Reads happen outside of our lock, so queries against other datasets,
+    // or against chunks which are already resident, are not held up by them.
+    const Fetched fetched(fetch(reader, requests, dims));
+
     std::lock_guard<std::mutex> lock(m_mutex);
-    for (const Dxyz& key : keys) block.push_back(get(reader, key));
+    for (const ChunkRequest& r : requests)
+    {
+        block.push_back(get(reader, r.key, fetched));
+    }
 
     purge();
 
     return block;
 }
 
-SharedChunkReader Cache::get(const Reader& reader, const Dxyz& key)
+Cache::Fetched Cache::fetch(
+        const Reader& reader,
+        const std::vector<ChunkRequest>& requests,
+        const DimSet& dims)
+{
+    struct Pending
+    {
+        Dxyz key;
+        DimSet dims;
+        uint64_t points;
+    };
+
+    Fetched fetched;
+    std::vector<Pending> pending;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const ChunkRequest& r : requests)
+        {
+            const Dxyz& key(r.key);
+            if (fetched.count(key)) continue;
+
+            DimSet needDims(dims);
+            uint64_t needPoints(r.points);
+
+            // If this chunk was partially read, reread it with the union of
+            // its current dimensions and points and those newly required.
+            // Outstanding holders of the previous chunk are unaffected.
+            auto it(m_chunks.find(GlobalId(reader.path(), key)));
+            if (it != m_chunks.end())
+            {
+                const ChunkReader& chunk(*it->second.chunk);
+                if (chunk.has(dims, r.points))
+                {
+                    // Hold on to this chunk, since it may be purged by a
+                    // concurrent caller before we return it.
+                    fetched[key] = it->second.chunk;
+                    continue;
+                }
+
+                if (!dims.empty() && !chunk.dims().empty())
+                {
+                    needDims.insert(chunk.dims().begin(), chunk.dims().end());
+                }
+                else needDims.clear();
+
+                needPoints = std::max(chunk.points(), r.points);
+            }
+
+            // Reserve our spot so duplicate requests are only fetched once.
+            fetched[key] = SharedChunkReader();
+            pending.push_back(Pending { key, needDims, needPoints });
+        }
+    }
+
+    if (pending.empty()) return fetched;
+
+    // Our pool is shared with concurrent callers, so rather than awaiting
+    // the whole pool we wait only for our own reads.
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t remaining(pending.size());
+    std::exception_ptr error;
+
+    for (const Pending& p : pending)
+    {
+        SharedChunkReader& dst(fetched[p.key]);
+
+        m_pool.add([&reader, &mutex, &cv, &remaining, &error, &dst, p]()
+        {
+            SharedChunkReader chunk;
+            std::exception_ptr current;
+
+            try
+            {
+                chunk = std::make_shared<ChunkReader>(
+                        reader, p.key, p.dims, p.points);
+            }
+            catch (...)
+            {
+                current = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            dst = chunk;
+            if (current && !error) error = current;
+            if (!--remaining) cv.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&remaining]() { return !remaining; });
+
+    if (error) std::rethrow_exception(error);
+
+    return fetched;
+}
+
+SharedChunkReader Cache::get(
+        const Reader& reader,
+        const Dxyz& key,
+        const Fetched& fetched)
 {
     const GlobalId id(reader.path(), key);
 
@@ -42,27 +158,48 @@ SharedChunkReader Cache::get(const Reader& reader, const Dxyz& key)
 
     if (it == m_chunks.end())
     {
-        // std::cout << "\tAdd " << id.key << std::endl;
         it = m_chunks.insert(std::make_pair(id, ChunkReaderInfo())).first;
-
-        ChunkReaderInfo& info(it->second);
-        info.chunk = std::make_shared<ChunkReader>(reader, key);
-        m_size += info.chunk->bytes();
     }
     else
     {
-        ChunkReaderInfo& info(it->second);
-        m_order.erase(info.it);
+        m_order.erase(it->second.it);
     }
 
-    m_order.push_front(it);
-
     ChunkReaderInfo& info(it->second);
+
+    // A concurrent caller may have already replaced this chunk with one
+    // which suffices, in which case we keep theirs.
+    auto f(fetched.find(key));
+    if (
+            f != fetched.end() &&
+            info.chunk != f->second &&
+            (!info.chunk ||
+                !info.chunk->has(f->second->dims(), f->second->points())))
+    {
+        if (info.chunk) shrink(info.chunk->bytes());
+        info.chunk = f->second;
+        grow(info.chunk->bytes());
+    }
+
+    m_order.push_front(it);
     info.it = m_order.begin();
 
     return info.chunk;
 }
 
+void Cache::drop(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it(m_chunks.lower_bound(GlobalId(path, Dxyz())));
+    while (it != m_chunks.end() && it->first.path == path)
+    {
+        if (it->second.chunk) shrink(it->second.chunk->bytes());
+        m_order.erase(it->second.it);
+        it = m_chunks.erase(it);
+    }
+}
+
 void Cache::purge()
 {
     const std::size_t start(m_size);
@@ -73,7 +210,7 @@ void Cache::purge()
         const ChunkReaderInfo& info(it->second);
 
         std::cout << "\tDel " << id.key << std::endl;
-        m_size -= info.chunk->bytes();
+        shrink(info.chunk->bytes());
         m_order.pop_back();
         m_chunks.erase(it);
     }
@@ -18,6 +18,8 @@
 
 #include <entwine/reader/chunk-reader.hpp>
 #include <entwine/types/key.hpp>
+#include <entwine/util/memory.hpp>
+#include <entwine/util/pool.hpp>
 
 namespace entwine
 {
@@ -46,23 +48,79 @@ struct ChunkReaderInfo
     Order::iterator it;
 };
 
+// A chunk to be acquired, and the number of its leading points required.
+struct ChunkRequest
+{
+    ChunkRequest(const Dxyz& key, uint64_t points = allPoints)
+        : key(key)
+        , points(points)
+    { }
+
+    Dxyz key;
+    uint64_t points;
+};
+
 class Cache
 {
 public:
-    Cache(std::size_t maxBytes = 1024 * 1024 * 256) // 250 MB.
+    Cache(
+            std::size_t maxBytes = 1024 * 1024 * 256, // 250 MB.
+            std::size_t threads = 8)
         : m_maxBytes(maxBytes)
+        , m_pool(threads, threads, false)
     { }
 
+    ~Cache() { Memory::sub(Memory::Category::Cache, m_size); }
+
     std::size_t maxBytes() const { return m_maxBytes; }
 
+    // Each returned chunk contains at least the given dimensions, where an
+    // empty set requires all of them, of at least its requested points.
+    // Chunks which must be read are fetched in parallel.
     std::deque<SharedChunkReader> acquire(
             const Reader& reader,
-            const std::vector<Dxyz>& keys);
+            const std::vector<ChunkRequest>& requests,
+            const DimSet& dims = DimSet());
+
+    // Release all chunks belonging to the dataset at this path.  Outstanding
+    // holders of those chunks are unaffected.
+    void drop(const std::string& path);
+
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_size;
+    }
 
 private:
-    SharedChunkReader get(const Reader& reader, const Dxyz& id);
+    // Every requested chunk, whether already resident or newly read.
+    using Fetched = std::map<Dxyz, SharedChunkReader>;
+
+    Fetched fetch(
+            const Reader& reader,
+            const std::vector<ChunkRequest>& requests,
+            const DimSet& dims);
+
+    SharedChunkReader get(
+            const Reader& reader,
+            const Dxyz& key,
+            const Fetched& fetched);
+
     void purge();
 
+    // Resize under our lock.
+    void grow(std::size_t bytes)
+    {
+        m_size += bytes;
+        Memory::add(Memory::Category::Cache, bytes);
+    }
+
+    void shrink(std::size_t bytes)
+    {
+        m_size -= bytes;
+        Memory::sub(Memory::Category::Cache, bytes);
+    }
+
     const std::size_t m_maxBytes;
 
     mutable std::mutex m_mutex;
@@ -70,7 +128,8 @@ private:
 
     ChunkReaderInfo::Map m_chunks;
     ChunkReaderInfo::Order m_order;
+
+    Pool m_pool;
 };
 
 } // namespace entwine
-
@@ -10,17 +10,31 @@
 
 #include <entwine/reader/chunk-reader.hpp>
 
+#include <algorithm>
+
 #include <entwine/io/io.hpp>
 #include <entwine/reader/reader.hpp>
+#include <entwine/util/scratch.hpp>
 
 namespace entwine
 {
 
-ChunkReader::ChunkReader(const Reader& r, const Dxyz& id)
+ChunkReader::ChunkReader(
+        const Reader& r,
+        const Dxyz& id,
+        const DimSet& dims,
+        const uint64_t points)
+    : m_dims(dims)
 {
+    const Schema& schema(r.metadata().schema());
+    const uint64_t count(r.hierarchy().count(id));
+
+    // Our data is retained by the cache, so size it up front rather than
+    // growing it, but stage through a reusable scratch table.
     std::vector<char> data;
+    data.reserve(std::min(count, points) * schema.pointSize());
 
-    VectorPointTable tmp(r.metadata().schema());
+    VectorPointTable tmp(schema, Scratch::take(4096 * schema.pointSize()));
     tmp.setProcess([&data, &tmp]()
     {
         data.insert(
@@ -29,13 +43,30 @@ ChunkReader::ChunkReader(const Reader& r, const Dxyz& id)
                 tmp.data().data() + tmp.numPoints() * tmp.pointSize());
     });
 
-    const auto dataEp(r.ep().getSubEndpoint("ept-data"));
-    r.metadata().dataIo().read(dataEp, r.tmp(), id.toString(), tmp);
+    const Metadata& m(r.metadata());
+    const bool partial(
+            m.bundled(id.d) ?
+                r.bundles()->read(r.tmp(), id, tmp, dims, points) :
+                m.dataIo().readPartial(
+                    r.ep().getSubEndpoint("ept-data"),
+                    r.tmp(),
+                    id.toString(),
+                    tmp,
+                    dims,
+                    points));
+
+    if (!partial) m_dims.clear();
 
-    m_table = makeUnique<VectorPointTable>(
-            r.metadata().schema(),
-            std::move(data));
+    Scratch::give(tmp.acquire());
+
+    m_table = makeUnique<VectorPointTable>(schema, std::move(data));
     m_table->clear(m_table->capacity());
+
+    // Data types may read more than requested, up to the entire chunk.
+    if (m_table->capacity() < count)
+    {
+        m_points = m_table->capacity();
+    }
 }
 
 } // namespace entwine
@@ -10,6 +10,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <memory>
 
 #include <entwine/types/key.hpp>
@@ -21,18 +24,48 @@ namespace entwine
 
 class Reader;
 
+// Requests every point of a chunk.
+const uint64_t allPoints(std::numeric_limits<uint64_t>::max());
+
 class ChunkReader
 {
 public:
-    ChunkReader(const Reader& reader, const Dxyz& id);
+    // Read at least the given dimensions, where an empty set means all of
+    // them, of at least the first `points` points of the chunk.  Data types
+    // without support for partial reads always read everything.
+    ChunkReader(
+            const Reader& reader,
+            const Dxyz& id,
+            const DimSet& dims,
+            uint64_t points = allPoints);
 
     VectorPointTable& table() { return *m_table; }
+
+    // The dimensions which were read, where an empty set means all of them.
+    const DimSet& dims() const { return m_dims; }
+
+    // The number of leading points which were read, or allPoints if this is
+    // the entire chunk.
+    uint64_t points() const { return m_points; }
+
+    bool has(const DimSet& dims, uint64_t points = allPoints) const
+    {
+        if (m_points != allPoints && m_points < points) return false;
+        if (m_dims.empty()) return true;
+        if (dims.empty()) return false;
+        return std::includes(
+                m_dims.begin(), m_dims.end(),
+                dims.begin(), dims.end());
+    }
+
     std::size_t bytes() const
     {
         return m_table->capacity() * m_table->pointSize();
     }
 
 private:
+    DimSet m_dims;
+    uint64_t m_points = allPoints;
     std::unique_ptr<VectorPointTable> m_table;
 };
 
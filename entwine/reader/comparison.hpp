@@ -285,6 +285,8 @@ public:
         m_op->log("");
     }
 
+    pdal::Dimension::Id dim() const { return m_dim; }
+
 protected:
     pdal::Dimension::Id m_dim;
     std::string m_name;
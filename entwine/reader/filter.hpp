@@ -55,6 +55,9 @@ public:
         m_root.log("");
     }
 
+    // Dimensions referenced by any comparison of this filter.
+    const DimSet& dims() const { return m_dims; }
+
 private:
     void build(LogicGate& gate, const json& j)
     {
@@ -93,7 +96,7 @@ private:
             else if (!val.is_object() || val.size() == 1)
             {
                 // a comparison query object.
-                active->push(Comparison::create(m_metadata, key, val));
+                push(*active, Comparison::create(m_metadata, key, val));
             }
             else
             {
@@ -111,7 +114,7 @@ private:
                     const std::string innerKey(inner.key());
                     const json& innerVal(inner.value());
                     const json next { { innerKey, innerVal } };
-                    active->push(Comparison::create(m_metadata, key, next));
+                    push(*active, Comparison::create(m_metadata, key, next));
                 }
             }
         }
@@ -119,9 +122,16 @@ private:
         if (outer) gate.push(std::move(outer));
     }
 
+    void push(LogicGate& gate, std::unique_ptr<Comparison> comparison)
+    {
+        m_dims.insert(comparison->dim());
+        gate.push(std::move(comparison));
+    }
+
     const Metadata& m_metadata;
     const Bounds m_queryBounds;
     LogicalAnd m_root;
+    DimSet m_dims;
 };
 
 } // namespace entwine
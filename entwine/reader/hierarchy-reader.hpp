@@ -12,10 +12,13 @@
 
 #include <cassert>
 #include <cstdint>
+#include <memory>
 
+#include <entwine/reader/snapshot.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/key.hpp>
 #include <entwine/util/json.hpp>
+#include <entwine/util/unique.hpp>
 
 namespace entwine
 {
@@ -31,24 +34,35 @@ public:
     using Keys = std::map<Dxyz, uint64_t>;
 
     HierarchyReader(const arbiter::Endpoint& out)
-        : m_ep(out.getSubEndpoint("ept-hierarchy"))
+        : m_ep(makeUnique<arbiter::Endpoint>(
+                    out.getSubEndpoint("ept-hierarchy")))
     {
         load();
     }
 
+    // Look up counts directly in a snapshot, which may be memory-mapped.
+    HierarchyReader(std::shared_ptr<const Snapshot> snapshot)
+        : m_snapshot(snapshot)
+    { }
+
     uint64_t count(const Dxyz& p) const
     {
+        if (m_snapshot) return m_snapshot->count(p);
+
         const auto it(m_keys.find(p));
         if (it != m_keys.end()) return it->second;
         else return 0;
     }
 
+    // Empty if we are backed by a snapshot.
+    const Keys& keys() const { return m_keys; }
+
 private:
     // For now, we'll just load everything on init.  This needs to be hooked up
     // to a caching mechanism.
     void load(const Dxyz& root = Dxyz())
     {
-        const json j(json::parse(m_ep.get(root.toString() + ".json")));
+        const json j(json::parse(m_ep->get(root.toString() + ".json")));
 
         for (const auto& p : j.items())
         {
@@ -60,8 +74,9 @@ private:
         }
     }
 
-    const arbiter::Endpoint m_ep;
+    std::unique_ptr<arbiter::Endpoint> m_ep;
     Keys m_keys;
+    std::shared_ptr<const Snapshot> m_snapshot;
 };
 
 } // namespace entwine
@@ -66,6 +66,14 @@ public:
                 q.at("depth").get<uint64_t>() + 1 : q.value("depthEnd", 0),
             q.value("filter", json()))
     {
+        m_fraction = q.value("fraction", 1.0);
+        m_budget = q.value<uint64_t>("points", 0);
+
+        if (!(m_fraction > 0 && m_fraction <= 1))
+        {
+            throw std::runtime_error("Invalid fraction: " + q.dump(2));
+        }
+
         if (q.count("depth"))
         {
             if (q.count("depthBegin") || q.count("depthEnd"))
@@ -81,11 +89,20 @@ public:
     std::size_t de() const { return m_depthEnd; }
     const json& filter() const { return m_filter; }
 
+    // Fraction of the points of each node to be read.
+    double fraction() const { return m_fraction; }
+
+    // If nonzero, the approximate total number of points to read, spread
+    // over the selected nodes in proportion to their counts.
+    uint64_t budget() const { return m_budget; }
+
 private:
     const Bounds m_bounds;
     const std::size_t m_depthBegin = 0;
     const std::size_t m_depthEnd = 0;
     const json m_filter;
+    double m_fraction = 1;
+    uint64_t m_budget = 0;
 };
 
 } // namespace entwine
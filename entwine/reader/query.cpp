@@ -10,11 +10,22 @@
 
 #include <entwine/reader/query.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 #include <entwine/reader/reader.hpp>
+#include <entwine/types/node-order.hpp>
+#include <entwine/util/trace.hpp>
 
 namespace entwine
 {
 
+namespace
+{
+    // Number of chunks acquired from the cache at once.
+    const std::size_t batchSize(16);
+}
+
 Query::Query(const Reader& r, const json& j)
     : m_reader(r)
     , m_metadata(r.metadata())
@@ -22,10 +33,33 @@ Query::Query(const Reader& r, const json& j)
     , m_params(j)
     , m_filter(m_metadata, m_params)
     , m_overlaps(overlaps())
-{ }
+    , m_fraction(m_params.fraction())
+{
+    if (m_params.budget())
+    {
+        uint64_t total(0);
+        for (const auto& k : m_overlaps) total += k.second;
+
+        if (total > m_params.budget())
+        {
+            m_fraction = std::min(
+                    m_fraction,
+                    static_cast<double>(m_params.budget()) / total);
+        }
+    }
+}
+
+uint64_t Query::limit(const uint64_t count) const
+{
+    if (m_fraction >= 1) return count;
+    const uint64_t n(std::ceil(count * m_fraction));
+    return std::max<uint64_t>(std::min(n, count), 1);
+}
 
 HierarchyReader::Keys Query::overlaps() const
 {
+    ENTWINE_TRACE_SPAN("query-overlaps", "query");
+
     HierarchyReader::Keys keys;
     ChunkKey c(m_metadata);
     overlaps(keys, c);
@@ -50,20 +84,66 @@ void Query::overlaps(HierarchyReader::Keys& keys, const ChunkKey& c) const
     }
 }
 
+DimSet Query::dims() const
+{
+    DimSet dims(m_filter.dims());
+    dims.insert(DimId::X);
+    dims.insert(DimId::Y);
+    dims.insert(DimId::Z);
+    return dims;
+}
+
 void Query::run()
 {
-    for (const auto& k : m_overlaps)
+    const DimSet needed(dims());
+
+    // Only unordered nodes may be read by prefix.  Sorted nodes are read in
+    // full and thinned evenly along their order instead, which for the curve
+    // orders spreads the selected points across the whole node.
+    const bool prefix(prefixSamples(m_metadata.nodeOrder()));
+
+    // Keys are ordered by depth and then position, so each batch tends to
+    // contain siblings, which are fetched together.
+    auto it(m_overlaps.begin());
+    while (it != m_overlaps.end())
     {
-        // For now we're doing one at a time.
-        std::vector<Dxyz> keys;
-        keys.push_back(k.first);
-        auto block(m_reader.cache().acquire(m_reader, keys));
+        std::vector<ChunkRequest> requests;
+        std::vector<uint64_t> limits;
+        std::vector<uint64_t> counts;
+
+        for ( ; it != m_overlaps.end() && requests.size() < batchSize; ++it)
+        {
+            const uint64_t n(limit(it->second));
+            requests.emplace_back(
+                    it->first,
+                    prefix && n < it->second ? n : allPoints);
+            limits.push_back(n);
+            counts.push_back(it->second);
+        }
 
-        for (auto& chunk : block)
+        auto block(m_reader.cache().acquire(m_reader, requests, needed));
+
+        ENTWINE_TRACE_SPAN("query-process", "query");
+        for (std::size_t c(0); c < block.size(); ++c)
         {
-            for (const auto& pr : chunk->table())
+            const uint64_t n(limits[c]);
+            const uint64_t count(counts[c]);
+
+            // The cached chunk may hold more than we asked for.
+            uint64_t i(0);
+            for (const auto& pr : block[c]->table())
             {
-                maybeProcess(pr);
+                if (prefix || n == count)
+                {
+                    if (i++ == n) break;
+                    maybeProcess(pr);
+                }
+                else
+                {
+                    // Select exactly n of the count points, evenly spaced.
+                    if ((i + 1) * n / count > i * n / count) maybeProcess(pr);
+                    if (++i == count) break;
+                }
             }
         }
     }
@@ -80,6 +160,13 @@ void Query::maybeProcess(const pdal::PointRef& pr)
     ++m_points;
 }
 
+DimSet ReadQuery::dims() const
+{
+    DimSet dims(Query::dims());
+    for (const auto& dimInfo : m_schema.dims()) dims.insert(dimInfo.id());
+    return dims;
+}
+
 void ReadQuery::process(const pdal::PointRef& pr)
 {
     m_data.resize(m_data.size() + m_schema.pointSize(), 0);
@@ -37,6 +37,9 @@ public:
 protected:
     virtual void process(const pdal::PointRef& pr) { }
 
+    // Dimensions which must be present in the chunks read for this query.
+    virtual DimSet dims() const;
+
     const Reader& m_reader;
     const Metadata& m_metadata;
     const HierarchyReader& m_hierarchy;
@@ -49,7 +52,11 @@ private:
 
     void maybeProcess(const pdal::PointRef& pr);
 
+    // Number of leading points of a node with the given count to be read.
+    uint64_t limit(uint64_t count) const;
+
     HierarchyReader::Keys m_overlaps;
+    double m_fraction = 1;
     uint64_t m_points = 0;
     std::deque<SharedChunkReader> m_chunks;
 };
@@ -75,6 +82,7 @@ public:
 
 protected:
     virtual void process(const pdal::PointRef& pr) override;
+    virtual DimSet dims() const override;
 
 private:
     void setAs(char* dst, double d, pdal::Dimension::Type t)
@@ -10,6 +10,7 @@
 
 #include <entwine/reader/reader.hpp>
 
+#include <entwine/types/files.hpp>
 #include <entwine/util/unique.hpp>
 
 namespace entwine
@@ -24,10 +25,37 @@ Reader::Reader(
     , m_ep(m_arbiter->getEndpoint(out))
     , m_tmp(m_arbiter->getEndpoint(
                 tmp.size() ? tmp : arbiter::getTempPath()))
-    , m_metadata(m_ep)
-    , m_hierarchy(m_ep)
-    , m_cache(makeUnique<Cache>())
-{ }
+    , m_cache(cache ? cache : std::make_shared<Cache>())
+{
+    if (auto snapshot = Snapshot::open(m_ep, m_tmp))
+    {
+        const json meta(snapshot->meta());
+        m_metadata = makeUnique<Metadata>(
+                meta.at("ept"),
+                meta.at("build"),
+                meta.at("files"));
+        m_hierarchy = makeUnique<HierarchyReader>(snapshot);
+    }
+    else
+    {
+        const json ept(json::parse(m_ep.get("ept.json")));
+        const json build(json::parse(m_ep.get("ept-build.json")));
+        const json files(Files::extract(m_ep, true));
+
+        m_metadata = makeUnique<Metadata>(ept, build, files);
+        auto hierarchy(makeUnique<HierarchyReader>(m_ep));
+
+        // Outputs built before snapshots existed get one on their first open.
+        Snapshot::trySave(m_ep, ept, build, files, hierarchy->keys());
+
+        m_hierarchy = std::move(hierarchy);
+    }
+
+    if (m_metadata->bundleDepth())
+    {
+        m_bundles = makeUnique<BundleReader>(*m_metadata, m_ep);
+    }
+}
 
 std::unique_ptr<CountQuery> Reader::count(const json& j) const
 {
@@ -13,9 +13,11 @@
 #include <memory>
 #include <string>
 
+#include <entwine/io/bundle.hpp>
 #include <entwine/reader/cache.hpp>
 #include <entwine/reader/hierarchy-reader.hpp>
 #include <entwine/reader/query.hpp>
+#include <entwine/reader/snapshot.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/key.hpp>
 #include <entwine/types/metadata.hpp>
@@ -37,12 +39,15 @@ public:
     std::unique_ptr<CountQuery> count(const json& j) const;
     std::unique_ptr<ReadQuery> read(const json& j) const;
 
-    const Metadata& metadata() const { return m_metadata; }
-    const HierarchyReader& hierarchy() const { return m_hierarchy; }
+    const Metadata& metadata() const { return *m_metadata; }
+    const HierarchyReader& hierarchy() const { return *m_hierarchy; }
     const arbiter::Endpoint& ep() const { return m_ep; }
     const arbiter::Endpoint& tmp() const { return m_tmp; }
     Cache& cache() const { return *m_cache; }
 
+    // Null unless the output is bundled.
+    const BundleReader* bundles() const { return m_bundles.get(); }
+
     std::string path() const { return ep().prefixedRoot(); }
 
 private:
@@ -50,10 +55,11 @@ private:
     arbiter::Endpoint m_ep;
     arbiter::Endpoint m_tmp;
 
-    const Metadata m_metadata;
-    const HierarchyReader m_hierarchy;
+    std::unique_ptr<const Metadata> m_metadata;
+    std::unique_ptr<const HierarchyReader> m_hierarchy;
+    std::unique_ptr<const BundleReader> m_bundles;
 
-    std::unique_ptr<Cache> m_cache;
+    std::shared_ptr<Cache> m_cache;
 };
 
 } // namespace entwine
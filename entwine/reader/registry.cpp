@@ -0,0 +1,220 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/registry.hpp>
+
+#include <algorithm>
+
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+ReaderRegistry::Lease::Lease(
+        ReaderRegistry& registry,
+        std::shared_ptr<Entry> entry)
+    : m_registry(&registry)
+    , m_entry(entry)
+    , m_reader(entry->reader)
+{ }
+
+ReaderRegistry::Lease::Lease(Lease&& other)
+    : m_registry(other.m_registry)
+    , m_entry(std::move(other.m_entry))
+    , m_reader(std::move(other.m_reader))
+{
+    other.m_registry = nullptr;
+}
+
+ReaderRegistry::Lease::~Lease()
+{
+    if (m_registry) m_registry->release(*m_entry);
+}
+
+ReaderRegistry::ReaderRegistry()
+    : ReaderRegistry(Options())
+{ }
+
+ReaderRegistry::ReaderRegistry(
+        const Options& options,
+        std::shared_ptr<arbiter::Arbiter> a)
+    : m_options(options)
+    , m_arbiter(maybeDefault(a))
+    , m_cache(std::make_shared<Cache>(options.cacheBytes, options.threads))
+{ }
+
+ReaderRegistry::Lease ReaderRegistry::acquire(const std::string& path)
+{
+    sweep();
+
+    const std::size_t limit(std::max<std::size_t>(m_options.perDataset, 1));
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        std::shared_ptr<Entry>& slot(m_entries[path]);
+        if (!slot) slot = std::make_shared<Entry>();
+        std::shared_ptr<Entry> entry(slot);
+
+        entry->cv.wait(lock, [&entry, limit]()
+        {
+            return !entry->opening && entry->active < limit;
+        });
+
+        // If this dataset was closed, or failed to open, while we waited,
+        // start over.
+        auto it(m_entries.find(path));
+        if (it == m_entries.end() || it->second != entry) continue;
+
+        ++entry->active;
+        entry->used = Clock::now();
+
+        if (!entry->reader)
+        {
+            // Open without holding our lock, so other datasets are not held
+            // up.  Acquisitions of this one wait for us.
+            entry->opening = true;
+            lock.unlock();
+
+            std::shared_ptr<const Reader> reader;
+
+            try
+            {
+                reader = std::make_shared<const Reader>(
+                        path,
+                        m_options.tmp,
+                        m_cache,
+                        m_arbiter);
+            }
+            catch (...)
+            {
+                lock.lock();
+                entry->opening = false;
+                --entry->active;
+
+                auto found(m_entries.find(path));
+                if (found != m_entries.end() && found->second == entry)
+                {
+                    m_entries.erase(found);
+                }
+
+                entry->cv.notify_all();
+                throw;
+            }
+
+            lock.lock();
+            entry->reader = reader;
+            entry->opening = false;
+            entry->cv.notify_all();
+        }
+
+        return Lease(*this, entry);
+    }
+}
+
+void ReaderRegistry::release(Entry& entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    --entry.active;
+    entry.used = Clock::now();
+    entry.cv.notify_all();
+}
+
+void ReaderRegistry::sweep()
+{
+    std::vector<std::string> closed;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        closed = expire();
+    }
+
+    for (const std::string& path : closed) m_cache->drop(path);
+}
+
+std::vector<std::string> ReaderRegistry::expire()
+{
+    std::vector<std::string> closed;
+    const auto now(Clock::now());
+
+    auto idle([](const Entry& entry)
+    {
+        return !entry.active && !entry.opening;
+    });
+
+    auto close([this, &closed](Entries::iterator it) -> Entries::iterator
+    {
+        if (it->second->reader) closed.push_back(it->second->reader->path());
+        return m_entries.erase(it);
+    });
+
+    auto it(m_entries.begin());
+    while (it != m_entries.end())
+    {
+        const Entry& entry(*it->second);
+        if (idle(entry) && now - entry.used >= m_options.idle) it = close(it);
+        else ++it;
+    }
+
+    // If we're still over our limit, close the least recently used of the
+    // remaining idle datasets.
+    while (m_entries.size() > m_options.maxOpen)
+    {
+        auto lru(m_entries.end());
+        for (auto it(m_entries.begin()); it != m_entries.end(); ++it)
+        {
+            const Entry& entry(*it->second);
+            if (
+                    idle(entry) &&
+                    (lru == m_entries.end() || entry.used < lru->second->used))
+            {
+                lru = it;
+            }
+        }
+
+        if (lru == m_entries.end()) break;
+        close(lru);
+    }
+
+    return closed;
+}
+
+std::size_t ReaderRegistry::open() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+json ReaderRegistry::info() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto now(Clock::now());
+    json datasets(json::object());
+
+    for (const auto& p : m_entries)
+    {
+        const Entry& entry(*p.second);
+        datasets[p.first] = {
+            { "active", entry.active },
+            { "idle", std::chrono::duration_cast<std::chrono::seconds>(
+                    now - entry.used).count() }
+        };
+    }
+
+    return json {
+        { "datasets", datasets },
+        { "cacheBytes", m_cache->size() },
+        { "maxCacheBytes", m_cache->maxBytes() }
+    };
+}
+
+} // namespace entwine
@@ -0,0 +1,133 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <entwine/reader/cache.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+
+// Serves many datasets from one process.  Readers are opened lazily on first
+// use and share a single Cache, and therefore a single chunk memory budget
+// and I/O pool.  Datasets without active leases may be closed, releasing
+// their metadata, hierarchy, and cached chunks, once they have been idle for
+// longer than the idle timeout or when more than the maximum are open.
+class ReaderRegistry
+{
+    struct Entry;
+
+public:
+    struct Options
+    {
+        // Chunk cache budget in bytes, and its I/O thread count, shared by
+        // all datasets.
+        std::size_t cacheBytes = 1024 * 1024 * 256;
+        std::size_t threads = 8;
+
+        // Most datasets held open at once.  Datasets with active leases are
+        // never closed, so this may be exceeded while they are in use.
+        std::size_t maxOpen = 64;
+
+        // Datasets idle for longer than this are closed.
+        std::chrono::seconds idle = std::chrono::seconds(300);
+
+        // Most concurrent leases per dataset.  Further acquisitions for a
+        // dataset at its limit block until one is released.
+        std::size_t perDataset = 4;
+
+        std::string tmp;
+    };
+
+    // Holds a dataset open and occupies one of its concurrency slots.
+    class Lease
+    {
+        friend class ReaderRegistry;
+
+    public:
+        Lease(Lease&& other);
+        Lease& operator=(Lease&&) = delete;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        const Reader& reader() const { return *m_reader; }
+
+    private:
+        Lease(ReaderRegistry& registry, std::shared_ptr<Entry> entry);
+
+        ReaderRegistry* m_registry;
+        std::shared_ptr<Entry> m_entry;
+        std::shared_ptr<const Reader> m_reader;
+    };
+
+    ReaderRegistry();
+    ReaderRegistry(
+            const Options& options,
+            std::shared_ptr<arbiter::Arbiter> a =
+                std::shared_ptr<arbiter::Arbiter>());
+
+    // Open the dataset at this path if necessary and lease it, blocking while
+    // it is at its concurrency limit.  Throws if the dataset cannot be read.
+    Lease acquire(const std::string& path);
+
+    // Close datasets which are idle and past their timeout.  This also
+    // happens as part of each acquisition.
+    void sweep();
+
+    // Number of datasets currently open.
+    std::size_t open() const;
+
+    Cache& cache() const { return *m_cache; }
+    const Options& options() const { return m_options; }
+
+    json info() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        std::shared_ptr<const Reader> reader;
+        std::size_t active = 0;
+        bool opening = false;
+        Clock::time_point used = Clock::now();
+        std::condition_variable cv;
+    };
+
+    using Entries = std::map<std::string, std::shared_ptr<Entry>>;
+
+    void release(Entry& entry);
+
+    // Close expired and excess datasets, returning the cache paths of those
+    // closed so their chunks may be dropped once our lock is released.
+    std::vector<std::string> expire();
+
+    const Options m_options;
+    std::shared_ptr<arbiter::Arbiter> m_arbiter;
+    std::shared_ptr<Cache> m_cache;
+
+    mutable std::mutex m_mutex;
+    Entries m_entries;
+};
+
+} // namespace entwine
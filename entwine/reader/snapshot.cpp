@@ -0,0 +1,347 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/snapshot.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <entwine/io/ensure.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    const char magic[4] = { 'E', 'S', 'N', 'P' };
+    const uint32_t currentVersion(1);
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t token;
+        uint64_t keys;
+        uint64_t metaOffset;
+        uint64_t metaSize;
+        uint64_t reserved[3];
+    };
+
+    static_assert(sizeof(Header) == 64, "Unexpected snapshot header size");
+    static_assert(
+            sizeof(Snapshot::Record) == 40,
+            "Unexpected snapshot record size");
+
+    bool parse(const char* data, const std::size_t size, Header& h)
+    {
+        if (size < sizeof(Header)) return false;
+        std::memcpy(&h, data, sizeof(Header));
+        return
+            std::equal(magic, magic + 4, h.magic) &&
+            h.version == currentVersion;
+    }
+
+    uint64_t randomToken()
+    {
+        std::random_device rd;
+        const uint64_t a(rd());
+        const uint64_t b(rd());
+        const uint64_t now(
+                std::chrono::steady_clock::now().time_since_epoch().count());
+        return ((a << 32) | b) ^ now;
+    }
+
+    bool exists(const std::string& path)
+    {
+        return std::ifstream(path, std::ios::in | std::ios::binary).good();
+    }
+
+    // Write via a uniquely named temporary so concurrent writers, and
+    // concurrent readers of an existing file, never see a partial snapshot.
+    bool writeFile(const std::string& path, const std::vector<char>& data)
+    {
+        const std::string partial(
+                path + ".partial-" + std::to_string(randomToken()));
+
+        {
+            std::ofstream file(partial, std::ios::out | std::ios::binary);
+            file.write(data.data(), data.size());
+            if (!file.good())
+            {
+                file.close();
+                std::remove(partial.c_str());
+                return false;
+            }
+        }
+
+        if (std::rename(partial.c_str(), path.c_str()))
+        {
+            std::remove(partial.c_str());
+            return false;
+        }
+
+        return true;
+    }
+}
+
+const std::string Snapshot::filename("ept-snapshot.bin");
+
+Snapshot::Snapshot(std::vector<char> data)
+    : m_owned(std::move(data))
+    , m_data(m_owned.data())
+    , m_size(m_owned.size())
+{ }
+
+Snapshot::Snapshot(const char* data, const std::size_t size)
+    : m_data(data)
+    , m_size(size)
+    , m_mapped(true)
+{ }
+
+Snapshot::~Snapshot()
+{
+#ifndef _WIN32
+    if (m_mapped) ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
+
+std::vector<char> Snapshot::create(
+        const json& ept,
+        const json& build,
+        const json& files,
+        const Keys& keys)
+{
+    std::vector<Record> records;
+    records.reserve(keys.size());
+    for (const auto& p : keys)
+    {
+        const Dxyz& k(p.first);
+        if (!p.second) continue;
+        records.push_back(Record { k.d, k.x, k.y, k.z, p.second });
+    }
+
+    const std::vector<uint8_t> meta(json::to_cbor(json {
+        { "ept", ept },
+        { "build", build },
+        { "files", files }
+    }));
+
+    Header h;
+    std::memset(&h, 0, sizeof(Header));
+    std::copy(magic, magic + 4, h.magic);
+    h.version = currentVersion;
+    h.token = randomToken();
+    h.keys = records.size();
+    h.metaOffset = sizeof(Header) + records.size() * sizeof(Record);
+    h.metaSize = meta.size();
+
+    std::vector<char> data(h.metaOffset + h.metaSize);
+    std::memcpy(data.data(), &h, sizeof(Header));
+    if (!records.empty())
+    {
+        std::memcpy(
+                data.data() + sizeof(Header),
+                records.data(),
+                records.size() * sizeof(Record));
+    }
+    std::copy(meta.begin(), meta.end(), data.begin() + h.metaOffset);
+
+    return data;
+}
+
+void Snapshot::save(
+        const arbiter::Endpoint& out,
+        const json& ept,
+        const json& build,
+        const json& files,
+        const Keys& keys)
+{
+    ensurePut(out, filename, create(ept, build, files, keys));
+}
+
+bool Snapshot::trySave(
+        const arbiter::Endpoint& out,
+        const json& ept,
+        const json& build,
+        const json& files,
+        const Keys& keys)
+{
+    if (!out.isLocal()) return false;
+
+    const std::string path(arbiter::expandTilde(out.fullPath(filename)));
+    return writeFile(path, create(ept, build, files, keys));
+}
+
+std::shared_ptr<const Snapshot> Snapshot::open(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp)
+{
+    if (out.isLocal())
+    {
+        const std::string path(arbiter::expandTilde(out.fullPath(filename)));
+        if (!exists(path)) return std::shared_ptr<const Snapshot>();
+
+        try
+        {
+            return map(path);
+        }
+        catch (std::exception& e)
+        {
+            std::cout << "Ignoring snapshot: " << e.what() << std::endl;
+            return std::shared_ptr<const Snapshot>();
+        }
+    }
+
+    if (!out.isHttpDerived()) return std::shared_ptr<const Snapshot>();
+
+    // Fetch only the header, whose token tells us whether our local copy, if
+    // we have one, is current.  A missing snapshot is not retried.
+    arbiter::http::Headers headers;
+    headers["Range"] = "bytes=0-" + std::to_string(sizeof(Header) - 1);
+    const auto head(out.tryGetBinary(filename, headers));
+
+    Header h;
+    if (!head || !parse(head->data(), head->size(), h))
+    {
+        return std::shared_ptr<const Snapshot>();
+    }
+
+    std::string local;
+    if (tmp.isLocal() && arbiter::mkdirp(tmp.root()))
+    {
+        const std::size_t hash(std::hash<std::string>()(out.prefixedRoot()));
+        local = arbiter::expandTilde(
+                tmp.fullPath("snapshot-" + std::to_string(hash) + ".bin"));
+
+        if (exists(local))
+        {
+            try
+            {
+                auto snapshot(map(local));
+                if (snapshot->token() == h.token) return snapshot;
+            }
+            catch (...) { }
+        }
+    }
+
+    auto data(ensureGetParallel(out, filename));
+    if (local.size() && writeFile(local, *data)) return map(local);
+
+    std::shared_ptr<Snapshot> snapshot(new Snapshot(std::move(*data)));
+    snapshot->validate();
+    return snapshot;
+}
+
+std::shared_ptr<const Snapshot> Snapshot::map(const std::string& path)
+{
+    std::shared_ptr<Snapshot> snapshot;
+
+#ifndef _WIN32
+    const int fd(::open(path.c_str(), O_RDONLY));
+    if (fd < 0) throw std::runtime_error("Could not open " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) || st.st_size <= 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Invalid snapshot " + path);
+    }
+
+    const std::size_t size(st.st_size);
+    void* p(::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0));
+    ::close(fd);
+
+    if (p == MAP_FAILED) throw std::runtime_error("Could not map " + path);
+    snapshot.reset(new Snapshot(static_cast<const char*>(p), size));
+#else
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.good()) throw std::runtime_error("Could not open " + path);
+    std::vector<char> data(
+            (std::istreambuf_iterator<char>(file)),
+            std::istreambuf_iterator<char>());
+    snapshot.reset(new Snapshot(std::move(data)));
+#endif
+
+    snapshot->validate();
+    return snapshot;
+}
+
+void Snapshot::validate()
+{
+    Header h;
+    if (!parse(m_data, m_size, h))
+    {
+        throw std::runtime_error("Invalid snapshot header");
+    }
+
+    // The metadata follows the records, but need not directly.
+    if (
+            h.keys > (m_size - sizeof(Header)) / sizeof(Record) ||
+            h.metaOffset < sizeof(Header) + h.keys * sizeof(Record) ||
+            h.metaOffset > m_size ||
+            h.metaSize > m_size - h.metaOffset)
+    {
+        throw std::runtime_error("Invalid snapshot layout");
+    }
+
+    m_token = h.token;
+    m_begin = reinterpret_cast<const Record*>(m_data + sizeof(Header));
+    m_end = m_begin + h.keys;
+    m_metaOffset = h.metaOffset;
+    m_metaSize = h.metaSize;
+}
+
+json Snapshot::meta() const
+{
+    const uint8_t* begin(
+            reinterpret_cast<const uint8_t*>(m_data + m_metaOffset));
+    return json::from_cbor(std::vector<uint8_t>(begin, begin + m_metaSize));
+}
+
+uint64_t Snapshot::count(const Dxyz& key) const
+{
+    const Record* it(std::lower_bound(
+                m_begin,
+                m_end,
+                key,
+                [](const Record& r, const Dxyz& k)
+                {
+                    if (r.d != k.d) return r.d < k.d;
+                    if (r.x != k.x) return r.x < k.x;
+                    if (r.y != k.y) return r.y < k.y;
+                    return r.z < k.z;
+                }));
+
+    if (
+            it != m_end &&
+            it->d == key.d && it->x == key.x && it->y == key.y &&
+            it->z == key.z)
+    {
+        return it->count;
+    }
+
+    return 0;
+}
+
+} // namespace entwine
@@ -0,0 +1,122 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/key.hpp>
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+
+// A compact binary image of an output's metadata and hierarchy, so a Reader
+// may open from a single file rather than fetching and parsing the JSON
+// metadata, file list, and every hierarchy file.  Local snapshots are
+// memory-mapped, so processes serving the same dataset share one copy of its
+// index in the page cache.
+//
+// The layout is a fixed 64-byte header, followed by one record per hierarchy
+// node sorted by key, followed by the CBOR-encoded metadata.  Integers are
+// stored in native byte order.
+class Snapshot
+{
+public:
+    using Keys = std::map<Dxyz, uint64_t>;
+
+    struct Record
+    {
+        uint64_t d;
+        uint64_t x;
+        uint64_t y;
+        uint64_t z;
+        uint64_t count;
+    };
+
+    static const std::string filename;
+
+    ~Snapshot();
+
+    // Serialize a snapshot.  Each snapshot receives a random token, which
+    // identifies it when validating cached copies.
+    static std::vector<char> create(
+            const json& ept,
+            const json& build,
+            const json& files,
+            const Keys& keys);
+
+    // Write a snapshot into an output, as done at the end of a build.
+    static void save(
+            const arbiter::Endpoint& out,
+            const json& ept,
+            const json& build,
+            const json& files,
+            const Keys& keys);
+
+    // Write a snapshot into a local output which lacks one, for example one
+    // built before snapshots existed.  Failure, for example due to a
+    // read-only output, is not an error.
+    static bool trySave(
+            const arbiter::Endpoint& out,
+            const json& ept,
+            const json& build,
+            const json& files,
+            const Keys& keys);
+
+    // Open the snapshot of this output, or return null if there is none.
+    // Remote snapshots are copied to a local tmp endpoint and mapped from
+    // there, and this copy is reused for as long as its token matches the
+    // remote one.
+    static std::shared_ptr<const Snapshot> open(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp);
+
+    // Map a local snapshot file.  Throws if it is not a valid snapshot.
+    static std::shared_ptr<const Snapshot> map(const std::string& path);
+
+    uint64_t token() const { return m_token; }
+
+    // An object containing the "ept", "build", and "files" used to create
+    // this snapshot.
+    json meta() const;
+
+    uint64_t count(const Dxyz& key) const;
+
+    const Record* begin() const { return m_begin; }
+    const Record* end() const { return m_end; }
+    std::size_t size() const { return m_end - m_begin; }
+
+private:
+    Snapshot(std::vector<char> data);
+    Snapshot(const char* data, std::size_t size);
+
+    // Check the layout of our data and locate its sections.
+    void validate();
+
+    std::vector<char> m_owned;
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_mapped = false;
+
+    uint64_t m_token = 0;
+    const Record* m_begin = nullptr;
+    const Record* m_end = nullptr;
+    uint64_t m_metaOffset = 0;
+    uint64_t m_metaSize = 0;
+};
+
+} // namespace entwine
@@ -843,6 +843,44 @@ http::Response Endpoint::httpPost(
     return getHttpDriver().internalPost(fullPath(path), data, headers, query);
 }
 
+bool Endpoint::supportsMultipart() const
+{
+    return dynamic_cast<const drivers::S3*>(&m_driver);
+}
+
+std::string Endpoint::initiateMultipart(const std::string subpath) const
+{
+    return getS3Driver().initiateMultipart(fullPath(subpath));
+}
+
+std::string Endpoint::putPart(
+        const std::string subpath,
+        const std::string& uploadId,
+        const std::size_t partNumber,
+        const std::vector<char>& data) const
+{
+    return getS3Driver().putPart(
+            fullPath(subpath),
+            uploadId,
+            partNumber,
+            data);
+}
+
+void Endpoint::completeMultipart(
+        const std::string subpath,
+        const std::string& uploadId,
+        const std::vector<std::string>& etags) const
+{
+    getS3Driver().completeMultipart(fullPath(subpath), uploadId, etags);
+}
+
+void Endpoint::abortMultipart(
+        const std::string subpath,
+        const std::string& uploadId) const
+{
+    getS3Driver().abortMultipart(fullPath(subpath), uploadId);
+}
+
 std::string Endpoint::fullPath(const std::string& subpath) const
 {
     return m_root + subpath;
@@ -863,6 +901,12 @@ std::string Endpoint::softPrefix() const
     return isRemote() ? type() + "://" : "";
 }
 
+const drivers::S3& Endpoint::getS3Driver() const
+{
+    if (auto d = dynamic_cast<const drivers::S3*>(&m_driver)) return *d;
+    throw ArbiterError("Cannot get driver of type " + type() + " as S3");
+}
+
 const drivers::Http* Endpoint::tryGetHttpDriver() const
 {
     return dynamic_cast<const drivers::Http*>(&m_driver);
@@ -1537,6 +1581,14 @@ Response Http::internalPost(
     return m_pool.acquire().post(typedPath(path), data, headers, query);
 }
 
+Response Http::internalDelete(
+        const std::string path,
+        const Headers headers,
+        const Query query) const
+{
+    return m_pool.acquire().del(typedPath(path), headers, query);
+}
+
 std::string Http::typedPath(const std::string& p) const
 {
     if (Arbiter::getType(p) != "file") return p;
@@ -2129,6 +2181,206 @@ void S3::copy(const std::string src, const std::string dst) const
     put(dst, std::vector<char>(), headers, Query());
 }
 
+std::string S3::initiateMultipart(
+        const std::string rawPath,
+        const Headers userHeaders) const
+{
+    // https://docs.aws.amazon.com/AmazonS3/latest/API/API_CreateMultipartUpload.html
+    const Resource resource(m_config->baseUrl(), rawPath);
+
+    Headers headers(m_config->baseHeaders());
+    headers.insert(userHeaders.begin(), userHeaders.end());
+
+    if (Arbiter::getExtension(rawPath) == "json")
+    {
+        headers["Content-Type"] = "application/json";
+    }
+
+    Query query;
+    query["uploads"] = "";
+
+    const ApiV4 apiV4(
+            "POST",
+            m_config->region(),
+            resource,
+            m_auth->fields(),
+            query,
+            headers,
+            empty);
+
+    drivers::Http http(m_pool);
+    Response res(
+            http.internalPost(
+                resource.url(),
+                empty,
+                apiV4.headers(),
+                apiV4.query()));
+
+    std::vector<char> data(res.data());
+    data.push_back('\0');
+
+    Xml::xml_document<> xml;
+
+    try
+    {
+        if (res.ok()) xml.parse<0>(data.data());
+    }
+    catch (Xml::parse_error&)
+    {
+        throw ArbiterError("Could not parse S3 response.");
+    }
+
+    if (XmlNode* topNode = xml.first_node("InitiateMultipartUploadResult"))
+    {
+        if (XmlNode* idNode = topNode->first_node("UploadId"))
+        {
+            return idNode->value();
+        }
+    }
+
+    throw ArbiterError(
+            "Couldn't initiate S3 multipart upload to " + rawPath + ": " +
+            std::string(res.data().data(), res.data().size()));
+}
+
+std::string S3::putPart(
+        const std::string rawPath,
+        const std::string& uploadId,
+        const std::size_t partNumber,
+        const std::vector<char>& data) const
+{
+    // https://docs.aws.amazon.com/AmazonS3/latest/API/API_UploadPart.html
+    const Resource resource(m_config->baseUrl(), rawPath);
+
+    // Encryption is specified when the upload is initiated.
+    Headers headers(m_config->baseHeaders());
+    headers.erase("x-amz-server-side-encryption");
+
+    Query query;
+    query["partNumber"] = std::to_string(partNumber);
+    query["uploadId"] = uploadId;
+
+    const ApiV4 apiV4(
+            "PUT",
+            m_config->region(),
+            resource,
+            m_auth->fields(),
+            query,
+            headers,
+            data);
+
+    drivers::Http http(m_pool);
+    Response res(
+            http.internalPut(
+                resource.url(),
+                data,
+                apiV4.headers(),
+                apiV4.query()));
+
+    if (res.ok())
+    {
+        for (const auto& h : res.headers())
+        {
+            if (toLower(h.first) == "etag") return h.second;
+        }
+    }
+
+    throw ArbiterError(
+            "Couldn't S3 PUT part " + std::to_string(partNumber) + " of " +
+            rawPath + ": " +
+            std::string(res.data().data(), res.data().size()));
+}
+
+void S3::completeMultipart(
+        const std::string rawPath,
+        const std::string& uploadId,
+        const std::vector<std::string>& etags) const
+{
+    // https://docs.aws.amazon.com/AmazonS3/latest/API/API_CompleteMultipartUpload.html
+    const Resource resource(m_config->baseUrl(), rawPath);
+
+    Headers headers(m_config->baseHeaders());
+    headers.erase("x-amz-server-side-encryption");
+    headers["Content-Type"] = "application/xml";
+
+    Query query;
+    query["uploadId"] = uploadId;
+
+    std::string body("<CompleteMultipartUpload>");
+    for (std::size_t i(0); i < etags.size(); ++i)
+    {
+        body +=
+            "<Part><PartNumber>" + std::to_string(i + 1) + "</PartNumber>" +
+            "<ETag>" + etags[i] + "</ETag></Part>";
+    }
+    body += "</CompleteMultipartUpload>";
+
+    const std::vector<char> data(body.begin(), body.end());
+
+    const ApiV4 apiV4(
+            "POST",
+            m_config->region(),
+            resource,
+            m_auth->fields(),
+            query,
+            headers,
+            data);
+
+    drivers::Http http(m_pool);
+    Response res(
+            http.internalPost(
+                resource.url(),
+                data,
+                apiV4.headers(),
+                apiV4.query()));
+
+    // A failure may also arrive as an error document in a 200 response.
+    const std::string result(res.data().data(), res.data().size());
+    if (!res.ok() || result.find("<Error>") != std::string::npos)
+    {
+        throw ArbiterError(
+                "Couldn't complete S3 multipart upload to " + rawPath + ": " +
+                result);
+    }
+}
+
+void S3::abortMultipart(
+        const std::string rawPath,
+        const std::string& uploadId) const
+{
+    // https://docs.aws.amazon.com/AmazonS3/latest/API/API_AbortMultipartUpload.html
+    const Resource resource(m_config->baseUrl(), rawPath);
+
+    Headers headers(m_config->baseHeaders());
+    headers.erase("x-amz-server-side-encryption");
+
+    Query query;
+    query["uploadId"] = uploadId;
+
+    const ApiV4 apiV4(
+            "DELETE",
+            m_config->region(),
+            resource,
+            m_auth->fields(),
+            query,
+            headers,
+            empty);
+
+    drivers::Http http(m_pool);
+    Response res(
+            http.internalDelete(
+                resource.url(),
+                apiV4.headers(),
+                apiV4.query()));
+
+    if (!res.ok())
+    {
+        throw ArbiterError(
+                "Couldn't abort S3 multipart upload to " + rawPath + ": " +
+                std::string(res.data().data(), res.data().size()));
+    }
+}
+
 std::vector<std::string> S3::glob(std::string path, bool verbose) const
 {
     std::vector<std::string> results;
@@ -3330,11 +3582,6 @@ namespace
         return fullBytes;
     }
 
-    std::size_t eatLogging(void *out, size_t size, size_t num, void *in)
-    {
-        return size * num;
-    }
-
 #else
     const std::string fail("Arbiter was built without curl");
 #endif // ARBITER_CURL
@@ -3628,13 +3875,27 @@ Response Curl::put(
             CURLOPT_INFILESIZE_LARGE,
             static_cast<curl_off_t>(data.size()));
 
-    // Hide Curl's habit of printing things to console even with verbose set
-    // to false.
-    curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, eatLogging);
+    // Keep the response, rather than letting Curl print it to the console.
+    std::vector<char> writeData;
+    curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, getCb);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, &writeData);
+
+    // Set up callback and data pointer for received headers.
+    Headers receivedHeaders;
+    curl_easy_setopt(m_curl, CURLOPT_HEADERFUNCTION, headerCb);
+    curl_easy_setopt(m_curl, CURLOPT_HEADERDATA, &receivedHeaders);
 
     // Run the command.
     const int httpCode(perform());
-    return Response(httpCode);
+
+    for (auto& h : receivedHeaders)
+    {
+        std::string& v(h.second);
+        while (v.size() && v.front() == ' ') v = v.substr(1);
+        while (v.size() && v.back() == ' ') v.pop_back();
+    }
+
+    return Response(httpCode, writeData, receivedHeaders);
 #else
     throw ArbiterError(fail);
 #endif
@@ -3686,6 +3947,31 @@ Response Curl::post(
 #endif
 }
 
+Response Curl::del(std::string path, Headers headers, Query query)
+{
+#ifdef ARBITER_CURL
+    std::vector<char> data;
+
+    init(path, headers, query);
+
+    // Register callback function and data pointer to consume the result.
+    curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, getCb);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, &data);
+
+    // Insert all headers into the request.
+    curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, m_headers);
+
+    // Specify a DELETE request.
+    curl_easy_setopt(m_curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+
+    // Run the command.
+    const int httpCode(perform());
+    return Response(httpCode, data, Headers());
+#else
+    throw ArbiterError(fail);
+#endif
+}
+
 } // namepace http
 } // namespace arbiter
 
@@ -3835,6 +4121,17 @@ Response Resource::post(
     });
 }
 
+Response Resource::del(
+        const std::string path,
+        const Headers headers,
+        const Query query)
+{
+    return exec([this, path, headers, query]()->Response
+    {
+        return m_curl.del(path, headers, query);
+    });
+}
+
 Response Resource::exec(std::function<Response()> f)
 {
     Response res;
@@ -23823,6 +23823,8 @@ public:
             Headers headers,
             Query query);
 
+    http::Response del(std::string path, Headers headers, Query query);
+
 private:
     Curl(std::string j);
 
@@ -23941,6 +23943,11 @@ public:
             Headers headers = Headers(),
             Query query = Query());
 
+    http::Response del(
+            std::string path,
+            Headers headers = Headers(),
+            Query query = Query());
+
 private:
     Pool& m_pool;
     Curl& m_curl;
@@ -24935,6 +24942,11 @@ public:
             http::Headers headers = http::Headers(),
             http::Query query = http::Query()) const;
 
+    http::Response internalDelete(
+            std::string path,
+            http::Headers headers = http::Headers(),
+            http::Query query = http::Query()) const;
+
 protected:
     /** HTTP-derived Drivers should override this version of GET to allow for
      * custom headers and query parameters.
@@ -25062,6 +25074,29 @@ public:
 
     virtual void copy(std::string src, std::string dst) const override;
 
+    /** Begin a multipart upload, returning its upload ID. */
+    std::string initiateMultipart(
+            std::string path,
+            http::Headers headers = http::Headers()) const;
+
+    /** Upload one part, numbered from 1, returning its ETag.  Every part but
+     * the last must be at least 5 MiB.
+     */
+    std::string putPart(
+            std::string path,
+            const std::string& uploadId,
+            std::size_t partNumber,
+            const std::vector<char>& data) const;
+
+    /** Complete an upload from the ETags of all of its parts, in order. */
+    void completeMultipart(
+            std::string path,
+            const std::string& uploadId,
+            const std::vector<std::string>& etags) const;
+
+    /** Discard an upload and any parts already stored for it. */
+    void abortMultipart(std::string path, const std::string& uploadId) const;
+
 private:
     static std::string extractProfile(std::string j);
 
@@ -25686,6 +25721,27 @@ public:
             http::Headers headers = http::Headers(),
             http::Query query = http::Query()) const;
 
+    /** True if uploads to this endpoint may be sent in parts.  Currently
+     * this holds only for S3.
+     */
+    bool supportsMultipart() const;
+
+    /** Passthroughs to the multipart operations of drivers::S3.  These throw
+     * if `supportsMultipart()` is false.
+     */
+    std::string initiateMultipart(std::string subpath) const;
+    std::string putPart(
+            std::string subpath,
+            const std::string& uploadId,
+            std::size_t partNumber,
+            const std::vector<char>& data) const;
+    void completeMultipart(
+            std::string subpath,
+            const std::string& uploadId,
+            const std::vector<std::string>& etags) const;
+    void abortMultipart(std::string subpath, const std::string& uploadId)
+        const;
+
 private:
     Endpoint(const Driver& driver, std::string root);
 
@@ -25695,6 +25751,7 @@ private:
 
     const drivers::Http* tryGetHttpDriver() const;
     const drivers::Http& getHttpDriver() const;
+    const drivers::S3& getS3Driver() const;
 
     const Driver& m_driver;
     std::string m_root;
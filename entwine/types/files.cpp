@@ -11,13 +11,16 @@
 #include <entwine/types/files.hpp>
 
 #include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <set>
 
 #include <entwine/io/ensure.hpp>
+#include <entwine/io/output-stream.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/util/json.hpp>
+#include <entwine/util/memory.hpp>
 #include <entwine/util/pool.hpp>
 #include <entwine/util/json.hpp>
 #include <entwine/util/unique.hpp>
@@ -33,6 +36,19 @@ std::string idFrom(std::string path)
     return arbiter::util::getBasename(path);
 }
 
+// Approximate, with per-file metadata counted at its serialized size.
+uint64_t footprint(const FileInfoList& files)
+{
+    uint64_t bytes(files.capacity() * sizeof(FileInfo));
+    for (const FileInfo& f : files)
+    {
+        bytes += f.path().size() + f.id().size() + f.url().size();
+        bytes += f.message().size();
+        if (!f.metadata().is_null()) bytes += f.metadata().dump().size();
+    }
+    return bytes;
+}
+
 } // unnamed namespace
 
 Files::Files(const FileInfoList& files)
@@ -83,6 +99,13 @@ Files::Files(const FileInfoList& files)
             f.setUrl(std::to_string(i / sourcesStep * sourcesStep) + ".json");
         }
     }
+
+    account();
+}
+
+Files::~Files()
+{
+    Memory::sub(Memory::Category::Files, m_bytes);
 }
 
 FileInfoList Files::extract(
@@ -141,8 +164,15 @@ void Files::writeList(
     json j;
     for (const FileInfo& f : list()) j.push_back(f.toListJson());
 
+    // Serialize directly into the output rather than into a string first,
+    // since this list may be very large.
     const bool styled(size() <= 1000);
-    ensurePut(ep, "list" + postfix + ".json", styled ? j.dump(2) : j.dump());
+    OutputStream stream(ep, "list" + postfix + ".json");
+    std::ostream os(&stream);
+    if (styled) os << std::setw(2);
+    os << j;
+    os.flush();
+    stream.close();
 }
 
 void Files::writeMeta(
@@ -180,6 +210,16 @@ void Files::append(const FileInfoList& fileInfo)
         f.setOrigin(m_files.size());
         m_files.emplace_back(f);
     }
+
+    account();
+}
+
+void Files::account()
+{
+    const uint64_t bytes(footprint(m_files));
+    if (bytes > m_bytes) Memory::add(Memory::Category::Files, bytes - m_bytes);
+    else Memory::sub(Memory::Category::Files, m_bytes - bytes);
+    m_bytes = bytes;
 }
 
 FileInfoList Files::diff(const FileInfoList& in) const
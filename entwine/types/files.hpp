@@ -34,6 +34,7 @@ class Files
 public:
     Files(const FileInfoList& files);
     Files(const json& j) : Files(j.get<FileInfoList>()) { }
+    ~Files();
 
     static FileInfoList extract(
             const arbiter::Endpoint& top,
@@ -80,6 +81,28 @@ public:
         if (primary) m_pointStats.addOutOfBounds(count);
     }
 
+    // Discount points of this origin which have been removed from the output.
+    void remove(Origin origin, std::size_t inserts)
+    {
+        const PointStats stats(inserts, 0);
+        get(origin).pointStats().subtract(stats);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pointStats.subtract(stats);
+    }
+
+    // Mark a file for insertion again, discarding its statistics.
+    void reset(Origin origin)
+    {
+        FileInfo& f(get(origin));
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pointStats.subtract(f.pointStats());
+        }
+        f.pointStats().clear();
+        f.status(FileInfo::Status::Outstanding);
+    }
+
     const FileInfoList& list() const { return m_files; }
     const PointStats& pointStats() const { return m_pointStats; }
 
@@ -115,7 +138,11 @@ private:
 
     void writeMeta(const arbiter::Endpoint& ep, const Config& config) const;
 
+    // Update our contribution to Memory::Category::Files.
+    void account();
+
     FileInfoList m_files;
+    uint64_t m_bytes = 0;
 
     mutable std::mutex m_mutex;
     PointStats m_pointStats;
@@ -10,9 +10,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <cmath>
 #include <cstdint>
+#include <limits>
 #include <ostream>
 #include <string>
 
@@ -136,8 +139,14 @@ inline bool operator!=(const Dxyz& a, const Dxyz& b)
 
 struct Key
 {
+    // The depth of the integer cell grid on which points are placed, limited
+    // so that squared distances across a cell fit in 64 bits.
+    static constexpr uint64_t maxGridLevels = 30;
+
     Key(const Metadata& metadata)
         : m(metadata)
+        , e(exactLevels(m.boundsCubic()))
+        , f(std::min(e, maxGridLevels))
     {
         reset();
     }
@@ -146,39 +155,260 @@ struct Key
     {
         b = m.boundsCubic();
         p.reset();
+        l = 0;
+        s = false;
+    }
+
+    // The cell of this point on the finest integer grid, at which every
+    // coarser cell is found by shifting.  This is only meaningful if the
+    // bounds are gridded at all - otherwise keys fall back to bisection.
+    Xyz cell(const Point& g) const
+    {
+        if (!f) return Xyz();
+
+        const Bounds& cube(m.boundsCubic());
+        const Point& mn(cube.min());
+        const Point& mx(cube.max());
+
+        return Xyz(
+                locate(mn.x, mx.x, g.x, f),
+                locate(mn.y, mx.y, g.y, f),
+                locate(mn.z, mx.z, g.z, f));
     }
 
     void init(const Point& g) { init(g, 0); }
 
     void init(const Point& g, uint64_t depth)
     {
-        reset();
-        for (std::size_t d(0); d < m.startDepth() + depth; ++d) step(g);
+        const uint64_t levels(m.startDepth() + depth);
+
+        if (levels <= e)
+        {
+            // Locate the cell directly rather than bisecting once per level.
+            // Since every bisection midpoint at these depths is exactly
+            // representable, the result is identical to stepping.
+            const Bounds& cube(m.boundsCubic());
+            const Point& mn(cube.min());
+            const Point& mx(cube.max());
+
+            p.x = locate(mn.x, mx.x, g.x, levels);
+            p.y = locate(mn.y, mx.y, g.y, levels);
+            p.z = locate(mn.z, mx.z, g.z, levels);
+            l = levels;
+            s = true;
+        }
+        else
+        {
+            reset();
+            for (std::size_t d(0); d < levels; ++d) step(g);
+        }
+    }
+
+    // As above, for a point whose grid cell is already known.
+    void init(const Point& g, const Xyz& c, uint64_t depth = 0)
+    {
+        const uint64_t levels(m.startDepth() + depth);
+        if (levels > f) return init(g, depth);
+
+        const uint64_t shift(f - levels);
+        p = Xyz(c.x >> shift, c.y >> shift, c.z >> shift);
+        l = levels;
+        s = true;
+    }
+
+    // The direction of the child cell containing this point.
+    Dir direction(const Point& g, const Xyz& c) const
+    {
+        if (l >= f) return getDirection(bounds().mid(), g);
+
+        const uint64_t shift(f - l - 1);
+        return toDir(
+                ((c.x >> shift) & 1 ? EwBit : 0) |
+                ((c.y >> shift) & 1 ? NsBit : 0) |
+                ((c.z >> shift) & 1 ? UdBit : 0));
+    }
+
+    Dir step(const Point& g, const Xyz& c)
+    {
+        if (l >= f) return step(getDirection(bounds().mid(), g));
+
+        const Dir dir(direction(g, c));
+        descend(dir);
+        s = true;
+        return dir;
     }
 
     Dir step(const Point& g)
     {
-        return step(getDirection(b.mid(), g));
+        return step(getDirection(bounds().mid(), g));
     }
 
     Dir step(Dir dir)
     {
-        p.x = (p.x << 1) | (isEast(dir)  ? 1u : 0u);
-        p.y = (p.y << 1) | (isNorth(dir) ? 1u : 0u);
-        p.z = (p.z << 1) | (isUp(dir)    ? 1u : 0u);
-
+        settle();
+        descend(dir);
         b.go(dir);
         return dir;
     }
 
+    // Whether point A is strictly nearer than point B to the middle of our
+    // cell, where both lie within it.  This must agree with comparing the
+    // squared distances in doubles, since that decides which point keeps a
+    // voxel.
+    bool nearer(
+            const Point& ag,
+            const Xyz& ac,
+            const Point& bg,
+            const Xyz& bc) const
+    {
+        if (l <= f)
+        {
+            // Measured in half-cells of the finest grid, taking each point as
+            // the center of its grid cell.  That is off by at most one unit
+            // per axis, which bounds the error of each squared distance.
+            // Double rounding is far smaller than one unit at these scales,
+            // so outside of that margin both comparisons agree.
+            const uint64_t shift(f - l);
+            uint64_t ad(0), ae(0), bd(0), be(0);
+            accumulate(ac.x, p.x, shift, ad, ae);
+            accumulate(ac.y, p.y, shift, ad, ae);
+            accumulate(ac.z, p.z, shift, ad, ae);
+            accumulate(bc.x, p.x, shift, bd, be);
+            accumulate(bc.y, p.y, shift, bd, be);
+            accumulate(bc.z, p.z, shift, bd, be);
+
+            const uint64_t margin(ae + be + ((ad + ae + bd + be) >> 48) + 1);
+            if (ad + margin <= bd) return true;
+            if (bd + margin <= ad) return false;
+        }
+
+        // A near tie, which is settled exactly as it always has been.
+        const Point& mid(bounds().mid());
+        return ag.sqDist3d(mid) < bg.sqDist3d(mid);
+    }
+
     const Metadata& metadata() const { return m; }
-    const Bounds& bounds() const { return b; }
     const Xyz& position() const { return p; }
 
+    const Bounds& bounds() const
+    {
+        settle();
+        return b;
+    }
+
+    // The number of bisections of these bounds for which every midpoint, and
+    // every cell edge, is an exactly representable double.  This holds for
+    // integral bounds as long as the finest cell size times the magnitude of
+    // the coordinates fits within the mantissa.
+    static uint64_t exactLevels(const Bounds& bounds)
+    {
+        const Point& mn(bounds.min());
+        const Point& mx(bounds.max());
+
+        const bool integral(
+                std::floor(mn.x) == mn.x && std::floor(mx.x) == mx.x &&
+                std::floor(mn.y) == mn.y && std::floor(mx.y) == mx.y &&
+                std::floor(mn.z) == mn.z && std::floor(mx.z) == mx.z);
+
+        if (!integral || mx.x <= mn.x || mx.y <= mn.y || mx.z <= mn.z)
+        {
+            return 0;
+        }
+
+        const double maxAbs(std::max({
+                std::abs(mn.x), std::abs(mx.x),
+                std::abs(mn.y), std::abs(mx.y),
+                std::abs(mn.z), std::abs(mx.z) }));
+
+        int exponent(0);
+        std::frexp(maxAbs, &exponent);
+        const int levels(std::numeric_limits<double>::digits - 2 - exponent);
+        return levels > 0 ? std::min(levels, 62) : 0;
+    }
+
+    // Equivalent to the result of bisecting [mn, mx) for the given number of
+    // levels, where a value at a midpoint belongs to the upper half.
+    static uint64_t locate(double mn, double mx, double v, uint64_t levels)
+    {
+        const int64_t n(1LL << levels);
+        const double cell((mx - mn) / n);
+
+        const double f(std::floor((v - mn) / cell));
+        int64_t i(0);
+        if (f >= n - 1) i = n - 1;
+        else if (f > 0) i = f;
+
+        // Correct for any rounding in the estimate above - the cell edges
+        // themselves are exact.
+        while (i > 0 && v < mn + i * cell) --i;
+        while (i < n - 1 && v >= mn + (i + 1) * cell) ++i;
+
+        return i;
+    }
+
     const Metadata& m;
+    uint64_t e = 0;
+    uint64_t f = 0;
 
-    Bounds b;
     Xyz p;
+    uint64_t l = 0;
+
+private:
+    void descend(Dir dir)
+    {
+        p.x = (p.x << 1) | (isEast(dir)  ? 1u : 0u);
+        p.y = (p.y << 1) | (isNorth(dir) ? 1u : 0u);
+        p.z = (p.z << 1) | (isUp(dir)    ? 1u : 0u);
+        ++l;
+    }
+
+    // Within the exact levels, our bounds follow from our position alone, so
+    // the integer path leaves them to be computed only when asked for.
+    void settle() const
+    {
+        if (!s) return;
+        s = false;
+
+        const Bounds& cube(m.boundsCubic());
+        const Point& mn(cube.min());
+        const Point& mx(cube.max());
+
+        const double n(1ULL << l);
+        const Point cell(
+                (mx.x - mn.x) / n,
+                (mx.y - mn.y) / n,
+                (mx.z - mn.z) / n);
+
+        b.set(
+                Point(
+                    mn.x + p.x * cell.x,
+                    mn.y + p.y * cell.y,
+                    mn.z + p.z * cell.z),
+                Point(
+                    mn.x + (p.x + 1) * cell.x,
+                    mn.y + (p.y + 1) * cell.y,
+                    mn.z + (p.z + 1) * cell.z));
+    }
+
+    // Add the squared distance along one axis, in half-cells of the finest
+    // grid, from the center of grid cell C to the middle of our cell at
+    // position P, along with the bound on its error.
+    static void accumulate(
+            uint64_t c,
+            uint64_t p,
+            uint64_t shift,
+            uint64_t& dist,
+            uint64_t& err)
+    {
+        const uint64_t a(2 * c + 1);
+        const uint64_t mid((2 * p + 1) << shift);
+        const uint64_t d(a > mid ? a - mid : mid - a);
+        dist += d * d;
+        err += 2 * d + 1;
+    }
+
+    mutable Bounds b;
+    mutable bool s = false;
 };
 
 inline bool operator<(const Key& a, const Key& b)
@@ -220,6 +450,11 @@ struct ChunkKey
         return c;
     }
 
+    Dir direction(const Point& g, const Xyz& c) const
+    {
+        return k.direction(g, c);
+    }
+
     std::string toString() const { return position().toString(d); }
 
     Dxyz get() const { return Dxyz(d, k.p); }
@@ -10,6 +10,7 @@
 
 #include <cassert>
 
+#include <entwine/builder/overflow-tuner.hpp>
 #include <entwine/io/io.hpp>
 #include <entwine/types/files.hpp>
 #include <entwine/types/metadata.hpp>
@@ -43,11 +44,19 @@ Metadata::Metadata(const Config& config, const bool exists)
     , m_srs(makeUnique<Srs>(config.srs()))
     , m_subset(Subset::create(boundsCubic(), config.subset()))
     , m_trustHeaders(config.trustHeaders())
+    , m_scaledResident(config.scaledResident() && m_outSchema->isScaled())
     , m_span(config.span())
     , m_startDepth(std::log2(m_span))
     , m_sharedDepth(m_subset ? m_subset->splits() : 0)
     , m_overflowDepth(std::max(config.overflowDepth(), m_sharedDepth))
     , m_overflowThreshold(config.overflowThreshold())
+    , m_overflowTuner(makeUnique<OverflowTuner>(
+                m_span,
+                m_overflowThreshold,
+                config.adaptiveOverflow()))
+    , m_nodeOrder(toNodeOrder(config.nodeOrder()))
+    , m_bundleDepth(m_subset ? 0 : config.bundleDepth())
+    , m_incremental(exists && !m_subset && config.incremental())
 {
     if (1ULL << m_startDepth != m_span)
     {
@@ -106,46 +115,68 @@ Metadata::Metadata(const arbiter::Endpoint& ep, const Config& c)
     m_files = makeUnique<Files>(files.list());
 }
 
+Metadata::Metadata(
+        const json& ept,
+        const json& build,
+        const json& files,
+        const Config& c)
+    : Metadata(entwine::merge(json(c), entwine::merge(build, ept)), true)
+{
+    Files list(files);
+    list.append(m_files->list());
+    m_files = makeUnique<Files>(list.list());
+}
+
 Metadata::~Metadata() { }
 
 void Metadata::save(const arbiter::Endpoint& ep, const Config& config) const
 {
     {
-        const json meta {
-            { "version", eptVersion().toString() },
-            { "bounds", boundsCubic() },
-            { "boundsConforming", boundsConforming() },
-            { "schema", *m_outSchema },
-            { "span", m_span },
-            { "points", m_files->totalInserts() },
-            { "dataType", m_dataIo->type() },
-            { "hierarchyType", "json" }, // TODO
-            { "srs", *m_srs }
-        };
-
         const std::string f("ept" + postfix() + ".json");
-        ensurePut(ep, f, meta.dump(2));
+        ensurePut(ep, f, eptJson().dump(2));
     }
 
     {
-        json buildMeta {
-            { "software", "Entwine" },
-            { "version", currentEntwineVersion().toString() },
-            { "trustHeaders", m_trustHeaders },
-            { "overflowDepth", m_overflowDepth },
-            { "overflowThreshold", m_overflowThreshold }
-        };
-        if (m_subset) buildMeta["subset"] = *m_subset;
-        if (m_reprojection) buildMeta["reprojection"] = *m_reprojection;
-
         const std::string f("ept-build" + postfix() + ".json");
-        ensurePut(ep, f, buildMeta.dump(2));
+        ensurePut(ep, f, buildJson().dump(2));
     }
 
     const bool detailed(!m_merged && primary());
     m_files->save(ep, postfix(), config, detailed);
 }
 
+json Metadata::eptJson() const
+{
+    return json {
+        { "version", eptVersion().toString() },
+        { "bounds", boundsCubic() },
+        { "boundsConforming", boundsConforming() },
+        { "schema", *m_outSchema },
+        { "span", m_span },
+        { "points", m_files->totalInserts() },
+        { "dataType", m_dataIo->type() },
+        { "hierarchyType", "json" }, // TODO
+        { "srs", *m_srs }
+    };
+}
+
+json Metadata::buildJson() const
+{
+    json buildMeta {
+        { "software", "Entwine" },
+        { "version", currentEntwineVersion().toString() },
+        { "trustHeaders", m_trustHeaders },
+        { "overflowDepth", m_overflowDepth },
+        { "overflowThreshold", m_overflowThreshold },
+        { "adaptiveOverflow", m_overflowTuner->adaptive() },
+        { "nodeOrder", toString(m_nodeOrder) },
+        { "bundleDepth", m_bundleDepth }
+    };
+    if (m_subset) buildMeta["subset"] = *m_subset;
+    if (m_reprojection) buildMeta["reprojection"] = *m_reprojection;
+    return buildMeta;
+}
+
 void Metadata::merge(const Metadata& other)
 {
     m_files->merge(other.files());
@@ -19,6 +19,7 @@
 #include <entwine/builder/config.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/defs.hpp>
+#include <entwine/types/node-order.hpp>
 #include <entwine/types/subset.hpp>
 
 namespace Json { class Value; }
@@ -30,6 +31,7 @@ namespace arbiter { class Endpoint; }
 
 class DataIo;
 class Files;
+class OverflowTuner;
 class Point;
 class Reprojection;
 class Schema;
@@ -39,6 +41,7 @@ class Version;
 class Metadata
 {
     friend class Builder;
+    friend class Remover;
     friend class Sequence;
 
 public:
@@ -47,11 +50,23 @@ public:
             const arbiter::Endpoint& endpoint,
             const Config& config = Config());
 
+    // Construct from the already-fetched contents of an existing output:
+    // its ept.json, ept-build.json, and detailed file list.
+    Metadata(
+            const json& ept,
+            const json& build,
+            const json& files,
+            const Config& config = Config());
+
     ~Metadata();
 
     void merge(const Metadata& other);
     void save(const arbiter::Endpoint& endpoint, const Config& config) const;
 
+    // The contents of ept.json and ept-build.json, respectively.
+    json eptJson() const;
+    json buildJson() const;
+
     const Bounds& boundsConforming() const { return *m_boundsConforming; }
     const Bounds& boundsCubic() const { return *m_boundsCubic; }
     const Bounds* boundsSubset() const
@@ -62,6 +77,15 @@ public:
 
     const Schema& schema() const { return *m_schema; }
     const Schema& outSchema() const { return *m_outSchema; }
+
+    // The layout of points held in memory during a build.  This is the
+    // absolute schema unless a scaled-resident build was requested, in which
+    // case points are held in the scaled output schema.
+    const Schema& residentSchema() const
+    {
+        return m_scaledResident ? *m_outSchema : *m_schema;
+    }
+    bool scaledResident() const { return m_scaledResident; }
     const Files& files() const { return *m_files; }
 
     const DataIo& dataIo() const { return *m_dataIo; }
@@ -81,6 +105,23 @@ public:
     uint64_t overflowDepth() const { return m_overflowDepth; }
     uint64_t overflowThreshold() const { return m_overflowThreshold; }
 
+    // Per-depth thresholds, which equal overflowThreshold() unless adaptive
+    // overflow is enabled.  Chunks report their activity to it.
+    OverflowTuner& overflowTuner() const { return *m_overflowTuner; }
+    NodeOrder nodeOrder() const { return m_nodeOrder; }
+
+    // Nodes at or below this depth are packed into bundles, one per node at
+    // this depth, rather than stored individually.  Zero if not bundled.
+    uint64_t bundleDepth() const { return m_bundleDepth; }
+    bool bundled(uint64_t depth) const
+    {
+        return m_bundleDepth && depth >= m_bundleDepth;
+    }
+
+    // True while appending to an existing build without rewriting the nodes
+    // which have already overflowed.  This is not persisted.
+    bool incremental() const { return m_incremental; }
+
     void makeWhole();
 
     std::string postfix() const;
@@ -109,6 +150,7 @@ private:
     std::unique_ptr<Subset> m_subset;
 
     const bool m_trustHeaders = true;
+    const bool m_scaledResident = false;
 
     const uint64_t m_span;
     const uint64_t m_startDepth;
@@ -116,6 +158,10 @@ private:
 
     const uint64_t m_overflowDepth;
     const uint64_t m_overflowThreshold;
+    std::unique_ptr<OverflowTuner> m_overflowTuner;
+    const NodeOrder m_nodeOrder;
+    const uint64_t m_bundleDepth;
+    const bool m_incremental;
 
     bool m_merged = false;
 };
@@ -0,0 +1,225 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/node-order.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <pdal/PointRef.hpp>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/scale-offset.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/types/vector-point-table.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    const uint32_t curveBits(21);
+    const uint32_t curveMax((1u << curveBits) - 1);
+
+    // Spread the lower 21 bits of v so that there are two zero bits between
+    // each of them.
+    uint64_t spread(uint64_t v)
+    {
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x001f00000000ffffULL;
+        v = (v | v << 16) & 0x001f0000ff0000ffULL;
+        v = (v | v << 8)  & 0x100f00f00f00f00fULL;
+        v = (v | v << 4)  & 0x10c30c30c30c30c3ULL;
+        v = (v | v << 2)  & 0x1249249249249249ULL;
+        return v;
+    }
+
+    uint32_t quantize(double v, double min, double width)
+    {
+        const double f(std::floor((v - min) / width * (curveMax + 1.0)));
+        if (!(f > 0)) return 0;
+        if (f >= curveMax) return curveMax;
+        return f;
+    }
+}
+
+NodeOrder toNodeOrder(const std::string& s)
+{
+    if (s == "none") return NodeOrder::None;
+    if (s == "gpstime") return NodeOrder::GpsTime;
+    if (s == "morton") return NodeOrder::Morton;
+    if (s == "hilbert") return NodeOrder::Hilbert;
+    throw std::runtime_error("Invalid node order: " + s);
+}
+
+std::string toString(const NodeOrder order)
+{
+    switch (order)
+    {
+        case NodeOrder::None: return "none";
+        case NodeOrder::GpsTime: return "gpstime";
+        case NodeOrder::Morton: return "morton";
+        case NodeOrder::Hilbert: return "hilbert";
+    }
+    throw std::runtime_error("Invalid node order");
+}
+
+bool prefixSamples(const NodeOrder order)
+{
+    return order == NodeOrder::None;
+}
+
+void radixSort(std::vector<std::pair<uint64_t, char*>>& keyed)
+{
+    using Keyed = std::pair<uint64_t, char*>;
+
+    std::vector<Keyed> swap(keyed.size());
+    std::array<std::size_t, 256> counts;
+
+    for (uint64_t shift(0); shift < 64; shift += 8)
+    {
+        counts.fill(0);
+        for (const Keyed& k : keyed) ++counts[(k.first >> shift) & 0xff];
+
+        // If every key has the same byte here, this pass is a no-op.
+        if (std::count(counts.begin(), counts.end(), 0) == 255) continue;
+
+        std::size_t offset(0);
+        for (std::size_t& c : counts)
+        {
+            const std::size_t n(c);
+            c = offset;
+            offset += n;
+        }
+
+        for (const Keyed& k : keyed)
+        {
+            swap[counts[(k.first >> shift) & 0xff]++] = k;
+        }
+
+        keyed.swap(swap);
+    }
+}
+
+uint64_t sortable(const double d)
+{
+    uint64_t u(0);
+    std::memcpy(&u, &d, sizeof(u));
+
+    const uint64_t sign(1ULL << 63);
+    return (u & sign) ? ~u : (u | sign);
+}
+
+uint64_t mortonCode(const uint32_t x, const uint32_t y, const uint32_t z)
+{
+    return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+}
+
+uint64_t hilbertCode(uint32_t x, uint32_t y, uint32_t z)
+{
+    // Skilling, "Programming the Hilbert curve", AIP Conf. Proc. 707 (2004).
+    std::array<uint32_t, 3> v { { x & curveMax, y & curveMax, z & curveMax } };
+    const uint32_t m(1u << (curveBits - 1));
+
+    // Inverse undo.
+    for (uint32_t q(m); q > 1; q >>= 1)
+    {
+        const uint32_t p(q - 1);
+        for (uint32_t& c : v)
+        {
+            if (c & q) v[0] ^= p;
+            else
+            {
+                const uint32_t t((v[0] ^ c) & p);
+                v[0] ^= t;
+                c ^= t;
+            }
+        }
+    }
+
+    // Gray encode.
+    v[1] ^= v[0];
+    v[2] ^= v[1];
+
+    uint32_t t(0);
+    for (uint32_t q(m); q > 1; q >>= 1) if (v[2] & q) t ^= q - 1;
+    for (uint32_t& c : v) c ^= t;
+
+    // Interleave the transposed result, most significant bits first.
+    uint64_t code(0);
+    for (int bit(curveBits - 1); bit >= 0; --bit)
+    {
+        for (const uint32_t c : v) code = (code << 1) | ((c >> bit) & 1);
+    }
+    return code;
+}
+
+void sortNode(
+        const Metadata& metadata,
+        const Bounds& bounds,
+        BlockPointTable& table)
+{
+    const NodeOrder order(metadata.nodeOrder());
+    if (order == NodeOrder::None || table.size() < 2) return;
+
+    const Schema& schema(metadata.residentSchema());
+    if (order == NodeOrder::GpsTime && !schema.contains(DimId::GpsTime))
+    {
+        return;
+    }
+
+    std::unique_ptr<ScaleOffset> so;
+    if (metadata.scaledResident()) so = metadata.outSchema().scaleOffset();
+
+    std::vector<std::pair<uint64_t, char*>> keyed;
+    keyed.reserve(table.size());
+
+    pdal::PointRef pr(table, 0);
+    Point p;
+
+    for (uint64_t i(0); i < table.size(); ++i)
+    {
+        pr.setPointId(i);
+        uint64_t key(0);
+
+        if (order == NodeOrder::GpsTime)
+        {
+            key = sortable(pr.getFieldAs<double>(DimId::GpsTime));
+        }
+        else
+        {
+            p.x = pr.getFieldAs<double>(DimId::X);
+            p.y = pr.getFieldAs<double>(DimId::Y);
+            p.z = pr.getFieldAs<double>(DimId::Z);
+            if (so) p = Point::unscale(p, so->scale(), so->offset());
+
+            const uint32_t x(quantize(p.x, bounds.min().x, bounds.width()));
+            const uint32_t y(quantize(p.y, bounds.min().y, bounds.depth()));
+            const uint32_t z(quantize(p.z, bounds.min().z, bounds.height()));
+
+            key = order == NodeOrder::Morton ?
+                mortonCode(x, y, z) :
+                hilbertCode(x, y, z);
+        }
+
+        keyed.emplace_back(key, table.getPoint(i));
+    }
+
+    radixSort(keyed);
+
+    std::vector<char*>& refs(table.refs());
+    for (std::size_t i(0); i < keyed.size(); ++i) refs[i] = keyed[i].second;
+}
+
+} // namespace entwine
@@ -0,0 +1,63 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace entwine
+{
+
+class BlockPointTable;
+class Bounds;
+class Metadata;
+
+// The order in which points are serialized within each data node.
+enum class NodeOrder
+{
+    None,       // Insertion order.
+    GpsTime,    // Ascending GpsTime.
+    Morton,     // Z-order curve of point position within the node bounds.
+    Hilbert     // Hilbert curve of point position within the node bounds.
+};
+
+NodeOrder toNodeOrder(const std::string& s);
+std::string toString(NodeOrder order);
+
+// Whether the leading points of a node in this order are a subsample of the
+// whole node.  The sorted orders lay points along a path through the node, so
+// a prefix of them covers only one end of that path - a spatial corner, for
+// the curve orders - and such nodes must be read in full and thinned instead.
+bool prefixSamples(NodeOrder order);
+
+// Sort 64-bit keys in place, stably, with an LSD radix sort.  Byte positions
+// at which all keys are identical are skipped.
+void radixSort(std::vector<std::pair<uint64_t, char*>>& keyed);
+
+// Order-preserving mapping of a double to an unsigned integer.
+uint64_t sortable(double d);
+
+// Interleave the lower 21 bits of each coordinate.
+uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z);
+
+// Position along a 3D Hilbert curve of 21 bits per dimension.
+uint64_t hilbertCode(uint32_t x, uint32_t y, uint32_t z);
+
+// Reorder the points of a node, in place, according to the node order of
+// this build.  The table must be in the resident schema of the metadata.
+void sortNode(
+        const Metadata& metadata,
+        const Bounds& bounds,
+        BlockPointTable& table);
+
+} // namespace entwine
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 
 #include <entwine/types/defs.hpp>
@@ -50,6 +51,13 @@ public:
     std::size_t oob() const { return outOfBounds(); }
 
     void addOutOfBounds(std::size_t n) { m_outOfBounds += n; }
+
+    void subtract(const PointStats& other)
+    {
+        m_inserts -= std::min(m_inserts, other.m_inserts);
+        m_outOfBounds -= std::min(m_outOfBounds, other.m_outOfBounds);
+    }
+
     void clear()
     {
         m_inserts = 0;
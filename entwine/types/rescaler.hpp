@@ -0,0 +1,100 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+
+#include <pdal/PointRef.hpp>
+
+#include <entwine/types/binary-point-table.hpp>
+#include <entwine/types/point.hpp>
+#include <entwine/types/scale-offset.hpp>
+#include <entwine/types/schema.hpp>
+
+namespace entwine
+{
+
+// Copies single points between the absolute schema, where XYZ are doubles,
+// and the scaled output schema, where XYZ are integers in the scale/offset
+// domain.  All non-spatial dimensions are copied verbatim.
+class Rescaler
+{
+public:
+    Rescaler(const Schema& dst, const ScaleOffset& so)
+        : m_layout(dst.pdalLayout())
+        , m_table(dst)
+        , m_so(so)
+        , m_dims(m_layout.dimTypes())
+    {
+        m_dims.erase(
+                std::remove_if(
+                    m_dims.begin(),
+                    m_dims.end(),
+                    [](const pdal::DimType& d)
+                    {
+                        return d.m_id == DimId::X || d.m_id == DimId::Y ||
+                            d.m_id == DimId::Z;
+                    }),
+                m_dims.end());
+    }
+
+    // Source XYZ are absolute, and will be written to the destination as
+    // scaled integers.
+    void scale(const pdal::PointRef& src, char* dst)
+    {
+        m_p.x = src.getFieldAs<double>(DimId::X);
+        m_p.y = src.getFieldAs<double>(DimId::Y);
+        m_p.z = src.getFieldAs<double>(DimId::Z);
+        m_p = Point::scale(m_p, m_so.scale(), m_so.offset()).round();
+
+        copy(src, dst);
+    }
+
+    // Source XYZ are scaled integers, and will be written to the destination
+    // as absolute doubles.
+    void unscale(const pdal::PointRef& src, char* dst)
+    {
+        m_p.x = src.getFieldAs<double>(DimId::X);
+        m_p.y = src.getFieldAs<double>(DimId::Y);
+        m_p.z = src.getFieldAs<double>(DimId::Z);
+        m_p = Point::unscale(m_p, m_so.scale(), m_so.offset());
+
+        copy(src, dst);
+    }
+
+private:
+    void copy(const pdal::PointRef& src, char* dst)
+    {
+        m_table.setPoint(dst);
+
+        pdal::PointRef& dstPr(m_table.ref());
+        dstPr.setField(DimId::X, m_p.x);
+        dstPr.setField(DimId::Y, m_p.y);
+        dstPr.setField(DimId::Z, m_p.z);
+
+        for (const pdal::DimType& dim : m_dims)
+        {
+            src.getField(
+                    dst + m_layout.dimOffset(dim.m_id),
+                    dim.m_id,
+                    dim.m_type);
+        }
+    }
+
+    const pdal::PointLayout& m_layout;
+    BinaryPointTable m_table;
+    const ScaleOffset& m_so;
+    pdal::DimTypeList m_dims;
+
+    Point m_p;
+};
+
+} // namespace entwine
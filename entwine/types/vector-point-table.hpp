@@ -18,6 +18,7 @@
 #include <pdal/PointTable.hpp>
 
 #include <entwine/types/schema.hpp>
+#include <entwine/util/memory.hpp>
 
 namespace entwine
 {
@@ -36,10 +37,26 @@ public:
         m_refs.reserve(m_pointsPerBlock);
     }
 
+    MemBlock(MemBlock&& other)
+        : m_pointSize(other.m_pointSize)
+        , m_pointsPerBlock(other.m_pointsPerBlock)
+        , m_bytesPerBlock(other.m_bytesPerBlock)
+        , m_blocks(std::move(other.m_blocks))
+        , m_pos(other.m_pos)
+        , m_end(other.m_end)
+        , m_refs(std::move(other.m_refs))
+    {
+        other.m_blocks.clear();
+        other.clear();
+    }
+
+    ~MemBlock() { clear(); }
+
     char* next()
     {
         if (m_pos == m_end)
         {
+            Memory::add(Memory::Category::Blocks, m_bytesPerBlock);
             m_blocks.emplace_back(Block(m_bytesPerBlock));
             m_pos = m_blocks.back().data();
             m_end = m_pos + m_bytesPerBlock;
@@ -55,6 +72,9 @@ public:
     const std::vector<char*>& refs() const { return m_refs; }
     void clear()
     {
+        Memory::sub(
+                Memory::Category::Blocks,
+                m_blocks.size() * m_bytesPerBlock);
         m_blocks.clear();
         m_pos = nullptr;
         m_end = nullptr;
@@ -95,6 +115,7 @@ public:
     virtual pdal::PointId addPoint() override { return m_index++; }
     virtual bool supportsView() const override { return true; }
     uint64_t size() const { return m_refs.size(); }
+    std::vector<char*>& refs() { return m_refs; }
 
 private:
     std::vector<char*> m_refs;
@@ -14,6 +14,7 @@
 #include <cmath>
 #include <cstddef>
 
+#include <entwine/types/key.hpp>
 #include <entwine/types/point.hpp>
 #include <entwine/types/scale-offset.hpp>
 
@@ -24,13 +25,15 @@ class Voxel
 {
 public:
     const Point& point() const { return m_point; }
+    const Xyz& cell() const { return m_cell; }
     const char* const data() const { return m_data; }
     void setData(char* pos) { m_data = pos; }
 
-    void initDeep(const Point& point, const char* const pos, std::size_t size)
+    void initDeep(const Voxel& voxel, std::size_t size)
     {
-        m_point = point;
-        std::copy(pos, pos + size, m_data);
+        m_point = voxel.m_point;
+        m_cell = voxel.m_cell;
+        std::copy(voxel.m_data, voxel.m_data + size, m_data);
     }
 
     void initShallow(const pdal::PointRef& pr, char* pos)
@@ -46,8 +49,23 @@ public:
         m_point = so.clip(m_point);
     }
 
+    // Place our point on the integer cell grid of this key, after any
+    // clipping, so that insertion never needs to revisit its coordinates.
+    void locate(const Key& key)
+    {
+        m_cell = key.cell(m_point);
+    }
+
+    // For voxels initialized from scaled-resident data, whose XYZ values are
+    // in the scaled integer domain.
+    void unscale(const ScaleOffset& so)
+    {
+        m_point = Point::unscale(m_point, so.scale(), so.offset());
+    }
+
 private:
     Point m_point;
+    Xyz m_cell;
     char* m_data = nullptr;
 };
 
@@ -0,0 +1,251 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/contention.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace entwine
+{
+
+namespace
+{
+    const std::size_t maxSites(64);
+
+    // Written only by the owning thread, so updates are plain loads and
+    // stores rather than read-modify-writes.
+    struct Counters
+    {
+        std::atomic<uint64_t> acquisitions;
+        std::atomic<uint64_t> contended;
+        std::atomic<uint64_t> spins;
+        std::atomic<uint64_t> yields;
+        std::atomic<uint64_t> parks;
+        std::atomic<uint64_t> wait;
+        std::atomic<uint64_t> hold;
+        std::atomic<uint64_t> maxHold;
+    };
+
+    using Sites = std::array<Counters, maxSites>;
+
+    void add(std::atomic<uint64_t>& a, uint64_t n)
+    {
+        if (!n) return;
+        const uint64_t v(a.load(std::memory_order_relaxed));
+        a.store(v + n, std::memory_order_relaxed);
+    }
+
+    uint64_t get(const std::atomic<uint64_t>& a)
+    {
+        return a.load(std::memory_order_relaxed);
+    }
+
+    void zero(Sites& sites)
+    {
+        for (Counters& c : sites)
+        {
+            c.acquisitions = 0;
+            c.contended = 0;
+            c.spins = 0;
+            c.yields = 0;
+            c.parks = 0;
+            c.wait = 0;
+            c.hold = 0;
+            c.maxHold = 0;
+        }
+    }
+
+    // Site zero is "other".  Slots are only ever filled, never cleared, so
+    // lookups of existing names need no lock.
+    std::array<std::atomic<const char*>, maxSites> names;
+    std::atomic<std::size_t> named(0);
+
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Sites>> threads;
+
+    Sites& local()
+    {
+        thread_local std::shared_ptr<Sites> sites([]()
+            -> std::shared_ptr<Sites>
+        {
+            auto s(std::make_shared<Sites>());
+            zero(*s);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.push_back(s);
+            return s;
+        }());
+
+        return *sites;
+    }
+
+    std::size_t find(const char* name, std::size_t n)
+    {
+        for (std::size_t i(0); i < n; ++i)
+        {
+            const char* s(names[i].load());
+            if (s == name || !std::strcmp(s, name)) return i;
+        }
+        return maxSites;
+    }
+
+    double ms(uint64_t ns) { return ns / 1000000.0; }
+}
+
+bool Contention::compiled()
+{
+#ifdef ENTWINE_LOCK_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::size_t Contention::site(const char* name)
+{
+    const std::size_t i(find(name, named.load()));
+    if (i < maxSites) return i;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!named.load())
+    {
+        names[0] = "other";
+        named = 1;
+    }
+
+    const std::size_t n(named.load());
+    const std::size_t j(find(name, n));
+    if (j < maxSites) return j;
+    if (n == maxSites) return 0;
+
+    names[n] = name;
+    named = n + 1;
+    return n;
+}
+
+void Contention::acquired(
+        const std::size_t site,
+        const bool contended,
+        const uint64_t wait,
+        const uint64_t spins,
+        const uint64_t yields,
+        const uint64_t parks)
+{
+    Counters& c(local()[site]);
+    add(c.acquisitions, 1);
+    if (!contended) return;
+
+    add(c.contended, 1);
+    add(c.wait, wait);
+    add(c.spins, spins);
+    add(c.yields, yields);
+    add(c.parks, parks);
+}
+
+void Contention::released(const std::size_t site, const uint64_t hold)
+{
+    Counters& c(local()[site]);
+    add(c.hold, hold);
+    if (hold > get(c.maxHold)) c.maxHold.store(hold);
+}
+
+std::vector<Contention::Stats> Contention::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<Stats> result(named.load());
+    for (std::size_t i(0); i < result.size(); ++i)
+    {
+        Stats& s(result[i]);
+        s.name = names[i].load();
+
+        for (const auto& t : threads)
+        {
+            const Counters& c((*t)[i]);
+            s.acquisitions += get(c.acquisitions);
+            s.contended += get(c.contended);
+            s.spins += get(c.spins);
+            s.yields += get(c.yields);
+            s.parks += get(c.parks);
+            s.wait += get(c.wait);
+            s.hold += get(c.hold);
+            s.maxHold = std::max(s.maxHold, get(c.maxHold));
+        }
+    }
+
+    result.erase(
+            std::remove_if(
+                result.begin(),
+                result.end(),
+                [](const Stats& s) { return !s.acquisitions; }),
+            result.end());
+
+    std::sort(
+            result.begin(),
+            result.end(),
+            [](const Stats& a, const Stats& b) { return a.wait > b.wait; });
+
+    return result;
+}
+
+void Contention::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& t : threads) zero(*t);
+}
+
+std::string Contention::report()
+{
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "Lock contention:" << std::endl;
+    ss << "\t" <<
+        std::left << std::setw(16) << "Site" << std::right <<
+        std::setw(14) << "Acquired" <<
+        std::setw(10) << "Cont %" <<
+        std::setw(12) << "Spins" <<
+        std::setw(10) << "Yields" <<
+        std::setw(8) << "Parks" <<
+        std::setw(12) << "Wait ms" <<
+        std::setw(12) << "Hold ms" <<
+        std::setw(12) << "Max hold ms" << std::endl;
+
+    for (const Stats& s : stats())
+    {
+        ss << "\t" <<
+            std::left << std::setw(16) << s.name << std::right <<
+            std::setw(14) << s.acquisitions <<
+            std::setw(10) << 100.0 * s.contended / s.acquisitions <<
+            std::setw(12) << s.spins <<
+            std::setw(10) << s.yields <<
+            std::setw(8) << s.parks <<
+            std::setw(12) << ms(s.wait) <<
+            std::setw(12) << ms(s.hold) <<
+            std::setw(12) << ms(s.maxHold) << std::endl;
+    }
+
+    return ss.str();
+}
+
+uint64_t Contention::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace entwine
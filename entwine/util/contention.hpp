@@ -0,0 +1,79 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace entwine
+{
+
+// Per-site lock statistics.  Locks are counted only when ENTWINE_LOCK_STATS
+// is defined (see the WITH_LOCK_STATS CMake option), in which case each
+// SpinLock reports to the site named at its construction, and the Executor
+// reports its global mutex as the "executor" site.
+//
+// Counters are kept per thread and summed when read, so instrumented locks
+// do not contend on their own statistics.
+class Contention
+{
+public:
+    struct Stats
+    {
+        std::string name;
+        uint64_t acquisitions = 0;
+        uint64_t contended = 0;
+
+        // Rounds of the backoff spent waiting on contended acquisitions.
+        uint64_t spins = 0;
+        uint64_t yields = 0;
+        uint64_t parks = 0;
+
+        // Nanoseconds.  Hold times are unavailable for the "executor" site.
+        uint64_t wait = 0;
+        uint64_t hold = 0;
+        uint64_t maxHold = 0;
+    };
+
+    // True if locks were compiled to report here.
+    static bool compiled();
+
+    // The index of the named site, registered on first use.  Names are
+    // compared by value, so the same literal in different translation units
+    // refers to the same site.  Past a fixed number of sites, new names are
+    // counted as "other".
+    static std::size_t site(const char* name);
+
+    static void acquired(
+            std::size_t site,
+            bool contended,
+            uint64_t wait,
+            uint64_t spins = 0,
+            uint64_t yields = 0,
+            uint64_t parks = 0);
+    static void released(std::size_t site, uint64_t hold);
+
+    // Sites with at least one acquisition, ordered by decreasing wait time.
+    static std::vector<Stats> stats();
+
+    // Zero all counters.  Counts from locks held during a reset may be lost.
+    static void reset();
+
+    // A table of stats(), one line per site.
+    static std::string report();
+
+    // Monotonic nanoseconds.
+    static uint64_t now();
+};
+
+} // namespace entwine
@@ -22,7 +22,9 @@
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/schema.hpp>
 #include <entwine/types/vector-point-table.hpp>
+#include <entwine/util/contention.hpp>
 #include <entwine/util/json.hpp>
+#include <entwine/util/trace.hpp>
 #include <entwine/util/unique.hpp>
 
 namespace entwine
@@ -267,8 +269,13 @@ std::unique_ptr<ScanInfo> Executor::deepScan(const json pipeline) const
     else return std::unique_ptr<ScanInfo>();
 }
 
-bool Executor::run(pdal::StreamPointTable& table, const json pipeline)
+bool Executor::run(
+        pdal::StreamPointTable& table,
+        const json pipeline,
+        std::string* const srs)
 {
+    ENTWINE_TRACE_SPAN("decode", "io");
+
     std::istringstream iss(objectify(pipeline).dump());
 
     auto lock(getLock());
@@ -281,6 +288,7 @@ bool Executor::run(pdal::StreamPointTable& table, const json pipeline)
         pdal::Stage *s = pm.getStage();
         if (!s) return false;
         s->prepare(table);
+        if (srs) *srs = s->getSpatialReference().getWKT();
 
         lock.unlock();
         s->execute(table);
@@ -294,6 +302,7 @@ bool Executor::run(pdal::StreamPointTable& table, const json pipeline)
             std::cout << "Using non-streaming mode" << std::endl;
         }
         pm.prepare();
+        if (srs) *srs = pm.getStage()->getSpatialReference().getWKT();
         lock.unlock();
 
         pm.execute();
@@ -323,7 +332,25 @@ bool Executor::run(pdal::StreamPointTable& table, const json pipeline)
 
 std::unique_lock<std::mutex> Executor::getLock()
 {
+    ENTWINE_TRACE_SPAN("executor-lock", "wait");
+#ifdef ENTWINE_LOCK_STATS
+    static const std::size_t site(Contention::site("executor"));
+
+    std::unique_lock<std::mutex> lock(mutex(), std::try_to_lock);
+    const bool contended(!lock.owns_lock());
+    uint64_t wait(0);
+    if (contended)
+    {
+        const uint64_t begin(Contention::now());
+        lock.lock();
+        wait = Contention::now() - begin;
+    }
+
+    Contention::acquired(site, contended, wait);
+    return lock;
+#else
     return std::unique_lock<std::mutex>(mutex());
+#endif
 }
 
 ScopedStage::ScopedStage(
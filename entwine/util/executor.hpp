@@ -85,7 +85,12 @@ public:
     // True if this path is recognized as a point cloud file.
     bool good(std::string path) const;
 
-    bool run(pdal::StreamPointTable& table, json pipeline);
+    // If `srs` is given, it is set to the WKT of the spatial reference of the
+    // pipeline's output before any points are processed.
+    bool run(
+            pdal::StreamPointTable& table,
+            json pipeline,
+            std::string* srs = nullptr);
 
     std::unique_ptr<ScanInfo> preview(json pipeline, bool shallow = true) const;
 
@@ -0,0 +1,442 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/las-reader.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <entwine/types/schema.hpp>
+#include <entwine/types/vector-point-table.hpp>
+#include <entwine/util/trace.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    template <typename T>
+    T get(const char* pos)
+    {
+        T v;
+        std::memcpy(&v, pos, sizeof(T));
+        return v;
+    }
+
+    uint8_t byte(const char* pos, const std::size_t offset)
+    {
+        return get<uint8_t>(pos + offset);
+    }
+
+    template <typename T>
+    void put(char* pos, const T v)
+    {
+        std::memcpy(pos, &v, sizeof(T));
+    }
+
+    // Header sizes, in bytes, of the point formats we decode.
+    std::size_t baseLength(const uint8_t format)
+    {
+        switch (format)
+        {
+            case 0: return 20;
+            case 1: return 28;
+            case 2: return 26;
+            case 3: return 34;
+            case 6: return 30;
+            case 7: return 36;
+            case 8: return 38;
+            default: return 0;
+        }
+    }
+
+    bool hasTime(const uint8_t f) { return f == 1 || f == 3 || f >= 6; }
+    bool hasColor(const uint8_t f) { return f == 2 || f == 3 || f >= 7; }
+
+    std::size_t colorOffset(const uint8_t f)
+    {
+        return f == 2 ? 20 : f == 3 ? 28 : 30;
+    }
+
+    // Reader options which affect only the SRS, not the points.
+    bool isSrsOption(const std::string& key)
+    {
+        return key == "default_srs" || key == "override_srs";
+    }
+
+    bool isLasPath(std::string path)
+    {
+        if (path.size() < 4) return false;
+        std::string ext(path.substr(path.size() - 4));
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return ext == ".las";
+    }
+
+    // The path of a pipeline which is only a LAS reader, or empty.
+    std::string lasPath(const json& pipeline)
+    {
+        if (!pipeline.is_array() || pipeline.size() != 1) return "";
+
+        const json& reader(pipeline.at(0));
+        if (!reader.is_object()) return "";
+
+        const std::string path(reader.value("filename", ""));
+        const std::string type(reader.value("type", ""));
+        if (type.size() ? type != "readers.las" : !isLasPath(path)) return "";
+
+        for (const auto& p : reader.items())
+        {
+            const std::string& key(p.key());
+            if (key != "filename" && key != "type" && !isSrsOption(key))
+            {
+                return "";
+            }
+        }
+
+        return path;
+    }
+
+    // Copy a fixed-size value from each of n strided records to each of n
+    // strided points.
+    template <std::size_t N>
+    void copy(
+            const char* in,
+            const std::size_t inStride,
+            char* out,
+            const std::size_t outStride,
+            const std::size_t n)
+    {
+        for (std::size_t i(0); i < n; ++i, in += inStride, out += outStride)
+        {
+            std::memcpy(out, in, N);
+        }
+    }
+
+    void storeAs(char* pos, const DimType type, const double v)
+    {
+        switch (type)
+        {
+            case DimType::Unsigned8: put(pos, static_cast<uint8_t>(v)); break;
+            case DimType::Unsigned16: put(pos, static_cast<uint16_t>(v)); break;
+            case DimType::Float: put(pos, static_cast<float>(v)); break;
+            case DimType::Double: put(pos, v); break;
+            default: throw std::runtime_error("Invalid LAS dimension type");
+        }
+    }
+}
+
+std::unique_ptr<LasReader> LasReader::create(
+        const json& pipeline,
+        const Schema& schema)
+{
+    std::unique_ptr<LasReader> reader;
+
+#ifndef _WIN32
+    const std::string path(lasPath(pipeline));
+    if (path.empty()) return reader;
+
+    const int fd(::open(path.c_str(), O_RDONLY));
+    if (fd < 0) return reader;
+
+    struct stat st;
+    if (::fstat(fd, &st) || !st.st_size)
+    {
+        ::close(fd);
+        return reader;
+    }
+
+    const std::size_t size(st.st_size);
+    void* data(::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    if (data == MAP_FAILED)
+    {
+        ::close(fd);
+        return reader;
+    }
+
+    ::madvise(data, size, MADV_SEQUENTIAL);
+
+    reader.reset(new LasReader(static_cast<const char*>(data), size, fd));
+    if (!reader->init(schema)) reader.reset();
+#endif
+
+    return reader;
+}
+
+LasReader::LasReader(const char* data, const std::size_t size, const int fd)
+    : m_data(data)
+    , m_size(size)
+    , m_fd(fd)
+{ }
+
+LasReader::~LasReader()
+{
+#ifndef _WIN32
+    ::munmap(const_cast<char*>(m_data), m_size);
+    ::close(m_fd);
+#endif
+}
+
+bool LasReader::init(const Schema& schema)
+{
+    if (m_size < 227 || std::memcmp(m_data, "LASF", 4)) return false;
+
+    const uint8_t minor(get<uint8_t>(m_data + 25));
+    const uint16_t headerSize(get<uint16_t>(m_data + 94));
+    m_pointOffset = get<uint32_t>(m_data + 96);
+    m_format = get<uint8_t>(m_data + 104);
+    m_recordLength = get<uint16_t>(m_data + 105);
+    m_points = get<uint32_t>(m_data + 107);
+
+    if (headerSize > m_size) return false;
+
+    // Version 1.4 headers hold a 64-bit count, which supersedes the legacy one.
+    if (minor >= 4 && headerSize >= 375) m_points = get<uint64_t>(m_data + 247);
+
+    for (std::size_t i(0); i < 3; ++i)
+    {
+        m_scale[i] = get<double>(m_data + 131 + i * 8);
+        m_offset[i] = get<double>(m_data + 155 + i * 8);
+    }
+
+    // The high bits of the point format mark compression.
+    const std::size_t base(baseLength(m_format));
+    if (!base || m_recordLength < base) return false;
+    if (m_pointOffset + m_points * m_recordLength > m_size) return false;
+
+    const bool legacy(m_format < 6);
+    const pdal::PointLayout& layout(schema.pdalLayout());
+    std::size_t xyz(0);
+
+    for (const DimInfo& dim : schema.dims())
+    {
+        const DimId id(dim.id());
+
+        if (DimInfo::isXyz(id))
+        {
+            if (dim.type() != DimType::Double) return false;
+            m_xyz[id == DimId::X ? 0 : id == DimId::Y ? 1 : 2] =
+                layout.dimOffset(id);
+            ++xyz;
+            continue;
+        }
+
+        // Assigned by the builder.
+        if (id == DimId::OriginId || id == DimId::PointId) continue;
+
+        Source source;
+        switch (id)
+        {
+            case DimId::Intensity: source = Source::Intensity; break;
+            case DimId::ReturnNumber: source = Source::ReturnNumber; break;
+            case DimId::NumberOfReturns:
+                source = Source::NumberOfReturns; break;
+            case DimId::ScanDirectionFlag:
+                source = Source::ScanDirectionFlag; break;
+            case DimId::EdgeOfFlightLine:
+                source = Source::EdgeOfFlightLine; break;
+            case DimId::Classification:
+                source = Source::Classification; break;
+            case DimId::ScanAngleRank: source = Source::ScanAngleRank; break;
+            case DimId::UserData: source = Source::UserData; break;
+            case DimId::PointSourceId: source = Source::PointSourceId; break;
+            case DimId::GpsTime: source = Source::GpsTime; break;
+            case DimId::Red: source = Source::Red; break;
+            case DimId::Green: source = Source::Green; break;
+            case DimId::Blue: source = Source::Blue; break;
+            case DimId::Infrared: source = Source::Infrared; break;
+            case DimId::ScanChannel: source = Source::ScanChannel; break;
+            case DimId::ClassFlags: source = Source::ClassFlags; break;
+            case DimId::Synthetic: source = Source::Synthetic; break;
+            case DimId::KeyPoint: source = Source::KeyPoint; break;
+            case DimId::Withheld: source = Source::Withheld; break;
+            case DimId::Overlap: source = Source::Overlap; break;
+            default: return false;
+        }
+
+        if (legacy && source >= Source::ClassFlags) return false;
+        if (dim.type() != pdal::Dimension::defaultType(id)) return false;
+
+        // Dimensions which this point format lacks are left zeroed, as PDAL
+        // leaves them.
+        if (source == Source::GpsTime && !hasTime(m_format)) continue;
+        if (source >= Source::Red && source <= Source::Blue &&
+                !hasColor(m_format))
+        {
+            continue;
+        }
+        if (source == Source::Infrared && m_format != 8) continue;
+        if (source == Source::ScanChannel && legacy) continue;
+
+        const long from(recordOffset(source));
+        if (from >= 0)
+        {
+            m_copies.push_back(Copy {
+                static_cast<std::size_t>(from),
+                layout.dimOffset(id),
+                layout.dimSize(id) });
+        }
+        else
+        {
+            m_fields.push_back(
+                    Field { source, dim.type(), layout.dimOffset(id) });
+        }
+    }
+
+    return xyz == 3;
+}
+
+long LasReader::recordOffset(const Source source) const
+{
+    const bool legacy(m_format < 6);
+    const long color(colorOffset(m_format));
+
+    switch (source)
+    {
+        case Source::Intensity: return 12;
+        case Source::Classification: return legacy ? 15 : 16;
+        case Source::UserData: return 17;
+        case Source::PointSourceId: return legacy ? 18 : 20;
+        case Source::GpsTime: return legacy ? 20 : 22;
+        case Source::Red: return color;
+        case Source::Green: return color + 2;
+        case Source::Blue: return color + 4;
+        case Source::Infrared: return 36;
+        default: return -1;
+    }
+}
+
+double LasReader::decode(const Source source, const char* r) const
+{
+    const bool legacy(m_format < 6);
+    const std::size_t color(colorOffset(m_format));
+
+    switch (source)
+    {
+        case Source::Intensity: return get<uint16_t>(r + 12);
+        case Source::ReturnNumber:
+            return legacy ? byte(r, 14) & 0x07 : byte(r, 14) & 0x0F;
+        case Source::NumberOfReturns:
+            return legacy ?
+                (byte(r, 14) >> 3) & 0x07 :
+                (byte(r, 14) >> 4) & 0x0F;
+        case Source::ScanDirectionFlag:
+            return (byte(r, legacy ? 14 : 15) >> 6) & 0x01;
+        case Source::EdgeOfFlightLine:
+            return (byte(r, legacy ? 14 : 15) >> 7) & 0x01;
+        case Source::Classification: return byte(r, legacy ? 15 : 16);
+        case Source::ScanAngleRank:
+            return legacy ? get<int8_t>(r + 16) : get<int16_t>(r + 18) * .006;
+        case Source::UserData: return byte(r, 17);
+        case Source::PointSourceId:
+            return get<uint16_t>(r + (legacy ? 18 : 20));
+        case Source::GpsTime: return get<double>(r + (legacy ? 20 : 22));
+        case Source::Red: return get<uint16_t>(r + color);
+        case Source::Green: return get<uint16_t>(r + color + 2);
+        case Source::Blue: return get<uint16_t>(r + color + 4);
+        case Source::Infrared: return get<uint16_t>(r + 36);
+        case Source::ScanChannel: return (byte(r, 15) >> 4) & 0x03;
+        case Source::ClassFlags: return byte(r, 15) & 0x0F;
+        case Source::Synthetic: return byte(r, 15) & 0x01;
+        case Source::KeyPoint: return (byte(r, 15) >> 1) & 0x01;
+        case Source::Withheld: return (byte(r, 15) >> 2) & 0x01;
+        case Source::Overlap: return (byte(r, 15) >> 3) & 0x01;
+    }
+
+    return 0;
+}
+
+void LasReader::run(VectorPointTable& table) const
+{
+    const std::size_t capacity(table.capacity());
+    const std::size_t pointSize(table.pointSize());
+
+    std::vector<int32_t> ints(capacity);
+    std::vector<double> doubles(capacity);
+
+    const char* records(m_data + m_pointOffset);
+    uint64_t begin(0);
+
+    while (begin < m_points)
+    {
+        ENTWINE_TRACE_SPAN("las-decode", "io");
+
+        const std::size_t n(std::min<uint64_t>(capacity, m_points - begin));
+        const char* first(records + begin * m_recordLength);
+        char* out(table.data().data());
+
+        // Each of XYZ is gathered, scaled in a tight loop which the compiler
+        // may vectorize, and scattered into the table.
+        for (std::size_t d(0); d < 3; ++d)
+        {
+            const char* in(first + d * 4);
+            for (std::size_t i(0); i < n; ++i, in += m_recordLength)
+            {
+                ints[i] = get<int32_t>(in);
+            }
+
+            const double scale(m_scale[d]);
+            const double offset(m_offset[d]);
+            for (std::size_t i(0); i < n; ++i)
+            {
+                doubles[i] = ints[i] * scale + offset;
+            }
+
+            char* pos(out + m_xyz[d]);
+            for (std::size_t i(0); i < n; ++i, pos += pointSize)
+            {
+                put(pos, doubles[i]);
+            }
+        }
+
+        for (const Copy& c : m_copies)
+        {
+            const char* in(first + c.from);
+            char* pos(out + c.to);
+
+            switch (c.size)
+            {
+                case 1: copy<1>(in, m_recordLength, pos, pointSize, n); break;
+                case 2: copy<2>(in, m_recordLength, pos, pointSize, n); break;
+                case 8: copy<8>(in, m_recordLength, pos, pointSize, n); break;
+                default: throw std::runtime_error("Invalid LAS copy size");
+            }
+        }
+
+        if (m_fields.size())
+        {
+            const char* r(first);
+            char* p(out);
+            for (
+                    std::size_t i(0);
+                    i < n;
+                    ++i, r += m_recordLength, p += pointSize)
+            {
+                for (const Field& f : m_fields)
+                {
+                    storeAs(p + f.offset, f.type, decode(f.source, r));
+                }
+            }
+        }
+
+        table.clear(n);
+        begin += n;
+    }
+}
+
+} // namespace entwine
@@ -0,0 +1,129 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <entwine/types/defs.hpp>
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+
+class Schema;
+class VectorPointTable;
+
+// Reads uncompressed LAS files without PDAL.  The file is memory mapped and
+// its fixed-size records are decoded straight into the layout of a build,
+// with the location of each of its dimensions resolved once per file.  Each
+// batch of points is filled a dimension at a time: XYZ are scaled in a tight
+// loop, dimensions stored whole with their table type are copied, and only
+// the remaining bit fields and converted values are decoded per point.
+//
+// Only cases where the result is known to match PDAL's LAS reader are
+// handled, so create() returns nothing whenever PDAL must read the file:
+//      - the pipeline is anything other than a lone LAS reader, aside from
+//        SRS options which do not change point values
+//      - the file is compressed, or has a point format other than 0-3 or 6-8
+//      - the schema has dimensions which we do not decode, for example from
+//        extra bytes, or types other than PDAL's defaults
+//      - for point formats 0-3, the schema has classification flags, whose
+//        derivation from the classification byte varies between versions of
+//        PDAL
+class LasReader
+{
+public:
+    static std::unique_ptr<LasReader> create(
+            const json& pipeline,
+            const Schema& schema);
+
+    ~LasReader();
+
+    uint64_t points() const { return m_points; }
+
+    // Decode every point into the table, in batches of its capacity, clearing
+    // the table after each.
+    void run(VectorPointTable& table) const;
+
+private:
+    // How a dimension is decoded from a record.
+    enum class Source
+    {
+        Intensity,
+        ReturnNumber,
+        NumberOfReturns,
+        ScanDirectionFlag,
+        EdgeOfFlightLine,
+        Classification,
+        ScanAngleRank,
+        UserData,
+        PointSourceId,
+        GpsTime,
+        Red,
+        Green,
+        Blue,
+        Infrared,
+        ScanChannel,
+        ClassFlags,
+        Synthetic,
+        KeyPoint,
+        Withheld,
+        Overlap
+    };
+
+    struct Field
+    {
+        Source source;
+        DimType type;
+        std::size_t offset;
+    };
+
+    // A dimension stored whole in the record, with the same type as in the
+    // table, which is copied rather than decoded.
+    struct Copy
+    {
+        std::size_t from;
+        std::size_t to;
+        std::size_t size;
+    };
+
+    LasReader(const char* data, std::size_t size, int fd);
+
+    bool init(const Schema& schema);
+    double decode(Source source, const char* record) const;
+
+    // The offset within the record of a dimension stored whole, with PDAL's
+    // default type, or -1 if it must be decoded.
+    long recordOffset(Source source) const;
+
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    int m_fd = -1;
+
+    uint8_t m_format = 0;
+    uint16_t m_recordLength = 0;
+    uint64_t m_pointOffset = 0;
+    uint64_t m_points = 0;
+
+    double m_scale[3];
+    double m_offset[3];
+
+    // Offsets of XYZ, which are doubles, within the table.
+    std::size_t m_xyz[3];
+    std::vector<Copy> m_copies;
+    std::vector<Field> m_fields;
+};
+
+} // namespace entwine
@@ -0,0 +1,204 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/memory.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace entwine
+{
+
+namespace
+{
+    using Category = Memory::Category;
+
+    const int64_t batchBytes(256 * 1024);
+
+    struct Totals
+    {
+        std::atomic<int64_t> live;
+        std::atomic<int64_t> peak;
+    };
+
+    // One for each category, and a final one for their in-memory sum.
+    std::array<Totals, Memory::categories + 1> totals;
+
+    std::size_t index(Category c) { return static_cast<std::size_t>(c); }
+
+    void apply(Totals& t, const int64_t delta)
+    {
+        const int64_t v(t.live += delta);
+        int64_t p(t.peak.load());
+        while (v > p && !t.peak.compare_exchange_weak(p, v)) { }
+    }
+
+    void apply(const std::size_t i, const int64_t delta)
+    {
+        apply(totals[i], delta);
+        if (i != index(Category::Tmp)) apply(totals.back(), delta);
+    }
+
+    struct Pending
+    {
+        ~Pending() { flush(); }
+
+        void change(const std::size_t i, const int64_t delta)
+        {
+            int64_t& d(deltas[i]);
+            d += delta;
+            if (d >= batchBytes || d <= -batchBytes)
+            {
+                apply(i, d);
+                d = 0;
+            }
+        }
+
+        void flush()
+        {
+            for (std::size_t i(0); i < deltas.size(); ++i)
+            {
+                if (deltas[i]) apply(i, deltas[i]);
+                deltas[i] = 0;
+            }
+        }
+
+        std::array<int64_t, Memory::categories> deltas {{ }};
+    };
+
+    Pending& local()
+    {
+        thread_local Pending pending;
+        return pending;
+    }
+
+    // Changes may be published out of order across threads, so a live count
+    // may briefly dip below zero.
+    Memory::Usage usage(const Totals& t)
+    {
+        Memory::Usage u;
+        u.live = std::max<int64_t>(t.live.load(), 0);
+        u.peak = std::max<int64_t>(t.peak.load(), 0);
+        return u;
+    }
+
+    std::string megs(uint64_t bytes)
+    {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(1) << bytes / 1024.0 / 1024.0;
+        return ss.str();
+    }
+}
+
+constexpr std::size_t Memory::categories;
+
+void Memory::add(const Category c, const uint64_t bytes)
+{
+    if (bytes) local().change(index(c), static_cast<int64_t>(bytes));
+}
+
+void Memory::sub(const Category c, const uint64_t bytes)
+{
+    if (bytes) local().change(index(c), -static_cast<int64_t>(bytes));
+}
+
+void Memory::flush()
+{
+    local().flush();
+}
+
+Memory::Usage Memory::usage(const Category c)
+{
+    return entwine::usage(totals[index(c)]);
+}
+
+Memory::Usage Memory::total()
+{
+    return entwine::usage(totals.back());
+}
+
+uint64_t Memory::peakRss()
+{
+#ifndef _WIN32
+    rusage r;
+    if (getrusage(RUSAGE_SELF, &r)) return 0;
+#ifdef __APPLE__
+    return r.ru_maxrss;
+#else
+    return static_cast<uint64_t>(r.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+std::string Memory::toString(const Category c)
+{
+    switch (c)
+    {
+        case Category::Grid: return "grid";
+        case Category::Overflow: return "overflow";
+        case Category::Blocks: return "blocks";
+        case Category::Hierarchy: return "hierarchy";
+        case Category::Files: return "files";
+        case Category::Scratch: return "scratch";
+        case Category::Cache: return "cache";
+        case Category::Tmp: return "tmp (disk)";
+    }
+
+    return "unknown";
+}
+
+std::string Memory::report()
+{
+    flush();
+
+    std::ostringstream ss;
+    ss << "\tMemory (MB):" << std::endl;
+    ss << "\t\t" << std::left << std::setw(14) << "Category" << std::right <<
+        std::setw(12) << "Live" << std::setw(12) << "Peak" << std::endl;
+
+    auto line([&ss](const std::string& name, const Usage& u)
+    {
+        ss << "\t\t" << std::left << std::setw(14) << name << std::right <<
+            std::setw(12) << megs(u.live) << std::setw(12) << megs(u.peak) <<
+            std::endl;
+    });
+
+    for (std::size_t i(0); i < categories; ++i)
+    {
+        const Category c(static_cast<Category>(i));
+        if (c != Category::Tmp) line(toString(c), usage(c));
+    }
+
+    // Category peaks need not coincide, so their sum may exceed the peak of
+    // their total.
+    const Usage all(total());
+    line("total", all);
+    line(toString(Category::Tmp), usage(Category::Tmp));
+
+    if (const uint64_t rss = peakRss())
+    {
+        ss << "\t\tProcess peak RSS: " << megs(rss) << ", of which " <<
+            megs(rss > all.peak ? rss - all.peak : 0) << " unattributed" <<
+            std::endl;
+    }
+
+    return ss.str();
+}
+
+} // namespace entwine
@@ -0,0 +1,69 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace entwine
+{
+
+// Live and high-water byte counts for the large consumers of memory, so the
+// memory used by a build may be attributed to its subsystems.
+//
+// Counts are estimates - container overhead is approximated - and each
+// thread batches its changes until they reach a few hundred kilobytes, so
+// reads may trail the true values by that much per thread.
+class Memory
+{
+public:
+    enum class Category
+    {
+        Grid,       // Chunk voxel grids.
+        Overflow,   // Chunk overflow lists.
+        Blocks,     // Point data held in MemBlocks.
+        Hierarchy,  // Hierarchy maps.
+        Files,      // Input file lists.
+        Scratch,    // Pooled scratch buffers.
+        Cache,      // Reader chunk caches.
+        Tmp         // Temporary files, on disk rather than in memory.
+    };
+
+    static constexpr std::size_t categories = 8;
+
+    struct Usage
+    {
+        uint64_t live = 0;
+        uint64_t peak = 0;
+    };
+
+    static void add(Category c, uint64_t bytes);
+    static void sub(Category c, uint64_t bytes);
+
+    // Publish the calling thread's pending changes.
+    static void flush();
+
+    static Usage usage(Category c);
+
+    // The sum of all categories held in memory, which excludes Tmp.
+    static Usage total();
+
+    // The peak resident set size of this process, or zero if unavailable.
+    static uint64_t peakRss();
+
+    static std::string toString(Category c);
+
+    // A table of the usage of each category.
+    static std::string report();
+};
+
+} // namespace entwine
@@ -20,6 +20,8 @@
 #include <thread>
 #include <vector>
 
+#include <entwine/util/trace.hpp>
+
 namespace entwine
 {
 
@@ -106,10 +108,14 @@ public:
                     "Attempted to add a task to a stopped Pool");
         }
 
-        m_produceCv.wait(lock, [this]()
+        if (m_tasks.size() >= m_queueSize)
         {
-            return m_tasks.size() < m_queueSize;
-        });
+            ENTWINE_TRACE_SPAN("pool-full", "wait");
+            m_produceCv.wait(lock, [this]()
+            {
+                return m_tasks.size() < m_queueSize;
+            });
+        }
 
         m_tasks.emplace(task);
 
@@ -0,0 +1,176 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/reprojector.hpp>
+
+#include <stdexcept>
+
+#ifdef ENTWINE_PROJ
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <proj.h>
+#endif
+
+#include <entwine/types/vector-point-table.hpp>
+#include <entwine/util/trace.hpp>
+
+namespace entwine
+{
+
+#ifdef ENTWINE_PROJ
+
+namespace
+{
+    class Cache
+    {
+    public:
+        Cache() : m_ctx(proj_context_create()) { }
+
+        ~Cache()
+        {
+            for (auto& p : m_transforms) proj_destroy(p.second);
+            proj_context_destroy(m_ctx);
+        }
+
+        PJ* get(const std::string& in, const std::string& out)
+        {
+            PJ*& pj(m_transforms[std::make_pair(in, out)]);
+            if (!pj) pj = create(in, out);
+            return pj;
+        }
+
+        // Coordinates are gathered into aligned arrays, reused across
+        // batches, since a point's doubles need not be aligned in the table.
+        std::vector<double> x, y, z;
+
+    private:
+        PJ* create(const std::string& in, const std::string& out)
+        {
+            PJ* raw(proj_create_crs_to_crs(
+                        m_ctx, in.c_str(), out.c_str(), nullptr));
+            if (!raw) fail(in, out);
+
+            // Use easting/northing and longitude/latitude ordering, as PDAL
+            // does, regardless of the axis order of each SRS's definition.
+            PJ* pj(proj_normalize_for_visualization(m_ctx, raw));
+            proj_destroy(raw);
+            if (!pj) fail(in, out);
+
+            return pj;
+        }
+
+        void fail(const std::string& in, const std::string& out)
+        {
+            throw std::runtime_error(
+                    "Could not create reprojection from " + in + " to " + out +
+                    ": " + proj_errno_string(proj_context_errno(m_ctx)));
+        }
+
+        PJ_CONTEXT* m_ctx;
+        std::map<std::pair<std::string, std::string>, PJ*> m_transforms;
+    };
+
+    Cache& cache()
+    {
+        thread_local Cache c;
+        return c;
+    }
+}
+
+bool Reprojector::available() { return true; }
+
+void Reprojector::transform(
+        VectorPointTable& table,
+        const std::string& in,
+        const std::string& out)
+{
+    ENTWINE_TRACE_SPAN("reproject-batch", "build");
+
+    if (in.empty())
+    {
+        throw std::runtime_error(
+                "Cannot reproject to " + out + " without an input SRS");
+    }
+
+    const std::size_t n(table.numPoints());
+    if (!n) return;
+
+    const pdal::PointLayout& layout(*table.layout());
+    const std::size_t pointSize(table.pointSize());
+
+    for (const DimId id : { DimId::X, DimId::Y, DimId::Z })
+    {
+        if (layout.dimType(id) != DimType::Double)
+        {
+            throw std::runtime_error("Reprojected XYZ must be doubles");
+        }
+    }
+
+    const std::size_t xo(layout.dimOffset(DimId::X));
+    const std::size_t yo(layout.dimOffset(DimId::Y));
+    const std::size_t zo(layout.dimOffset(DimId::Z));
+
+    Cache& c(cache());
+    PJ* pj(c.get(in, out));
+
+    c.x.resize(n);
+    c.y.resize(n);
+    c.z.resize(n);
+
+    const char* pos(table.data().data());
+    for (std::size_t i(0); i < n; ++i, pos += pointSize)
+    {
+        std::memcpy(&c.x[i], pos + xo, sizeof(double));
+        std::memcpy(&c.y[i], pos + yo, sizeof(double));
+        std::memcpy(&c.z[i], pos + zo, sizeof(double));
+    }
+
+    const std::size_t s(sizeof(double));
+    proj_trans_generic(
+            pj, PJ_FWD,
+            c.x.data(), s, n,
+            c.y.data(), s, n,
+            c.z.data(), s, n,
+            nullptr, 0, 0);
+
+    char* dst(table.data().data());
+    for (std::size_t i(0); i < n; ++i, dst += pointSize)
+    {
+        if (c.x[i] == HUGE_VAL || c.y[i] == HUGE_VAL || c.z[i] == HUGE_VAL)
+        {
+            table.setSkip(i);
+            continue;
+        }
+
+        std::memcpy(dst + xo, &c.x[i], sizeof(double));
+        std::memcpy(dst + yo, &c.y[i], sizeof(double));
+        std::memcpy(dst + zo, &c.z[i], sizeof(double));
+    }
+}
+
+#else
+
+bool Reprojector::available() { return false; }
+
+void Reprojector::transform(
+        VectorPointTable&,
+        const std::string&,
+        const std::string&)
+{
+    throw std::runtime_error("Entwine was built without PROJ");
+}
+
+#endif
+
+} // namespace entwine
@@ -0,0 +1,42 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <string>
+
+namespace entwine
+{
+
+class VectorPointTable;
+
+// Reprojects whole batches of points with PROJ, in place of a PDAL
+// filters.reprojection stage which creates a transformation for every file,
+// under the executor lock, and then transforms points one at a time.
+//
+// Each thread keeps its own PROJ context and a transformation for each
+// pair of SRSes it has seen, since PROJ objects may not be shared between
+// threads.  Points which fail to transform are skipped, as they are by PDAL.
+class Reprojector
+{
+public:
+    // False if Entwine was built without PROJ, in which case reprojection is
+    // left to PDAL.
+    static bool available();
+
+    // Transform the XYZ values, which must be doubles, of the points of this
+    // table from the SRS `in`, typically WKT from the reader, to `out`.
+    static void transform(
+            VectorPointTable& table,
+            const std::string& in,
+            const std::string& out);
+};
+
+} // namespace entwine
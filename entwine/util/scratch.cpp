@@ -0,0 +1,174 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/scratch.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+#include <entwine/util/memory.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Limits on what each thread keeps around between uses.
+    const std::size_t maxBuffers(4);
+    const std::size_t maxPooledBytes(256 * 1024 * 1024);
+
+    std::atomic<uint64_t> taken(0);
+    std::atomic<uint64_t> reused(0);
+    std::atomic<uint64_t> peak(0);
+    std::atomic<uint64_t> pooled(0);
+
+    class ThreadPool
+    {
+    public:
+        // Touching the thread's memory accounting first ensures that it
+        // outlives us, since our destructor reports to it.
+        ThreadPool() { Memory::flush(); }
+        ~ThreadPool() { clear(); }
+
+        std::vector<char> take(const std::size_t size)
+        {
+            if (m_buffers.empty()) return std::vector<char>();
+
+            // Prefer the smallest buffer that fits, otherwise the largest.
+            auto fits(m_buffers.end());
+            auto largest(m_buffers.begin());
+            for (auto it(m_buffers.begin()); it != m_buffers.end(); ++it)
+            {
+                const std::size_t c(it->capacity());
+                if (c >= size)
+                {
+                    if (fits == m_buffers.end() || c < fits->capacity())
+                    {
+                        fits = it;
+                    }
+                }
+                if (c > largest->capacity()) largest = it;
+            }
+
+            const auto best(fits != m_buffers.end() ? fits : largest);
+            std::vector<char> buffer(std::move(*best));
+            m_buffers.erase(best);
+            release(buffer.capacity());
+            return buffer;
+        }
+
+        void give(std::vector<char>&& buffer)
+        {
+            const std::size_t c(buffer.capacity());
+            if (!c || c > maxPooledBytes) return;
+
+            m_buffers.push_back(std::move(buffer));
+            m_bytes += c;
+            pooled += c;
+            Memory::add(Memory::Category::Scratch, c);
+
+            // Evict the smallest buffers until we're within our limits.
+            while (
+                    m_buffers.size() > maxBuffers ||
+                    (m_bytes > maxPooledBytes && m_buffers.size() > 1))
+            {
+                auto smallest(std::min_element(
+                            m_buffers.begin(),
+                            m_buffers.end(),
+                            [](const std::vector<char>& a,
+                                const std::vector<char>& b)
+                            {
+                                return a.capacity() < b.capacity();
+                            }));
+
+                release(smallest->capacity());
+                m_buffers.erase(smallest);
+            }
+        }
+
+        void clear()
+        {
+            release(m_bytes);
+            m_buffers.clear();
+        }
+
+    private:
+        void release(const std::size_t bytes)
+        {
+            m_bytes -= bytes;
+            pooled -= bytes;
+            Memory::sub(Memory::Category::Scratch, bytes);
+        }
+
+        std::vector<std::vector<char>> m_buffers;
+        std::size_t m_bytes = 0;
+    };
+
+    ThreadPool& local()
+    {
+        thread_local ThreadPool pool;
+        return pool;
+    }
+}
+
+std::vector<char> Scratch::take(const std::size_t size)
+{
+    std::vector<char> buffer(local().take(size));
+
+    ++taken;
+    if (buffer.capacity() >= size) ++reused;
+
+    uint64_t p(peak);
+    while (size > p && !peak.compare_exchange_weak(p, size)) { }
+
+    // Only newly exposed bytes are zero-filled here.
+    buffer.resize(size);
+    return buffer;
+}
+
+void Scratch::give(std::vector<char>&& buffer)
+{
+    local().give(std::move(buffer));
+}
+
+void Scratch::clear()
+{
+    local().clear();
+}
+
+Scratch::Stats Scratch::stats()
+{
+    Stats s;
+    s.taken = taken;
+    s.reused = reused;
+    s.peak = peak;
+    s.pooled = pooled;
+    return s;
+}
+
+void Scratch::resetStats()
+{
+    taken = 0;
+    reused = 0;
+    peak = 0;
+}
+
+json Scratch::Stats::toJson() const
+{
+    return json {
+        { "taken", taken },
+        { "reused", reused },
+        { "reuseRate", reuseRate() },
+        { "peak", peak },
+        { "pooled", pooled }
+    };
+}
+
+} // namespace entwine
@@ -0,0 +1,63 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+
+// A per-thread pool of byte buffers for codec and reader temporaries, so
+// their allocations, page faults, and zero-fill are paid once per thread
+// rather than once per chunk.
+class Scratch
+{
+public:
+    struct Stats
+    {
+        // Buffers taken, and how many of those were satisfied without
+        // allocating.
+        uint64_t taken = 0;
+        uint64_t reused = 0;
+
+        // Largest buffer taken, and the total bytes currently pooled across
+        // all threads.
+        uint64_t peak = 0;
+        uint64_t pooled = 0;
+
+        double reuseRate() const
+        {
+            return taken ? static_cast<double>(reused) / taken : 0;
+        }
+
+        json toJson() const;
+    };
+
+    // Take a buffer from this thread's pool, resized to `size` bytes.  Its
+    // contents are unspecified, so callers must overwrite or clear it.
+    static std::vector<char> take(std::size_t size);
+
+    // Return a buffer to this thread's pool.  Buffers may come from
+    // anywhere, for example a VectorPointTable via acquire().
+    static void give(std::vector<char>&& buffer);
+
+    // Drop this thread's pooled buffers.
+    static void clear();
+
+    static Stats stats();
+    static void resetStats();
+};
+
+} // namespace entwine
@@ -10,31 +10,155 @@
 
 #pragma once
 
-#ifdef SPINLOCK_AS_MUTEX
-#include <mutex>
-#else
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#ifdef ENTWINE_LOCK_STATS
+#include <entwine/util/contention.hpp>
 #endif
 
 namespace entwine
 {
 
+// Waits out a contended lock.  The first rounds spin for exponentially
+// longer, then the thread yields, and finally it sleeps briefly, so threads
+// whose lock holder has been descheduled stop burning the CPU it needs.
+class Backoff
+{
+public:
+    void operator()()
+    {
+        if (m_rounds < spinRounds)
+        {
+            const uint32_t n(1u << std::min<uint32_t>(m_rounds, 6));
+            for (uint32_t i(0); i < n; ++i) pause();
+            ++m_spins;
+        }
+        else if (m_rounds < spinRounds + yieldRounds)
+        {
+            std::this_thread::yield();
+            ++m_yields;
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            ++m_parks;
+        }
+
+        ++m_rounds;
+    }
+
+    uint32_t spins() const { return m_spins; }
+    uint32_t yields() const { return m_yields; }
+    uint32_t parks() const { return m_parks; }
+
+private:
+    static void pause()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
+
+    static constexpr uint32_t spinRounds = 10;
+    static constexpr uint32_t yieldRounds = 32;
+
+    uint32_t m_rounds = 0;
+    uint32_t m_spins = 0;
+    uint32_t m_yields = 0;
+    uint32_t m_parks = 0;
+};
+
+// Locks take an optional site name, under which they are counted in
+// contention builds - see Contention.  Otherwise the name is unused.
 #ifdef SPINLOCK_AS_MUTEX
 
-using SpinLock = std::mutex;
+class SpinLock : public std::mutex
+{
+public:
+    explicit SpinLock(const char* site = "other") { }
+};
 
 #else
 
 class SpinLock
 {
 public:
-    SpinLock() = default;
+#ifdef ENTWINE_LOCK_STATS
+    explicit SpinLock(const char* site = "other")
+        : m_site(Contention::site(site))
+    { }
+#else
+    explicit SpinLock(const char* site = "other") { }
+#endif
+
+    void lock()
+    {
+#ifdef ENTWINE_LOCK_STATS
+        Backoff backoff;
+        const bool contended(!tryLock());
+        const uint64_t begin(contended ? Contention::now() : 0);
+        if (contended) wait(backoff);
 
-    void lock() { while (m_flag.test_and_set()) ; }
-    void unlock() { m_flag.clear(); }
+        m_acquired = Contention::now();
+        Contention::acquired(
+                m_site,
+                contended,
+                contended ? m_acquired - begin : 0,
+                backoff.spins(),
+                backoff.yields(),
+                backoff.parks());
+#else
+        if (tryLock()) return;
+        Backoff backoff;
+        wait(backoff);
+#endif
+    }
+
+    void unlock()
+    {
+#ifdef ENTWINE_LOCK_STATS
+        const uint64_t hold(Contention::now() - m_acquired);
+        m_flag.store(false, std::memory_order_release);
+        Contention::released(m_site, hold);
+#else
+        m_flag.store(false, std::memory_order_release);
+#endif
+    }
 
 private:
-    std::atomic_flag m_flag = ATOMIC_FLAG_INIT;
+    bool tryLock()
+    {
+        return !m_flag.exchange(true, std::memory_order_acquire);
+    }
+
+    // Spin on a plain load, which leaves the cache line shared, rather than
+    // on the exchange.
+    void wait(Backoff& backoff)
+    {
+        do
+        {
+            while (m_flag.load(std::memory_order_relaxed)) backoff();
+        }
+        while (!tryLock());
+    }
+
+    std::atomic<bool> m_flag { false };
+
+#ifdef ENTWINE_LOCK_STATS
+    const std::size_t m_site;
+    uint64_t m_acquired = 0;
+#endif
 
     SpinLock(const SpinLock& other) = delete;
 };
@@ -45,4 +169,3 @@ using SpinGuard = std::lock_guard<SpinLock>;
 using UniqueSpin = std::unique_lock<SpinLock>;
 
 } // namespace entwine
-
@@ -0,0 +1,225 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <entwine/util/spin-lock.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Event
+    {
+        const char* name;
+        const char* category;
+        uint64_t begin;
+        uint64_t duration;
+    };
+
+    // The spans of one thread.  Only its owner records into it, so its lock
+    // is uncontended except while exporting.
+    class Buffer
+    {
+    public:
+        Buffer(uint64_t tid, std::size_t capacity)
+            : m_tid(tid)
+            , m_name("thread-" + std::to_string(tid))
+            , m_capacity(capacity)
+        { }
+
+        void record(const Event& e)
+        {
+            SpinGuard lock(m_spin);
+            if (m_events.size() < m_capacity) m_events.push_back(e);
+            else
+            {
+                m_events[m_next] = e;
+                m_next = (m_next + 1) % m_capacity;
+                ++m_dropped;
+            }
+        }
+
+        void reset(std::size_t capacity)
+        {
+            SpinGuard lock(m_spin);
+            m_events.clear();
+            m_capacity = std::max<std::size_t>(capacity, 1);
+            m_next = 0;
+            m_dropped = 0;
+        }
+
+        void name(const std::string& name)
+        {
+            SpinGuard lock(m_spin);
+            m_name = name;
+        }
+
+        // Appends our events, oldest first, and returns the number dropped.
+        uint64_t append(json& events)
+        {
+            std::vector<Event> copy;
+            std::string name;
+            uint64_t dropped(0);
+
+            {
+                SpinGuard lock(m_spin);
+                copy.reserve(m_events.size());
+                const auto mid(m_events.begin() + m_next);
+                copy.insert(copy.end(), mid, m_events.end());
+                copy.insert(copy.end(), m_events.begin(), mid);
+                name = m_name;
+                dropped = m_dropped;
+            }
+
+            if (copy.empty()) return dropped;
+
+            events.push_back(json {
+                { "name", "thread_name" },
+                { "ph", "M" },
+                { "pid", 1 },
+                { "tid", m_tid },
+                { "args", { { "name", name } } }
+            });
+
+            for (const Event& e : copy)
+            {
+                events.push_back(json {
+                    { "name", e.name },
+                    { "cat", e.category },
+                    { "ph", "X" },
+                    { "ts", e.begin / 1000.0 },
+                    { "dur", e.duration / 1000.0 },
+                    { "pid", 1 },
+                    { "tid", m_tid }
+                });
+            }
+
+            return dropped;
+        }
+
+    private:
+        const uint64_t m_tid;
+        std::string m_name;
+
+        SpinLock m_spin { "trace" };
+        std::vector<Event> m_events;
+        std::size_t m_capacity;
+        std::size_t m_next = 0;
+        uint64_t m_dropped = 0;
+    };
+
+    std::atomic<bool> enabled(false);
+    std::atomic<int64_t> epoch(0);
+
+    // Buffers outlive their threads, so spans from finished threads are
+    // still exported.
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    std::size_t capacity(1 << 16);
+
+    Buffer& local()
+    {
+        thread_local std::shared_ptr<Buffer> buffer([]()
+            -> std::shared_ptr<Buffer>
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.push_back(
+                    std::make_shared<Buffer>(buffers.size() + 1, capacity));
+            return buffers.back();
+        }());
+
+        return *buffer;
+    }
+
+    int64_t ticks()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now().time_since_epoch()).count();
+    }
+}
+
+const uint64_t Trace::none;
+
+bool Trace::compiled()
+{
+#ifdef ENTWINE_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Trace::start(const std::size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = std::max<std::size_t>(size, 1);
+    for (auto& b : buffers) b->reset(capacity);
+    epoch = ticks();
+    enabled = true;
+}
+
+void Trace::stop()
+{
+    enabled = false;
+}
+
+bool Trace::active()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Trace::name(const std::string& name)
+{
+    local().name(name);
+}
+
+json Trace::toJson()
+{
+    json events(json::array());
+    uint64_t dropped(0);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& b : buffers) dropped += b->append(events);
+
+    return json {
+        { "traceEvents", events },
+        { "displayTimeUnit", "ms" },
+        { "otherData", { { "dropped", dropped } } }
+    };
+}
+
+uint64_t Trace::time()
+{
+    return std::max<int64_t>(ticks() - epoch.load(), 0);
+}
+
+void Trace::record(
+        const char* name,
+        const char* category,
+        const uint64_t begin)
+{
+    if (!active()) return;
+    const uint64_t end(time());
+    local().record(
+            Event { name, category, begin, end > begin ? end - begin : 0 });
+}
+
+} // namespace entwine
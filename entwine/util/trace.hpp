@@ -0,0 +1,91 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <entwine/util/json.hpp>
+
+// Scoped spans for the hot paths of builds and queries, viewable in Perfetto
+// or chrome://tracing.  Spans are compiled out entirely unless ENTWINE_TRACE
+// is defined (see the WITH_TRACE CMake option), and when compiled in they
+// cost one check of a flag until Trace::start() is called.
+//
+//      ENTWINE_TRACE_SPAN("chunk-write", "chunk");
+//
+// Both arguments must be string literals, or otherwise outlive the trace.
+#ifdef ENTWINE_TRACE
+#define ENTWINE_TRACE_CAT_(a, b) a##b
+#define ENTWINE_TRACE_CAT(a, b) ENTWINE_TRACE_CAT_(a, b)
+#define ENTWINE_TRACE_SPAN(name, category) \
+    ::entwine::Trace::Span ENTWINE_TRACE_CAT(entwineTraceSpan, __LINE__)( \
+            name, category)
+#else
+#define ENTWINE_TRACE_SPAN(name, category) do { } while (false)
+#endif
+
+namespace entwine
+{
+
+class Trace
+{
+public:
+    class Span
+    {
+    public:
+        Span(const char* name, const char* category)
+            : m_name(name)
+            , m_category(category)
+            , m_begin(active() ? time() : none)
+        { }
+
+        ~Span()
+        {
+            if (m_begin != none) record(m_name, m_category, m_begin);
+        }
+
+    private:
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        const char* const m_name;
+        const char* const m_category;
+        const uint64_t m_begin;
+    };
+
+    // True if spans were compiled in, in which case start() records them.
+    static bool compiled();
+
+    // Begin recording, discarding any previous recording.  Each thread keeps
+    // only its most recent `capacity` spans, so a long build may be traced
+    // without unbounded memory use.
+    static void start(std::size_t capacity = 1 << 16);
+    static void stop();
+    static bool active();
+
+    // Label the calling thread in the exported trace.
+    static void name(const std::string& name);
+
+    // The recording in the Chrome trace-event format, with times in
+    // microseconds since start().  Threads may be recording while this runs.
+    static json toJson();
+
+private:
+    static const uint64_t none = ~uint64_t(0);
+
+    // Nanoseconds since start().
+    static uint64_t time();
+    static void record(const char* name, const char* category, uint64_t begin);
+};
+
+} // namespace entwine
@@ -2,9 +2,19 @@
 #include "config.hpp"
 #include "verify.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+
 #include <entwine/builder/builder.hpp>
 #include <entwine/builder/merger.hpp>
+#include <entwine/builder/remover.hpp>
 #include <entwine/builder/scan.hpp>
+#include <entwine/io/bundle.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/util/pool.hpp>
+#include <entwine/util/reprojector.hpp>
 
 using namespace entwine;
 
@@ -13,6 +23,39 @@ namespace
     const arbiter::Arbiter a;
     const Verify v;
 
+    // Each of X, Y, and Z of every point of a build, sorted separately, so
+    // builds whose points landed in different nodes may be compared.
+    std::vector<std::vector<double>> readXyz(const std::string path)
+    {
+        const Schema xyz(DimList {
+            { DimId::X, DimType::Double },
+            { DimId::Y, DimType::Double },
+            { DimId::Z, DimType::Double }
+        });
+
+        Reader reader(path);
+        auto q(reader.read(json { { "schema", xyz } }));
+        q->run();
+
+        const std::vector<char>& data(q->data());
+        const std::size_t n(data.size() / xyz.pointSize());
+
+        std::vector<std::vector<double>> result(3, std::vector<double>(n));
+        for (std::size_t i(0); i < n; ++i)
+        {
+            for (std::size_t d(0); d < 3; ++d)
+            {
+                std::memcpy(
+                        &result[d][i],
+                        data.data() + i * xyz.pointSize() + d * sizeof(double),
+                        sizeof(double));
+            }
+        }
+
+        for (auto& values : result) std::sort(values.begin(), values.end());
+        return result;
+    }
+
     void checkSources(std::string outPath)
     {
         const json list(json::parse(a.get(outPath + "ept-sources/list.json")));
@@ -40,6 +83,48 @@ namespace
             ASSERT_TRUE(meta.at("metadata").is_object());
         }
     }
+
+    // The sum of the point counts of every node, so every point must land
+    // in exactly one node.
+    uint64_t hierarchyPoints(const std::string outPath)
+    {
+        std::function<uint64_t(std::string)> count(
+                [&](const std::string key) -> uint64_t
+        {
+            uint64_t n(0);
+            const json h(json::parse(
+                        a.get(outPath + "ept-hierarchy/" + key + ".json")));
+            for (const auto& p : h.items())
+            {
+                const int64_t points(p.value().get<int64_t>());
+                if (points >= 0) n += points;
+                else n += count(p.key());
+            }
+            return n;
+        });
+
+        return count("0-0-0-0");
+    }
+
+    // The point count of every node, keyed by node.
+    std::map<std::string, int64_t> readHierarchy(const std::string outPath)
+    {
+        std::map<std::string, int64_t> result;
+        std::function<void(std::string)> read([&](const std::string key)
+        {
+            const json h(json::parse(
+                        a.get(outPath + "ept-hierarchy/" + key + ".json")));
+            for (const auto& p : h.items())
+            {
+                const int64_t points(p.value().get<int64_t>());
+                if (points >= 0) result[p.key()] = points;
+                else read(p.key());
+            }
+        });
+
+        read("0-0-0-0");
+        return result;
+    }
 }
 
 TEST(build, basic)
@@ -142,6 +227,47 @@ TEST(build, continued)
     checkSources(outPath);
 }
 
+TEST(build, incremental)
+{
+    const std::string outPath(test::dataPath() + "out/ellipsoid-incremental/");
+
+    {
+        Config c(json {
+            { "input", test::dataPath() + "ellipsoid-multi/" },
+            { "output", outPath },
+            { "force", true },
+            { "span", v.span() },
+            { "hierarchyStep", v.hierarchyStep() },
+            { "run", 4 }
+        });
+
+        Builder(c).go();
+    }
+
+    const std::string rootPath(outPath + "ept-hierarchy/0-0-0-0.json");
+    const uint64_t rootPoints(
+            json::parse(a.get(rootPath)).at("0-0-0-0").get<uint64_t>());
+
+    {
+        Config c(json { { "output", outPath }, { "incremental", true } });
+        Builder(c).go();
+    }
+
+    const auto info(json::parse(a.get(outPath + "ept.json")));
+    EXPECT_EQ(info.at("points").get<uint64_t>(), v.points());
+    EXPECT_EQ(hierarchyPoints(outPath), v.points());
+
+    // The root overflowed in the first run, so it was passed through.
+    EXPECT_EQ(
+            json::parse(a.get(rootPath)).at("0-0-0-0").get<uint64_t>(),
+            rootPoints);
+
+    const auto build(json::parse(a.get(outPath + "ept-build.json")));
+    EXPECT_FALSE(build.count("incremental"));
+
+    checkSources(outPath);
+}
+
 TEST(build, addedLater)
 {
     const std::string outPath(test::dataPath() + "out/ellipsoid/");
@@ -446,51 +572,437 @@ TEST(build, reprojected)
         return;
     }
 
-    const std::string outPath(test::dataPath() + "out/ellipsoid-re/");
-    const std::string metaPath(outPath + "ept-sources/");
+    const std::string nativePath(test::dataPath() + "out/ellipsoid-re/");
+    const std::string pdalPath(test::dataPath() + "out/ellipsoid-re-pdal/");
+
+    // A filters.reprojection stage of our own makes PDAL reproject, so both
+    // paths are built and must agree.
+    for (const bool native : { true, false })
+    {
+        const std::string outPath(native ? nativePath : pdalPath);
+
+        const Config c(merge(json {
+            { "input", test::dataPath() + "ellipsoid-multi/" },
+            { "output", outPath },
+            { "reprojection", {
+                { "out", "EPSG:26918" }
+            } },
+            { "force", true },
+            { "span", v.span() },
+            { "hierarchyStep", v.hierarchyStep() }
+        }, native ? json::object() : json {
+            { "pipeline", json::array({
+                json::object(),
+                { { "type", "filters.reprojection" } }
+            }) }
+        }));
+
+        EXPECT_EQ(
+                c.nativeReprojection(),
+                native && Reprojector::available());
+
+        Builder(c).go();
+
+        const auto info(json::parse(a.get(outPath + "ept.json")));
+
+        const Bounds bounds(info.at("bounds"));
+        const Bounds boundsConforming(info.at("boundsConforming"));
+        EXPECT_TRUE(bounds.isCubic());
+        EXPECT_TRUE(bounds.contains(boundsConforming));
+        for (std::size_t i(0); i < 6; ++i)
+        {
+            ASSERT_NEAR(boundsConforming[i], v.boundsUtm()[i], 2.0) <<
+                "At: " << i <<
+                "\n" << boundsConforming << "\n!=\n" << v.boundsUtm() <<
+                std::endl;
+        }
+
+        const auto dataType(info.at("dataType").get<std::string>());
+        EXPECT_EQ(dataType, "laszip");
+
+        const auto hierarchyType(
+                info.at("hierarchyType").get<std::string>());
+        EXPECT_EQ(hierarchyType, "json");
+
+        const auto points(info.at("points").get<uint64_t>());
+        EXPECT_EQ(points, v.points());
+
+        const Schema schema(info.at("schema"));
+        Schema verifySchema(v.schema().append(DimId::OriginId));
+        verifySchema.setOffset(bounds.mid().round());
+        EXPECT_EQ(schema, verifySchema);
+
+        EXPECT_EQ(info.at("span").get<uint64_t>(), v.span());
+
+        checkSources(outPath);
+    }
+
+    // The two may round differently to our 0.01 scale, but no further.
+    const auto nativeXyz(readXyz(nativePath));
+    const auto pdalXyz(readXyz(pdalPath));
+
+    for (std::size_t d(0); d < 3; ++d)
+    {
+        ASSERT_EQ(nativeXyz[d].size(), v.points());
+        ASSERT_EQ(pdalXyz[d].size(), v.points());
+
+        for (std::size_t i(0); i < v.points(); ++i)
+        {
+            ASSERT_NEAR(nativeXyz[d][i], pdalXyz[d][i], 0.0101) <<
+                "Dimension " << d << ", point " << i;
+        }
+    }
+}
+
+TEST(build, scaledResident)
+{
+    const std::string base(test::dataPath() + "out/ellipsoid-scaled/");
+
+    for (const std::string dataType : { "laszip", "binary" })
+    {
+        const std::string outPath(base + dataType + "-scaled/");
+        const std::string doublePath(base + dataType + "-double/");
+
+        for (const bool scaled : { false, true })
+        {
+            Config c(json {
+                { "input", test::dataPath() + "ellipsoid-multi/" },
+                { "output", scaled ? outPath : doublePath },
+                { "force", true },
+                { "span", v.span() },
+                { "hierarchyStep", v.hierarchyStep() },
+                { "dataType", dataType },
+                { "scaledResident", scaled }
+            });
+
+            Builder(c).go();
+        }
+
+        const auto info(json::parse(a.get(outPath + "ept.json")));
+
+        const Bounds bounds(info.at("bounds"));
+        const Bounds boundsConforming(info.at("boundsConforming"));
+        EXPECT_TRUE(bounds.isCubic());
+        EXPECT_TRUE(bounds.contains(boundsConforming));
+        for (std::size_t i(0); i < 6; ++i)
+        {
+            ASSERT_NEAR(boundsConforming[i], v.bounds()[i], 2.0) <<
+                "At: " << i <<
+                "\n" << boundsConforming << "\n!=\n" << v.bounds() <<
+                std::endl;
+        }
+
+        EXPECT_EQ(info.at("dataType").get<std::string>(), dataType);
+
+        const auto points(info.at("points").get<uint64_t>());
+        EXPECT_EQ(points, v.points());
+
+        const Schema schema(info.at("schema"));
+        Schema verifySchema(v.schema().append(DimId::OriginId));
+        verifySchema.setOffset(bounds.mid().round());
+        EXPECT_EQ(schema, verifySchema);
+
+        checkSources(outPath);
+
+        // Points are placed on the integer grid in either case, so the
+        // scaled build must match one held in doubles: the same nodes with
+        // the same counts, and XYZ within one scale step.
+        const auto doubleInfo(json::parse(a.get(doublePath + "ept.json")));
+        EXPECT_EQ(doubleInfo.at("points").get<uint64_t>(), points);
+        EXPECT_EQ(readHierarchy(outPath), readHierarchy(doublePath));
+
+        const Point scale(schema.scaleOffset()->scale());
+        const auto scaledXyz(readXyz(outPath));
+        const auto doubleXyz(readXyz(doublePath));
+
+        for (std::size_t d(0); d < 3; ++d)
+        {
+            ASSERT_EQ(scaledXyz[d].size(), v.points());
+            ASSERT_EQ(doubleXyz[d].size(), v.points());
+
+            for (std::size_t i(0); i < v.points(); ++i)
+            {
+                ASSERT_NEAR(scaledXyz[d][i], doubleXyz[d][i], scale[d]) <<
+                    dataType << ": dimension " << d << ", point " << i;
+            }
+        }
+    }
+}
+
+TEST(build, adaptiveOverflow)
+{
+    const std::string outPath(test::dataPath() + "out/ellipsoid-adaptive/");
 
     Config c(json {
         { "input", test::dataPath() + "ellipsoid-multi/" },
         { "output", outPath },
-        { "reprojection", {
-            { "out", "EPSG:26918" }
-        } },
         { "force", true },
         { "span", v.span() },
-        { "hierarchyStep", v.hierarchyStep() }
+        { "hierarchyStep", v.hierarchyStep() },
+        { "overflowThreshold", 64 },
+        { "adaptiveOverflow", true }
     });
 
     Builder(c).go();
 
     const auto info(json::parse(a.get(outPath + "ept.json")));
+    EXPECT_EQ(info.at("points").get<uint64_t>(), v.points());
 
-    const Bounds bounds(info.at("bounds"));
-    const Bounds boundsConforming(info.at("boundsConforming"));
-    EXPECT_TRUE(bounds.isCubic());
-    EXPECT_TRUE(bounds.contains(boundsConforming));
-    for (std::size_t i(0); i < 6; ++i)
+    const auto build(json::parse(a.get(outPath + "ept-build.json")));
+    EXPECT_TRUE(build.at("adaptiveOverflow").get<bool>());
+    EXPECT_EQ(build.at("overflowThreshold").get<uint64_t>(), 64u);
+
+    EXPECT_EQ(hierarchyPoints(outPath), v.points());
+}
+
+TEST(build, sharedChunks)
+{
+    // Without sharing, with so little that chunks are constantly evicted, and
+    // with the default sharing under a memory limit that is always exceeded.
+    const std::vector<json> configs {
+        json { { "sharedChunks", 0 } },
+        json { { "sharedChunks", 2 } },
+        json { { "memoryLimit", 1 } }
+    };
+
+    for (std::size_t i(0); i < configs.size(); ++i)
     {
-        ASSERT_NEAR(boundsConforming[i], v.boundsUtm()[i], 2.0) <<
-            "At: " << i <<
-            "\n" << boundsConforming << "\n!=\n" << v.boundsUtm() << std::endl;
+        const std::string outPath(
+                test::dataPath() + "out/ellipsoid-shared-" +
+                std::to_string(i) + "/");
+
+        Config c(merge(json {
+            { "input", test::dataPath() + "ellipsoid-multi/" },
+            { "output", outPath },
+            { "force", true },
+            { "span", v.span() },
+            { "hierarchyStep", v.hierarchyStep() }
+        }, configs[i]));
+
+        Builder(c).go();
+
+        const auto info(json::parse(a.get(outPath + "ept.json")));
+        EXPECT_EQ(info.at("points").get<uint64_t>(), v.points());
+        EXPECT_EQ(hierarchyPoints(outPath), v.points());
     }
+}
 
-    const auto dataType(info.at("dataType").get<std::string>());
-    EXPECT_EQ(dataType, "laszip");
+TEST(build, remove)
+{
+    const std::string outPath(test::dataPath() + "out/ellipsoid-remove/");
 
-    const auto hierarchyType(info.at("hierarchyType").get<std::string>());
-    EXPECT_EQ(hierarchyType, "json");
+    {
+        Config c(json {
+            { "input", test::dataPath() + "ellipsoid-multi/" },
+            { "output", outPath },
+            { "force", true },
+            { "span", v.span() },
+            { "hierarchyStep", v.hierarchyStep() }
+        });
 
-    const auto points(info.at("points").get<uint64_t>());
-    EXPECT_EQ(points, v.points());
+        Builder(c).go();
+    }
 
-    const Schema schema(info.at("schema"));
-    Schema verifySchema(v.schema().append(DimId::OriginId));
-    verifySchema.setOffset(bounds.mid().round());
-    EXPECT_EQ(schema, verifySchema);
+    const json list(json::parse(a.get(outPath + "ept-sources/list.json")));
+    const auto entry(list.at(0));
+    const auto id(entry.at("id").get<std::string>());
+    const json full(json::parse(
+                a.get(outPath + "ept-sources/" +
+                    entry.at("url").get<std::string>())));
+    const uint64_t removed(full.at(id).at("points").get<uint64_t>());
 
-    EXPECT_EQ(info.at("span").get<uint64_t>(), v.span());
+    {
+        Config c(json {
+            { "output", outPath },
+            { "origins", { 0 } },
+            { "replace", true }
+        });
+
+        Remover remover(c);
+        remover.go();
+        EXPECT_EQ(remover.removed(), removed);
+    }
+
+    auto info(json::parse(a.get(outPath + "ept.json")));
+    EXPECT_EQ(info.at("points").get<uint64_t>(), v.points() - removed);
+    EXPECT_EQ(hierarchyPoints(outPath), v.points() - removed);
+
+    // Continuing the build inserts the replaced origin again.
+    {
+        Config c(json { { "output", outPath } });
+        Builder(c).go();
+    }
+
+    info = json::parse(a.get(outPath + "ept.json"));
+    EXPECT_EQ(info.at("points").get<uint64_t>(), v.points());
+    EXPECT_EQ(hierarchyPoints(outPath), v.points());
+    checkSources(outPath);
+
+    // Everything within the region is removed, whatever its origin.
+    {
+        Config c(json { { "output", outPath }, { "region", v.bounds() } });
+        Remover(c).go();
+    }
+
+    info = json::parse(a.get(outPath + "ept.json"));
+    EXPECT_EQ(info.at("points").get<uint64_t>(), 0u);
+    EXPECT_EQ(hierarchyPoints(outPath), 0u);
+}
+
+TEST(build, bundled)
+{
+    const std::string outPath(test::dataPath() + "out/ellipsoid-bundled/");
+    const uint64_t depth(2);
+
+    {
+        Config c(json {
+            { "input", test::dataPath() + "ellipsoid-multi/" },
+            { "output", outPath },
+            { "force", true },
+            { "span", v.span() },
+            { "hierarchyStep", v.hierarchyStep() },
+            { "bundleDepth", depth },
+            { "run", 4 }
+        });
+
+        Builder(c).go();
+    }
+
+    // Continuing unpacks the existing bundles, so nodes written by the first
+    // run may be read back and extended.
+    {
+        Config c(json { { "output", outPath } });
+        Builder(c).go();
+    }
 
+    const auto info(json::parse(a.get(outPath + "ept.json")));
+    EXPECT_EQ(info.at("points").get<uint64_t>(), v.points());
+    EXPECT_EQ(hierarchyPoints(outPath), v.points());
     checkSources(outPath);
+
+    const auto build(json::parse(a.get(outPath + "ept-build.json")));
+    EXPECT_EQ(build.at("bundleDepth").get<uint64_t>(), depth);
+
+    // Only nodes above the bundle depth are stored individually.
+    uint64_t bundles(0);
+    for (const std::string path : arbiter::glob(outPath + "ept-data/*"))
+    {
+        const std::string name(arbiter::util::getBasename(path));
+        const std::size_t dot(name.find('.'));
+        ASSERT_NE(dot, std::string::npos);
+
+        const Dxyz key(name.substr(0, dot));
+        if (name.substr(dot) == ".bundle")
+        {
+            EXPECT_EQ(key.d, depth);
+            EXPECT_TRUE(a.exists(
+                        outPath + "ept-hierarchy/" +
+                        key.toString() + "-bundle.json"));
+            ++bundles;
+        }
+        else EXPECT_LT(key.d, depth);
+    }
+    EXPECT_GT(bundles, 0u);
+}
+
+TEST(build, bundledFromMemory)
+{
+    // These data types read bundled nodes straight from the fetched range,
+    // which must match reading the unbundled nodes from their own files.
+    for (const std::string dataType : { "binary", "zstandard", "columnar" })
+    {
+        const std::string base(test::dataPath() + "out/bundled-" + dataType);
+
+        for (const uint64_t depth : { 0, 2 })
+        {
+            Config c(json {
+                { "input", test::dataPath() + "ellipsoid-multi/" },
+                { "output", base + "-" + std::to_string(depth) + "/" },
+                { "force", true },
+                { "span", v.span() },
+                { "hierarchyStep", v.hierarchyStep() },
+                { "dataType", dataType },
+                { "bundleDepth", depth }
+            });
+
+            Builder(c).go();
+        }
+
+        const auto expected(readXyz(base + "-0/"));
+        ASSERT_EQ(expected.at(0).size(), v.points());
+        EXPECT_EQ(readXyz(base + "-2/"), expected) << dataType;
+    }
 }
 
+TEST(build, bundleStage)
+{
+    const std::string root(test::dataPath() + "out/bundle-stage/");
+    for (const std::string dir : { "stage", "data", "hierarchy" })
+    {
+        ASSERT_TRUE(arbiter::mkdirp(root + dir));
+        for (const auto& f : arbiter::glob(root + dir + "/*"))
+        {
+            arbiter::remove(f);
+        }
+    }
+
+    const arbiter::Endpoint stage(a.getEndpoint(root + "stage"));
+    const arbiter::Endpoint data(a.getEndpoint(root + "data"));
+    const arbiter::Endpoint hier(a.getEndpoint(root + "hierarchy"));
+
+    const Metadata m(Config(json {
+        { "bounds", v.bounds() },
+        { "schema", v.schema() },
+        { "span", v.span() },
+        { "dataType", "binary" },
+        { "bundleDepth", 1 }
+    }));
+
+    // Two bundles, of two nodes each.
+    const std::vector<Dxyz> keys {
+        Dxyz(1, 0, 0, 0), Dxyz(2, 0, 0, 0),
+        Dxyz(1, 1, 1, 1), Dxyz(2, 2, 2, 2)
+    };
+    Bundle::Counts counts;
+    for (const Dxyz& k : keys) counts[k] = 1;
+
+    const auto name([](const Dxyz& k) { return k.toString() + ".bin"; });
+    Pool pool(2);
+
+    {
+        BundleStage bundles(m, stage, data, hier, Bundle::Counts());
+        for (const Dxyz& k : keys)
+        {
+            bundles.write(k).put(name(k), k.toString());
+        }
+
+        EXPECT_EQ(bundles.pack(counts, pool), 2u);
+
+        // Nothing has been rewritten since.
+        EXPECT_EQ(bundles.pack(counts, pool), 0u);
+    }
+
+    for (const Dxyz& k : keys) arbiter::remove(stage.fullPath(name(k)));
+
+    {
+        BundleStage bundles(m, stage, data, hier, counts);
+
+        // Reading a node stages only its own bundle.
+        const arbiter::Endpoint& ep(bundles.read(Dxyz(2, 0, 0, 0)));
+        EXPECT_EQ(ep.get(name(Dxyz(2, 0, 0, 0))), "2-0-0-0");
+        EXPECT_TRUE(stage.tryGetSize(name(Dxyz(1, 0, 0, 0))));
+        EXPECT_FALSE(stage.tryGetSize(name(Dxyz(1, 1, 1, 1))));
+        EXPECT_FALSE(stage.tryGetSize(name(Dxyz(2, 2, 2, 2))));
+        EXPECT_EQ(bundles.pack(counts, pool), 0u);
+
+        // Writing a node stages the rest of its bundle, which is repacked.
+        bundles.write(Dxyz(1, 1, 1, 1)).put(name(Dxyz(1, 1, 1, 1)), "new");
+        EXPECT_EQ(stage.get(name(Dxyz(2, 2, 2, 2))), "2-2-2-2");
+        EXPECT_EQ(bundles.pack(counts, pool), 1u);
+    }
+
+    const Bundle::Index index(Bundle::loadIndex(hier, Dxyz(1, 1, 1, 1)));
+    const Bundle::Range r(index.at(Dxyz(1, 1, 1, 1)));
+    const std::string bundle(data.get(Bundle::filename(Dxyz(1, 1, 1, 1))));
+    EXPECT_EQ(bundle.substr(r.first, r.second), "new");
+}
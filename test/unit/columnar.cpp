@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+#include "verify.hpp"
+
+#include <random>
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/io/columnar.hpp>
+#include <entwine/reader/chunk-reader.hpp>
+#include <entwine/reader/reader.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const arbiter::Arbiter a;
+    const Verify v;
+
+    std::vector<char> readAll(Reader& r, const json& j)
+    {
+        auto q(r.read(j));
+        q->run();
+        return q->data();
+    }
+}
+
+TEST(columnar, delta)
+{
+    std::mt19937_64 gen(42);
+
+    // Include an empty column, partial blocks, and full-range jumps.
+    for (const std::size_t n : { 0, 1, 1023, 1024, 1025, 5000 })
+    {
+        std::vector<int64_t> values(n);
+        int64_t walk(0);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            walk += static_cast<int64_t>(gen() % 201) - 100;
+            values[i] = i % 700 == 699 ? static_cast<int64_t>(gen()) : walk;
+        }
+
+        const std::vector<char> encoded(Columnar::encodeDelta(values));
+        EXPECT_EQ(Columnar::decodeDelta(encoded, n), values);
+    }
+
+    // A smooth sequence should pack into a few bits per value.
+    std::vector<int64_t> smooth(100000);
+    for (std::size_t i(0); i < smooth.size(); ++i) smooth[i] = 1000000 + i * 3;
+    EXPECT_LT(Columnar::encodeDelta(smooth).size(), smooth.size());
+}
+
+TEST(columnar, rle)
+{
+    std::vector<char> bytes(10000, 2);
+    for (std::size_t i(0); i < bytes.size(); i += 37) bytes[i] = i % 5;
+
+    const std::vector<char> encoded(Columnar::encodeRle(bytes));
+    EXPECT_EQ(Columnar::decodeRle(encoded, bytes.size()), bytes);
+
+    EXPECT_ANY_THROW(Columnar::decodeRle(encoded, bytes.size() - 1));
+}
+
+TEST(columnar, read)
+{
+    const std::string binPath(test::dataPath() + "out/columnar/binary/");
+    const std::string colPath(test::dataPath() + "out/columnar/columnar/");
+
+    for (const std::string dataType : { "binary", "columnar" })
+    {
+        Config c(json {
+            { "input", test::dataPath() + "ellipsoid.laz" },
+            { "output", dataType == "binary" ? binPath : colPath },
+            { "force", true },
+            { "span", v.span() },
+            { "hierarchyStep", v.hierarchyStep() },
+            { "dataType", dataType },
+            { "nodeOrder", "morton" }
+        });
+
+        Builder(c).go();
+    }
+
+    EXPECT_FALSE(a.resolve(colPath + "ept-data/*.col").empty());
+
+    Reader bin(binPath);
+    Reader col(colPath);
+
+    // Partial-schema and filtered reads match the row-oriented output.  The
+    // trailing full read must reload the chunks cached by the partial reads.
+    const Schema xyz(DimList { DimId::X, DimId::Y, DimId::Z });
+    const json filter { { "Intensity", { { "$gt", 100 } } } };
+
+    const std::vector<json> queries {
+        json { { "schema", xyz } },
+        json { { "schema", xyz }, { "filter", filter } },
+        json::object()
+    };
+
+    for (const json& q : queries)
+    {
+        const auto expected(readAll(bin, q));
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(readAll(col, q), expected) << q.dump();
+    }
+
+    // Only the requested dimensions are decoded.
+    const DimSet dims { DimId::X, DimId::Y, DimId::Z };
+    ChunkReader partial(col, Dxyz(), dims);
+    EXPECT_EQ(partial.dims(), dims);
+    EXPECT_TRUE(partial.has(DimSet { DimId::X }));
+    EXPECT_FALSE(partial.has(DimSet { DimId::Intensity }));
+    EXPECT_FALSE(partial.has(DimSet()));
+
+    ChunkReader full(bin, Dxyz(), dims);
+    EXPECT_TRUE(full.dims().empty());
+    EXPECT_TRUE(full.has(DimSet()));
+}
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include <pdal/StageFactory.hpp>
+
+#include "gtest/gtest.h"
+
+#include "config.hpp"
+#include "verify.hpp"
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/formats/copc/exporter.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/types/vector-point-table.hpp>
+#include <entwine/util/executor.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const arbiter::Arbiter a;
+    const Verify v;
+
+    template <typename T>
+    T get(const std::vector<char>& data, const std::size_t pos)
+    {
+        T t;
+        std::memcpy(&t, data.data() + pos, sizeof(T));
+        return t;
+    }
+
+    std::string str(const std::vector<char>& data, const std::size_t pos)
+    {
+        return std::string(data.data() + pos);
+    }
+
+    std::string build()
+    {
+        const std::string out(test::dataPath() + "out/copc/ept/");
+
+        Config c(json {
+            { "input", test::dataPath() + "ellipsoid.laz" },
+            { "output", out },
+            { "force", true },
+            { "hierarchyStep", v.hierarchyStep() },
+            { "span", v.span() }
+        });
+
+        Builder(c).go();
+        return out;
+    }
+
+    const Schema xyz(DimList {
+        { DimId::X, DimType::Double },
+        { DimId::Y, DimType::Double },
+        { DimId::Z, DimType::Double }
+    });
+
+    // Each of X, Y, and Z of every point, sorted separately.
+    using Xyz = std::vector<std::vector<double>>;
+
+    Xyz sorted(const std::vector<char>& data)
+    {
+        const std::size_t n(data.size() / xyz.pointSize());
+        Xyz result(3, std::vector<double>(n));
+        for (std::size_t i(0); i < n; ++i)
+        {
+            for (std::size_t d(0); d < 3; ++d)
+            {
+                result[d][i] = get<double>(
+                        data,
+                        i * xyz.pointSize() + d * sizeof(double));
+            }
+        }
+
+        for (auto& values : result) std::sort(values.begin(), values.end());
+        return result;
+    }
+
+    // Read an exported file with PDAL, preferring its COPC reader where this
+    // PDAL has one.  A COPC file is also a valid LAS 1.4 file.
+    Xyz readPdal(const std::string path)
+    {
+        pdal::StageFactory factory;
+        const std::string type(
+                factory.createStage("readers.copc") ?
+                    "readers.copc" : "readers.las");
+
+        VectorPointTable table(xyz, 4096);
+        std::vector<char> data;
+        table.setProcess([&table, &data]()
+        {
+            const auto& d(table.data());
+            data.insert(
+                    data.end(),
+                    d.begin(),
+                    d.begin() + table.numPoints() * table.pointSize());
+        });
+
+        const json pipeline(json::array({
+            { { "filename", path }, { "type", type } }
+        }));
+        EXPECT_TRUE(Executor::get().run(table, pipeline)) << type;
+        return sorted(data);
+    }
+
+    Xyz readEpt(const std::string path)
+    {
+        Reader reader(path);
+        auto q(reader.read(json { { "schema", xyz } }));
+        q->run();
+        return sorted(q->data());
+    }
+}
+
+TEST(copc, export)
+{
+    const std::string in(build());
+    const std::string path(test::dataPath() + "out/copc/ellipsoid.copc.laz");
+
+    copc::Exporter exporter(json {
+        { "input", in },
+        { "output", path },
+        { "hierarchyStep", 2 }
+    });
+
+    if (!copc::Exporter::available())
+    {
+        EXPECT_THROW(exporter.go(), std::runtime_error);
+        return;
+    }
+
+    const copc::Exporter::Stats stats(exporter.go());
+    EXPECT_EQ(stats.points, v.points());
+
+    const std::vector<char> data(a.getBinary(path));
+    ASSERT_EQ(data.size(), stats.bytes);
+    ASSERT_GT(data.size(), 375u);
+
+    EXPECT_EQ(std::string(data.data(), 4), "LASF");
+    EXPECT_EQ(get<uint8_t>(data, 24), 1);
+    EXPECT_EQ(get<uint8_t>(data, 25), 4);
+    EXPECT_EQ(get<uint16_t>(data, 94), 375);
+    EXPECT_EQ(get<uint8_t>(data, 104), exporter.pointFormat() | 0x80);
+    EXPECT_EQ(get<uint64_t>(data, 247), v.points());
+
+    // The COPC info VLR must directly follow the header.
+    EXPECT_EQ(str(data, 375 + 2), "copc");
+    EXPECT_EQ(get<uint16_t>(data, 375 + 18), 1);
+    EXPECT_EQ(get<uint16_t>(data, 375 + 20), 160);
+
+    const uint64_t rootOffset(get<uint64_t>(data, 375 + 54 + 40));
+    const uint64_t rootSize(get<uint64_t>(data, 375 + 54 + 48));
+
+    const uint64_t evlr(get<uint64_t>(data, 235));
+    EXPECT_EQ(get<uint32_t>(data, 243), 1u);
+    EXPECT_EQ(str(data, evlr + 2), "copc");
+    EXPECT_EQ(get<uint16_t>(data, evlr + 18), 1000);
+    EXPECT_EQ(evlr + 60 + get<uint64_t>(data, evlr + 20), data.size());
+
+    // Every point is in exactly one node, each of which is a chunk within
+    // the point data.
+    const uint64_t pointOffset(get<uint32_t>(data, 96));
+    uint64_t nodes(0);
+    uint64_t pages(0);
+
+    std::function<uint64_t(uint64_t, uint64_t)> count(
+            [&](uint64_t offset, uint64_t size) -> uint64_t
+    {
+        ++pages;
+        uint64_t np(0);
+        for (uint64_t pos(offset); pos < offset + size; pos += 32)
+        {
+            const uint64_t o(get<uint64_t>(data, pos + 16));
+            const int32_t s(get<int32_t>(data, pos + 24));
+            const int32_t n(get<int32_t>(data, pos + 28));
+
+            if (n < 0) np += count(o, s);
+            else
+            {
+                EXPECT_GE(o, pointOffset + 8);
+                EXPECT_LE(o + s, evlr);
+                np += n;
+                ++nodes;
+            }
+        }
+        return np;
+    });
+
+    EXPECT_EQ(count(rootOffset, rootSize), v.points());
+    EXPECT_EQ(nodes, stats.nodes);
+    EXPECT_GT(pages, 1u);
+
+    // PDAL must read back every point of the EPT source, within the bounds
+    // of the header.
+    const Xyz copc(readPdal(path));
+    const Xyz ept(readEpt(in));
+
+    for (std::size_t d(0); d < 3; ++d)
+    {
+        ASSERT_EQ(copc[d].size(), v.points());
+        ASSERT_EQ(ept[d].size(), v.points());
+
+        const double max(get<double>(data, 179 + d * 16));
+        const double min(get<double>(data, 187 + d * 16));
+        EXPECT_NEAR(copc[d].front(), min, 0.0001) << "Dimension " << d;
+        EXPECT_NEAR(copc[d].back(), max, 0.0001) << "Dimension " << d;
+
+        for (std::size_t i(0); i < v.points(); i += 997)
+        {
+            ASSERT_NEAR(copc[d][i], ept[d][i], 0.0001) <<
+                "Dimension " << d << ", point " << i;
+        }
+    }
+}
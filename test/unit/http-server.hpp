@@ -0,0 +1,205 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace test
+{
+
+// A minimal HTTP/1.1 file server for tests, serving GET and HEAD requests
+// with single-range support from a local directory.  Each connection serves
+// one request.
+class HttpServer
+{
+public:
+    HttpServer(std::string root)
+        : m_root(root)
+    {
+        m_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (m_fd < 0) throw std::runtime_error("Could not create socket");
+
+        const int on(1);
+        ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr = { };
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+
+        socklen_t len(sizeof(addr));
+        if (
+                ::bind(m_fd, reinterpret_cast<sockaddr*>(&addr), len) ||
+                ::listen(m_fd, 64) ||
+                ::getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len))
+        {
+            ::close(m_fd);
+            throw std::runtime_error("Could not start HTTP server");
+        }
+
+        m_port = ntohs(addr.sin_port);
+        m_thread = std::thread([this]() { serve(); });
+    }
+
+    ~HttpServer()
+    {
+        m_done = true;
+        ::shutdown(m_fd, SHUT_RDWR);
+        ::close(m_fd);
+        m_thread.join();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& t : m_workers) t.join();
+    }
+
+    std::string url() const
+    {
+        return "http://127.0.0.1:" + std::to_string(m_port) + "/";
+    }
+
+    uint64_t gets() const { return m_gets; }
+    uint64_t heads() const { return m_heads; }
+    uint64_t ranged() const { return m_ranged; }
+
+private:
+    void serve()
+    {
+        while (!m_done)
+        {
+            const int client(::accept(m_fd, nullptr, nullptr));
+            if (client < 0) continue;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_workers.emplace_back([this, client]() { handle(client); });
+        }
+    }
+
+    void handle(const int client)
+    {
+        std::string request;
+        char buffer[4096];
+        while (request.find("\r\n\r\n") == std::string::npos)
+        {
+            const ssize_t n(::recv(client, buffer, sizeof(buffer), 0));
+            if (n <= 0) break;
+            request.append(buffer, n);
+        }
+
+        std::istringstream lines(request);
+        std::string method, path, version;
+        lines >> method >> path >> version;
+
+        uint64_t begin(0);
+        uint64_t end(0);
+        bool range(false);
+
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            const std::string key("range: bytes=");
+            std::string lower(line);
+            for (char& c : lower) c = std::tolower(c);
+
+            if (lower.compare(0, key.size(), key) == 0)
+            {
+                const std::string spec(line.substr(key.size()));
+                const std::size_t dash(spec.find('-'));
+                begin = std::stoull(spec.substr(0, dash));
+                end = std::stoull(spec.substr(dash + 1)) + 1;
+                range = true;
+            }
+        }
+
+        std::ifstream file(
+                m_root + path.substr(1),
+                std::ios::in | std::ios::binary);
+
+        std::ostringstream response;
+        std::string body;
+
+        if (!file.good())
+        {
+            response << "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n";
+        }
+        else
+        {
+            body.assign(
+                    std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+            const uint64_t size(body.size());
+
+            if (range && begin >= size)
+            {
+                ++m_ranged;
+                body.clear();
+
+                response << "HTTP/1.1 416 Range Not Satisfiable\r\n" <<
+                    "Content-Range: bytes */" << size << "\r\n";
+            }
+            else if (range)
+            {
+                ++m_ranged;
+                end = std::min(end, size);
+                begin = std::min(begin, end);
+                body = body.substr(begin, end - begin);
+
+                response << "HTTP/1.1 206 Partial Content\r\n" <<
+                    "Content-Range: bytes " << begin << "-" <<
+                    (end ? end - 1 : 0) << "/" << size << "\r\n";
+            }
+            else response << "HTTP/1.1 200 OK\r\n";
+
+            response << "Content-Length: " << body.size() << "\r\n";
+        }
+
+        if (method == "HEAD")
+        {
+            ++m_heads;
+            body.clear();
+        }
+        else ++m_gets;
+
+        response << "Connection: close\r\n\r\n" << body;
+
+        const std::string data(response.str());
+        std::size_t sent(0);
+        while (sent < data.size())
+        {
+            const ssize_t n(
+                    ::send(client, data.data() + sent, data.size() - sent, 0));
+            if (n <= 0) break;
+            sent += n;
+        }
+
+        ::close(client);
+    }
+
+    const std::string m_root;
+    int m_fd = -1;
+    int m_port = 0;
+
+    std::atomic_bool m_done { false };
+    std::atomic<uint64_t> m_gets { 0 };
+    std::atomic<uint64_t> m_heads { 0 };
+    std::atomic<uint64_t> m_ranged { 0 };
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::vector<std::thread> m_workers;
+};
+
+} // namespace test
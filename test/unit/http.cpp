@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+#include "http-server.hpp"
+#include "verify.hpp"
+
+#include <random>
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/io/ensure.hpp>
+#include <entwine/reader/reader.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const Verify v;
+
+    std::vector<char> random(std::size_t size)
+    {
+        std::mt19937 gen(42);
+        std::vector<char> data(size);
+        for (char& c : data) c = gen();
+        return data;
+    }
+}
+
+TEST(http, parallelGet)
+{
+    const std::string root(test::dataPath() + "out/http/");
+    arbiter::Arbiter a;
+
+    const std::vector<char> big(random(1000 * 1000 + 7));
+    const std::vector<char> small(random(1000));
+    a.put(root + "big", big);
+    a.put(root + "small", small);
+
+    test::HttpServer server(root);
+    const arbiter::Endpoint ep(a.getEndpoint(server.url()));
+
+    // Larger than a part: a speculative first part, a HEAD, and then the
+    // remaining parts in parallel.
+    const uint64_t partSize(64 * 1024);
+    EXPECT_EQ(*ensureGetParallel(ep, "big", partSize, 4), big);
+    EXPECT_EQ(server.heads(), 1u);
+    EXPECT_EQ(server.gets(), (big.size() + partSize - 1) / partSize);
+    EXPECT_EQ(server.ranged(), server.gets());
+
+    // Within a single part, only one request is made.
+    const uint64_t gets(server.gets());
+    EXPECT_EQ(*ensureGetParallel(ep, "small", partSize, 4), small);
+    EXPECT_EQ(server.gets(), gets + 1);
+    EXPECT_EQ(server.heads(), 1u);
+
+    // Exactly one part.
+    const std::vector<char> exact(random(partSize));
+    a.put(root + "exact", exact);
+    EXPECT_EQ(*ensureGetParallel(ep, "exact", partSize, 4), exact);
+
+    EXPECT_EQ(*ensureGetRange(ep, "big", 10, 20),
+            std::vector<char>(big.begin() + 10, big.begin() + 20));
+
+    // Empty ranges, and ranges past the end of the file, are empty.
+    const uint64_t ranged(server.ranged());
+    EXPECT_TRUE(ensureGetRange(ep, "big", 10, 10)->empty());
+    EXPECT_EQ(server.ranged(), ranged);
+    EXPECT_TRUE(ensureGetRange(ep, "small", 2000, 3000)->empty());
+
+    a.put(root + "empty", std::vector<char>());
+    EXPECT_TRUE(ensureGetParallel(ep, "empty", partSize, 4)->empty());
+}
+
+TEST(http, read)
+{
+    const std::string root(test::dataPath() + "out/");
+
+    for (const std::string dataType : { "laszip", "binary", "columnar" })
+    {
+        const std::string name("http-" + dataType + "/");
+
+        {
+            Config c(json {
+                { "input", test::dataPath() + "ellipsoid.laz" },
+                { "output", root + name },
+                { "force", true },
+                { "span", v.span() },
+                { "hierarchyStep", v.hierarchyStep() },
+                { "dataType", dataType }
+            });
+
+            Builder(c).go();
+        }
+
+        test::HttpServer server(root);
+
+        // Batched chunk fetches over HTTP match local reads.
+        Reader local(root + name);
+        Reader remote(server.url() + name);
+
+        auto run([](Reader& r, const json& j)
+        {
+            auto q(r.read(j));
+            q->run();
+            return q->data();
+        });
+
+        const auto expected(run(local, json::object()));
+        EXPECT_EQ(expected.size() / local.metadata().outSchema().pointSize(),
+                v.points());
+        EXPECT_EQ(run(remote, json::object()), expected) << dataType;
+        EXPECT_GT(server.gets(), 0u);
+    }
+}
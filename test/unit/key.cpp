@@ -0,0 +1,189 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+#include "verify.hpp"
+
+#include <random>
+#include <vector>
+
+#include <entwine/builder/config.hpp>
+#include <entwine/types/key.hpp>
+#include <entwine/types/metadata.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const Verify v;
+
+    Config config(const Bounds& bounds)
+    {
+        return Config(json {
+            { "bounds", bounds },
+            { "schema", v.schema() },
+            { "span", v.span() }
+        });
+    }
+
+    // The original per-level bisection, against which the direct location
+    // must match exactly.
+    Key bisect(const Metadata& m, const Point& g, uint64_t depth)
+    {
+        Key k(m);
+        for (uint64_t d(0); d < m.startDepth() + depth; ++d) k.step(g);
+        return k;
+    }
+
+    std::vector<Point> makePoints(const Metadata& m, uint64_t depth)
+    {
+        const Bounds& cube(m.boundsCubic());
+        const ScaleOffset so(m.outSchema().scale(), m.outSchema().offset());
+
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> dx(cube.min().x, cube.max().x);
+        std::uniform_real_distribution<double> dy(cube.min().y, cube.max().y);
+        std::uniform_real_distribution<double> dz(cube.min().z, cube.max().z);
+
+        std::vector<Point> points;
+        for (std::size_t i(0); i < 100000; ++i)
+        {
+            points.push_back(so.clip(Point(dx(gen), dy(gen), dz(gen))));
+        }
+
+        // Points landing exactly on cell edges, and just to either side of
+        // them, exercise the tie-breaking of the bisection.
+        const double n(1ULL << (m.startDepth() + depth));
+        for (std::size_t i(0); i <= n; i += 7)
+        {
+            const Point edge(
+                    cube.min().x + i * cube.width() / n,
+                    cube.min().y + i * cube.depth() / n,
+                    cube.min().z + i * cube.height() / n);
+
+            points.push_back(edge);
+            points.push_back(edge.apply([](double d)
+            {
+                return std::nextafter(d, -std::numeric_limits<double>::max());
+            }));
+            points.push_back(edge.apply([](double d)
+            {
+                return std::nextafter(d, std::numeric_limits<double>::max());
+            }));
+        }
+
+        return points;
+    }
+}
+
+TEST(key, exactLevels)
+{
+    EXPECT_EQ(Key::exactLevels(Bounds(0, 0, 0, 0.5, 1, 1)), 0u);
+    EXPECT_EQ(Key::exactLevels(Bounds(0, 0, 0, 0, 1, 1)), 0u);
+    EXPECT_GT(Key::exactLevels(Bounds(-8, -8, -8, 8, 8, 8)), 40u);
+
+    EXPECT_GE(Key::exactLevels(v.bounds()), 20u);
+}
+
+TEST(key, matchesBisection)
+{
+    const Metadata m(config(v.bounds()));
+
+    for (uint64_t depth(0); depth < 12; ++depth)
+    {
+        for (const Point& g : makePoints(m, depth))
+        {
+            Key fast(m);
+            fast.init(g, depth);
+            const Key slow(bisect(m, g, depth));
+
+            ASSERT_EQ(fast.position(), slow.position()) << g << " " << depth;
+            ASSERT_EQ(fast.bounds().min(), slow.bounds().min());
+            ASSERT_EQ(fast.bounds().max(), slow.bounds().max());
+            ASSERT_EQ(fast.bounds().mid(), slow.bounds().mid());
+        }
+    }
+}
+
+TEST(key, gridMatchesBisection)
+{
+    const Metadata m(config(v.bounds()));
+    const Key grid(m);
+    ASSERT_GT(grid.f, 0u);
+
+    for (uint64_t depth(0); depth < 12; ++depth)
+    {
+        for (const Point& g : makePoints(m, depth))
+        {
+            const Xyz c(grid.cell(g));
+
+            Key fast(m);
+            fast.init(g, c, depth);
+            Key slow(bisect(m, g, depth));
+
+            ASSERT_EQ(fast.position(), slow.position()) << g << " " << depth;
+
+            // Keep descending, past the depth of the grid if need be.
+            for (uint64_t d(0); d < 4; ++d)
+            {
+                ASSERT_EQ(fast.direction(g, c), getDirection(
+                            slow.bounds().mid(), g));
+                ASSERT_EQ(fast.step(g, c), slow.step(g));
+                ASSERT_EQ(fast.position(), slow.position());
+                ASSERT_EQ(fast.bounds().min(), slow.bounds().min());
+                ASSERT_EQ(fast.bounds().max(), slow.bounds().max());
+            }
+        }
+    }
+}
+
+TEST(key, nearerMatchesDoubles)
+{
+    const Metadata m(config(v.bounds()));
+    const ScaleOffset so(m.outSchema().scale(), m.outSchema().offset());
+    const Key grid(m);
+
+    std::mt19937 gen(42);
+
+    for (uint64_t depth(0); depth < 12; ++depth)
+    {
+        for (const Point& g : makePoints(m, depth))
+        {
+            Key key(m);
+            key.init(g, grid.cell(g), depth);
+
+            const Bounds& b(key.bounds());
+            const Point& mid(b.mid());
+
+            std::uniform_real_distribution<double> dx(b.min().x, b.max().x);
+            std::uniform_real_distribution<double> dy(b.min().y, b.max().y);
+            std::uniform_real_distribution<double> dz(b.min().z, b.max().z);
+
+            // Other points in the same cell, including exact and near ties
+            // with this one.
+            std::vector<Point> others;
+            others.push_back(so.clip(Point(dx(gen), dy(gen), dz(gen))));
+            others.push_back(Point(dx(gen), dy(gen), dz(gen)));
+            others.push_back(Point(
+                        2 * mid.x - g.x,
+                        2 * mid.y - g.y,
+                        2 * mid.z - g.z));
+            others.push_back(Point(g.y, g.x, g.z));
+            others.push_back(g.apply([](double d)
+            {
+                return std::nextafter(d, std::numeric_limits<double>::max());
+            }));
+
+            for (const Point& o : others)
+            {
+                if (!b.contains(o)) continue;
+
+                const bool expected(g.sqDist3d(mid) < o.sqDist3d(mid));
+                ASSERT_EQ(
+                        key.nearer(g, grid.cell(g), o, grid.cell(o)),
+                        expected) << g << " " << o << " " << depth;
+                ASSERT_EQ(
+                        key.nearer(o, grid.cell(o), g, grid.cell(g)),
+                        o.sqDist3d(mid) < g.sqDist3d(mid));
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+
+#include <entwine/builder/synthetic.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/types/vector-point-table.hpp>
+#include <entwine/util/executor.hpp>
+#include <entwine/util/las-reader.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    // The schema with which a build would read this file.
+    Schema schemaOf(const std::string path)
+    {
+        const auto info(Executor::get().preview(json { { "filename", path } }));
+        if (!info) throw std::runtime_error("Could not preview " + path);
+
+        DimList dims;
+        for (const std::string name : info->dimNames) dims.emplace_back(name);
+        return Schema::makeAbsolute(Schema(dims));
+    }
+
+    template <typename F>
+    std::vector<char> collect(const Schema& schema, F f)
+    {
+        VectorPointTable table(schema, 1000);
+
+        std::vector<char> result;
+        table.setProcess([&table, &result]()
+        {
+            const auto& data(table.data());
+            result.insert(
+                    result.end(),
+                    data.begin(),
+                    data.begin() + table.numPoints() * table.pointSize());
+        });
+
+        f(table);
+        return result;
+    }
+}
+
+TEST(lasReader, matchesPdal)
+{
+    for (const std::string distribution : { "terrain", "pathological" })
+    {
+        const std::string path(
+                test::dataPath() + "out/las-reader-" + distribution + ".las");
+
+        const Synthetic synthetic(json {
+            { "distribution", distribution },
+            { "points", 25000 }
+        });
+        synthetic.write(path);
+
+        const Schema schema(schemaOf(path));
+        const json pipeline(json::array({ { { "filename", path } } }));
+
+        const auto reader(LasReader::create(pipeline, schema));
+        ASSERT_TRUE(reader);
+        EXPECT_EQ(reader->points(), 25000u);
+
+        const auto ours(collect(schema, [&reader](VectorPointTable& table)
+        {
+            reader->run(table);
+        }));
+        const auto theirs(collect(schema, [&pipeline](VectorPointTable& table)
+        {
+            ASSERT_TRUE(Executor::get().run(table, pipeline));
+        }));
+
+        ASSERT_EQ(ours.size(), 25000u * schema.pointSize());
+        EXPECT_TRUE(ours == theirs) << distribution;
+    }
+}
+
+TEST(lasReader, fallback)
+{
+    const std::string path(test::dataPath() + "out/las-reader-fallback.las");
+    Synthetic(json { { "points", 100 } }).write(path);
+    const Schema schema(schemaOf(path));
+
+    auto create([&schema](const json& pipeline)
+    {
+        return LasReader::create(pipeline, schema);
+    });
+
+    // SRS options leave the points alone.
+    EXPECT_TRUE(create(json::array({
+        { { "filename", path }, { "override_srs", "EPSG:3857" } }
+    })));
+
+    // Anything else is left to PDAL.
+    EXPECT_FALSE(create(json::array({
+        { { "filename", path } },
+        { { "type", "filters.range" }, { "limits", "Z[0:10]" } }
+    })));
+    EXPECT_FALSE(create(json::array({
+        { { "filename", path }, { "count", 10 } }
+    })));
+
+    const std::string laz(test::dataPath() + "out/las-reader-fallback.laz");
+    Synthetic(json { { "points", 100 } }).write(laz);
+    EXPECT_FALSE(create(json::array({
+        { { "filename", laz }, { "type", "readers.las" } }
+    })));
+
+    DimList dims(schema.dims());
+    dims.emplace_back("SomethingElse", DimType::Double);
+    EXPECT_FALSE(LasReader::create(
+                json::array({ { { "filename", path } } }),
+                Schema(dims)));
+}
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+
+#include <atomic>
+#include <thread>
+
+#include <entwine/io/local-io.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::string dir(test::dataPath() + "out/local-io/");
+
+    std::vector<char> makeData(const std::size_t size, const int seed)
+    {
+        std::vector<char> data(size);
+        for (std::size_t i(0); i < size; ++i) data[i] = (i * 31 + seed) % 251;
+        return data;
+    }
+}
+
+TEST(localIo, roundTrip)
+{
+    arbiter::mkdirp(dir);
+    LocalIo& io(LocalIo::get());
+
+    // Large enough to require several transfers.
+    const std::vector<char> data(makeData(16 * 1024 * 1024 + 7, 1));
+    io.write(dir + "round-trip", data);
+
+    const auto read(io.read(dir + "round-trip"));
+    ASSERT_TRUE(read);
+    EXPECT_TRUE(*read == data);
+
+    const std::vector<char> empty;
+    io.write(dir + "empty", empty);
+    const auto none(io.read(dir + "empty"));
+    ASSERT_TRUE(none);
+    EXPECT_TRUE(none->empty());
+}
+
+TEST(localIo, ranges)
+{
+    arbiter::mkdirp(dir);
+    LocalIo& io(LocalIo::get());
+
+    const std::vector<char> data(makeData(1000, 2));
+    io.write(dir + "ranges", data);
+
+    const auto middle(io.read(dir + "ranges", 100, 250));
+    ASSERT_TRUE(middle);
+    EXPECT_TRUE(std::equal(middle->begin(), middle->end(), data.begin() + 100));
+    EXPECT_EQ(middle->size(), 150u);
+
+    // Ranges are clamped to the file size.
+    const auto tail(io.read(dir + "ranges", 990, 5000));
+    ASSERT_TRUE(tail);
+    EXPECT_EQ(tail->size(), 10u);
+
+    const auto past(io.read(dir + "ranges", 2000, 3000));
+    ASSERT_TRUE(past);
+    EXPECT_TRUE(past->empty());
+}
+
+TEST(localIo, failures)
+{
+    arbiter::mkdirp(dir);
+    LocalIo& io(LocalIo::get());
+
+    EXPECT_FALSE(io.read(dir + "nonexistent"));
+    EXPECT_THROW(
+            io.write(dir + "nonexistent/file", makeData(10, 3)),
+            std::runtime_error);
+}
+
+TEST(localIo, batched)
+{
+    arbiter::mkdirp(dir);
+    LocalIo& io(LocalIo::get());
+
+    // More writes than fit in the ring at once.
+    std::vector<std::vector<char>> data;
+    std::vector<LocalIo::Write> writes;
+    for (int i(0); i < 1000; ++i) data.push_back(makeData(100 + i, i));
+    for (int i(0); i < 1000; ++i)
+    {
+        writes.emplace_back(dir + "batch-" + std::to_string(i), data[i]);
+    }
+
+    io.write(writes);
+
+    for (int i(0); i < 1000; ++i)
+    {
+        const auto read(io.read(dir + "batch-" + std::to_string(i)));
+        ASSERT_TRUE(read);
+        EXPECT_TRUE(*read == data[i]) << i;
+    }
+}
+
+TEST(localIo, concurrent)
+{
+    arbiter::mkdirp(dir);
+    LocalIo& io(LocalIo::get());
+
+    std::atomic_size_t bad(0);
+    std::vector<std::thread> threads;
+
+    for (int t(0); t < 16; ++t)
+    {
+        threads.emplace_back([&io, &bad, t]()
+        {
+            for (int i(0); i < 200; ++i)
+            {
+                const std::string path(
+                        dir + "concurrent-" + std::to_string(t) + "-" +
+                        std::to_string(i % 10));
+                const std::vector<char> data(makeData(4096 + i, t));
+
+                io.write(path, data);
+                const auto read(io.read(path));
+                if (!read || *read != data) ++bad;
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(bad, 0u);
+}
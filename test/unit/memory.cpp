@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+
+#include <entwine/types/vector-point-table.hpp>
+#include <entwine/util/memory.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    // Other tests in this process may hold memory, so only changes are
+    // compared.
+    uint64_t live(Memory::Category c)
+    {
+        Memory::flush();
+        return Memory::usage(c).live;
+    }
+}
+
+TEST(memory, accounting)
+{
+    const auto c(Memory::Category::Hierarchy);
+    const uint64_t start(live(c));
+    const uint64_t total(Memory::total().live);
+
+    Memory::add(c, 1000);
+    Memory::add(c, 500);
+    EXPECT_EQ(live(c), start + 1500);
+    EXPECT_GE(Memory::usage(c).peak, start + 1500);
+    EXPECT_EQ(Memory::total().live, total + 1500);
+
+    Memory::sub(c, 1500);
+    EXPECT_EQ(live(c), start);
+    EXPECT_GE(Memory::usage(c).peak, start + 1500);
+
+    // Temporary files are on disk, so excluded from the total.
+    const uint64_t tmp(live(Memory::Category::Tmp));
+    Memory::add(Memory::Category::Tmp, 100);
+    EXPECT_EQ(live(Memory::Category::Tmp), tmp + 100);
+    EXPECT_EQ(Memory::total().live, total);
+    Memory::sub(Memory::Category::Tmp, 100);
+}
+
+TEST(memory, threads)
+{
+    const auto c(Memory::Category::Files);
+    const uint64_t start(live(c));
+
+    // Changes made on other threads are published when those threads exit,
+    // and in batches while they run.
+    std::thread([c]() { Memory::add(c, 100); }).join();
+    EXPECT_EQ(live(c), start + 100);
+
+    std::thread([c]() { Memory::add(c, 1 << 20); }).join();
+    EXPECT_EQ(live(c), start + 100 + (1 << 20));
+    EXPECT_GE(Memory::usage(c).peak, start + 100 + (1 << 20));
+
+    Memory::sub(c, 100 + (1 << 20));
+    EXPECT_EQ(live(c), start);
+}
+
+TEST(memory, blocks)
+{
+    const auto c(Memory::Category::Blocks);
+    const uint64_t start(live(c));
+
+    {
+        MemBlock block(10, 4);
+        for (std::size_t i(0); i < 5; ++i) block.next();
+        EXPECT_EQ(live(c), start + 80);
+
+        MemBlock moved(std::move(block));
+        EXPECT_EQ(moved.size(), 5u);
+        EXPECT_EQ(live(c), start + 80);
+
+        moved.clear();
+        EXPECT_EQ(live(c), start);
+
+        moved.next();
+        EXPECT_EQ(live(c), start + 40);
+    }
+
+    EXPECT_EQ(live(c), start);
+}
+
+TEST(memory, report)
+{
+    const std::string report(Memory::report());
+    EXPECT_NE(report.find("grid"), std::string::npos);
+    EXPECT_NE(report.find("total"), std::string::npos);
+}
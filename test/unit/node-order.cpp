@@ -0,0 +1,255 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+#include "verify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/types/key.hpp>
+#include <entwine/types/node-order.hpp>
+#include <entwine/types/vector-point-table.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const arbiter::Arbiter a;
+    const Verify v;
+
+    // Every node of a build with points in it.
+    std::vector<Dxyz> nodes(const std::string out)
+    {
+        std::vector<Dxyz> result;
+        std::function<void(std::string)> read([&](const std::string key)
+        {
+            const json h(json::parse(
+                        a.get(out + "ept-hierarchy/" + key + ".json")));
+            for (const auto& p : h.items())
+            {
+                const int64_t points(p.value().get<int64_t>());
+                if (points > 0) result.emplace_back(p.key());
+                else if (points < 0) read(p.key());
+            }
+        });
+
+        read("0-0-0-0");
+        return result;
+    }
+
+    // The bounds of a node, stepped down from the root as the builder does.
+    Bounds boundsOf(const Metadata& m, const Dxyz& dxyz)
+    {
+        ChunkKey c(m);
+        for (uint64_t i(dxyz.d); i > 0; --i)
+        {
+            const uint64_t b(i - 1);
+            c.step(static_cast<Dir>(
+                        ((dxyz.x >> b) & 1 ? EwBit : 0) |
+                        ((dxyz.y >> b) & 1 ? NsBit : 0) |
+                        ((dxyz.z >> b) & 1 ? UdBit : 0)));
+        }
+        return c.bounds();
+    }
+
+    // Mirrors the quantization of point positions within a node for sorting.
+    uint32_t quantize(double v, double min, double width)
+    {
+        const uint32_t max((1u << 21) - 1);
+        const double f(std::floor((v - min) / width * (max + 1.0)));
+        if (!(f > 0)) return 0;
+        if (f >= max) return max;
+        return f;
+    }
+}
+
+TEST(nodeOrder, parse)
+{
+    for (const std::string s : { "none", "gpstime", "morton", "hilbert" })
+    {
+        EXPECT_EQ(toString(toNodeOrder(s)), s);
+    }
+
+    EXPECT_ANY_THROW(toNodeOrder("peano"));
+}
+
+TEST(nodeOrder, radixSort)
+{
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<uint64_t> dist;
+
+    std::vector<char> data(10000);
+    std::vector<std::pair<uint64_t, char*>> keyed;
+    for (std::size_t i(0); i < data.size(); ++i)
+    {
+        // Include duplicates to check stability.
+        keyed.emplace_back(dist(gen) % (i % 3 ? 1000 : ~0ULL), &data[i]);
+    }
+
+    auto expected(keyed);
+    std::stable_sort(
+            expected.begin(),
+            expected.end(),
+            [](const std::pair<uint64_t, char*>& a,
+                const std::pair<uint64_t, char*>& b)
+            {
+                return a.first < b.first;
+            });
+
+    radixSort(keyed);
+    EXPECT_EQ(keyed, expected);
+}
+
+TEST(nodeOrder, sortable)
+{
+    const std::vector<double> values { -1e9, -2.5, -0.0, 0.0, 1e-9, 3.0, 1e12 };
+    for (std::size_t i(1); i < values.size(); ++i)
+    {
+        EXPECT_LE(sortable(values[i - 1]), sortable(values[i]));
+    }
+}
+
+TEST(nodeOrder, curves)
+{
+    EXPECT_EQ(mortonCode(0, 0, 0), 0u);
+    EXPECT_EQ(mortonCode(1, 0, 0), 1u);
+    EXPECT_EQ(mortonCode(0, 1, 0), 2u);
+    EXPECT_EQ(mortonCode(0, 0, 1), 4u);
+    EXPECT_EQ(mortonCode(2, 0, 0), 8u);
+
+    // Consecutive Hilbert codes are always face-adjacent cells.  Check this
+    // over the 16^3 cells of the coarsest levels of the curve.
+    const uint32_t shift(17);
+    const uint32_t n(16);
+
+    std::vector<std::pair<uint64_t, Point>> cells;
+    for (uint32_t x(0); x < n; ++x)
+    {
+        for (uint32_t y(0); y < n; ++y)
+        {
+            for (uint32_t z(0); z < n; ++z)
+            {
+                cells.emplace_back(
+                        hilbertCode(x << shift, y << shift, z << shift),
+                        Point(x, y, z));
+            }
+        }
+    }
+
+    std::sort(
+            cells.begin(),
+            cells.end(),
+            [](const std::pair<uint64_t, Point>& a,
+                const std::pair<uint64_t, Point>& b)
+            {
+                return a.first < b.first;
+            });
+
+    for (std::size_t i(1); i < cells.size(); ++i)
+    {
+        ASSERT_NE(cells[i - 1].first, cells[i].first);
+
+        const Point& a(cells[i - 1].second);
+        const Point& b(cells[i].second);
+        const double d(
+                std::abs(a.x - b.x) +
+                std::abs(a.y - b.y) +
+                std::abs(a.z - b.z));
+        ASSERT_EQ(d, 1.0) << a << " -> " << b;
+    }
+}
+
+TEST(nodeOrder, roundTrip)
+{
+    // Zstandard data is stored absolute, so positions read back exactly as
+    // they were sorted.  LAZ stores scaled positions, which may land on the
+    // other side of a curve cell boundary once rounded.
+    const std::vector<std::pair<std::string, std::string>> cases {
+        { "laszip", "hilbert" },
+        { "zstandard", "hilbert" },
+        { "zstandard", "morton" }
+    };
+
+    const Schema xyz(DimList {
+        { DimId::X, DimType::Double },
+        { DimId::Y, DimType::Double },
+        { DimId::Z, DimType::Double }
+    });
+
+    for (const auto& c : cases)
+    {
+        const std::string dataType(c.first);
+        const std::string order(c.second);
+        const bool absolute(dataType != "laszip");
+        const std::string out(
+                test::dataPath() + "out/node-order/" +
+                dataType + "-" + order + "/");
+
+        {
+            Config config(json {
+                { "input", test::dataPath() + "ellipsoid.laz" },
+                { "output", out },
+                { "force", true },
+                { "span", v.span() },
+                { "hierarchyStep", v.hierarchyStep() },
+                { "dataType", dataType },
+                { "nodeOrder", order },
+                { "absolute", absolute },
+                { "progressInterval", 0 }
+            });
+
+            Builder(config).go();
+        }
+
+        Reader r(out);
+        auto q(r.read(json::object()));
+        q->run();
+
+        EXPECT_EQ(q->points(), v.points()) << dataType << " " << order;
+        if (!absolute) continue;
+
+        // Within every node, points are stored in curve order.
+        const Metadata& m(r.metadata());
+        const arbiter::Endpoint data(a.getEndpoint(out + "ept-data"));
+        const arbiter::Endpoint tmp(a.getEndpoint(test::dataPath() + "out"));
+
+        for (const Dxyz& dxyz : nodes(out))
+        {
+            const Bounds bounds(boundsOf(m, dxyz));
+
+            std::vector<uint64_t> codes;
+            VectorPointTable table(xyz);
+            table.setProcess([&]()
+            {
+                for (const auto& pr : table)
+                {
+                    const uint32_t x(quantize(
+                                pr.getFieldAs<double>(DimId::X),
+                                bounds.min().x,
+                                bounds.width()));
+                    const uint32_t y(quantize(
+                                pr.getFieldAs<double>(DimId::Y),
+                                bounds.min().y,
+                                bounds.depth()));
+                    const uint32_t z(quantize(
+                                pr.getFieldAs<double>(DimId::Z),
+                                bounds.min().z,
+                                bounds.height()));
+
+                    codes.push_back(order == "morton" ?
+                            mortonCode(x, y, z) :
+                            hilbertCode(x, y, z));
+                }
+            });
+
+            m.dataIo().read(data, tmp, dxyz.toString(), table);
+
+            ASSERT_FALSE(codes.empty()) << dxyz.toString();
+            ASSERT_TRUE(std::is_sorted(codes.begin(), codes.end())) <<
+                order << " order broken in " << dxyz.toString();
+        }
+    }
+}
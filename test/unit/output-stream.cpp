@@ -0,0 +1,139 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+
+#include <entwine/io/output-stream.hpp>
+#include <entwine/util/json.hpp>
+#include <entwine/util/unique.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const arbiter::Arbiter a;
+    const std::string out(test::dataPath() + "out/output-stream/");
+}
+
+TEST(outputStream, parts)
+{
+    const arbiter::Endpoint ep(a.getEndpoint(out));
+
+    std::vector<char> expected;
+    for (std::size_t i(0); i < 100000; ++i) expected.push_back(i * 7);
+
+    {
+        // Uneven writes spanning many small parts, flushed in parallel.
+        OutputStream stream(ep, "parts", 1000, 4);
+        std::size_t pos(0);
+        std::size_t size(1);
+        while (pos < expected.size())
+        {
+            const std::size_t n(std::min(size, expected.size() - pos));
+            stream.write(expected.data() + pos, n);
+            pos += n;
+            size = size * 3 % 4099;
+        }
+
+        EXPECT_EQ(stream.size(), expected.size());
+        stream.close();
+    }
+
+    EXPECT_EQ(ep.getBinary("parts"), expected);
+}
+
+TEST(outputStream, ostream)
+{
+    const arbiter::Endpoint ep(a.getEndpoint(out));
+
+    json j;
+    for (int i(0); i < 1000; ++i) j.push_back({ { "id", i } });
+
+    {
+        OutputStream stream(ep, "stream.json", 64);
+        std::ostream os(&stream);
+        os << std::setw(2) << j;
+        os.flush();
+        stream.close();
+    }
+
+    EXPECT_EQ(ep.get("stream.json"), j.dump(2));
+}
+
+TEST(outputStream, abandoned)
+{
+    const arbiter::Endpoint ep(a.getEndpoint(out));
+
+    {
+        OutputStream stream(ep, "abandoned", 4);
+        stream.write(std::vector<char>(100, 'x'));
+    }
+
+    EXPECT_FALSE(ep.tryGetSize("abandoned"));
+    EXPECT_FALSE(ep.tryGetSize("abandoned.partial"));
+}
+
+TEST(outputStream, singlePart)
+{
+    // Records how the output reaches it.
+    class Sink : public PartSink
+    {
+    public:
+        Sink(std::vector<char>& data, std::size_t& writes, std::size_t& parts)
+            : m_data(data)
+            , m_writes(writes)
+            , m_parts(parts)
+        { }
+
+        virtual void write(const std::vector<char>& data) override
+        {
+            ++m_writes;
+            m_data = data;
+        }
+
+        virtual void put(
+                uint64_t part,
+                uint64_t offset,
+                const std::vector<char>& data) override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_parts;
+            if (m_data.size() < offset + data.size())
+            {
+                m_data.resize(offset + data.size());
+            }
+            std::copy(data.begin(), data.end(), m_data.begin() + offset);
+        }
+
+        virtual void done(uint64_t size) override { m_data.resize(size); }
+
+    private:
+        std::vector<char>& m_data;
+        std::size_t& m_writes;
+        std::size_t& m_parts;
+        std::mutex m_mutex;
+    };
+
+    // Outputs of up to one part are written whole, and larger ones in parts.
+    for (const std::size_t size : { 0, 1, 100, 101, 1000 })
+    {
+        std::vector<char> expected(size);
+        for (std::size_t i(0); i < size; ++i) expected[i] = i * 3;
+
+        std::vector<char> data;
+        std::size_t writes(0);
+        std::size_t parts(0);
+
+        {
+            OutputStream stream(makeUnique<Sink>(data, writes, parts), 100);
+            stream.write(expected);
+            stream.close();
+        }
+
+        EXPECT_EQ(data, expected);
+        EXPECT_EQ(writes, size <= 100 ? 1u : 0u);
+        EXPECT_EQ(parts, size <= 100 ? 0u : (size + 99) / 100);
+    }
+}
@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+
+#include <entwine/builder/hierarchy.hpp>
+#include <entwine/builder/overflow-tuner.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const uint64_t span(16);
+    const uint64_t base(128);
+    const uint64_t nominal(span * span + base);
+}
+
+TEST(overflowTuner, fixed)
+{
+    OverflowTuner t(span, base, false);
+
+    Hierarchy h;
+    for (std::size_t i(0); i < 100; ++i)
+    {
+        t.overflowed(5, 10 * nominal);
+        t.written(5, nominal / 2, nominal / 2);
+        h.set(Dxyz(5, i, 0, 0), nominal / 2);
+    }
+
+    EXPECT_EQ(t.threshold(5), base);
+
+    t.tally(h);
+    const auto s(t.stats());
+    EXPECT_EQ(s.nodes, 100u);
+    EXPECT_EQ(s.reinserted, 1000 * nominal);
+    EXPECT_DOUBLE_EQ(s.meanSize, nominal / 2);
+    EXPECT_DOUBLE_EQ(s.variation, 0);
+}
+
+TEST(overflowTuner, saturated)
+{
+    OverflowTuner t(span, base, true);
+
+    // Most points arriving at depth 5 are pushed down again.
+    for (std::size_t i(0); i < 200; ++i)
+    {
+        t.overflowed(5, 2 * nominal);
+        t.written(5, nominal, nominal);
+    }
+
+    // Raised, until nodes outgrow their bound.
+    EXPECT_GT(t.threshold(5), base);
+    EXPECT_LE(t.threshold(5), base * 4);
+
+    // Other depths are unaffected.
+    EXPECT_EQ(t.threshold(6), base);
+}
+
+TEST(overflowTuner, oversized)
+{
+    OverflowTuner t(span, base, true);
+
+    for (std::size_t i(0); i < 200; ++i)
+    {
+        t.written(3, nominal * 4, nominal * 4);
+    }
+
+    EXPECT_LT(t.threshold(3), base);
+    EXPECT_GE(t.threshold(3), base / 2);
+}
+
+TEST(overflowTuner, settled)
+{
+    OverflowTuner t(span, base, true);
+
+    // Little churn and nominally sized nodes leave the threshold alone.
+    Hierarchy h;
+    for (std::size_t i(0); i < 200; ++i)
+    {
+        t.overflowed(4, nominal / 10);
+        t.written(4, nominal, nominal);
+        h.set(Dxyz(4, i, 0, 0), nominal);
+    }
+
+    EXPECT_EQ(t.threshold(4), base);
+
+    t.tally(h);
+    const auto s(t.stats());
+    EXPECT_EQ(s.maxSize, nominal);
+    EXPECT_NE(t.summary().find("4:128"), std::string::npos);
+}
+
+TEST(overflowTuner, reawakened)
+{
+    OverflowTuner t(span, base, true);
+
+    // A node written three times as it grows is a single node of its final
+    // size.
+    Hierarchy h;
+    t.written(2, nominal / 4, nominal / 4);
+    t.written(2, nominal / 2, nominal / 4);
+    t.written(2, nominal, nominal / 2);
+    h.set(Dxyz(2, 0, 0, 0), nominal);
+    t.tally(h);
+
+    auto s(t.stats());
+    EXPECT_EQ(s.nodes, 1u);
+    EXPECT_DOUBLE_EQ(s.meanSize, nominal);
+    EXPECT_EQ(s.maxSize, nominal);
+
+    // Tallying again replaces the previous tally.
+    h.set(Dxyz(2, 1, 0, 0), nominal / 2);
+    t.tally(h);
+    s = t.stats();
+    EXPECT_EQ(s.nodes, 2u);
+    EXPECT_DOUBLE_EQ(s.meanSize, nominal * 3 / 4.0);
+}
+
+TEST(overflowTuner, rewrites)
+{
+    OverflowTuner t(span, base, true);
+
+    // Rewrites of nodes which gain few points while most arriving points are
+    // pushed down are saturation, though the nodes hold many points in all.
+    for (std::size_t i(0); i < 200; ++i)
+    {
+        t.overflowed(6, nominal);
+        t.written(6, nominal, nominal / 10);
+    }
+
+    EXPECT_GT(t.threshold(6), base);
+}
@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
 #include "gtest/gtest.h"
 
 #include "config.hpp"
@@ -5,6 +11,8 @@
 
 #include <entwine/builder/builder.hpp>
 #include <entwine/reader/reader.hpp>
+#include <entwine/reader/registry.hpp>
+#include <entwine/reader/snapshot.hpp>
 
 namespace
 {
@@ -124,3 +132,286 @@ TEST(read, filter)
 {
 }
 
+
+TEST(read, fraction)
+{
+    const std::vector<std::string> dataTypes { "laszip", "binary", "columnar" };
+
+    std::vector<uint64_t> counts;
+
+    for (const std::string& dataType : dataTypes)
+    {
+        const std::string out(
+                test::dataPath() + "out/ellipsoid-fraction/" + dataType);
+
+        {
+            Config c(json {
+                { "input", test::dataPath() + "ellipsoid.laz" },
+                { "output", out },
+                { "force", true },
+                { "hierarchyStep", v.hierarchyStep() },
+                { "span", v.span() },
+                { "dataType", dataType },
+                { "nodeOrder", "morton" }
+            });
+
+            Builder b(c);
+            b.go();
+        }
+
+        Reader r(out);
+
+        auto run([&r](json j)
+        {
+            auto q(r.read(j));
+            q->run();
+            return q->points();
+        });
+
+        // Each node contributes the ceiling of its share, and at least one
+        // point.
+        const uint64_t quarter(run(json { { "fraction", 0.25 } }));
+        EXPECT_GE(quarter, v.points() / 4) << dataType;
+        EXPECT_LT(quarter, v.points() / 2) << dataType;
+
+        const uint64_t budget(run(json { { "points", v.points() / 10 } }));
+        EXPECT_GE(budget, v.points() / 10) << dataType;
+        EXPECT_LT(budget, v.points() / 4) << dataType;
+
+        // Under a curve order, a prefix of a node is a corner of it, so the
+        // thinned points must instead span nearly the whole root node.
+        const Schema schema(DimList { DimId::X, DimId::Y, DimId::Z });
+        auto extents([&](json j)
+        {
+            j["depth"] = 0;
+            j["schema"] = schema;
+            auto q(r.read(j));
+            q->run();
+
+            const std::vector<char>& data(q->data());
+            Point lo(std::numeric_limits<double>::max());
+            Point hi(std::numeric_limits<double>::lowest());
+            for (std::size_t i(0); i < data.size(); i += schema.pointSize())
+            {
+                Point p;
+                const char* pos(data.data() + i);
+                std::memcpy(&p.x, pos, sizeof(double));
+                std::memcpy(&p.y, pos + sizeof(double), sizeof(double));
+                std::memcpy(&p.z, pos + 2 * sizeof(double), sizeof(double));
+                lo = Point::min(lo, p);
+                hi = Point::max(hi, p);
+            }
+            return hi - lo;
+        });
+
+        const Point full(extents(json::object()));
+        const Point part(extents(json { { "fraction", 0.25 } }));
+        EXPECT_GT(part.x, full.x * 0.75) << dataType;
+        EXPECT_GT(part.y, full.y * 0.75) << dataType;
+        EXPECT_GT(part.z, full.z * 0.75) << dataType;
+
+        // A subsequent full read must not be limited by the partial chunks
+        // cached by the previous queries.
+        EXPECT_EQ(run(json::object()), v.points()) << dataType;
+        EXPECT_ANY_THROW(r.read(json { { "fraction", 0 } }));
+
+        counts.push_back(quarter);
+    }
+
+    // With the same node order, every data type reads the same points.
+    for (const uint64_t count : counts) EXPECT_EQ(count, counts.front());
+}
+
+TEST(read, registry)
+{
+    const std::string out(test::dataPath() + "out/ellipsoid/ellipsoid");
+
+    {
+        Config c(json {
+            { "input", test::dataPath() + "ellipsoid.laz" },
+            { "output", out },
+            { "force", true },
+            { "hierarchyStep", v.hierarchyStep() },
+            { "span", v.span() }
+        });
+
+        Builder b(c);
+        b.go();
+    }
+
+    ReaderRegistry::Options options;
+    options.perDataset = 2;
+    options.idle = std::chrono::seconds(0);
+    ReaderRegistry registry(options);
+
+    EXPECT_EQ(registry.open(), 0u);
+
+    {
+        // Concurrent leases of one dataset share a single reader.
+        auto a(registry.acquire(out));
+        auto b(registry.acquire(out));
+        EXPECT_EQ(&a.reader(), &b.reader());
+        EXPECT_EQ(registry.open(), 1u);
+
+        auto q(a.reader().read(json::object()));
+        q->run();
+        EXPECT_EQ(q->points(), v.points());
+        EXPECT_GT(registry.cache().size(), 0u);
+
+        // Leased datasets are never closed.
+        registry.sweep();
+        EXPECT_EQ(registry.open(), 1u);
+    }
+
+    EXPECT_ANY_THROW(registry.acquire(test::dataPath() + "out/nonexistent"));
+
+    // Once idle, the dataset is closed and its chunks are released.
+    registry.sweep();
+    EXPECT_EQ(registry.open(), 0u);
+    EXPECT_EQ(registry.cache().size(), 0u);
+}
+
+TEST(read, snapshot)
+{
+    const std::string out(test::dataPath() + "out/ellipsoid/ellipsoid");
+    const std::string path(out + "/" + Snapshot::filename);
+
+    {
+        Config c(json {
+            { "input", test::dataPath() + "ellipsoid.laz" },
+            { "output", out },
+            { "force", true },
+            { "hierarchyStep", v.hierarchyStep() },
+            { "span", v.span() }
+        });
+
+        Builder b(c);
+        b.go();
+    }
+
+    auto count([&out]()
+    {
+        Reader r(out);
+        EXPECT_EQ(r.metadata().span(), v.span());
+        EXPECT_TRUE(r.hierarchy().keys().empty());
+
+        auto q(r.count(json::object()));
+        q->run();
+        return q->points();
+    });
+
+    // The build writes a snapshot, from which the reader opens.
+    auto snapshot(Snapshot::map(path));
+    ASSERT_TRUE(snapshot);
+    EXPECT_GT(snapshot->size(), 0u);
+    EXPECT_EQ(
+            snapshot->meta().at("ept").at("points").get<uint64_t>(),
+            v.points());
+    EXPECT_EQ(count(), v.points());
+
+    // Without one, the reader falls back to the JSON hierarchy and writes a
+    // fresh snapshot for next time.
+    const uint64_t token(snapshot->token());
+    snapshot.reset();
+    ASSERT_EQ(std::remove(path.c_str()), 0);
+
+    {
+        Reader r(out);
+        EXPECT_FALSE(r.hierarchy().keys().empty());
+
+        auto q(r.count(json::object()));
+        q->run();
+        EXPECT_EQ(q->points(), v.points());
+    }
+
+    snapshot = Snapshot::map(path);
+    EXPECT_NE(snapshot->token(), token);
+    EXPECT_EQ(count(), v.points());
+
+    // Bytes following the metadata, such as a future section, are ignored.
+    snapshot.reset();
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file << "trailing";
+    }
+
+    snapshot = Snapshot::map(path);
+    ASSERT_TRUE(snapshot);
+    EXPECT_EQ(
+            snapshot->meta().at("ept").at("points").get<uint64_t>(),
+            v.points());
+}
+
+TEST(read, bundled)
+{
+    const Schema schema(DimList { DimId::X, DimId::Y, DimId::Z });
+
+    auto points([&schema](const Reader& r, json j) -> std::vector<Point>
+    {
+        j["schema"] = schema;
+        auto q(r.read(j));
+        q->run();
+
+        std::vector<Point> result;
+        const std::vector<char>& data(q->data());
+        for (std::size_t i(0); i < data.size(); i += schema.pointSize())
+        {
+            Point p;
+            const char* pos(data.data() + i);
+            std::memcpy(&p.x, pos, sizeof(double));
+            std::memcpy(&p.y, pos + sizeof(double), sizeof(double));
+            std::memcpy(&p.z, pos + 2 * sizeof(double), sizeof(double));
+            result.push_back(p);
+        }
+
+        std::sort(
+                result.begin(),
+                result.end(),
+                [](const Point& a, const Point& b) { return ltChained(a, b); });
+        return result;
+    });
+
+    for (const std::string dataType : { "laszip", "binary" })
+    {
+        std::vector<std::vector<Point>> results;
+
+        for (const uint64_t bundleDepth : { 0, 2 })
+        {
+            const std::string out(
+                    test::dataPath() + "out/ellipsoid-bundled/" + dataType +
+                    "-" + std::to_string(bundleDepth));
+
+            {
+                Config c(json {
+                    { "input", test::dataPath() + "ellipsoid.laz" },
+                    { "output", out },
+                    { "force", true },
+                    { "hierarchyStep", v.hierarchyStep() },
+                    { "span", v.span() },
+                    { "dataType", dataType },
+                    { "nodeOrder", "morton" },
+                    { "bundleDepth", bundleDepth }
+                });
+
+                Builder b(c);
+                b.go();
+            }
+
+            Reader r(out);
+            EXPECT_EQ(r.metadata().bundleDepth(), bundleDepth);
+            EXPECT_EQ(!!r.bundles(), bundleDepth > 0);
+
+            results.push_back(points(r, json::object()));
+            EXPECT_EQ(results.back().size(), v.points()) << dataType;
+
+            // Partial reads of bundled nodes take the same prefixes.
+            results.push_back(points(r, json { { "fraction", 0.25 } }));
+        }
+
+        ASSERT_EQ(results.size(), 4u);
+        EXPECT_EQ(results[0].size(), results[2].size()) << dataType;
+        EXPECT_TRUE(results[0] == results[2]) << dataType;
+        EXPECT_EQ(results[1].size(), results[3].size()) << dataType;
+        EXPECT_TRUE(results[1] == results[3]) << dataType;
+    }
+}
@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+
+#include <entwine/util/scratch.hpp>
+
+using namespace entwine;
+
+TEST(scratch, reuse)
+{
+    Scratch::clear();
+    Scratch::resetStats();
+
+    std::vector<char> a(Scratch::take(1000));
+    EXPECT_EQ(a.size(), 1000u);
+    const char* data(a.data());
+    Scratch::give(std::move(a));
+
+    // A smaller request reuses the same allocation.
+    std::vector<char> b(Scratch::take(500));
+    EXPECT_EQ(b.size(), 500u);
+    EXPECT_EQ(b.data(), data);
+
+    Scratch::Stats stats(Scratch::stats());
+    EXPECT_EQ(stats.taken, 2u);
+    EXPECT_EQ(stats.reused, 1u);
+    EXPECT_EQ(stats.peak, 1000u);
+    EXPECT_EQ(stats.pooled, 0u);
+    EXPECT_DOUBLE_EQ(stats.reuseRate(), 0.5);
+
+    Scratch::give(std::move(b));
+    EXPECT_GE(Scratch::stats().pooled, 1000u);
+
+    Scratch::clear();
+    EXPECT_EQ(Scratch::stats().pooled, 0u);
+}
+
+TEST(scratch, bestFit)
+{
+    Scratch::clear();
+
+    std::vector<std::vector<char>> buffers;
+    for (const std::size_t size : { 100, 10000, 1000 })
+    {
+        buffers.push_back(Scratch::take(size));
+    }
+
+    const char* mid(buffers[2].data());
+    for (auto& b : buffers) Scratch::give(std::move(b));
+
+    // The smallest buffer which fits is chosen.
+    std::vector<char> c(Scratch::take(900));
+    EXPECT_EQ(c.data(), mid);
+    Scratch::give(std::move(c));
+
+    // The pool is bounded.
+    for (std::size_t i(0); i < 16; ++i)
+    {
+        Scratch::give(std::vector<char>(1 + i));
+    }
+    EXPECT_LE(Scratch::stats().pooled, 4u * 10000u);
+
+    Scratch::clear();
+}
+
+TEST(scratch, threads)
+{
+    Scratch::clear();
+
+    std::vector<char> a(Scratch::take(1000));
+    Scratch::give(std::move(a));
+
+    // Pools are per-thread, and are released when their thread exits.
+    std::thread t([]()
+    {
+        std::vector<char> b(Scratch::take(1000));
+        EXPECT_EQ(Scratch::stats().pooled, 1000u);
+        Scratch::give(std::move(b));
+    });
+    t.join();
+
+    EXPECT_EQ(Scratch::stats().pooled, 1000u);
+    Scratch::clear();
+}
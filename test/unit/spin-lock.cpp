@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+#include <entwine/util/contention.hpp>
+#include <entwine/util/spin-lock.hpp>
+
+using namespace entwine;
+
+TEST(spinLock, exclusive)
+{
+    // Oversubscribe, so some holders are descheduled while others wait.
+    const std::size_t threads(std::thread::hardware_concurrency() * 4 + 2);
+    const std::size_t iterations(20000);
+
+    SpinLock spin("test-exclusive");
+    uint64_t total(0);
+
+    std::vector<std::thread> pool;
+    for (std::size_t t(0); t < threads; ++t)
+    {
+        pool.emplace_back([&]()
+        {
+            for (std::size_t i(0); i < iterations; ++i)
+            {
+                SpinGuard lock(spin);
+                ++total;
+            }
+        });
+    }
+
+    for (auto& t : pool) t.join();
+    EXPECT_EQ(total, threads * iterations);
+}
+
+TEST(spinLock, backoff)
+{
+    Backoff backoff;
+    for (std::size_t i(0); i < 10; ++i) backoff();
+    EXPECT_EQ(backoff.spins(), 10u);
+    EXPECT_EQ(backoff.yields(), 0u);
+
+    for (std::size_t i(0); i < 32; ++i) backoff();
+    EXPECT_EQ(backoff.yields(), 32u);
+    EXPECT_EQ(backoff.parks(), 0u);
+
+    backoff();
+    EXPECT_EQ(backoff.parks(), 1u);
+}
+
+TEST(spinLock, contention)
+{
+    // Sites are shared by name.
+    const std::size_t a(Contention::site("test-a"));
+    const std::string name("test-a");
+    EXPECT_EQ(Contention::site(name.c_str()), a);
+    EXPECT_NE(Contention::site("test-b"), a);
+
+    Contention::reset();
+
+    std::thread([a]()
+    {
+        Contention::acquired(a, false, 0);
+        Contention::released(a, 100);
+    }).join();
+
+    Contention::acquired(a, true, 1000, 3, 2, 1);
+    Contention::released(a, 300);
+
+    Contention::Stats stats;
+    for (const auto& s : Contention::stats())
+    {
+        if (s.name == "test-a") stats = s;
+    }
+
+    EXPECT_EQ(stats.acquisitions, 2u);
+    EXPECT_EQ(stats.contended, 1u);
+    EXPECT_EQ(stats.wait, 1000u);
+    EXPECT_EQ(stats.spins, 3u);
+    EXPECT_EQ(stats.yields, 2u);
+    EXPECT_EQ(stats.parks, 1u);
+    EXPECT_EQ(stats.hold, 400u);
+    EXPECT_EQ(stats.maxHold, 300u);
+
+    EXPECT_NE(Contention::report().find("test-a"), std::string::npos);
+
+    Contention::reset();
+    for (const auto& s : Contention::stats()) EXPECT_NE(s.name, "test-a");
+}
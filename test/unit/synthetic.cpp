@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+#include "verify.hpp"
+
+#include <algorithm>
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/builder/scan.hpp>
+#include <entwine/builder/synthetic.hpp>
+#include <entwine/types/vector-point-table.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const arbiter::Arbiter a;
+    const Verify v;
+
+    const std::vector<std::string> distributions {
+        "uniform", "urban", "terrain", "pathological"
+    };
+
+    // All points of the given range, in the absolute schema of the source.
+    std::vector<char> generate(
+            const Synthetic& s,
+            uint64_t begin = 0,
+            uint64_t end = 0)
+    {
+        VectorPointTable table(Schema::makeAbsolute(s.schema()), 1000);
+
+        std::vector<char> result;
+        table.setProcess([&table, &result]()
+        {
+            const auto& data(table.data());
+            result.insert(
+                    result.end(),
+                    data.begin(),
+                    data.begin() + table.numPoints() * table.pointSize());
+        });
+
+        s.run(table, begin, end);
+        return result;
+    }
+}
+
+TEST(synthetic, path)
+{
+    const Synthetic s(Synthetic::fromPath(
+                "synthetic://urban?points=1234&seed=7&dims=Intensity"));
+
+    EXPECT_EQ(s.distribution(), Synthetic::Distribution::Urban);
+    EXPECT_EQ(s.points(), 1234u);
+    EXPECT_EQ(s.seed(), 7u);
+    EXPECT_EQ(s.schema().pointSize(), 14u);
+
+    const Synthetic copy(Synthetic::fromPath(s.path()));
+    EXPECT_EQ(copy.path(), s.path());
+    EXPECT_EQ(copy.toJson(), s.toJson());
+
+    EXPECT_TRUE(Synthetic::isSynthetic(s.path()));
+    EXPECT_FALSE(Synthetic::isSynthetic("file.laz"));
+
+    EXPECT_ANY_THROW(Synthetic::fromPath("synthetic://nothing"));
+    EXPECT_ANY_THROW(Synthetic::fromPath("synthetic://uniform?size=1"));
+    EXPECT_ANY_THROW(Synthetic::fromPath("synthetic://uniform?dims=Nope"));
+    EXPECT_ANY_THROW(
+            Synthetic::fromPath("synthetic://uniform?bounds=0,0,0,0,1,1"));
+}
+
+TEST(synthetic, deterministic)
+{
+    for (const std::string& d : distributions)
+    {
+        const json j { { "distribution", d }, { "points", 5000 } };
+        const Synthetic s(j);
+
+        const std::vector<char> all(generate(s));
+        ASSERT_EQ(all.size(), 5000 * s.schema().pointSize()) << d;
+        EXPECT_EQ(generate(Synthetic(j)), all) << d;
+
+        // Any range matches the corresponding part of the whole.
+        const std::vector<char> part(generate(s, 1234, 3456));
+        const std::size_t ps(s.schema().pointSize());
+        ASSERT_EQ(part.size(), (3456 - 1234) * ps);
+        EXPECT_TRUE(
+                std::equal(part.begin(), part.end(), all.data() + 1234 * ps))
+            << d;
+
+        json other(j);
+        other["seed"] = 1;
+        EXPECT_NE(generate(Synthetic(other)), all) << d;
+    }
+}
+
+TEST(synthetic, bounds)
+{
+    const Bounds bounds(-50, 100, 10, 150, 200, 20);
+
+    for (const std::string& d : distributions)
+    {
+        const Synthetic s(json {
+            { "distribution", d },
+            { "points", 5000 },
+            { "bounds", bounds }
+        });
+
+        VectorPointTable table(Schema::makeAbsolute(s.schema()), 1000);
+        uint64_t np(0);
+        table.setProcess([&]()
+        {
+            for (auto it(table.begin()); it != table.end(); ++it)
+            {
+                const Point p(
+                        it.pointRef().getFieldAs<double>(DimId::X),
+                        it.pointRef().getFieldAs<double>(DimId::Y),
+                        it.pointRef().getFieldAs<double>(DimId::Z));
+
+                ASSERT_TRUE(bounds.growBy(1e-9).contains(p)) << d << " " << p;
+                ++np;
+            }
+        });
+
+        s.run(table);
+        EXPECT_EQ(np, 5000u) << d;
+    }
+}
+
+TEST(synthetic, build)
+{
+    const std::string out(test::dataPath() + "out/synthetic/");
+    const std::string path("synthetic://urban?points=20000&seed=3");
+
+    const Config scanned(Scan(json { { "input", path } }).go());
+    EXPECT_EQ(scanned.points(), 20000u);
+    EXPECT_EQ(scanned.bounds(), Synthetic::fromPath(path).bounds());
+
+    Builder(Config(json {
+        { "input", path },
+        { "output", out },
+        { "force", true },
+        { "span", v.span() },
+        { "hierarchyStep", v.hierarchyStep() }
+    })).go();
+
+    const auto info(json::parse(a.get(out + "ept.json")));
+    EXPECT_EQ(info.at("points").get<uint64_t>(), 20000u);
+
+    const Schema schema(info.at("schema"));
+    EXPECT_TRUE(schema.contains(DimId::Classification));
+    EXPECT_TRUE(schema.contains(DimId::GpsTime));
+}
@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+
+#include <set>
+#include <thread>
+
+#include <entwine/util/trace.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    // Spans are used directly here, rather than by ENTWINE_TRACE_SPAN, so
+    // these run whether or not the macro is compiled in.
+    void work(std::size_t n)
+    {
+        for (std::size_t i(0); i < n; ++i)
+        {
+            Trace::Span outer("outer", "test");
+            Trace::Span inner("inner", "test");
+        }
+    }
+
+    std::size_t count(const json& trace, const std::string ph)
+    {
+        std::size_t n(0);
+        for (const json& e : trace.at("traceEvents"))
+        {
+            if (e.at("ph").get<std::string>() == ph) ++n;
+        }
+        return n;
+    }
+}
+
+TEST(trace, inactive)
+{
+    Trace::start();
+    Trace::stop();
+
+    work(10);
+    const json trace(Trace::toJson());
+    EXPECT_EQ(count(trace, "X"), 0u);
+    EXPECT_EQ(trace.at("otherData").at("dropped").get<uint64_t>(), 0u);
+}
+
+TEST(trace, record)
+{
+    Trace::start();
+    Trace::name("main");
+    work(10);
+    Trace::stop();
+
+    const json trace(Trace::toJson());
+    EXPECT_EQ(count(trace, "X"), 20u);
+    EXPECT_EQ(count(trace, "M"), 1u);
+
+    for (const json& e : trace.at("traceEvents"))
+    {
+        if (e.at("ph").get<std::string>() == "M")
+        {
+            EXPECT_EQ(e.at("args").at("name").get<std::string>(), "main");
+            continue;
+        }
+
+        EXPECT_EQ(e.at("cat").get<std::string>(), "test");
+        EXPECT_GE(e.at("ts").get<double>(), 0);
+        EXPECT_GE(e.at("dur").get<double>(), 0);
+    }
+
+    // Inner spans close first, and each lies within its outer span.
+    const json& events(trace.at("traceEvents"));
+    const json& inner(events.at(1));
+    const json& outer(events.at(2));
+    EXPECT_EQ(inner.at("name").get<std::string>(), "inner");
+    EXPECT_EQ(outer.at("name").get<std::string>(), "outer");
+    EXPECT_LE(outer.at("ts").get<double>(), inner.at("ts").get<double>());
+    EXPECT_GE(
+            outer.at("ts").get<double>() + outer.at("dur").get<double>(),
+            inner.at("ts").get<double>() + inner.at("dur").get<double>());
+}
+
+TEST(trace, bounded)
+{
+    Trace::start(8);
+
+    std::vector<std::thread> threads;
+    for (std::size_t i(0); i < 4; ++i) threads.emplace_back([]() { work(50); });
+    for (auto& t : threads) t.join();
+
+    Trace::stop();
+
+    // Each thread keeps its most recent spans, and counts what it dropped.
+    const json trace(Trace::toJson());
+    EXPECT_EQ(count(trace, "X"), 4u * 8u);
+    EXPECT_EQ(trace.at("otherData").at("dropped").get<uint64_t>(), 4u * 92u);
+
+    std::set<uint64_t> tids;
+    for (const json& e : trace.at("traceEvents"))
+    {
+        tids.insert(e.at("tid").get<uint64_t>());
+    }
+    EXPECT_EQ(tids.size(), 4u);
+
+    // A restart discards everything.
+    Trace::start();
+    Trace::stop();
+    EXPECT_EQ(Trace::toJson().at("traceEvents").size(), 0u);
+}